@@ -284,12 +284,7 @@ static void _AELimiterDequeue(__unsafe_unretained AELimiter *THIS, float** buffe
 
 UInt32 AELimiterFillCount(__unsafe_unretained AELimiter *THIS, AudioTimeStamp *timestamp, UInt32 *trueFillCount) {
     if ( timestamp ) memset(timestamp, 0, sizeof(AudioTimeStamp));
-    int fillCount = 0;
-    AudioBufferList *bufferList = TPCircularBufferNextBufferList(&THIS->_buffer, timestamp);
-    while ( bufferList ) {
-        fillCount += bufferList->mBuffers[0].mDataByteSize / sizeof(float);
-        bufferList = TPCircularBufferNextBufferListAfter(&THIS->_buffer, bufferList, NULL);
-    }
+    int fillCount = TPCircularBufferPeek(&THIS->_buffer, timestamp, &THIS->_audioDescription);
     if ( trueFillCount ) *trueFillCount = fillCount;
     return MAX(0, fillCount - (int)THIS->_attack);
 }
@@ -35,6 +35,10 @@ extern "C" {
  * to be used as an AEAudioFilter.
  *
  * See the AELimiter documentation for descriptions of the parameters.
+ *
+ * The audio is delayed by @link attack @endlink frames, which the filter reports
+ * as its @link AEAudioFilter::filterLatency filterLatency @endlink, so the audio
+ * controller can compensate for it.
  */
 @interface AELimiterFilter : NSObject <AEAudioFilter>
 
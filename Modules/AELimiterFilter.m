@@ -30,8 +30,42 @@
 
 const int kScratchBufferLength = 8192;
 
+/*!
+ * Render state, swapped as a whole when the client format changes
+ */
+typedef struct {
+    __unsafe_unretained AEFloatConverter *floatConverter;
+    __unsafe_unretained AELimiter *limiter;
+    float **scratchBuffer;
+    int numberOfChannels;
+} limiter_state_t;
+
+static limiter_state_t *createState(AEFloatConverter *floatConverter, AELimiter *limiter, AudioStreamBasicDescription clientFormat) {
+    limiter_state_t *state = (limiter_state_t*)malloc(sizeof(limiter_state_t));
+    assert(state);
+    state->floatConverter = floatConverter;
+    state->limiter = limiter;
+    state->numberOfChannels = clientFormat.mChannelsPerFrame;
+    state->scratchBuffer = (float**)malloc(sizeof(float*) * clientFormat.mChannelsPerFrame);
+    assert(state->scratchBuffer);
+    for ( int i=0; i<clientFormat.mChannelsPerFrame; i++ ) {
+        state->scratchBuffer[i] = malloc(sizeof(float) * kScratchBufferLength);
+        assert(state->scratchBuffer[i]);
+    }
+    return state;
+}
+
+static void freeState(limiter_state_t *state) {
+    if ( !state ) return;
+    for ( int i=0; i<state->numberOfChannels; i++ ) {
+        free(state->scratchBuffer[i]);
+    }
+    free(state->scratchBuffer);
+    free(state);
+}
+
 @interface AELimiterFilter () {
-    float **_scratchBuffer;
+    limiter_state_t *_state;
 }
 @property (nonatomic, strong) AEFloatConverter *floatConverter;
 @property (nonatomic, strong) AELimiter *limiter;
@@ -56,49 +90,38 @@ const int kScratchBufferLength = 8192;
     _clientFormat = audioController.audioDescription;
     self.floatConverter = [[AEFloatConverter alloc] initWithSourceFormat:_clientFormat];
     self.limiter = [[AELimiter alloc] initWithNumberOfChannels:_clientFormat.mChannelsPerFrame sampleRate:_clientFormat.mSampleRate];
-    
-    _scratchBuffer = (float**)malloc(sizeof(float*) * _clientFormat.mChannelsPerFrame);
-    assert(_scratchBuffer);
-    for ( int i=0; i<_clientFormat.mChannelsPerFrame; i++ ) {
-        _scratchBuffer[i] = malloc(sizeof(float) * kScratchBufferLength);
-        assert(_scratchBuffer[i]);
-    }
+    _state = createState(_floatConverter, _limiter, _clientFormat);
 }
 
 - (void)teardown {
-    for ( int i=0; i<_clientFormat.mChannelsPerFrame; i++ ) {
-        free(_scratchBuffer[i]);
-    }
-    free(_scratchBuffer);
+    freeState(_state);
+    _state = NULL;
     self.audioController = nil;
 }
 
 -(void)setClientFormat:(AudioStreamBasicDescription)clientFormat {
     
     AEFloatConverter *floatConverter = [[AEFloatConverter alloc] initWithSourceFormat:clientFormat];
+    AELimiter *limiter = [[AELimiter alloc] initWithNumberOfChannels:clientFormat.mChannelsPerFrame sampleRate:clientFormat.mSampleRate];
+    limiter_state_t *state = createState(floatConverter, limiter, clientFormat);
     
-    float **scratchBuffer = (float**)malloc(sizeof(float*) * clientFormat.mChannelsPerFrame);
-    assert(scratchBuffer);
-    for ( int i=0; i<clientFormat.mChannelsPerFrame; i++ ) {
-        scratchBuffer[i] = malloc(sizeof(float) * kScratchBufferLength);
-        assert(scratchBuffer[i]);
-    }
+    // Swap in the new state with a single pointer store
+    limiter_state_t *oldState = _state;
+    AEFloatConverter *oldFloatConverter = _floatConverter;
+    AELimiter *oldLimiter = _limiter;
+    OSMemoryBarrier();
+    _state = state;
     
-    AELimiter *limiter = [[AELimiter alloc] initWithNumberOfChannels:clientFormat.mChannelsPerFrame sampleRate:clientFormat.mSampleRate];
-    float** oldScratchBuffer = _scratchBuffer;
-    AudioStreamBasicDescription oldClientFormat = _clientFormat;
+    _limiter = limiter;
+    _floatConverter = floatConverter;
+    _clientFormat = clientFormat;
     
-    [_audioController performSynchronousMessageExchangeWithBlock:^{
-        _limiter = limiter;
-        _floatConverter = floatConverter;
-        _scratchBuffer = scratchBuffer;
-        _clientFormat = clientFormat;
+    // Release the old state once the render thread is done with it; the block keeps the old objects alive until then
+    [_audioController.messageQueue releaseWhenSafeWithBlock:^{
+        freeState(oldState);
+        (void)oldFloatConverter;
+        (void)oldLimiter;
     }];
-    
-    for ( int i=0; i<oldClientFormat.mChannelsPerFrame; i++ ) {
-        free(oldScratchBuffer[i]);
-    }
-    free(oldScratchBuffer);
 }
 
 
@@ -134,6 +157,14 @@ const int kScratchBufferLength = 8192;
     return _limiter.level;
 }
 
+-(UInt32)filterLatency {
+    return _limiter.attack;
+}
+
++(NSSet *)keyPathsForValuesAffectingFilterLatency {
+    return [NSSet setWithObjects:@"attack", @"clientFormat", nil];
+}
+
 static OSStatus filterCallback(__unsafe_unretained AELimiterFilter *THIS,
                                __unsafe_unretained AEAudioController *audioController,
                                AEAudioFilterProducer producer,
@@ -147,17 +178,28 @@ static OSStatus filterCallback(__unsafe_unretained AELimiterFilter *THIS,
     OSStatus status = producer(producerToken, audio, &frames);
     if ( status != noErr ) return status;
     
+    limiter_state_t *state = THIS->_state;
+    
     // Copy buffer into floating point scratch buffer
-    AEFloatConverterToFloat(THIS->_floatConverter, audio, THIS->_scratchBuffer, frames);
+    AEFloatConverterToFloat(state->floatConverter, audio, state->scratchBuffer, frames);
+    
+    AELimiterEnqueue(state->limiter, state->scratchBuffer, frames, NULL);
     
-    AELimiterEnqueue(THIS->_limiter, THIS->_scratchBuffer, frames, NULL);
-    AELimiterDequeue(THIS->_limiter, THIS->_scratchBuffer, &frames, NULL);
+    UInt32 dequeued = frames;
+    AELimiterDequeue(state->limiter, state->scratchBuffer, &dequeued, NULL);
     
-    if ( frames > 0 ) {
-        // Convert back to buffer
-        AEFloatConverterFromFloat(THIS->_floatConverter, THIS->_scratchBuffer, audio, frames);
+    if ( dequeued < frames ) {
+        // Pad with silence while the look-ahead fills, so the delay is always the reported latency
+        UInt32 padding = frames - dequeued;
+        for ( int i=0; i<state->numberOfChannels; i++ ) {
+            memmove(state->scratchBuffer[i] + padding, state->scratchBuffer[i], dequeued * sizeof(float));
+            memset(state->scratchBuffer[i], 0, padding * sizeof(float));
+        }
     }
     
+    // Convert back to buffer
+    AEFloatConverterFromFloat(state->floatConverter, state->scratchBuffer, audio, frames);
+    
     return noErr;
 }
 
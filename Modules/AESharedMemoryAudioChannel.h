@@ -0,0 +1,77 @@
+//
+//  AESharedMemoryAudioChannel.h
+//  TheAmazingAudioEngine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#import <Foundation/Foundation.h>
+#import "TheAmazingAudioEngine.h"
+
+/*!
+ * Shared memory audio channel
+ *
+ *  This channel plays audio sent from another process by an AESharedMemoryAudioSender.
+ *  It attaches to the sender's shared memory buffer, and dequeues audio directly from it
+ *  on the realtime thread. To keep latency down, any audio queued beyond what's needed
+ *  for the current render cycle is skipped.
+ *
+ *  If the sending process hasn't created the buffer yet, call @link connect @endlink
+ *  later to try again. If the sending process restarts, create a new channel.
+ */
+@interface AESharedMemoryAudioChannel : NSObject <AEAudioPlayable>
+
+/*!
+ * Initialise
+ *
+ *  Attempts to attach to the shared memory buffer straight away.
+ *
+ * @param name The name given to the AESharedMemoryAudioSender in the other process
+ * @param audioDescription The format of the audio the sender receives
+ */
+- (id)initWithName:(NSString*)name audioDescription:(AudioStreamBasicDescription)audioDescription;
+
+/*!
+ * Attach to the shared memory buffer, if not already attached
+ *
+ *  Call this on the main thread.
+ *
+ * @return YES if attached
+ */
+- (BOOL)connect;
+
+/*!
+ * Whether the channel is attached to the sender's shared memory buffer
+ */
+@property (nonatomic, readonly) BOOL connected;
+
+@property (nonatomic, readonly) NSString *name;
+@property (nonatomic, assign) float volume;
+@property (nonatomic, assign) float pan;
+@property (nonatomic, assign) BOOL channelIsMuted;
+@property (nonatomic, readonly) AudioStreamBasicDescription audioDescription;
+@end
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,100 @@
+//
+//  AESharedMemoryAudioChannel.m
+//  TheAmazingAudioEngine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#import "AESharedMemoryAudioChannel.h"
+#import "TPCircularBuffer.h"
+#import "TPCircularBuffer+AudioBufferList.h"
+
+static const int kSkipThreshold = 2;
+
+@interface AESharedMemoryAudioChannel () {
+    TPCircularBuffer *_buffer;
+}
+@end
+
+@implementation AESharedMemoryAudioChannel
+@synthesize volume = _volume;
+
+- (id)initWithName:(NSString*)name audioDescription:(AudioStreamBasicDescription)audioDescription {
+    if ( !(self = [super init]) ) return nil;
+    _name = [name copy];
+    _audioDescription = audioDescription;
+    _volume = 1.0;
+    [self connect];
+    return self;
+}
+
+- (void)dealloc {
+    if ( _buffer ) {
+        TPCircularBufferCloseShared(_buffer);
+    }
+}
+
+- (BOOL)connect {
+    if ( _buffer ) return YES;
+    TPCircularBuffer *buffer = TPCircularBufferOpenShared([_name UTF8String]);
+    if ( !buffer ) return NO;
+    
+    [self willChangeValueForKey:@"connected"];
+    OSMemoryBarrier();
+    _buffer = buffer;
+    [self didChangeValueForKey:@"connected"];
+    return YES;
+}
+
+-(BOOL)connected {
+    return _buffer != NULL;
+}
+
+static OSStatus renderCallback(__unsafe_unretained AESharedMemoryAudioChannel *THIS,
+                               __unsafe_unretained AEAudioController *audioController,
+                               const AudioTimeStamp     *time,
+                               UInt32                    frames,
+                               AudioBufferList          *audio) {
+    TPCircularBuffer *buffer = THIS->_buffer;
+    if ( !buffer ) return noErr;
+    
+    while ( 1 ) {
+        // Discard any buffers with an incompatible format, in the event of a format change in the sender
+        AudioBufferList *nextBuffer = TPCircularBufferNextBufferList(buffer, NULL);
+        if ( !nextBuffer ) break;
+        if ( nextBuffer->mNumberBuffers == audio->mNumberBuffers ) break;
+        TPCircularBufferConsumeNextBufferList(buffer);
+    }
+    
+    UInt32 fillCount = TPCircularBufferPeek(buffer, NULL, &THIS->_audioDescription);
+    if ( fillCount > frames+kSkipThreshold ) {
+        UInt32 skip = fillCount - frames;
+        TPCircularBufferDequeueBufferListFrames(buffer, &skip, NULL, NULL, &THIS->_audioDescription);
+    }
+    
+    TPCircularBufferDequeueBufferListFrames(buffer, &frames, audio, NULL, &THIS->_audioDescription);
+    
+    return noErr;
+}
+
+-(AEAudioRenderCallback)renderCallback {
+    return renderCallback;
+}
+
+@end
@@ -0,0 +1,81 @@
+//
+//  AESharedMemoryAudioSender.h
+//  TheAmazingAudioEngine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#import <Foundation/Foundation.h>
+#import "TheAmazingAudioEngine.h"
+
+/*!
+ * Shared memory audio sender
+ *
+ *  This receiver queues the audio it receives on a circular buffer in named shared
+ *  memory, for an AESharedMemoryAudioChannel in another process to play. Add it as
+ *  an input or output receiver, or as a channel group's output receiver.
+ *
+ *  Audio is copied straight into the shared buffer on the realtime thread, without
+ *  locks or system calls, so the receiving process gets it within a render cycle.
+ *
+ *  Both processes should use the same audio format; set the channel's audio description
+ *  to match the audio this sender receives.
+ */
+@interface AESharedMemoryAudioSender : NSObject <AEAudioReceiver>
+
+/*!
+ * Initialise
+ *
+ *  Creates the shared memory buffer, replacing any existing buffer with the same name.
+ *
+ * @param name Shared memory name: a short string beginning with a slash, such as "/myapp.audio"
+ * @param bufferLength Buffer length in bytes, large enough to cover scheduling jitter in the receiving process
+ * @return The sender, or nil if the shared memory couldn't be created
+ */
+- (id)initWithName:(NSString*)name bufferLength:(int32_t)bufferLength;
+
+/*!
+ * Initialise, with a default buffer length
+ *
+ * @param name Shared memory name: a short string beginning with a slash, such as "/myapp.audio"
+ * @return The sender, or nil if the shared memory couldn't be created
+ */
+- (id)initWithName:(NSString*)name;
+
+/*!
+ * The shared memory name
+ */
+@property (nonatomic, readonly) NSString *name;
+
+/*!
+ * The number of times audio was dropped because the buffer was full
+ *
+ *  This happens if the receiving process isn't consuming audio quickly enough, or at all.
+ */
+@property (nonatomic, readonly) UInt32 overflowCount;
+
+@end
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,76 @@
+//
+//  AESharedMemoryAudioSender.m
+//  TheAmazingAudioEngine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#import "AESharedMemoryAudioSender.h"
+#import "TPCircularBuffer.h"
+#import "TPCircularBuffer+AudioBufferList.h"
+
+static const int32_t kDefaultBufferLength = 65536;
+
+@interface AESharedMemoryAudioSender () {
+    TPCircularBuffer *_buffer;
+    volatile int32_t _overflowCount;
+}
+@end
+
+@implementation AESharedMemoryAudioSender
+
+- (id)initWithName:(NSString*)name bufferLength:(int32_t)bufferLength {
+    if ( !(self = [super init]) ) return nil;
+    _buffer = TPCircularBufferCreateShared([name UTF8String], bufferLength);
+    if ( !_buffer ) return nil;
+    _name = [name copy];
+    return self;
+}
+
+- (id)initWithName:(NSString*)name {
+    return [self initWithName:name bufferLength:kDefaultBufferLength];
+}
+
+- (void)dealloc {
+    if ( _buffer ) {
+        TPCircularBufferUnlinkShared([_name UTF8String]);
+        TPCircularBufferCloseShared(_buffer);
+    }
+}
+
+-(UInt32)overflowCount {
+    return _overflowCount;
+}
+
+static void receiverCallback(__unsafe_unretained AESharedMemoryAudioSender *THIS,
+                             __unsafe_unretained AEAudioController *audioController,
+                             void                     *source,
+                             const AudioTimeStamp     *time,
+                             UInt32                    frames,
+                             AudioBufferList          *audio) {
+    if ( !TPCircularBufferCopyAudioBufferList(THIS->_buffer, audio, time, kTPCircularBufferCopyAll, NULL) ) {
+        OSAtomicIncrement32(&THIS->_overflowCount);
+    }
+}
+
+-(AEAudioReceiverCallback)receiverCallback {
+    return receiverCallback;
+}
+
+@end
@@ -35,6 +35,7 @@ extern "C" {
 #endif
 
 #include "TPCircularBuffer.h"
+#include "TPMultiProducerCircularBuffer.h"
 #include <AudioToolbox/AudioToolbox.h>
 
 #define kTPCircularBufferCopyAll UINT32_MAX
@@ -42,9 +43,28 @@ extern "C" {
 typedef struct {
     AudioTimeStamp timestamp;
     UInt32 totalLength;
+    UInt32 audioBytePosition;   // Running total of audio bytes (per buffer) queued before this block's first frame
+    UInt32 blockNumber;         // Sequence number of this block, used to look up the block index
+    UInt32 dataOffset;          // Offset of the first buffer's data from the start of the block
+    UInt32 dataStride;          // Distance between the start of each buffer's data
     AudioBufferList bufferList;
 } TPCircularBufferABLBlockHeader;
 
+/*!
+ * Point a queued block's buffers at its data
+ *
+ *  The buffer pointers are stored by the producer, which may have mapped the buffer
+ *  at a different address (see TPCircularBufferCreateShared), so the consumer
+ *  rebuilds them from the block's own address before use.
+ */
+static __inline__ __attribute__((always_inline)) AudioBufferList *_TPCircularBufferBlockBufferList(TPCircularBufferABLBlockHeader *block) {
+    char *data = (char*)block + block->dataOffset;
+    for ( UInt32 i=0; i<block->bufferList.mNumberBuffers; i++, data += block->dataStride ) {
+        block->bufferList.mBuffers[i].mData = data;
+    }
+    return &block->bufferList;
+}
+
     
 /*!
  * Prepare an empty buffer list, stored on the circular buffer
@@ -83,6 +103,9 @@ void TPCircularBufferProduceAudioBufferList(TPCircularBuffer *buffer, const Audi
 /*!
  * Copy the audio buffer list onto the buffer
  *
+ *  If overwrite-oldest is enabled with TPCircularBufferSetOverwriteOldest, this discards
+ *  the oldest queued buffer lists to make room, counting each as an overrun.
+ *
  * @param buffer            Circular buffer
  * @param bufferList        Buffer list containing audio to copy to buffer
  * @param timestamp         The timestamp associated with the buffer, or NULL
@@ -92,6 +115,62 @@ void TPCircularBufferProduceAudioBufferList(TPCircularBuffer *buffer, const Audi
  */
 bool TPCircularBufferCopyAudioBufferList(TPCircularBuffer *buffer, const AudioBufferList *bufferList, const AudioTimeStamp *timestamp, UInt32 frames, const AudioStreamBasicDescription *audioFormat);
 
+/*!
+ * Prepare an empty buffer list on a multi-producer circular buffer
+ *
+ *  This may be called by any number of producer threads at once. Each prepared buffer
+ *  list must be passed to TPMultiProducerCircularBufferProduceAudioBufferList by the same
+ *  thread, promptly, as buffer lists prepared later by other threads won't become
+ *  visible to the consumer until it has been.
+ *
+ *  The consumer uses the usual TPCircularBuffer functions on the buffer's embedded
+ *  TPCircularBuffer (`&buffer->buffer`).
+ *
+ * @param buffer            Multi-producer circular buffer
+ * @param numberOfBuffers   The number of buffers to be contained within the buffer list
+ * @param bytesPerBuffer    The number of bytes to store for each buffer
+ * @param timestamp         The timestamp associated with the buffer, or NULL
+ * @return The empty buffer list, or NULL if circular buffer has insufficient space
+ */
+AudioBufferList *TPMultiProducerCircularBufferPrepareEmptyAudioBufferList(TPMultiProducerCircularBuffer *buffer, int numberOfBuffers, int bytesPerBuffer, const AudioTimeStamp *timestamp);
+
+/*!
+ * Prepare an empty buffer list on a multi-producer circular buffer, using an audio description to automatically configure buffer
+ *
+ * @param buffer            Multi-producer circular buffer
+ * @param audioFormat       The kind of audio that will be stored
+ * @param frameCount        The number of frames that will be stored
+ * @param timestamp         The timestamp associated with the buffer, or NULL
+ * @return The empty buffer list, or NULL if circular buffer has insufficient space
+ */
+AudioBufferList *TPMultiProducerCircularBufferPrepareEmptyAudioBufferListWithAudioFormat(TPMultiProducerCircularBuffer *buffer, const AudioStreamBasicDescription *audioFormat, UInt32 frameCount, const AudioTimeStamp *timestamp);
+
+/*!
+ * Mark a buffer list prepared on a multi-producer circular buffer as ready for reading
+ *
+ *  If other threads prepared buffer lists earlier and haven't produced them yet,
+ *  this waits for them.
+ *
+ * @param buffer            Multi-producer circular buffer
+ * @param bufferList        The buffer list returned by TPMultiProducerCircularBufferPrepareEmptyAudioBufferList
+ * @param timestamp         The timestamp associated with the buffer, or NULL to leave as-is
+ */
+void TPMultiProducerCircularBufferProduceAudioBufferList(TPMultiProducerCircularBuffer *buffer, AudioBufferList *bufferList, const AudioTimeStamp *timestamp);
+
+/*!
+ * Copy the audio buffer list onto a multi-producer circular buffer
+ *
+ *  This may be called by any number of producer threads at once.
+ *
+ * @param buffer            Multi-producer circular buffer
+ * @param bufferList        Buffer list containing audio to copy to buffer
+ * @param timestamp         The timestamp associated with the buffer, or NULL
+ * @param frames            Length of audio in frames. Specify kTPCircularBufferCopyAll to copy the whole buffer (audioFormat can be NULL, in this case)
+ * @param audioFormat       The AudioStreamBasicDescription describing the audio, or NULL if you specify kTPCircularBufferCopyAll to the `frames` argument
+ * @return YES if buffer list was successfully copied; NO if there was insufficient space
+ */
+bool TPMultiProducerCircularBufferCopyAudioBufferList(TPMultiProducerCircularBuffer *buffer, const AudioBufferList *bufferList, const AudioTimeStamp *timestamp, UInt32 frames, const AudioStreamBasicDescription *audioFormat);
+
 /*!
  * Get a pointer to the next stored buffer list
  *
@@ -111,7 +190,7 @@ static __inline__ __attribute__((always_inline)) AudioBufferList *TPCircularBuff
     if ( outTimestamp ) {
         memcpy(outTimestamp, &block->timestamp, sizeof(AudioTimeStamp));
     }
-    return &block->bufferList;
+    return _TPCircularBufferBlockBufferList(block);
 }
 
 /*!
@@ -158,16 +237,37 @@ void TPCircularBufferConsumeNextBufferListPartial(TPCircularBuffer *buffer, int
  *
  * @param buffer            Circular buffer
  * @param ioLengthInFrames  On input, the number of frames in the given audio format to consume; on output, the number of frames provided
- * @param outputBufferList  The buffer list to copy audio to, or NULL to discard audio. If not NULL, the structure must be initialised properly, and the mData pointers must not be NULL.
+ * @param outputBufferList  The buffer list to copy audio to, or NULL to discard audio. If not NULL, the structure must be initialised properly, and the mData pointers must not be NULL. Discarding audio doesn't visit each queued buffer list; the last one to keep is found by binary search.
  * @param outTimestamp      On output, if not NULL, the timestamp corresponding to the first audio frame returned
  * @param audioFormat       The format of the audio stored in the buffer
  */
 void TPCircularBufferDequeueBufferListFrames(TPCircularBuffer *buffer, UInt32 *ioLengthInFrames, AudioBufferList *outputBufferList, AudioTimeStamp *outTimestamp, const AudioStreamBasicDescription *audioFormat);
 
+/*!
+ * Consume all queued frames before the given sample time
+ *
+ *  Finds the queued buffer list containing the given sample time by binary search over
+ *  the queued timestamps, then consumes everything before that frame in one step,
+ *  including the first part of that buffer list. If the sample time falls between two
+ *  queued buffer lists, or after the last one, all buffer lists before it are consumed.
+ *
+ *  The queued timestamps must have valid, increasing sample times.
+ *
+ *  Note: This function should only be used on the consumer thread, not the producer thread.
+ *
+ * @param buffer            Circular buffer
+ * @param sampleTime        The sample time of the first frame to keep
+ * @param audioFormat       The format of the audio stored in the buffer
+ * @return The number of frames consumed
+ */
+UInt32 TPCircularBufferSeekToSampleTime(TPCircularBuffer *buffer, Float64 sampleTime, const AudioStreamBasicDescription *audioFormat);
+
 /*!
  * Determine how many frames of audio are buffered
  *
- *  Given the provided audio format, determines the frame count of all queued buffers
+ *  Given the provided audio format, determines the frame count of all queued buffers.
+ *  This is a constant-time operation: the producer keeps a running count of queued
+ *  audio, so the queue is not walked.
  *
  *  Note: This function should only be used on the consumer thread, not the producer thread.
  *
@@ -184,6 +284,12 @@ UInt32 TPCircularBufferPeek(TPCircularBuffer *buffer, AudioTimeStamp *outTimesta
  *  Given the provided audio format, determines the frame count of all queued buffers that are contiguous,
  *  given their corresponding timestamps (sample time).
  *
+ *  This is a constant-time operation when the producer has seen no discontinuity since the
+ *  first queued frame. Otherwise, queued buffers are walked up to the first discontinuity that
+ *  exceeds the tolerance. The producer can only detect discontinuities if it knows the audio
+ *  format, so use TPCircularBufferPrepareEmptyAudioBufferListWithAudioFormat, or pass the
+ *  audio format to TPCircularBufferCopyAudioBufferList, to benefit from this.
+ *
  *  Note: This function should only be used on the consumer thread, not the producer thread.
  *
  * @param buffer            Circular buffer
@@ -27,10 +27,53 @@
 //  3. This notice may not be removed or altered from any source distribution.
 //
 
+#if !defined(__APPLE__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "TPCircularBuffer.h"
-#include <mach/mach.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+static uint32_t blockEndsCapacity(int32_t length) {
+    // Index of block end positions for the AudioBufferList utilities; sized for the most blocks the buffer can hold
+    return length / kTPCircularBufferMinimumBlockLength + 2;
+}
+
+static bool initBufferState(TPCircularBuffer *buffer, void *address, int32_t *blockEnds) {
+    buffer->blockEndsCapacity = blockEndsCapacity(buffer->length);
+    if ( !blockEnds ) {
+        blockEnds = (int32_t*)calloc(buffer->blockEndsCapacity, sizeof(int32_t));
+        if ( !blockEnds ) {
+            printf("Couldn't allocate block index\n");
+            return false;
+        }
+    }
+    
+    buffer->bufferOffset = (intptr_t)address - (intptr_t)buffer;
+    buffer->blockEndsOffset = (intptr_t)blockEnds - (intptr_t)buffer;
+    buffer->sharedHeaderLength = 0;
+    buffer->sharedMagic = 0;
+    buffer->head = buffer->tail = 0;
+    buffer->cachedHead = buffer->cachedTail = 0;
+    buffer->audioBytesProduced = buffer->audioBytesAtDiscontinuity = 0;
+    buffer->audioBytesPerFrame = 0;
+    buffer->nextSampleTime = 0;
+    buffer->blocksProduced = 0;
+    buffer->overruns = 0;
+    buffer->atomic = true;
+    buffer->overwriteOldest = false;
+    return true;
+}
+
+#ifdef __APPLE__
+
+#include <mach/mach.h>
 
 #define reportResult(result,operation) (_reportResult((result),(operation),strrchr(__FILE__, '/')+1,__LINE__))
 static inline bool _reportResult(kern_return_t result, const char *operation, const char* file, int line) {
@@ -43,7 +86,7 @@ static inline bool _reportResult(kern_return_t result, const char *operation, co
 
 bool _TPCircularBufferInit(TPCircularBuffer *buffer, int32_t length, size_t structSize) {
     
-    assert(length > 0);
+    assert(length > 0 && length <= INT32_MAX / 4);
     
     if ( structSize != sizeof(TPCircularBuffer) ) {
         fprintf(stderr, "TPCircularBuffer: Header version mismatch. Check for old versions of TPCircularBuffer in your project\n");
@@ -122,10 +165,10 @@ bool _TPCircularBufferInit(TPCircularBuffer *buffer, int32_t length, size_t stru
             continue;
         }
         
-        buffer->buffer = (void*)bufferAddress;
-        buffer->fillCount = 0;
-        buffer->head = buffer->tail = 0;
-        buffer->atomic = true;
+        if ( !initBufferState(buffer, (void*)bufferAddress, NULL) ) {
+            vm_deallocate(mach_task_self(), bufferAddress, buffer->length * 2);
+            return false;
+        }
         
         return true;
     }
@@ -133,10 +176,242 @@ bool _TPCircularBufferInit(TPCircularBuffer *buffer, int32_t length, size_t stru
 }
 
 void TPCircularBufferCleanup(TPCircularBuffer *buffer) {
-    vm_deallocate(mach_task_self(), (vm_address_t)buffer->buffer, buffer->length * 2);
+    assert(!buffer->sharedHeaderLength /* Use TPCircularBufferCloseShared */);
+    vm_deallocate(mach_task_self(), (vm_address_t)_TPCircularBufferPointer(buffer, 0), buffer->length * 2);
+    free(_TPCircularBufferBlockEnds(buffer));
     memset(buffer, 0, sizeof(TPCircularBuffer));
 }
 
+#else
+
+#define reportResult(operation) (_reportResult((operation),strrchr(__FILE__, '/')+1,__LINE__))
+static inline void _reportResult(const char *operation, const char* file, int line) {
+    printf("%s:%d: %s: %s\n", file, line, operation, strerror(errno));
+}
+
+static int createSharedMemoryObject(size_t length) {
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+    int fd = memfd_create("TPCircularBuffer", MFD_CLOEXEC);
+#else
+    // No memfd: use a uniquely-named POSIX shared memory object, unlinked straight away
+    char name[64];
+    static volatile int32_t counter = 0;
+    snprintf(name, sizeof(name), "/TPCircularBuffer.%d.%d", (int)getpid(), (int)OSAtomicAdd32Barrier(1, &counter));
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if ( fd != -1 ) {
+        shm_unlink(name);
+    }
+#endif
+    if ( fd == -1 ) return -1;
+    
+    if ( ftruncate(fd, (off_t)length) != 0 ) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    
+    return fd;
+}
+
+bool _TPCircularBufferInit(TPCircularBuffer *buffer, int32_t length, size_t structSize) {
+    
+    assert(length > 0 && length <= INT32_MAX / 4);
+    
+    if ( structSize != sizeof(TPCircularBuffer) ) {
+        fprintf(stderr, "TPCircularBuffer: Header version mismatch. Check for old versions of TPCircularBuffer in your project\n");
+        abort();
+    }
+    
+    // We need whole page sizes
+    long pageSize = sysconf(_SC_PAGESIZE);
+    buffer->length = (int32_t)(((length + pageSize - 1) / pageSize) * pageSize);
+    
+    // Keep trying until we get our buffer, needed to handle transient failures
+    int retries = 3;
+    while ( true ) {
+        
+        int fd = createSharedMemoryObject(buffer->length);
+        if ( fd == -1 ) {
+            if ( retries-- == 0 ) {
+                reportResult("Shared memory allocation");
+                return false;
+            }
+            continue;
+        }
+        
+        // Reserve twice the length, so we have the contiguous address space to support a second
+        // instance of the buffer directly after. Nothing else can be mapped into this range while we hold it.
+        void *bufferAddress = mmap(NULL, buffer->length * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if ( bufferAddress == MAP_FAILED ) {
+            close(fd);
+            if ( retries-- == 0 ) {
+                reportResult("Buffer allocation");
+                return false;
+            }
+            continue;
+        }
+        
+        // Map the shared memory object over both halves of the reservation
+        void *firstAddress = mmap(bufferAddress, buffer->length, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_FIXED, fd, 0);
+        void *virtualAddress = firstAddress == MAP_FAILED ? MAP_FAILED
+                             : mmap((char*)bufferAddress + buffer->length, buffer->length, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_FIXED, fd, 0);
+        
+        // The mappings keep the memory alive; we don't need the descriptor any more
+        close(fd);
+        
+        if ( firstAddress != bufferAddress || virtualAddress != (char*)bufferAddress + buffer->length ) {
+            munmap(bufferAddress, buffer->length * 2);
+            if ( retries-- == 0 ) {
+                reportResult("Remap buffer memory");
+                return false;
+            }
+            continue;
+        }
+        
+        if ( !initBufferState(buffer, bufferAddress, NULL) ) {
+            munmap(bufferAddress, buffer->length * 2);
+            return false;
+        }
+        
+        return true;
+    }
+    return false;
+}
+
+void TPCircularBufferCleanup(TPCircularBuffer *buffer) {
+    assert(!buffer->sharedHeaderLength /* Use TPCircularBufferCloseShared */);
+    munmap(_TPCircularBufferPointer(buffer, 0), buffer->length * 2);
+    free(_TPCircularBufferBlockEnds(buffer));
+    memset(buffer, 0, sizeof(TPCircularBuffer));
+}
+
+#endif
+
+#define kSharedMagic 0x54504342 // 'TPCB'
+
+static void reportSharedError(const char *operation, const char *name) {
+    printf("TPCircularBuffer: %s %s: %s\n", operation, name, strerror(errno));
+}
+
+// The block index follows the structure, on its own cache line
+#define kSharedBlockEndsOffset ((sizeof(TPCircularBuffer) + kTPCircularBufferCacheLineSize - 1) & ~(kTPCircularBufferCacheLineSize - 1))
+
+static uint32_t sharedHeaderLength(int32_t length) {
+    // The structure and block index, padded to a whole page so the buffer itself can be mapped twice
+    long pageSize = sysconf(_SC_PAGESIZE);
+    size_t headerLength = kSharedBlockEndsOffset + blockEndsCapacity(length) * sizeof(int32_t);
+    return (uint32_t)(((headerLength + pageSize - 1) / pageSize) * pageSize);
+}
+
+static TPCircularBuffer *mapSharedBuffer(int fd, int32_t length, uint32_t headerLength) {
+    // Reserve the address space, then map the header and buffer, followed by a second instance of the buffer
+    size_t mappingLength = headerLength + (size_t)length * 2;
+    char *address = (char*)mmap(NULL, mappingLength, PROT_NONE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if ( address == MAP_FAILED ) return NULL;
+    
+    if ( mmap(address, headerLength + length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != address
+            || mmap(address + headerLength + length, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, headerLength)
+                != address + headerLength + length ) {
+        munmap(address, mappingLength);
+        return NULL;
+    }
+    
+    return (TPCircularBuffer*)address;
+}
+
+TPCircularBuffer *TPCircularBufferCreateShared(const char *name, int32_t length) {
+    
+    assert(length > 0 && length <= INT32_MAX / 4);
+    
+    // We need whole page sizes
+    long pageSize = sysconf(_SC_PAGESIZE);
+    length = (int32_t)(((length + pageSize - 1) / pageSize) * pageSize);
+    uint32_t headerLength = sharedHeaderLength(length);
+    
+    // Replace any object left behind by an earlier run
+    shm_unlink(name);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if ( fd == -1 ) {
+        reportSharedError("Create shared memory", name);
+        return NULL;
+    }
+    
+    if ( ftruncate(fd, (off_t)headerLength + length) != 0 ) {
+        reportSharedError("Size shared memory", name);
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    
+    TPCircularBuffer *buffer = mapSharedBuffer(fd, length, headerLength);
+    if ( !buffer ) {
+        reportSharedError("Map shared memory", name);
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    close(fd);
+    
+    // The object starts zeroed, so the block index is already cleared
+    buffer->length = length;
+    initBufferState(buffer, (char*)buffer + headerLength, (int32_t*)((char*)buffer + kSharedBlockEndsOffset));
+    buffer->sharedHeaderLength = headerLength;
+    
+    // Let other processes attach
+    __atomic_store_n(&buffer->sharedMagic, kSharedMagic, __ATOMIC_RELEASE);
+    
+    return buffer;
+}
+
+TPCircularBuffer *TPCircularBufferOpenShared(const char *name) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if ( fd == -1 ) {
+        if ( errno != ENOENT ) reportSharedError("Open shared memory", name);
+        return NULL;
+    }
+    
+    // Read the header to find the layout, once the creator has finished setting it up
+    struct stat info;
+    if ( fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(TPCircularBuffer) ) {
+        close(fd);
+        return NULL;
+    }
+    TPCircularBuffer *header = (TPCircularBuffer*)mmap(NULL, sizeof(TPCircularBuffer), PROT_READ, MAP_SHARED, fd, 0);
+    if ( header == MAP_FAILED ) {
+        reportSharedError("Map shared memory", name);
+        close(fd);
+        return NULL;
+    }
+    bool ready = __atomic_load_n(&header->sharedMagic, __ATOMIC_ACQUIRE) == kSharedMagic;
+    int32_t length = header->length;
+    uint32_t headerLength = header->sharedHeaderLength;
+    munmap(header, sizeof(TPCircularBuffer));
+    
+    if ( !ready || headerLength != sharedHeaderLength(length) || info.st_size != (off_t)headerLength + length ) {
+        close(fd);
+        return NULL;
+    }
+    
+    TPCircularBuffer *buffer = mapSharedBuffer(fd, length, headerLength);
+    if ( !buffer ) {
+        reportSharedError("Map shared memory", name);
+    }
+    close(fd);
+    return buffer;
+}
+
+void TPCircularBufferCloseShared(TPCircularBuffer *buffer) {
+    assert(buffer->sharedHeaderLength /* Use TPCircularBufferCleanup */);
+    munmap(buffer, buffer->sharedHeaderLength + (size_t)buffer->length * 2);
+}
+
+bool TPCircularBufferUnlinkShared(const char *name) {
+    return shm_unlink(name) == 0;
+}
+
 void TPCircularBufferClear(TPCircularBuffer *buffer) {
     int32_t fillCount;
     if ( TPCircularBufferTail(buffer, &fillCount) ) {
@@ -147,3 +422,33 @@ void TPCircularBufferClear(TPCircularBuffer *buffer) {
 void  TPCircularBufferSetAtomic(TPCircularBuffer *buffer, bool atomic) {
     buffer->atomic = atomic;
 }
+
+void  TPCircularBufferSetOverwriteOldest(TPCircularBuffer *buffer, bool overwriteOldest) {
+    buffer->overwriteOldest = overwriteOldest;
+}
+
+uint32_t TPCircularBufferGetOverrunCount(TPCircularBuffer *buffer) {
+    return __atomic_load_n(&buffer->overruns, __ATOMIC_RELAXED);
+}
+
+int32_t _TPCircularBufferClaimTail(TPCircularBuffer *buffer) {
+    int32_t tail = __atomic_load_n(&buffer->tail, __ATOMIC_ACQUIRE);
+    while ( !(tail & kTPCircularBufferTailClaimed) ) {
+        if ( __atomic_compare_exchange_n(&buffer->tail, &tail, tail | kTPCircularBufferTailClaimed, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ) {
+            break;
+        }
+    }
+    return tail & ~kTPCircularBufferTailClaimed;
+}
+
+void _TPCircularBufferReleaseTail(TPCircularBuffer *buffer) {
+    if ( !buffer->overwriteOldest ) return;
+    __atomic_fetch_and(&buffer->tail, ~kTPCircularBufferTailClaimed, __ATOMIC_RELEASE);
+}
+
+void _TPCircularBufferConsumeClaimed(TPCircularBuffer *buffer, int32_t amount) {
+    // Once claimed, the producer won't move the tail, so we can store the new, unclaimed value directly
+    int32_t tail = _TPCircularBufferClaimTail(buffer);
+    assert(amount >= 0 && amount <= _TPCircularBufferDistance(buffer, tail, _TPCircularBufferLoadIndex(buffer, &buffer->head)));
+    __atomic_store_n(&buffer->tail, _TPCircularBufferAdvanceIndex(buffer, tail, amount), __ATOMIC_RELEASE);
+}
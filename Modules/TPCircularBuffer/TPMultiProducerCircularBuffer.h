@@ -0,0 +1,130 @@
+//
+//  TPMultiProducerCircularBuffer.h
+//  Circular/Ring buffer implementation
+//
+//  https://github.com/michaeltyson/TPCircularBuffer
+//
+//  A variant of TPCircularBuffer that can be fed by any number of producer threads, and
+//  drained by a single consumer. Producers reserve space with a compare-and-swap on a shared
+//  reservation index, fill it in place, and then commit it. Commits are published in
+//  reservation order, so the consumer sees exactly the same layout as a TPCircularBuffer
+//  and uses the ordinary TPCircularBuffer (and TPCircularBuffer+AudioBufferList) consumer
+//  functions on the embedded buffer. The consumer never waits on producers.
+//
+//  Copyright (C) 2012-2013 A Tasty Pixel
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef TPMultiProducerCircularBuffer_h
+#define TPMultiProducerCircularBuffer_h
+
+#include "TPCircularBuffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    TPCircularBuffer  buffer;       // Consumer-side buffer: use the TPCircularBuffer consumer functions on this; ends with padding
+    volatile uint64_t reservation;  // Generation (high 32 bits) and index (low 32 bits) of the next reservation
+    _TPCircularBufferCacheLinePadding(_padding);
+} TPMultiProducerCircularBuffer;
+
+/*!
+ * Initialise buffer
+ *
+ *  Note that the length is advisory only: Because of the way the
+ *  memory mirroring technique works, the true buffer length will
+ *  be multiples of the device page size (e.g. 4096 bytes)
+ *
+ * @param buffer Multi-producer circular buffer
+ * @param length Length of buffer
+ */
+#define TPMultiProducerCircularBufferInit(buffer, length) \
+    _TPMultiProducerCircularBufferInit(buffer, length, sizeof(*buffer))
+bool _TPMultiProducerCircularBufferInit(TPMultiProducerCircularBuffer *buffer, int32_t length, size_t structSize);
+
+/*!
+ * Cleanup buffer
+ *
+ *  Releases buffer resources.
+ */
+void TPMultiProducerCircularBufferCleanup(TPMultiProducerCircularBuffer *buffer);
+
+/*!
+ * Reserve space at the front of the buffer
+ *
+ *  Reserves the given number of bytes for the calling producer. The space can be
+ *  filled without any further synchronization, and must then be passed to
+ *  TPMultiProducerCircularBufferCommit. Every reservation must be committed, as later
+ *  reservations are not made visible to the consumer until earlier ones are.
+ *
+ *  Competing producers only ever retry the reservation itself. If space reserved earlier
+ *  by other producers isn't committed promptly, this yields once before reserving, so that
+ *  producers that outnumber the available cores don't end up taking turns to commit.
+ *
+ * @param buffer Multi-producer circular buffer
+ * @param length Number of bytes to reserve
+ * @return Pointer to the reserved space, or NULL if there was insufficient space
+ */
+void *TPMultiProducerCircularBufferReserve(TPMultiProducerCircularBuffer *buffer, int32_t length);
+
+/*!
+ * Commit reserved space
+ *
+ *  Marks the reserved space ready for reading. If other producers reserved space
+ *  earlier and haven't committed it yet, this waits for them, so don't hold a
+ *  reservation open for long.
+ *
+ * @param buffer Multi-producer circular buffer
+ * @param reservedSpace Pointer returned by TPMultiProducerCircularBufferReserve
+ * @param length Number of bytes that were reserved
+ */
+void TPMultiProducerCircularBufferCommit(TPMultiProducerCircularBuffer *buffer, void *reservedSpace, int32_t length);
+
+/*!
+ * Helper routine to copy bytes to buffer
+ *
+ *  This reserves space, copies the given bytes into it and commits it.
+ *
+ * @param buffer Multi-producer circular buffer
+ * @param src Source buffer
+ * @param len Number of bytes in source buffer
+ * @return true if bytes copied, false if there was insufficient space
+ */
+bool TPMultiProducerCircularBufferProduceBytes(TPMultiProducerCircularBuffer *buffer, const void* src, int32_t len);
+
+/*!
+ * Wait until the given reserved space is next to be committed
+ *
+ *  Used by TPMultiProducerCircularBufferCommit and the AudioBufferList utilities. On
+ *  return, the buffer's head points at the reserved space, and the calling producer is
+ *  the only one that may produce until it has done so.
+ *
+ * @param buffer Multi-producer circular buffer
+ * @param reservedSpace Pointer returned by TPMultiProducerCircularBufferReserve
+ */
+void _TPMultiProducerCircularBufferAwaitTurn(TPMultiProducerCircularBuffer *buffer, void *reservedSpace);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
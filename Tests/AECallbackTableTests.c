@@ -0,0 +1,191 @@
+//
+//  AECallbackTableTests.c
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+// Growing callback tables as AEAudioController's reserveCapacity:forCallbackTable: does: build
+// a larger copy off the render thread, swap it in with a message to the render thread, then
+// free the old arrays once the swap has been performed.
+
+#include "AETest.h"
+#include "AECallbackTable.h"
+#include "AETypedMessageQueue.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define kCallbacks 100
+
+static void filter(void) {}
+static void receiver(void) {}
+
+static uint8_t flagsForCallback(int index) {
+    return index % 3 == 2 ? kAECallbackReceiverFlag : kAECallbackFilterFlag;
+}
+
+static void *callbackForFlags(uint8_t flags) {
+    return flags & kAECallbackFilterFlag ? (void*)filter : (void*)receiver;
+}
+
+/*!
+ * Whether the table holds callbacks 0 to count-1, in order, with filters chained newest first
+ */
+static bool tableIsConsistent(const AECallbackTable *table) {
+    if ( table->count > table->capacity || table->filterCount > table->count ) return false;
+    int filters = 0;
+    for ( int i=0; i<table->count; i++ ) {
+        const AECallback *entry = &table->callbacks[i];
+        if ( entry->userInfo != (void*)(intptr_t)i || entry->flags != flagsForCallback(i) || entry->callback != callbackForFlags(entry->flags) ) return false;
+        if ( entry->flags & kAECallbackFilterFlag ) filters++;
+    }
+    if ( filters != table->filterCount ) return false;
+    for ( int i=0; i<table->filterCount; i++ ) {
+        const AECallback *entry = table->filters[i];
+        if ( entry < table->callbacks || entry >= table->callbacks + table->count ) return false;
+        if ( i > 0 && entry >= table->filters[i-1] ) return false;
+    }
+    return true;
+}
+
+static void testGrowthDoublesCapacity(void) {
+    AECallbackTable table;
+    memset(&table, 0, sizeof(table));
+    
+    int capacities[8];
+    int growths = 0;
+    for ( int i=0; i<kCallbacks; i++ ) {
+        if ( table.count == table.capacity ) {
+            AECallback *oldCallbacks = table.callbacks;
+            AECallbackTable grown;
+            AETestAssert(AECallbackTableBuildGrown(&table, table.count+1, &grown));
+            AETestAssert(grown.count == table.count && grown.callbacks != oldCallbacks);
+            AECallbackTableSwap(&table, &grown);
+            
+            // The replaced arrays come back for freeing
+            AETestAssert(grown.callbacks == oldCallbacks);
+            AECallbackTableCleanup(&grown);
+            AETestAssert(grown.callbacks == NULL && grown.filters == NULL && grown.capacity == 0);
+            
+            if ( growths < 8 ) capacities[growths] = table.capacity;
+            growths++;
+        }
+        uint8_t flags = flagsForCallback(i);
+        AECallbackTableAdd(&table, callbackForFlags(flags), (void*)(intptr_t)i, flags);
+        AETestAssert(tableIsConsistent(&table));
+    }
+    
+    static const int expected[] = { 4, 8, 16, 32, 64, 128 };
+    AETestAssert(growths == 6);
+    AETestAssert(memcmp(capacities, expected, sizeof(expected)) == 0);
+    
+    // A request beyond double the capacity is met directly
+    AECallbackTable grown;
+    AETestAssert(AECallbackTableBuildGrown(&table, 1000, &grown));
+    AETestAssert(grown.capacity == 1000 && tableIsConsistent(&grown));
+    AECallbackTableCleanup(&grown);
+    
+    AECallbackTableCleanup(&table);
+}
+
+static AETypedMessageQueue *queue;
+static AECallbackTable table;
+static volatile int running;
+static int performed;
+static int renders;
+static int inconsistentRenders;
+
+static void *renderThread(void *arg) {
+    while ( running ) {
+        AETypedMessageQueueProcessOnRealtimeThread(queue);
+        if ( !tableIsConsistent(&table) ) inconsistentRenders++;
+        renders++;
+        sched_yield();
+    }
+    return NULL;
+}
+
+static void swapTables(const void *payload, int payloadLength) {
+    AECallbackTable *grown = *(AECallbackTable**)payload;
+    AECallbackTableSwap(&table, grown);
+    __atomic_store_n(&performed, 1, __ATOMIC_RELEASE);
+}
+
+static void addCallback(const void *payload, int payloadLength) {
+    int index = *(int*)payload;
+    uint8_t flags = flagsForCallback(index);
+    AECallbackTableAdd(&table, callbackForFlags(flags), (void*)(intptr_t)index, flags);
+    __atomic_store_n(&performed, 1, __ATOMIC_RELEASE);
+}
+
+/*!
+ * Perform a message on the render thread and wait for it, like a synchronous message exchange
+ */
+static void performOnRenderThread(AETypedMessageHandler handler, const void *payload, int payloadLength) {
+    __atomic_store_n(&performed, 0, __ATOMIC_RELAXED);
+    while ( !AETypedMessageQueueSendToRealtimeThread(queue, handler, payload, payloadLength) ) sched_yield();
+    while ( !__atomic_load_n(&performed, __ATOMIC_ACQUIRE) ) sched_yield();
+}
+
+static void testGrowingWhileRendering(void) {
+    memset(&table, 0, sizeof(table));
+    renders = inconsistentRenders = 0;
+    queue = AETypedMessageQueueCreate(4096);
+    running = 1;
+    pthread_t thread;
+    pthread_create(&thread, NULL, renderThread, NULL);
+    
+    int growths = 0;
+    int oldArraysReturned = 0;
+    for ( int i=0; i<kCallbacks; i++ ) {
+        // The table is only changed on the render thread, so its size is safe to read here between exchanges
+        if ( table.count == table.capacity ) {
+            AECallback *oldCallbacks = table.callbacks;
+            AECallbackTable grown;
+            AETestAssert(AECallbackTableBuildGrown(&table, table.count+1, &grown));
+            AECallbackTable *grownPointer = &grown;
+            performOnRenderThread(swapTables, &grownPointer, sizeof(grownPointer));
+            if ( grown.callbacks == oldCallbacks ) oldArraysReturned++;
+            AECallbackTableCleanup(&grown);
+            growths++;
+        }
+        performOnRenderThread(addCallback, &i, sizeof(i));
+    }
+    
+    running = 0;
+    pthread_join(thread, NULL);
+    
+    AETestAssert(growths == 6);
+    AETestAssert(oldArraysReturned == growths);
+    AETestAssert(table.count == kCallbacks && table.capacity == 128);
+    AETestAssert(renders > 0);
+    AETestAssert(inconsistentRenders == 0);
+    
+    AECallbackTableCleanup(&table);
+    AETypedMessageQueueDestroy(queue);
+}
+
+int main(int argc, char *argv[]) {
+    AETestRun(testGrowthDoublesCapacity);
+    AETestRun(testGrowingWhileRendering);
+    return AETestExitStatus();
+}
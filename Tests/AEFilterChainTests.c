@@ -0,0 +1,325 @@
+//
+//  AEFilterChainTests.c
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+// Filter chains, built by AECallbackTable as AEAudioController uses it. The chain walk is
+// a model of AEAudioController's channel producer, minus the Objective-C, silence tracking
+// and profiling: the producer here walks the real table's filter array the same way. The
+// benchmark times it against the producer as it was before filter chains, rescanning the
+// callback table for the next filter on every pull, with a channel of 15 filters.
+
+#include "AETest.h"
+#include "AECallbackTable.h"
+#include <AudioToolbox/AudioToolbox.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kChannels 2
+#define kFrames 256
+#define kMaxCallbacks 32
+
+typedef OSStatus (*filter_producer_t)(void *token, AudioBufferList *audio, UInt32 *frames);
+typedef OSStatus (*filter_callback_t)(void *userInfo, filter_producer_t producer, void *token, UInt32 frames, AudioBufferList *audio);
+
+typedef struct {
+    AECallbackTable *callbacks;
+    float phase;
+    bool idle;      //!< Leave the buffer untouched, to time the walk on its own
+} channel_t;
+
+typedef struct {
+    channel_t *channel;
+    AudioTimeStamp timeStamp;
+    AudioTimeStamp originalTimeStamp;
+    int nextFilterIndex;
+} producer_arg_t;
+
+static void renderSource(channel_t *channel, AudioBufferList *audio, UInt32 frames) {
+    if ( channel->idle ) return;
+    for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+        memset(audio->mBuffers[i].mData, 0, audio->mBuffers[i].mDataByteSize);
+    }
+    float *left = (float*)audio->mBuffers[0].mData;
+    float *right = (float*)audio->mBuffers[1].mData;
+    for ( UInt32 i=0; i<frames; i++ ) {
+        left[i] = right[i] = channel->phase;
+        channel->phase += 0.001f;
+        if ( channel->phase > 1.0f ) channel->phase -= 2.0f;
+    }
+}
+
+/*!
+ * The producer before precompiled chains: find the filter at nextFilterIndex by scanning the
+ * table backwards, and recurse through a fresh copy of the argument
+ */
+static OSStatus scanningProducer(void *userInfo, AudioBufferList *audio, UInt32 *frames) {
+    producer_arg_t *arg = (producer_arg_t*)userInfo;
+    channel_t *channel = arg->channel;
+
+    for ( int i=channel->callbacks->count-1, filterIndex=0; i>=0; i-- ) {
+        AECallback *callback = &channel->callbacks->callbacks[i];
+        if ( callback->flags & kAECallbackFilterFlag ) {
+            if ( filterIndex == arg->nextFilterIndex ) {
+                producer_arg_t filterArg = *arg;
+                filterArg.nextFilterIndex = filterIndex+1;
+                return ((filter_callback_t)callback->callback)(callback->userInfo, &scanningProducer, &filterArg, *frames, audio);
+            }
+            filterIndex++;
+        }
+    }
+
+    renderSource(channel, audio, *frames);
+    return noErr;
+}
+
+/*!
+ * The producer with precompiled chains, as AEAudioController's channel producer: index straight
+ * into the filter array, stepping nextFilterIndex around each call so a filter that pulls more
+ * than once reaches the next stage
+ */
+static OSStatus chainProducer(void *userInfo, AudioBufferList *audio, UInt32 *frames) {
+    producer_arg_t *arg = (producer_arg_t*)userInfo;
+    channel_t *channel = arg->channel;
+
+    if ( arg->nextFilterIndex < channel->callbacks->filterCount ) {
+        AECallback *filter = channel->callbacks->filters[arg->nextFilterIndex];
+        arg->nextFilterIndex++;
+        OSStatus status = ((filter_callback_t)filter->callback)(filter->userInfo, &chainProducer, arg, *frames, audio);
+        arg->nextFilterIndex--;
+        return status;
+    }
+
+    renderSource(channel, audio, *frames);
+    return noErr;
+}
+
+static OSStatus gainFilter(void *userInfo, filter_producer_t producer, void *token, UInt32 frames, AudioBufferList *audio) {
+    OSStatus status = producer(token, audio, &frames);
+    if ( status != noErr ) return status;
+    float gain = *(float*)userInfo;
+    for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+        float *samples = (float*)audio->mBuffers[i].mData;
+        for ( UInt32 j=0; j<frames; j++ ) {
+            samples[j] *= gain;
+        }
+    }
+    return noErr;
+}
+
+static OSStatus passThroughFilter(void *userInfo, filter_producer_t producer, void *token, UInt32 frames, AudioBufferList *audio) {
+    return producer(token, audio, &frames);
+}
+
+static int runOrder[kMaxCallbacks];
+static int runCount;
+
+static OSStatus recordingFilter(void *userInfo, filter_producer_t producer, void *token, UInt32 frames, AudioBufferList *audio) {
+    OSStatus status = producer(token, audio, &frames);
+    runOrder[runCount++] = (int)(intptr_t)userInfo;
+    return status;
+}
+
+static OSStatus doublePullFilter(void *userInfo, filter_producer_t producer, void *token, UInt32 frames, AudioBufferList *audio) {
+    // Pulls twice, as a time-stretching filter might; both pulls must reach the same next stage
+    UInt32 half = frames / 2;
+    AudioBufferList *second = (AudioBufferList*)malloc(sizeof(AudioBufferList) + (kChannels-1) * sizeof(AudioBuffer));
+    *second = *audio;
+    second->mNumberBuffers = audio->mNumberBuffers;
+    for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+        audio->mBuffers[i].mDataByteSize = half * sizeof(float);
+        second->mBuffers[i] = audio->mBuffers[i];
+        second->mBuffers[i].mData = (float*)audio->mBuffers[i].mData + half;
+    }
+    OSStatus status = producer(token, audio, &half);
+    if ( status == noErr ) status = producer(token, second, &half);
+    for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+        audio->mBuffers[i].mDataByteSize = frames * sizeof(float);
+    }
+    free(second);
+    return status;
+}
+
+static AudioBufferList *allocateBufferList(void) {
+    AudioBufferList *bufferList = (AudioBufferList*)malloc(sizeof(AudioBufferList) + (kChannels-1) * sizeof(AudioBuffer));
+    bufferList->mNumberBuffers = kChannels;
+    for ( int i=0; i<kChannels; i++ ) {
+        bufferList->mBuffers[i].mNumberChannels = 1;
+        bufferList->mBuffers[i].mDataByteSize = kFrames * sizeof(float);
+        bufferList->mBuffers[i].mData = calloc(kFrames, sizeof(float));
+    }
+    return bufferList;
+}
+
+static void freeBufferList(AudioBufferList *bufferList) {
+    for ( int i=0; i<bufferList->mNumberBuffers; i++ ) {
+        free(bufferList->mBuffers[i].mData);
+    }
+    free(bufferList);
+}
+
+static AECallbackTable *createTable(void) {
+    AECallbackTable *table = (AECallbackTable*)calloc(1, sizeof(AECallbackTable));
+    table->capacity = kMaxCallbacks;
+    table->callbacks = (AECallback*)calloc(kMaxCallbacks, sizeof(AECallback));
+    table->filters = (AECallback**)calloc(kMaxCallbacks, sizeof(AECallback*));
+    return table;
+}
+
+static void destroyTable(AECallbackTable *table) {
+    AECallbackTableCleanup(table);
+    free(table);
+}
+
+static OSStatus render(filter_producer_t producer, channel_t *channel, AudioBufferList *audio) {
+    producer_arg_t arg = { .channel = channel };
+    UInt32 frames = kFrames;
+    return producer(&arg, audio, &frames);
+}
+
+static void testChainRunsFiltersInScanOrder(void) {
+    AECallbackTable *table = createTable();
+    for ( int i=0; i<15; i++ ) {
+        AECallbackTableAdd(table, recordingFilter, (void*)(intptr_t)i, kAECallbackFilterFlag);
+        if ( i % 4 == 0 ) AECallbackTableAdd(table, NULL, NULL, kAECallbackReceiverFlag);
+    }
+    channel_t channel = { .callbacks = table };
+    AudioBufferList *audio = allocateBufferList();
+
+    int scanOrder[kMaxCallbacks];
+    runCount = 0;
+    AETestAssert(render(scanningProducer, &channel, audio) == noErr);
+    AETestAssert(runCount == 15);
+    memcpy(scanOrder, runOrder, sizeof(scanOrder));
+
+    runCount = 0;
+    AETestAssert(render(chainProducer, &channel, audio) == noErr);
+    AETestAssert(runCount == 15);
+    AETestAssert(memcmp(scanOrder, runOrder, 15 * sizeof(int)) == 0);
+
+    // The first filter added is run last, on the way out
+    AETestAssert(runOrder[14] == 14 && runOrder[0] == 0);
+
+    freeBufferList(audio);
+    destroyTable(table);
+}
+
+static void testRemovingCallbacksUpdatesChain(void) {
+    AECallbackTable *table = createTable();
+    for ( int i=0; i<5; i++ ) {
+        AECallbackTableAdd(table, recordingFilter, (void*)(intptr_t)i, kAECallbackFilterFlag);
+        AECallbackTableAdd(table, NULL, (void*)(intptr_t)i, kAECallbackReceiverFlag);
+    }
+    AETestAssert(table->count == 10 && table->filterCount == 5);
+
+    AETestAssert(AECallbackTableRemove(table, recordingFilter, (void*)(intptr_t)2));
+    AETestAssert(AECallbackTableRemove(table, NULL, (void*)(intptr_t)0));
+    AETestAssert(!AECallbackTableRemove(table, recordingFilter, (void*)(intptr_t)2));
+    AETestAssert(table->count == 8 && table->filterCount == 4);
+
+    channel_t channel = { .callbacks = table };
+    AudioBufferList *audio = allocateBufferList();
+    runCount = 0;
+    AETestAssert(render(chainProducer, &channel, audio) == noErr);
+    AETestAssert(runCount == 4);
+    AETestAssert(runOrder[0] == 0 && runOrder[1] == 1 && runOrder[2] == 3 && runOrder[3] == 4);
+
+    freeBufferList(audio);
+    destroyTable(table);
+}
+
+static void testChainMatchesScanOutput(void) {
+    static float gains[15];
+    AECallbackTable *table = createTable();
+    for ( int i=0; i<15; i++ ) {
+        gains[i] = 0.9f + 0.01f * i;
+        AECallbackTableAdd(table, i == 7 ? (void*)doublePullFilter : (void*)gainFilter, &gains[i], kAECallbackFilterFlag);
+    }
+    AudioBufferList *scanAudio = allocateBufferList();
+    AudioBufferList *chainAudio = allocateBufferList();
+
+    for ( int cycle=0; cycle<4; cycle++ ) {
+        channel_t scanChannel = { .callbacks = table, .phase = 0.25f * cycle };
+        channel_t chainChannel = { .callbacks = table, .phase = 0.25f * cycle };
+        AETestAssert(render(scanningProducer, &scanChannel, scanAudio) == noErr);
+        AETestAssert(render(chainProducer, &chainChannel, chainAudio) == noErr);
+        for ( int i=0; i<kChannels; i++ ) {
+            AETestAssert(memcmp(scanAudio->mBuffers[i].mData, chainAudio->mBuffers[i].mData, kFrames * sizeof(float)) == 0);
+        }
+    }
+
+    freeBufferList(scanAudio);
+    freeBufferList(chainAudio);
+    destroyTable(table);
+}
+
+#define kBenchmarkRenders 200000
+
+static double secondsPerRender(filter_producer_t producer, channel_t *channel, AudioBufferList *audio) {
+    double best = INFINITY;
+    for ( int run=0; run<5; run++ ) {
+        double start = AETestSeconds();
+        for ( int i=0; i<kBenchmarkRenders; i++ ) {
+            render(producer, channel, audio);
+        }
+        double perRender = (AETestSeconds() - start) / kBenchmarkRenders;
+        if ( perRender < best ) best = perRender;
+    }
+    return best;
+}
+
+static void benchmarkFifteenFilters(void) {
+    static float gain = 0.999f;
+    AudioBufferList *audio = allocateBufferList();
+
+    for ( int passThrough=1; passThrough>=0; passThrough-- ) {
+        // Pass-through filters on an idle source time the walk alone; gain filters on a tone, a whole render
+        // A channel with 15 filters, and a few receivers among them for the scan to step over
+        AECallbackTable *table = createTable();
+        for ( int i=0; i<15; i++ ) {
+            AECallbackTableAdd(table, passThrough ? (void*)passThroughFilter : (void*)gainFilter, &gain, kAECallbackFilterFlag);
+            if ( i % 5 == 0 ) AECallbackTableAdd(table, NULL, NULL, kAECallbackReceiverFlag);
+        }
+        channel_t channel = { .callbacks = table, .idle = passThrough };
+
+        double before = secondsPerRender(scanningProducer, &channel, audio);
+        double after = secondsPerRender(chainProducer, &channel, audio);
+        printf("     15 %s, %d frames: %.0f ns per render rescanning, %.0f ns with the filter chain (%.2fx)\n",
+               passThrough ? "pass-through filters, idle source" : "gain filters, tone source", kFrames, before * 1.0e9, after * 1.0e9, before / after);
+        if ( passThrough ) {
+            // With no processing to hide it, walking the chain must beat rescanning the table
+            AETestAssert(after < before);
+        }
+        destroyTable(table);
+    }
+
+    freeBufferList(audio);
+}
+
+int main(int argc, char *argv[]) {
+    AETestRun(testChainRunsFiltersInScanOrder);
+    AETestRun(testChainMatchesScanOutput);
+    AETestRun(testRemovingCallbacksUpdatesChain);
+    AETestRun(benchmarkFifteenFilters);
+    return AETestExitStatus();
+}
@@ -0,0 +1,314 @@
+//
+//  AEGroupMixerTests.c
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+// The native group mixer and automation lanes, plus benchmarks of a group of
+// 64 stereo inputs at 256 frames, and of one group of up to 2,000 channels.
+//
+// The 2,000-channel benchmark is a model of AEAudioController's native mixing loop: it
+// times the real AEGroupMixer over a flat array of separately allocated channels, but not
+// the controller's own channel and callback tables. AECallbackTableTests covers growing
+// those tables.
+
+#include "AETest.h"
+#include "AEGroupMixer.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kFrames 256
+#define kTolerance 1.0e-5f
+
+static float source[2][kFrames];
+static float output[2][kFrames];
+static const float * const sources[2] = { source[0], source[1] };
+static float * const outputs[2] = { output[0], output[1] };
+
+static void fillSource(void) {
+    for ( int i=0; i<kFrames; i++ ) {
+        source[0][i] = sinf(i * 0.01f);
+        source[1][i] = cosf(i * 0.01f);
+    }
+}
+
+static bool near(float a, float b) {
+    return fabsf(a - b) <= kTolerance;
+}
+
+static void testConstantGainAccumulatesInPlace(void) {
+    fillSource();
+    for ( int i=0; i<kFrames; i++ ) output[0][i] = output[1][i] = 1.0f;
+
+    AEGroupMixerInput input;
+    AEGroupMixerInputReset(&input);
+    AEGroupMixerAccumulate(&input, 0.5f, 0.0f, sources, 2, outputs, 2, kFrames);
+
+    for ( int i=0; i<kFrames; i++ ) {
+        AETestAssert(near(output[0][i], 1.0f + 0.5f * source[0][i]));
+        AETestAssert(near(output[1][i], 1.0f + 0.5f * source[1][i]));
+    }
+}
+
+static void testPanBalancesStereo(void) {
+    fillSource();
+    AEGroupMixerClear(outputs, 2, kFrames);
+
+    AEGroupMixerInput input;
+    AEGroupMixerInputReset(&input);
+    AEGroupMixerAccumulate(&input, 1.0f, 0.5f, sources, 2, outputs, 2, kFrames);
+
+    for ( int i=0; i<kFrames; i++ ) {
+        AETestAssert(near(output[0][i], 0.5f * source[0][i]));
+        AETestAssert(near(output[1][i], source[1][i]));
+    }
+}
+
+static void testMonoSourceFeedsBothSides(void) {
+    fillSource();
+    AEGroupMixerClear(outputs, 2, kFrames);
+
+    AEGroupMixerInput input;
+    AEGroupMixerInputReset(&input);
+    AEGroupMixerAccumulate(&input, 1.0f, 0.0f, sources, 1, outputs, 2, kFrames);
+
+    for ( int i=0; i<kFrames; i++ ) {
+        AETestAssert(near(output[0][i], source[0][i]));
+        AETestAssert(near(output[1][i], source[0][i]));
+    }
+}
+
+static void testMonoOutputAveragesSource(void) {
+    fillSource();
+    AEGroupMixerClear(outputs, 1, kFrames);
+
+    AEGroupMixerInput input;
+    AEGroupMixerInputReset(&input);
+    AEGroupMixerAccumulate(&input, 1.0f, 0.0f, sources, 2, outputs, 1, kFrames);
+
+    for ( int i=0; i<kFrames; i++ ) {
+        AETestAssert(near(output[0][i], 0.5f * (source[0][i] + source[1][i])));
+    }
+}
+
+static void testVolumeChangeRampsAcrossBlock(void) {
+    for ( int i=0; i<kFrames; i++ ) source[0][i] = source[1][i] = 1.0f;
+
+    AEGroupMixerInput input;
+    AEGroupMixerInputReset(&input);
+    AEGroupMixerClear(outputs, 2, kFrames);
+    AEGroupMixerAccumulate(&input, 1.0f, 0.0f, sources, 2, outputs, 2, kFrames);
+
+    AEGroupMixerClear(outputs, 2, kFrames);
+    AEGroupMixerAccumulate(&input, 0.0f, 0.0f, sources, 2, outputs, 2, kFrames);
+    for ( int i=0; i<kFrames; i++ ) {
+        AETestAssert(near(output[0][i], 1.0f - (float)(i+1) / kFrames));
+    }
+
+    // Once there, it stays there
+    AEGroupMixerClear(outputs, 2, kFrames);
+    AEGroupMixerAccumulate(&input, 0.0f, 0.0f, sources, 2, outputs, 2, kFrames);
+    for ( int i=0; i<kFrames; i++ ) {
+        AETestAssert(output[0][i] == 0.0f && output[1][i] == 0.0f);
+    }
+}
+
+static void testAutomationSplitsBlockAtBreakpoint(void) {
+    for ( int i=0; i<kFrames; i++ ) source[0][i] = source[1][i] = 1.0f;
+    AEGroupMixerClear(outputs, 2, kFrames);
+
+    static AEAutomationLane volumeLane, panLane;
+    memset(&volumeLane, 0, sizeof(volumeLane));
+    memset(&panLane, 0, sizeof(panLane));
+    AETestAssert(AEAutomationLaneAddPoint(&volumeLane, 63, 0.0f));
+
+    AEGroupMixerInput input;
+    AEGroupMixerInputReset(&input);
+    AEGroupMixerAccumulateAutomated(&input, &volumeLane, 1.0f, &panLane, 0.0f, 1.0f, 0, sources, 2, outputs, 2, kFrames);
+
+    // Fades from the current volume to silence at the point, then holds
+    for ( int i=0; i<64; i++ ) {
+        AETestAssert(near(output[0][i], 1.0f - (float)(i+1) / 64));
+    }
+    for ( int i=64; i<kFrames; i++ ) {
+        AETestAssert(output[0][i] == 0.0f);
+    }
+}
+
+static void testAutomationLaneRejectsPointsOutOfOrder(void) {
+    static AEAutomationLane lane;
+    memset(&lane, 0, sizeof(lane));
+    AETestAssert(AEAutomationLaneAddPoint(&lane, 100, 1.0f));
+    AETestAssert(!AEAutomationLaneAddPoint(&lane, 50, 1.0f));
+    AETestAssert(AEAutomationLaneAddPoint(&lane, 100, 0.5f));
+}
+
+static void testAutomationLaneResetRestoresParameter(void) {
+    static AEAutomationLane lane;
+    memset(&lane, 0, sizeof(lane));
+    AETestAssert(AEAutomationLaneAddPoint(&lane, 1000, 0.0f));
+    AETestAssert(AEAutomationLaneAdvance(&lane, 0, 1.0f) == 1001);
+    AETestAssert(AEAutomationLaneValue(&lane, 499, 1.0f) < 1.0f);
+
+    AEAutomationLaneReset(&lane);
+    AETestAssert(AEAutomationLaneAdvance(&lane, 500, 1.0f) == INT32_MAX);
+    AETestAssert(AEAutomationLaneValue(&lane, 500, 0.75f) == 0.75f);
+}
+
+static void testAutomationLaneFillsToCapacity(void) {
+    static AEAutomationLane lane;
+    memset(&lane, 0, sizeof(lane));
+    for ( int i=0; i<kAEAutomationLaneCapacity; i++ ) {
+        AETestAssert(AEAutomationLaneAddPoint(&lane, i, 1.0f));
+    }
+    AETestAssert(!AEAutomationLaneAddPoint(&lane, kAEAutomationLaneCapacity, 1.0f));
+
+    // Passing points frees their slots
+    AEAutomationLaneAdvance(&lane, 10, 1.0f);
+    AETestAssert(AEAutomationLaneAddPoint(&lane, kAEAutomationLaneCapacity, 1.0f));
+}
+
+#define kBenchmarkInputs 64
+#define kBenchmarkCycles 20000
+#define kBenchmarkSampleRate 44100.0
+
+static void benchmarkSixtyFourStereoInputs(void) {
+    // Each input has its own buffers, as each channel renders into the scratch buffer in turn
+    float *inputBuffers = (float*)malloc(kBenchmarkInputs * 2 * kFrames * sizeof(float));
+    for ( int i=0; i<kBenchmarkInputs * 2 * kFrames; i++ ) {
+        inputBuffers[i] = (float)((i * 7919) % 2000) / 1000.0f - 1.0f;
+    }
+    AEGroupMixerInput inputs[kBenchmarkInputs];
+    for ( int i=0; i<kBenchmarkInputs; i++ ) {
+        AEGroupMixerInputReset(&inputs[i]);
+    }
+
+    for ( int ramping=0; ramping<2; ramping++ ) {
+        double start = AETestSeconds();
+        for ( int cycle=0; cycle<kBenchmarkCycles; cycle++ ) {
+            AEGroupMixerClear(outputs, 2, kFrames);
+            for ( int i=0; i<kBenchmarkInputs; i++ ) {
+                const float *channelSources[2] = { inputBuffers + (2*i) * kFrames, inputBuffers + (2*i+1) * kFrames };
+                // When ramping, every input's volume and pan change every block
+                float volume = ramping ? 0.5f + 0.5f * ((cycle + i) & 1) : 0.8f;
+                float pan = ramping ? ((cycle + i) & 1 ? -0.5f : 0.5f) : 0.0f;
+                AEGroupMixerAccumulate(&inputs[i], volume, pan, channelSources, 2, outputs, 2, kFrames);
+            }
+        }
+        double perCycle = (AETestSeconds() - start) / kBenchmarkCycles;
+        double budget = kFrames / kBenchmarkSampleRate;
+        printf("     %d stereo inputs, %d frames, %s: %.2f us per cycle, %.2f%% of the %.2f ms budget\n",
+               kBenchmarkInputs, kFrames, ramping ? "ramping" : "steady", perCycle * 1.0e6, 100.0 * perCycle / budget, budget * 1.0e3);
+        AETestAssert(perCycle < budget);
+    }
+
+    free(inputBuffers);
+}
+
+/*!
+ * A model channel, as the group mixer sees it: a render callback, and its mixer state
+ */
+typedef struct {
+    void (*render)(void *userInfo, float * const *audio, int frames);
+    float phase;
+    float volume;
+    float pan;
+    AEGroupMixerInput mixerInput;
+} benchmark_channel_t;
+
+static void renderTone(void *userInfo, float * const *audio, int frames) {
+    benchmark_channel_t *channel = (benchmark_channel_t*)userInfo;
+    float phase = channel->phase;
+    for ( int i=0; i<frames; i++ ) {
+        audio[0][i] = audio[1][i] = phase;
+        phase += 0.01f;
+        if ( phase > 1.0f ) phase -= 2.0f;
+    }
+    channel->phase = phase;
+}
+
+static double secondsPerChannelForGroupOfSize(int count) {
+    // A model of a group's render list: each channel is allocated on its own and listed in one
+    // flat array, and they all render into the same scratch buffer
+    benchmark_channel_t **renderList = (benchmark_channel_t**)malloc(count * sizeof(benchmark_channel_t*));
+    for ( int i=0; i<count; i++ ) {
+        benchmark_channel_t *channel = (benchmark_channel_t*)calloc(1, sizeof(benchmark_channel_t));
+        channel->render = renderTone;
+        channel->phase = (float)i / count;
+        channel->volume = 1.0f / count;
+        channel->pan = (float)(i % 3) - 1.0f;
+        AEGroupMixerInputReset(&channel->mixerInput);
+        renderList[i] = channel;
+    }
+    float *scratch[2] = { source[0], source[1] };
+
+    // Mix about the same number of channel blocks at every size, and take the best of a few runs
+    int cycles = 400000 / count;
+    double best = INFINITY;
+    for ( int run=0; run<5; run++ ) {
+        double start = AETestSeconds();
+        for ( int cycle=0; cycle<cycles; cycle++ ) {
+            AEGroupMixerClear(outputs, 2, kFrames);
+            for ( int i=0; i<count; i++ ) {
+                benchmark_channel_t *channel = renderList[i];
+                channel->render(channel, scratch, kFrames);
+                AEGroupMixerAccumulate(&channel->mixerInput, channel->volume, channel->pan,
+                                       (const float * const *)scratch, 2, outputs, 2, kFrames);
+            }
+        }
+        double perChannel = (AETestSeconds() - start) / ((double)cycles * count);
+        if ( perChannel < best ) best = perChannel;
+    }
+
+    for ( int i=0; i<count; i++ ) {
+        free(renderList[i]);
+    }
+    free(renderList);
+    return best;
+}
+
+static void benchmarkTwoThousandChannelsInOneGroup(void) {
+    static const int sizes[] = { 100, 500, 1000, 2000 };
+    double perChannel[sizeof(sizes)/sizeof(sizes[0])];
+    for ( int i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++ ) {
+        perChannel[i] = secondsPerChannelForGroupOfSize(sizes[i]);
+        printf("     %4d channels in one group, %d frames: %.0f ns per channel, %.2f%% of the budget\n",
+               sizes[i], kFrames, perChannel[i] * 1.0e9, 100.0 * perChannel[i] * sizes[i] / (kFrames / kBenchmarkSampleRate));
+    }
+
+    // The cost of each channel shouldn't grow with the size of the group
+    AETestAssert(perChannel[3] < perChannel[0] * 2.0);
+}
+
+int main(int argc, char *argv[]) {
+    AETestRun(testConstantGainAccumulatesInPlace);
+    AETestRun(testPanBalancesStereo);
+    AETestRun(testMonoSourceFeedsBothSides);
+    AETestRun(testMonoOutputAveragesSource);
+    AETestRun(testVolumeChangeRampsAcrossBlock);
+    AETestRun(testAutomationSplitsBlockAtBreakpoint);
+    AETestRun(testAutomationLaneRejectsPointsOutOfOrder);
+    AETestRun(testAutomationLaneResetRestoresParameter);
+    AETestRun(testAutomationLaneFillsToCapacity);
+    AETestRun(benchmarkSixtyFourStereoInputs);
+    AETestRun(benchmarkTwoThousandChannelsInOneGroup);
+    return AETestExitStatus();
+}
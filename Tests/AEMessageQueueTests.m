@@ -0,0 +1,236 @@
+//
+//  AEMessageQueueTests.m
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+// AEMessageQueue needs Foundation, so these build on macOS only. The first benchmark compares
+// typed messages with block messages, each sent in bursts and performed on this thread, as
+// AEMessageQueueProcessMessagesOnRealtimeThread allows before the realtime thread starts.
+// The others run a thread standing in for the realtime thread, processing messages once
+// per render cycle, and time synchronous exchanges and round trips against it.
+
+#import "AETest.h"
+#import "AEMessageQueue.h"
+#import <pthread.h>
+#import <time.h>
+
+#define kBenchmarkMessages 200000
+#define kBenchmarkBurst 32
+#define kSynchronousExchanges 1000
+#define kRoundTrips 200
+#define kRenderCycleFrames 64
+#define kSampleRate 44100.0
+
+@interface AEMessageQueue (AEMessageQueueTests)
+- (void)pollForMessageResponses;
+@end
+
+static int64_t benchmarkTotal;
+
+static void accumulate(const void *payload, int payloadLength) {
+    const int64_t *value = (const int64_t*)payload;
+    benchmarkTotal += value[0] + value[1];
+}
+
+static void benchmarkTypedAgainstBlockMessages(void) {
+    @autoreleasepool {
+        AEMessageQueue *queue = [[AEMessageQueue alloc] initWithMessageBufferLength:65536];
+        int64_t payload[2] = { 1, 2 };
+        
+        benchmarkTotal = 0;
+        double start = AETestSeconds();
+        for ( int i=0; i<kBenchmarkMessages; i += kBenchmarkBurst ) {
+            for ( int j=0; j<kBenchmarkBurst; j++ ) {
+                AEMessageQueueSendTypedMessageToRealtimeThread(queue, accumulate, payload, sizeof(payload));
+            }
+            AEMessageQueueProcessMessagesOnRealtimeThread(queue);
+        }
+        double typedSeconds = AETestSeconds() - start;
+        AETestAssert(benchmarkTotal == (int64_t)kBenchmarkMessages * 3);
+        
+        // Block messages come back to the main thread, which releases the blocks, so that's part of their cost
+        benchmarkTotal = 0;
+        start = AETestSeconds();
+        for ( int i=0; i<kBenchmarkMessages; i += kBenchmarkBurst ) {
+            for ( int j=0; j<kBenchmarkBurst; j++ ) {
+                int64_t first = payload[0], second = payload[1];
+                [queue performAsynchronousMessageExchangeWithBlock:^{ benchmarkTotal += first + second; } responseBlock:nil];
+            }
+            AEMessageQueueProcessMessagesOnRealtimeThread(queue);
+            [queue pollForMessageResponses];
+        }
+        double blockSeconds = AETestSeconds() - start;
+        AETestAssert(benchmarkTotal == (int64_t)kBenchmarkMessages * 3);
+        
+        printf("     typed messages: %.0f ns per message sent and performed\n", typedSeconds * 1.0e9 / kBenchmarkMessages);
+        printf("     block messages: %.0f ns per message sent, performed and released (%.1fx typed)\n",
+               blockSeconds * 1.0e9 / kBenchmarkMessages, blockSeconds / typedSeconds);
+    }
+}
+
+typedef struct {
+    __unsafe_unretained AEMessageQueue *queue;
+    volatile int running;
+} render_thread_t;
+
+static void *renderThread(void *arg) {
+    render_thread_t *thread = (render_thread_t*)arg;
+    const long cycleNanoseconds = (long)(kRenderCycleFrames / kSampleRate * 1.0e9);
+    struct timespec cycle = { .tv_sec = 0, .tv_nsec = cycleNanoseconds };
+    while ( thread->running ) {
+        AEMessageQueueProcessMessagesOnRealtimeThread(thread->queue);
+        nanosleep(&cycle, NULL);
+    }
+    return NULL;
+}
+
+static double threadCPUSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1.0e-9;
+}
+
+static void benchmarkSynchronousExchanges(void) {
+    @autoreleasepool {
+        AEMessageQueue *queue = [[AEMessageQueue alloc] init];
+        render_thread_t thread = { .queue = queue, .running = 1 };
+        pthread_t renderThreadHandle;
+        pthread_create(&renderThreadHandle, NULL, renderThread, &thread);
+        
+        __block int performed = 0;
+        int finished = 0;
+        double start = AETestSeconds();
+        double startCPU = threadCPUSeconds();
+        for ( int i=0; i<kSynchronousExchanges; i++ ) {
+            if ( [queue performSynchronousMessageExchangeWithBlock:^{ performed++; }] ) finished++;
+            
+            // Handle the reply, as the main run loop would once the poll thread saw it
+            [queue pollForMessageResponses];
+        }
+        double cpuSeconds = threadCPUSeconds() - startCPU;
+        double seconds = AETestSeconds() - start;
+        
+        thread.running = 0;
+        pthread_join(renderThreadHandle, NULL);
+        [queue pollForMessageResponses];
+        
+        AETestAssert(finished == kSynchronousExchanges && performed == kSynchronousExchanges);
+        
+        double cycleSeconds = kRenderCycleFrames / kSampleRate;
+        printf("     %d exchanges in %.2f s: %.2f ms each (%.2f render cycles of %.2f ms), %.1f us of caller CPU each\n",
+               kSynchronousExchanges, seconds, seconds * 1.0e3 / kSynchronousExchanges,
+               seconds / kSynchronousExchanges / cycleSeconds, cycleSeconds * 1.0e3,
+               cpuSeconds * 1.0e6 / kSynchronousExchanges);
+        
+        // Each exchange should return within about a render cycle of being sent, not a polling interval
+        AETestAssert(seconds / kSynchronousExchanges < cycleSeconds * 3);
+    }
+}
+
+static BOOL runMainRunLoopUntil(volatile int *flag, NSTimeInterval timeout) {
+    NSDate *giveUpDate = [NSDate dateWithTimeIntervalSinceNow:timeout];
+    while ( !*flag && [giveUpDate timeIntervalSinceNow] > 0 ) {
+        @autoreleasepool {
+            [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.001]];
+        }
+    }
+    return *flag != 0;
+}
+
+static void testAutoProcessingDoesNotReleaseEarly(void) {
+    @autoreleasepool {
+        // No realtime thread is running, so the poll thread performs messages itself
+        AEMessageQueue *queue = [[AEMessageQueue alloc] init];
+        queue.autoProcessTimeout = 0.01;
+        [queue startPolling];
+        
+        __block volatile int performed = 0;
+        __block volatile int released = 0;
+        [queue releaseWhenSafeWithBlock:^{ released = 1; }];
+        [queue performAsynchronousMessageExchangeWithBlock:^{ performed = 1; } responseBlock:nil];
+        
+        // The realtime thread might only be running late, so the release must wait for it
+        runMainRunLoopUntil(&performed, 1.0);
+        AETestAssert(performed);
+        [NSThread sleepForTimeInterval:0.1];
+        AETestAssert(!released);
+        
+        // Once the realtime thread begins a cycle, the poll thread is woken to release
+        AEMessageQueueProcessMessagesOnRealtimeThread(queue);
+        runMainRunLoopUntil(&released, 1.0);
+        AETestAssert(released);
+        
+        [queue stopPolling];
+    }
+}
+
+static void benchmarkRoundTripLatency(void) {
+    @autoreleasepool {
+        AEMessageQueue *queue = [[AEMessageQueue alloc] init];
+        [queue startPolling];
+        render_thread_t thread = { .queue = queue, .running = 1 };
+        pthread_t renderThreadHandle;
+        pthread_create(&renderThreadHandle, NULL, renderThread, &thread);
+        
+        double totalRoundTrip = 0, totalResponse = 0, worstResponse = 0;
+        int completed = 0;
+        for ( int i=0; i<kRoundTrips; i++ ) {
+            __block double performTime = 0;
+            __block double responseTime = 0;
+            __block volatile int responded = 0;
+            double sendTime = AETestSeconds();
+            [queue performAsynchronousMessageExchangeWithBlock:^{
+                performTime = AETestSeconds();
+            } responseBlock:^{
+                responseTime = AETestSeconds();
+                responded = 1;
+            }];
+            if ( !runMainRunLoopUntil(&responded, 1.0) ) break;
+            completed++;
+            
+            // Delay from the realtime thread performing the message to the main thread handling its response
+            double response = responseTime - performTime;
+            totalResponse += response;
+            if ( response > worstResponse ) worstResponse = response;
+            totalRoundTrip += responseTime - sendTime;
+        }
+        
+        thread.running = 0;
+        pthread_join(renderThreadHandle, NULL);
+        [queue stopPolling];
+        
+        AETestAssert(completed == kRoundTrips);
+        
+        printf("     %d round trips: %.2f ms each on average, of which %.3f ms from realtime to main thread (worst %.3f ms)\n",
+               kRoundTrips, totalRoundTrip * 1.0e3 / kRoundTrips, totalResponse * 1.0e3 / kRoundTrips, worstResponse * 1.0e3);
+        
+        // Responses reach the main thread without waiting for a polling interval
+        AETestAssert(totalResponse / kRoundTrips < 0.005);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    AETestRun(benchmarkTypedAgainstBlockMessages);
+    AETestRun(benchmarkSynchronousExchanges);
+    AETestRun(testAutoProcessingDoesNotReleaseEarly);
+    AETestRun(benchmarkRoundTripLatency);
+    return AETestExitStatus();
+}
@@ -0,0 +1,65 @@
+//
+//  AETest.h
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+// Minimal test harness for the pure C sources. Each test program is a list of test
+// functions run from main with AETestRun, which reports failed assertions and returns
+// non-zero if any failed.
+
+#ifndef AETest_h
+#define AETest_h
+
+#include <stdio.h>
+#include <time.h>
+
+static int __AETestFailures = 0;
+static const char *__AETestCurrent = NULL;
+
+#define AETestAssert(condition) \
+    do { \
+        if ( !(condition) ) { \
+            fprintf(stderr, "%s:%d: %s: assertion failed: %s\n", __FILE__, __LINE__, __AETestCurrent, #condition); \
+            __AETestFailures++; \
+            return; \
+        } \
+    } while ( 0 )
+
+#define AETestRun(test) \
+    do { \
+        int __failuresBefore = __AETestFailures; \
+        __AETestCurrent = #test; \
+        test(); \
+        printf("%s %s\n", __AETestFailures == __failuresBefore ? "ok  " : "FAIL", #test); \
+    } while ( 0 )
+
+#define AETestExitStatus() (__AETestFailures ? 1 : 0)
+
+/*!
+ * Monotonic time in seconds, for benchmarks
+ */
+static inline double AETestSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1.0e-9;
+}
+
+#endif
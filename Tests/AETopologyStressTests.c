@@ -0,0 +1,345 @@
+//
+//  AETopologyStressTests.c
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+// Topology stress: a render thread mixes a group through its render list at the hardware's
+// pace, while the main thread adds and removes 100 channels a second. Each change is
+// published the way AEAudioController's publishRenderListForGroup:releasingChannels:count:
+// does it, with AERenderList: a new list is built, swapped in by an AERenderListUpdate at the
+// start of a render cycle, and the update comes back to the main thread to free the old list
+// and release the removed channels. Typed messages stand in for the controller's
+// asynchronous message exchange.
+//
+// Counts glitches: render cycles whose work overran their period, any use of a channel after
+// it was released, channels released before the render thread had moved past them or out of
+// the order they were removed, and aux-bus-style channels rendered before the others.
+
+#include "AETest.h"
+#include "AEGroupMixer.h"
+#include "AERenderList.h"
+#include "AETypedMessageQueue.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kFrames 256
+#define kSampleRate 44100.0
+#define kInitialChannels 100
+#define kLastChannels 5
+#define kChangesPerSecond 100
+#define kDurationSeconds 2.0
+#define kLiveMagic 0x6c697665
+#define kReleasedMagic 0x64656164
+
+typedef struct {
+    uint32_t magic;
+    bool     isLast;            //!< Renders after the others, like an aux bus
+    float    phase;
+    int      removalOrder;      //!< Main thread: the order the channel was removed in
+    int      removedInUpdate;   //!< Main thread: the update that dropped it
+    AEGroupMixerInput mixerInput;
+} channel_t;
+
+typedef struct {
+    AETypedMessageQueue *queue;
+    AERenderList *renderList;           // The slot the render thread reads, swapped by AERenderListUpdateApply
+    volatile int running;
+    int updatesApplied;                 // Written by the render thread, atomically
+
+    // Render thread statistics
+    int cycles;
+    int overruns;
+    int lateCycles;
+    int releasedChannelsRendered;
+    int lastChannelsOutOfOrder;
+    double worstCycle;
+
+    // Main thread state: the group's channels, as the controller keeps them
+    channel_t **channels;
+    int channelCount;
+    int updatesPublished;
+    int updatesFinished;
+    int channelsRemoved;
+    int channelsReleased;
+    int releasedBeforeApplied;
+    int releasedOutOfOrder;
+    channel_t **graveyard;
+} stress_state_t;
+
+typedef struct {
+    stress_state_t     *state;
+    AERenderListUpdate *update;
+    int                 sequence;
+} update_message_t;
+
+static float channelBuffers[2][kFrames];
+static float outputBuffers[2][kFrames];
+
+static void sleepUntil(double time) {
+    struct timespec target = { .tv_sec = (time_t)time, .tv_nsec = (long)((time - (time_t)time) * 1.0e9) };
+    while ( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, NULL) != 0 );
+}
+
+static double threadCPUSeconds(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec * 1.0e-9;
+}
+
+static bool channelIsLast(void *channel) {
+    return ((channel_t*)channel)->isLast;
+}
+
+static void releaseChannel(void *channel, void *userInfo) {
+    // Main thread, from AERenderListUpdateFinish
+    channel_t *released = (channel_t*)channel;
+    stress_state_t *state = (stress_state_t*)userInfo;
+    if ( released->removedInUpdate >= __atomic_load_n(&state->updatesApplied, __ATOMIC_ACQUIRE) ) state->releasedBeforeApplied++;
+    if ( released->removalOrder != state->channelsReleased ) state->releasedOutOfOrder++;
+    
+    // Poison rather than free, so the render thread can tell if it ever sees this channel again
+    released->magic = kReleasedMagic;
+    state->graveyard[state->channelsReleased++] = released;
+}
+
+static void finishUpdate(const void *payload, int payloadLength) {
+    // Main thread: the render thread has swapped past the old list
+    const update_message_t *message = (const update_message_t*)payload;
+    AERenderListUpdateFinish(message->update, releaseChannel, message->state);
+    message->state->updatesFinished++;
+}
+
+static void applyUpdate(const void *payload, int payloadLength) {
+    // Render thread, at the start of a cycle
+    const update_message_t *message = (const update_message_t*)payload;
+    stress_state_t *state = message->state;
+    AERenderListUpdateApply(message->update);
+    __atomic_store_n(&state->updatesApplied, message->sequence + 1, __ATOMIC_RELEASE);
+    while ( !AETypedMessageQueueSendToMainThread(state->queue, finishUpdate, message, sizeof(update_message_t)) );
+}
+
+static void *renderThread(void *userInfo) {
+    stress_state_t *state = (stress_state_t*)userInfo;
+    double period = kFrames / kSampleRate;
+    double deadline = AETestSeconds();
+
+    while ( state->running ) {
+        deadline += period;
+        double start = threadCPUSeconds();
+
+        AETypedMessageQueueProcessOnRealtimeThread(state->queue);
+
+        float * const outputs[2] = { outputBuffers[0], outputBuffers[1] };
+        float * const channelAudio[2] = { channelBuffers[0], channelBuffers[1] };
+        AEGroupMixerClear(outputs, 2, kFrames);
+        AERenderList *list = state->renderList;
+        bool sawLast = false;
+        for ( int i=0; i<list->count; i++ ) {
+            channel_t *channel = (channel_t*)list->channels[i];
+            if ( channel->magic != kLiveMagic ) {
+                state->releasedChannelsRendered++;
+                continue;
+            }
+            if ( channel->isLast ) {
+                sawLast = true;
+            } else if ( sawLast ) {
+                state->lastChannelsOutOfOrder++;
+            }
+            for ( int j=0; j<kFrames; j++ ) {
+                channelBuffers[0][j] = channelBuffers[1][j] = channel->phase;
+                channel->phase += 0.01f;
+                if ( channel->phase > 1.0f ) channel->phase -= 2.0f;
+            }
+            AEGroupMixerAccumulate(&channel->mixerInput, 1.0f / kInitialChannels, 0.0f,
+                                   (const float * const *)channelAudio, 2, outputs, 2, kFrames);
+        }
+
+        double work = threadCPUSeconds() - start;
+        state->cycles++;
+        if ( work > state->worstCycle ) state->worstCycle = work;
+        if ( work > period ) {
+            // The cycle's own work overran the period: the hardware would have run out of audio
+            state->overruns++;
+        }
+        double end = AETestSeconds();
+        if ( end > deadline ) {
+            // Woke late, which on a loaded machine is down to the scheduler, not the render path
+            state->lateCycles++;
+            deadline = end;
+        } else {
+            sleepUntil(deadline);
+        }
+    }
+    return NULL;
+}
+
+static channel_t *createChannel(bool isLast) {
+    channel_t *channel = (channel_t*)calloc(1, sizeof(channel_t));
+    channel->magic = kLiveMagic;
+    channel->isLast = isLast;
+    AEGroupMixerInputReset(&channel->mixerInput);
+    return channel;
+}
+
+static void publish(stress_state_t *state, channel_t **releasing, int count) {
+    // As publishRenderListForGroup:releasingChannels:count:
+    AERenderList *list = AERenderListCreate((void**)state->channels, state->channelCount, channelIsLast);
+    AERenderListUpdate *update = AERenderListUpdateCreate(&state->renderList, list, (void**)releasing, count);
+    for ( int i=0; i<count; i++ ) {
+        releasing[i]->removedInUpdate = state->updatesPublished;
+    }
+    
+    update_message_t message = { .state = state, .update = update, .sequence = state->updatesPublished };
+    while ( !AETypedMessageQueueSendToRealtimeThread(state->queue, applyUpdate, &message, sizeof(message)) ) {
+        AETypedMessageQueueProcessOnMainThread(state->queue);
+    }
+    state->updatesPublished++;
+}
+
+static void addChannel(stress_state_t *state) {
+    state->channels[state->channelCount++] = createChannel(false);
+    publish(state, NULL, 0);
+}
+
+static void removeChannel(stress_state_t *state, int index) {
+    channel_t *removed = state->channels[index];
+    removed->removalOrder = state->channelsRemoved++;
+    memmove(&state->channels[index], &state->channels[index+1], (state->channelCount - index - 1) * sizeof(channel_t*));
+    state->channelCount--;
+    publish(state, &removed, 1);
+}
+
+static void testListPutsLastChannelsAfterOthers(void) {
+    channel_t *a = createChannel(false), *bus = createChannel(true), *b = createChannel(false);
+    channel_t *channels[] = { bus, NULL, a, NULL, b };
+    AERenderList *list = AERenderListCreate((void**)channels, 5, channelIsLast);
+    AETestAssert(list->count == 3);
+    AETestAssert(list->channels[0] == a && list->channels[1] == b && list->channels[2] == bus);
+    AETestAssert(list->parallelChannels == &list->channels[5]);
+    free(list);
+    
+    list = AERenderListCreate((void**)channels, 5, NULL);
+    AETestAssert(list->count == 3 && list->channels[0] == bus && list->channels[1] == a && list->channels[2] == b);
+    free(list);
+    
+    free(a);
+    free(bus);
+    free(b);
+}
+
+static void testUpdateReleasesChannelsAfterSwap(void) {
+    stress_state_t state = { 0 };
+    channel_t *kept = createChannel(false), *first = createChannel(false), *second = createChannel(false);
+    state.graveyard = (channel_t**)malloc(2 * sizeof(channel_t*));
+    state.renderList = AERenderListCreate((void**)(channel_t*[3]){ kept, first, second }, 3, NULL);
+    AERenderList *oldList = state.renderList;
+    
+    first->removalOrder = 0;
+    second->removalOrder = 1;
+    channel_t *removed[] = { first, NULL, second };
+    AERenderList *list = AERenderListCreate((void**)&kept, 1, NULL);
+    AERenderListUpdate *update = AERenderListUpdateCreate(&state.renderList, list, (void**)removed, 3);
+    AETestAssert(state.renderList == oldList);
+    
+    AERenderListUpdateApply(update);
+    AETestAssert(state.renderList == list);
+    __atomic_store_n(&state.updatesApplied, 1, __ATOMIC_RELEASE);
+    
+    AERenderListUpdateFinish(update, releaseChannel, &state);
+    AETestAssert(state.channelsReleased == 2);
+    AETestAssert(state.graveyard[0] == first && state.graveyard[1] == second);
+    AETestAssert(state.releasedOutOfOrder == 0 && state.releasedBeforeApplied == 0);
+    AETestAssert(kept->magic == kLiveMagic);
+    
+    free(state.renderList);
+    free(kept);
+    free(first);
+    free(second);
+    free(state.graveyard);
+}
+
+static void testAddAndRemoveHundredChannelsPerSecondWhileRendering(void) {
+    stress_state_t state = { 0 };
+    state.queue = AETypedMessageQueueCreate(16384);
+    int changeCount = (int)(kDurationSeconds * kChangesPerSecond);
+    state.graveyard = (channel_t**)malloc(changeCount * sizeof(channel_t*));
+    state.channels = (channel_t**)malloc((kInitialChannels + 1) * sizeof(channel_t*));
+    for ( int i=0; i<kInitialChannels; i++ ) {
+        state.channels[state.channelCount++] = createChannel(i < kLastChannels);
+    }
+    state.renderList = AERenderListCreate((void**)state.channels, state.channelCount, channelIsLast);
+    state.running = 1;
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, renderThread, &state);
+
+    // Each tick adds one channel and removes another, so 100 of each every second
+    double interval = 1.0 / kChangesPerSecond;
+    double tick = AETestSeconds();
+    unsigned int seed = 1;
+    for ( int i=0; i<changeCount; i++ ) {
+        tick += interval;
+        sleepUntil(tick);
+        AETypedMessageQueueProcessOnMainThread(state.queue);
+        addChannel(&state);
+        removeChannel(&state, rand_r(&seed) % state.channelCount);
+    }
+
+    // Let the render thread take the last changes, then stop it and collect what's left
+    sleepUntil(AETestSeconds() + 0.05);
+    state.running = 0;
+    pthread_join(thread, NULL);
+    AETypedMessageQueueProcessOnMainThread(state.queue);
+    AETypedMessageQueueProcessOnRealtimeThread(state.queue);
+    AETypedMessageQueueProcessOnMainThread(state.queue);
+
+    printf("     %d topology changes over %.0f s, %d render cycles: %d overruns, %d woken late, %d released channels rendered, worst cycle %.0f us of %.0f us\n",
+           state.updatesPublished, kDurationSeconds, state.cycles, state.overruns, state.lateCycles, state.releasedChannelsRendered,
+           state.worstCycle * 1.0e6, kFrames / kSampleRate * 1.0e6);
+
+    AETestAssert(state.releasedChannelsRendered == 0);
+    AETestAssert(state.lastChannelsOutOfOrder == 0);
+    AETestAssert(state.updatesFinished == state.updatesPublished);
+    AETestAssert(state.channelsReleased == changeCount);
+    AETestAssert(state.releasedBeforeApplied == 0);
+    AETestAssert(state.releasedOutOfOrder == 0);
+    AETestAssert(state.renderList->count == state.channelCount && state.channelCount == kInitialChannels);
+    AETestAssert(state.overruns == 0);
+
+    for ( int i=0; i<state.channelCount; i++ ) {
+        free(state.channels[i]);
+    }
+    free(state.channels);
+    free(state.renderList);
+    for ( int i=0; i<state.channelsReleased; i++ ) {
+        free(state.graveyard[i]);
+    }
+    free(state.graveyard);
+    AETypedMessageQueueDestroy(state.queue);
+}
+
+int main(int argc, char *argv[]) {
+    AETestRun(testListPutsLastChannelsAfterOthers);
+    AETestRun(testUpdateReleasesChannelsAfterSwap);
+    AETestRun(testAddAndRemoveHundredChannelsPerSecondWhileRendering);
+    return AETestExitStatus();
+}
@@ -0,0 +1,190 @@
+//
+//  AETypedMessageQueueTests.c
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+// Typed messages sent from several threads at once, as the realtime thread and the
+// parallel render workers do when sending to the main thread. The benchmark measures the
+// cost of sending and processing a message in each direction; AEMessageQueueBenchmarks.m
+// compares it with block messages on macOS.
+
+#include "AETest.h"
+#include "AETypedMessageQueue.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kSenders 4
+#define kMessagesPerSender 50000
+#define kBenchmarkMessages 2000000
+#define kBenchmarkBurst 32
+
+typedef struct {
+    int sender;
+    int sequence;
+} payload_t;
+
+static AETypedMessageQueue *queue;
+static int received[kSenders];
+static int outOfOrder;
+static int malformed;
+
+static void receive(const void *payload, int payloadLength) {
+    if ( payloadLength != sizeof(payload_t) ) {
+        malformed++;
+        return;
+    }
+    const payload_t *message = (const payload_t*)payload;
+    if ( message->sender < 0 || message->sender >= kSenders ) {
+        malformed++;
+        return;
+    }
+    if ( message->sequence != received[message->sender] ) {
+        outOfOrder++;
+    }
+    received[message->sender] = message->sequence + 1;
+}
+
+static void *sendToMainThread(void *arg) {
+    payload_t payload = { .sender = (int)(intptr_t)arg };
+    for ( payload.sequence = 0; payload.sequence < kMessagesPerSender; ) {
+        if ( AETypedMessageQueueSendToMainThread(queue, receive, &payload, sizeof(payload)) ) {
+            payload.sequence++;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *sendToRealtimeThread(void *arg) {
+    payload_t payload = { .sender = (int)(intptr_t)arg };
+    for ( payload.sequence = 0; payload.sequence < kMessagesPerSender; ) {
+        if ( AETypedMessageQueueSendToRealtimeThread(queue, receive, &payload, sizeof(payload)) ) {
+            payload.sequence++;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void runSenders(void *(*sender)(void*), int (*process)(AETypedMessageQueue*)) {
+    memset(received, 0, sizeof(received));
+    outOfOrder = malformed = 0;
+    queue = AETypedMessageQueueCreate(4096);
+    
+    pthread_t threads[kSenders];
+    for ( int i=0; i<kSenders; i++ ) {
+        pthread_create(&threads[i], NULL, sender, (void*)(intptr_t)i);
+    }
+    
+    int total = 0;
+    while ( total < kSenders * kMessagesPerSender ) {
+        int count = process(queue);
+        if ( !count ) sched_yield();
+        total += count;
+    }
+    
+    for ( int i=0; i<kSenders; i++ ) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    AETypedMessageQueueDestroy(queue);
+}
+
+static void testSeveralThreadsSendToMainThread(void) {
+    runSenders(sendToMainThread, AETypedMessageQueueProcessOnMainThread);
+    AETestAssert(malformed == 0);
+    AETestAssert(outOfOrder == 0);
+    for ( int i=0; i<kSenders; i++ ) {
+        AETestAssert(received[i] == kMessagesPerSender);
+    }
+}
+
+static void testSeveralThreadsSendToRealtimeThread(void) {
+    runSenders(sendToRealtimeThread, AETypedMessageQueueProcessOnRealtimeThread);
+    AETestAssert(malformed == 0);
+    AETestAssert(outOfOrder == 0);
+    for ( int i=0; i<kSenders; i++ ) {
+        AETestAssert(received[i] == kMessagesPerSender);
+    }
+}
+
+static void testFullQueueRejectsMessages(void) {
+    queue = AETypedMessageQueueCreate(4096);
+    payload_t payload = { 0, 0 };
+    int sent = 0;
+    while ( AETypedMessageQueueSendToMainThread(queue, receive, &payload, sizeof(payload)) ) {
+        sent++;
+        AETestAssert(sent < 1000);
+    }
+    AETestAssert(sent > 0);
+    AETestAssert(AETypedMessageQueueHasMainThreadMessages(queue));
+    memset(received, 0, sizeof(received));
+    outOfOrder = malformed = 0;
+    AETestAssert(AETypedMessageQueueProcessOnMainThread(queue) == sent);
+    AETestAssert(!AETypedMessageQueueHasMainThreadMessages(queue));
+    AETestAssert(AETypedMessageQueueSendToMainThread(queue, receive, &payload, sizeof(payload)));
+    AETypedMessageQueueDestroy(queue);
+}
+
+static int64_t benchmarkTotal;
+
+static void accumulate(const void *payload, int payloadLength) {
+    const int64_t *value = (const int64_t*)payload;
+    benchmarkTotal += value[0] + value[1];
+}
+
+static double timeSendAndProcess(bool (*send)(AETypedMessageQueue*, AETypedMessageHandler, const void*, int),
+                                 int (*process)(AETypedMessageQueue*)) {
+    // Bursts of messages, each then processed at once, as from a slider drag between render cycles
+    queue = AETypedMessageQueueCreate(8192);
+    benchmarkTotal = 0;
+    int64_t payload[2] = { 1, 2 };
+    double start = AETestSeconds();
+    for ( int i=0; i<kBenchmarkMessages; i += kBenchmarkBurst ) {
+        for ( int j=0; j<kBenchmarkBurst; j++ ) {
+            send(queue, accumulate, payload, sizeof(payload));
+        }
+        process(queue);
+    }
+    double seconds = AETestSeconds() - start;
+    AETypedMessageQueueDestroy(queue);
+    return benchmarkTotal == (int64_t)kBenchmarkMessages * 3 ? seconds : -1;
+}
+
+static void benchmarkSendAndProcess(void) {
+    double toRealtimeThread = timeSendAndProcess(AETypedMessageQueueSendToRealtimeThread, AETypedMessageQueueProcessOnRealtimeThread);
+    double toMainThread = timeSendAndProcess(AETypedMessageQueueSendToMainThread, AETypedMessageQueueProcessOnMainThread);
+    AETestAssert(toRealtimeThread > 0 && toMainThread > 0);
+    printf("     to realtime thread: %.1f ns per message sent and processed\n", toRealtimeThread * 1.0e9 / kBenchmarkMessages);
+    printf("     to main thread:     %.1f ns per message sent and processed\n", toMainThread * 1.0e9 / kBenchmarkMessages);
+}
+
+int main(int argc, char *argv[]) {
+    AETestRun(testSeveralThreadsSendToMainThread);
+    AETestRun(testSeveralThreadsSendToRealtimeThread);
+    AETestRun(testFullQueueRejectsMessages);
+    AETestRun(benchmarkSendAndProcess);
+    return AETestExitStatus();
+}
@@ -0,0 +1,110 @@
+//
+//  AudioToolbox.h
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+// The subset of the Core Audio types used by the pure C sources, so that they can be
+// built and tested on platforms without AudioToolbox. Layouts match CoreAudioTypes.h.
+
+#ifndef AETests_AudioToolbox_h
+#define AETests_AudioToolbox_h
+
+// AudioToolbox brings these in on Apple platforms
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+
+typedef uint8_t  Boolean;
+typedef int16_t  SInt16;
+typedef uint16_t UInt16;
+typedef int32_t  SInt32;
+typedef uint32_t UInt32;
+typedef int64_t  SInt64;
+typedef uint64_t UInt64;
+typedef float    Float32;
+typedef double   Float64;
+typedef SInt32   OSStatus;
+
+enum { noErr = 0 };
+
+typedef struct AudioBuffer {
+    UInt32 mNumberChannels;
+    UInt32 mDataByteSize;
+    void  *mData;
+} AudioBuffer;
+
+typedef struct AudioBufferList {
+    UInt32      mNumberBuffers;
+    AudioBuffer mBuffers[1];
+} AudioBufferList;
+
+typedef struct SMPTETime {
+    SInt16 mSubframes;
+    SInt16 mSubframeDivisor;
+    UInt32 mCounter;
+    UInt32 mType;
+    UInt32 mFlags;
+    SInt16 mHours;
+    SInt16 mMinutes;
+    SInt16 mSeconds;
+    SInt16 mFrames;
+} SMPTETime;
+
+typedef struct AudioTimeStamp {
+    Float64   mSampleTime;
+    UInt64    mHostTime;
+    Float64   mRateScalar;
+    UInt64    mWordClockTime;
+    SMPTETime mSMPTETime;
+    UInt32    mFlags;
+    UInt32    mReserved;
+} AudioTimeStamp;
+
+enum {
+    kAudioTimeStampSampleTimeValid    = (1U << 0),
+    kAudioTimeStampHostTimeValid      = (1U << 1),
+    kAudioTimeStampRateScalarValid    = (1U << 2),
+    kAudioTimeStampWordClockTimeValid = (1U << 3),
+    kAudioTimeStampSMPTETimeValid     = (1U << 4),
+    kAudioTimeStampSampleHostTimeValid = (kAudioTimeStampSampleTimeValid | kAudioTimeStampHostTimeValid)
+};
+
+typedef struct AudioStreamBasicDescription {
+    Float64 mSampleRate;
+    UInt32  mFormatID;
+    UInt32  mFormatFlags;
+    UInt32  mBytesPerPacket;
+    UInt32  mFramesPerPacket;
+    UInt32  mBytesPerFrame;
+    UInt32  mChannelsPerFrame;
+    UInt32  mBitsPerChannel;
+    UInt32  mReserved;
+} AudioStreamBasicDescription;
+
+enum {
+    kAudioFormatLinearPCM             = 0x6C70636D, // 'lpcm'
+    kAudioFormatFlagIsFloat           = (1U << 0),
+    kAudioFormatFlagIsPacked          = (1U << 3),
+    kAudioFormatFlagIsNonInterleaved  = (1U << 5),
+    kAudioFormatFlagsNativeFloatPacked = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked
+};
+
+#endif
@@ -0,0 +1,50 @@
+//
+//  mach_time.h
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+// mach_time in terms of the POSIX monotonic clock, for building the pure C sources
+// on platforms without Mach. Host ticks are nanoseconds.
+
+#ifndef AETests_mach_time_h
+#define AETests_mach_time_h
+
+#include <stdint.h>
+#include <time.h>
+
+typedef struct mach_timebase_info {
+    uint32_t numer;
+    uint32_t denom;
+} mach_timebase_info_data_t;
+
+static inline int mach_timebase_info(mach_timebase_info_data_t *info) {
+    info->numer = 1;
+    info->denom = 1;
+    return 0;
+}
+
+static inline uint64_t mach_absolute_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+#endif
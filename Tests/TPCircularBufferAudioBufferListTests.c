@@ -0,0 +1,305 @@
+//
+//  TPCircularBufferAudioBufferListTests.c
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+// Buffer lists queued on a TPCircularBuffer in one process: the overwrite-oldest overflow
+// policy, and the running frame index behind the peek functions, checked against walking
+// the queue and timed on a queue fragmented into small buffer lists.
+
+#include "AETest.h"
+#include "TPCircularBuffer.h"
+#include "TPCircularBuffer+AudioBufferList.h"
+#include <stdlib.h>
+
+#define kChannels 2
+#define kFramesPerBlock 64
+#define kMaxFramesPerBlock 256
+#define kBufferLength 16384
+#define kFragmentedBufferLength (1024 * 1024)
+#define kPeekIterations 2000
+
+static const AudioStreamBasicDescription kAudioDescription = {
+    .mSampleRate       = 44100.0,
+    .mFormatID         = kAudioFormatLinearPCM,
+    .mFormatFlags      = kAudioFormatFlagsNativeFloatPacked | kAudioFormatFlagIsNonInterleaved,
+    .mBytesPerPacket   = sizeof(float),
+    .mFramesPerPacket  = 1,
+    .mBytesPerFrame    = sizeof(float),
+    .mChannelsPerFrame = kChannels,
+    .mBitsPerChannel   = 32
+};
+
+static float sampleValue(int channel, UInt32 frame) {
+    return channel * 100000.0f + frame;
+}
+
+static AudioBufferList *allocateBufferList(void) {
+    AudioBufferList *bufferList = (AudioBufferList*)malloc(sizeof(AudioBufferList) + (kChannels-1) * sizeof(AudioBuffer));
+    bufferList->mNumberBuffers = kChannels;
+    return bufferList;
+}
+
+static bool produceFrames(TPCircularBuffer *buffer, UInt32 firstFrame, UInt32 frames) {
+    float data[kChannels][kMaxFramesPerBlock];
+    AudioBufferList *bufferList = allocateBufferList();
+    for ( int channel=0; channel<kChannels; channel++ ) {
+        for ( UInt32 frame=0; frame<frames; frame++ ) {
+            data[channel][frame] = sampleValue(channel, firstFrame + frame);
+        }
+        bufferList->mBuffers[channel].mNumberChannels = 1;
+        bufferList->mBuffers[channel].mDataByteSize = frames * sizeof(float);
+        bufferList->mBuffers[channel].mData = data[channel];
+    }
+    AudioTimeStamp timestamp = { .mSampleTime = firstFrame, .mFlags = kAudioTimeStampSampleTimeValid };
+    bool copied = TPCircularBufferCopyAudioBufferList(buffer, bufferList, &timestamp, kTPCircularBufferCopyAll, &kAudioDescription);
+    free(bufferList);
+    return copied;
+}
+
+static bool produceBlock(TPCircularBuffer *buffer, UInt32 firstFrame) {
+    return produceFrames(buffer, firstFrame, kFramesPerBlock);
+}
+
+static bool nextBlockStartsAt(TPCircularBuffer *buffer, UInt32 frame) {
+    AudioTimeStamp timestamp;
+    AudioBufferList *bufferList = TPCircularBufferNextBufferList(buffer, &timestamp);
+    return bufferList
+        && timestamp.mSampleTime == frame
+        && ((float*)bufferList->mBuffers[kChannels-1].mData)[0] == sampleValue(kChannels-1, frame);
+}
+
+static UInt32 blockCapacity(void) {
+    // The number of blocks that fit, found by filling a buffer that refuses new data when full
+    TPCircularBuffer buffer;
+    TPCircularBufferInit(&buffer, kBufferLength);
+    UInt32 blocks = 0;
+    while ( produceBlock(&buffer, blocks * kFramesPerBlock) ) blocks++;
+    TPCircularBufferCleanup(&buffer);
+    return blocks;
+}
+
+static void testOverwriteDiscardsOldestWhenFull(void) {
+    UInt32 capacity = blockCapacity();
+    AETestAssert(capacity > 4);
+
+    TPCircularBuffer buffer;
+    TPCircularBufferInit(&buffer, kBufferLength);
+    TPCircularBufferSetOverwriteOldest(&buffer, true);
+
+    for ( UInt32 i=0; i<capacity + 5; i++ ) {
+        AETestAssert(produceBlock(&buffer, i * kFramesPerBlock));
+    }
+
+    // Each block beyond capacity displaced exactly one of the oldest
+    AETestAssert(TPCircularBufferGetOverrunCount(&buffer) == 5);
+    AETestAssert(TPCircularBufferPeek(&buffer, NULL, &kAudioDescription) == capacity * kFramesPerBlock);
+    AETestAssert(nextBlockStartsAt(&buffer, 5 * kFramesPerBlock));
+
+    TPCircularBufferCleanup(&buffer);
+}
+
+static void testClaimedBlockIsKeptAndNewestDropped(void) {
+    UInt32 capacity = blockCapacity();
+
+    TPCircularBuffer buffer;
+    TPCircularBufferInit(&buffer, kBufferLength);
+    TPCircularBufferSetOverwriteOldest(&buffer, true);
+
+    for ( UInt32 i=0; i<capacity; i++ ) {
+        AETestAssert(produceBlock(&buffer, i * kFramesPerBlock));
+    }
+
+    // While the consumer is reading the oldest block, the producer mustn't discard it
+    AETestAssert(nextBlockStartsAt(&buffer, 0));
+    AETestAssert(!produceBlock(&buffer, capacity * kFramesPerBlock));
+    AETestAssert(TPCircularBufferGetOverrunCount(&buffer) == 1);
+    AETestAssert(nextBlockStartsAt(&buffer, 0));
+
+    // Consuming releases the claim
+    TPCircularBufferConsumeNextBufferList(&buffer);
+    AETestAssert(produceBlock(&buffer, (capacity + 1) * kFramesPerBlock));
+    AETestAssert(produceBlock(&buffer, (capacity + 2) * kFramesPerBlock));
+    AETestAssert(TPCircularBufferGetOverrunCount(&buffer) == 2);
+    AETestAssert(nextBlockStartsAt(&buffer, 2 * kFramesPerBlock));
+
+    TPCircularBufferCleanup(&buffer);
+}
+
+static void testDrainedConsumerDoesNotBlockOverwrite(void) {
+    UInt32 capacity = blockCapacity();
+
+    TPCircularBuffer buffer;
+    TPCircularBufferInit(&buffer, kBufferLength);
+    TPCircularBufferSetOverwriteOldest(&buffer, true);
+
+    // The consumer drains the queue with each of the consuming functions, every one of
+    // which ends by finding the buffer empty
+    UInt32 frame = 0;
+    for ( int i=0; i<3; i++, frame += kFramesPerBlock ) {
+        AETestAssert(produceBlock(&buffer, frame));
+    }
+    float data[kChannels][kFramesPerBlock * 4];
+    AudioBufferList *output = allocateBufferList();
+    for ( int channel=0; channel<kChannels; channel++ ) {
+        output->mBuffers[channel].mNumberChannels = 1;
+        output->mBuffers[channel].mDataByteSize = sizeof(data[channel]);
+        output->mBuffers[channel].mData = data[channel];
+    }
+    UInt32 frames = kFramesPerBlock * 4;
+    TPCircularBufferDequeueBufferListFrames(&buffer, &frames, output, NULL, &kAudioDescription);
+    free(output);
+    AETestAssert(frames == 3 * kFramesPerBlock);
+    AETestAssert(TPCircularBufferNextBufferList(&buffer, NULL) == NULL);
+    TPCircularBufferConsumeNextBufferList(&buffer);
+    TPCircularBufferClear(&buffer);
+
+    // ...then stalls, while the producer carries on well past capacity
+    UInt32 firstAfterStall = frame;
+    for ( UInt32 i=0; i<capacity + 7; i++, frame += kFramesPerBlock ) {
+        AETestAssert(produceBlock(&buffer, frame));
+    }
+
+    // The producer kept the newest audio, displacing the oldest
+    AETestAssert(TPCircularBufferGetOverrunCount(&buffer) == 7);
+    AETestAssert(TPCircularBufferPeek(&buffer, NULL, &kAudioDescription) == capacity * kFramesPerBlock);
+    AETestAssert(nextBlockStartsAt(&buffer, firstAfterStall + 7 * kFramesPerBlock));
+
+    TPCircularBufferCleanup(&buffer);
+}
+
+static UInt32 walkQueuedFrames(TPCircularBuffer *buffer, AudioTimeStamp *outTimestamp, UInt32 contiguousToleranceSampleTime) {
+    // Total the queued frames by visiting every queued buffer list, as the peek functions used to
+    AudioTimeStamp timestamp;
+    AudioBufferList *bufferList = TPCircularBufferNextBufferList(buffer, &timestamp);
+    if ( outTimestamp ) *outTimestamp = timestamp;
+    UInt32 frames = 0;
+    while ( bufferList ) {
+        UInt32 bufferFrames = bufferList->mBuffers[0].mDataByteSize / kAudioDescription.mBytesPerFrame;
+        frames += bufferFrames;
+        AudioTimeStamp nextTimestamp;
+        bufferList = TPCircularBufferNextBufferListAfter(buffer, bufferList, &nextTimestamp);
+        if ( bufferList && contiguousToleranceSampleTime != UINT32_MAX
+                && fabs(nextTimestamp.mSampleTime - (timestamp.mSampleTime + bufferFrames)) > contiguousToleranceSampleTime ) {
+            break;
+        }
+        timestamp = nextTimestamp;
+    }
+    return frames;
+}
+
+static void dequeueFrames(TPCircularBuffer *buffer, UInt32 frames, bool discard) {
+    float data[kChannels][kMaxFramesPerBlock * 2];
+    AudioBufferList *output = NULL;
+    if ( !discard ) {
+        output = allocateBufferList();
+        for ( int channel=0; channel<kChannels; channel++ ) {
+            output->mBuffers[channel].mNumberChannels = 1;
+            output->mBuffers[channel].mDataByteSize = frames * sizeof(float);
+            output->mBuffers[channel].mData = data[channel];
+        }
+    }
+    TPCircularBufferDequeueBufferListFrames(buffer, &frames, output, NULL, &kAudioDescription);
+    free(output);
+}
+
+static void testPeekMatchesWalkingTheQueue(void) {
+    TPCircularBuffer buffer;
+    TPCircularBufferInit(&buffer, kBufferLength * 4);
+
+    // Random buffer list lengths, occasional gaps in the sample times, and partial consumption,
+    // so the tail is often part-way through a buffer list
+    unsigned int seed = 3;
+    UInt32 nextFrame = 0;
+    int comparisons = 0;
+    for ( int step=0; step<5000; step++ ) {
+        if ( rand_r(&seed) % 3 != 0 ) {
+            UInt32 frames = 16 + rand_r(&seed) % (kMaxFramesPerBlock - 16);
+            if ( rand_r(&seed) % 8 == 0 ) nextFrame += 1 + rand_r(&seed) % 5;
+            if ( produceFrames(&buffer, nextFrame, frames) ) nextFrame += frames;
+        } else {
+            dequeueFrames(&buffer, 1 + rand_r(&seed) % (kMaxFramesPerBlock * 2 - 1), rand_r(&seed) % 2);
+        }
+
+        const UInt32 tolerances[] = { UINT32_MAX, 0, 2 };
+        for ( int t=0; t<sizeof(tolerances)/sizeof(tolerances[0]); t++ ) {
+            AudioTimeStamp walkedTimestamp, peekedTimestamp;
+            UInt32 walked = walkQueuedFrames(&buffer, &walkedTimestamp, tolerances[t]);
+            UInt32 peeked = tolerances[t] == UINT32_MAX
+                ? TPCircularBufferPeek(&buffer, &peekedTimestamp, &kAudioDescription)
+                : TPCircularBufferPeekContiguous(&buffer, &peekedTimestamp, &kAudioDescription, tolerances[t]);
+            AETestAssert(peeked == walked);
+            AETestAssert(!walked || peekedTimestamp.mSampleTime == walkedTimestamp.mSampleTime);
+            comparisons++;
+        }
+    }
+    AETestAssert(comparisons == 15000);
+
+    TPCircularBufferCleanup(&buffer);
+}
+
+static void benchmarkPeekFragmentedQueue(void) {
+    TPCircularBuffer buffer;
+    TPCircularBufferInit(&buffer, kFragmentedBufferLength);
+
+    // Fill the buffer with 64-frame buffer lists
+    UInt32 blocks = 0;
+    while ( produceBlock(&buffer, blocks * kFramesPerBlock) ) blocks++;
+
+    UInt32 frames = 0;
+    double start = AETestSeconds();
+    for ( int i=0; i<kPeekIterations; i++ ) {
+        frames += walkQueuedFrames(&buffer, NULL, UINT32_MAX);
+    }
+    double walkSeconds = AETestSeconds() - start;
+    AETestAssert(frames == kPeekIterations * blocks * kFramesPerBlock);
+
+    frames = 0;
+    start = AETestSeconds();
+    for ( int i=0; i<kPeekIterations; i++ ) {
+        frames += TPCircularBufferPeek(&buffer, NULL, &kAudioDescription);
+    }
+    double peekSeconds = AETestSeconds() - start;
+    AETestAssert(frames == kPeekIterations * blocks * kFramesPerBlock);
+
+    frames = 0;
+    start = AETestSeconds();
+    for ( int i=0; i<kPeekIterations; i++ ) {
+        frames += TPCircularBufferPeekContiguous(&buffer, NULL, &kAudioDescription, 0);
+    }
+    double contiguousSeconds = AETestSeconds() - start;
+    AETestAssert(frames == kPeekIterations * blocks * kFramesPerBlock);
+
+    printf("     %u queued 64-frame buffer lists: walking %.0f ns, TPCircularBufferPeek %.0f ns, TPCircularBufferPeekContiguous %.0f ns\n",
+           blocks, walkSeconds / kPeekIterations * 1.0e9, peekSeconds / kPeekIterations * 1.0e9, contiguousSeconds / kPeekIterations * 1.0e9);
+    AETestAssert(peekSeconds < walkSeconds && contiguousSeconds < walkSeconds);
+
+    TPCircularBufferCleanup(&buffer);
+}
+
+int main(int argc, char *argv[]) {
+    AETestRun(testOverwriteDiscardsOldestWhenFull);
+    AETestRun(testClaimedBlockIsKeptAndNewestDropped);
+    AETestRun(testDrainedConsumerDoesNotBlockOverwrite);
+    AETestRun(testPeekMatchesWalkingTheQueue);
+    AETestRun(benchmarkPeekFragmentedQueue);
+    return AETestExitStatus();
+}
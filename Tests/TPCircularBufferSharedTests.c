@@ -0,0 +1,168 @@
+//
+//  TPCircularBufferSharedTests.c
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+// Shared memory buffer lists: the producer and consumer map the buffer at different
+// addresses, as they would in different processes.
+
+#include "AETest.h"
+#include "TPCircularBuffer.h"
+#include "TPCircularBuffer+AudioBufferList.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+#define kChannels 2
+#define kFramesPerBlock 64
+
+static const AudioStreamBasicDescription kAudioDescription = {
+    .mSampleRate       = 44100.0,
+    .mFormatID         = kAudioFormatLinearPCM,
+    .mFormatFlags      = kAudioFormatFlagsNativeFloatPacked | kAudioFormatFlagIsNonInterleaved,
+    .mBytesPerPacket   = sizeof(float),
+    .mFramesPerPacket  = 1,
+    .mBytesPerFrame    = sizeof(float),
+    .mChannelsPerFrame = kChannels,
+    .mBitsPerChannel   = 32
+};
+
+static char sharedName[64];
+
+static AudioBufferList *allocateBufferList(void) {
+    AudioBufferList *bufferList = (AudioBufferList*)malloc(sizeof(AudioBufferList) + (kChannels-1) * sizeof(AudioBuffer));
+    bufferList->mNumberBuffers = kChannels;
+    return bufferList;
+}
+
+static float sampleValue(int channel, UInt32 frame) {
+    return channel * 100000.0f + frame;
+}
+
+static bool produceBlock(TPCircularBuffer *buffer, UInt32 firstFrame) {
+    float data[kChannels][kFramesPerBlock];
+    AudioBufferList *bufferList = allocateBufferList();
+    for ( int channel=0; channel<kChannels; channel++ ) {
+        for ( int frame=0; frame<kFramesPerBlock; frame++ ) {
+            data[channel][frame] = sampleValue(channel, firstFrame + frame);
+        }
+        bufferList->mBuffers[channel].mNumberChannels = 1;
+        bufferList->mBuffers[channel].mDataByteSize = sizeof(data[channel]);
+        bufferList->mBuffers[channel].mData = data[channel];
+    }
+    AudioTimeStamp timestamp = { .mSampleTime = firstFrame, .mFlags = kAudioTimeStampSampleTimeValid };
+    bool copied = TPCircularBufferCopyAudioBufferList(buffer, bufferList, &timestamp, kTPCircularBufferCopyAll, &kAudioDescription);
+    free(bufferList);
+    return copied;
+}
+
+static bool isWithinMapping(TPCircularBuffer *buffer, void *pointer) {
+    char *start = (char*)_TPCircularBufferPointer(buffer, 0);
+    return (char*)pointer >= start && (char*)pointer < start + buffer->length * 2;
+}
+
+static bool dequeueAndVerify(TPCircularBuffer *buffer, UInt32 firstFrame, UInt32 frames) {
+    float data[kChannels][kFramesPerBlock * 4];
+    AudioBufferList *bufferList = allocateBufferList();
+    for ( int channel=0; channel<kChannels; channel++ ) {
+        bufferList->mBuffers[channel].mNumberChannels = 1;
+        bufferList->mBuffers[channel].mDataByteSize = frames * sizeof(float);
+        bufferList->mBuffers[channel].mData = data[channel];
+    }
+    UInt32 dequeued = frames;
+    TPCircularBufferDequeueBufferListFrames(buffer, &dequeued, bufferList, NULL, &kAudioDescription);
+    free(bufferList);
+    if ( dequeued != frames ) return false;
+    for ( int channel=0; channel<kChannels; channel++ ) {
+        for ( UInt32 frame=0; frame<frames; frame++ ) {
+            if ( data[channel][frame] != sampleValue(channel, firstFrame + frame) ) return false;
+        }
+    }
+    return true;
+}
+
+static void testConsumerReadsThroughItsOwnMapping(void) {
+    TPCircularBuffer *producer = TPCircularBufferCreateShared(sharedName, 16384);
+    AETestAssert(producer);
+    TPCircularBuffer *consumer = TPCircularBufferOpenShared(sharedName);
+    AETestAssert(consumer);
+    AETestAssert(consumer != producer);
+    
+    for ( int i=0; i<3; i++ ) {
+        AETestAssert(produceBlock(producer, i * kFramesPerBlock));
+    }
+    
+    // Drop the producer's mapping, so any pointer into it faults
+    TPCircularBufferCloseShared(producer);
+    
+    AudioBufferList *bufferList = TPCircularBufferNextBufferList(consumer, NULL);
+    AETestAssert(bufferList && bufferList->mNumberBuffers == kChannels);
+    for ( int channel=0; channel<kChannels; channel++ ) {
+        AETestAssert(isWithinMapping(consumer, bufferList->mBuffers[channel].mData));
+        AETestAssert(((float*)bufferList->mBuffers[channel].mData)[1] == sampleValue(channel, 1));
+    }
+    
+    AudioBufferList *nextBufferList = TPCircularBufferNextBufferListAfter(consumer, bufferList, NULL);
+    AETestAssert(nextBufferList && isWithinMapping(consumer, nextBufferList->mBuffers[1].mData));
+    AETestAssert(((float*)nextBufferList->mBuffers[1].mData)[0] == sampleValue(1, kFramesPerBlock));
+    
+    // Spans a partially-consumed block
+    AETestAssert(TPCircularBufferPeek(consumer, NULL, &kAudioDescription) == 3 * kFramesPerBlock);
+    AETestAssert(dequeueAndVerify(consumer, 0, kFramesPerBlock + 10));
+    AETestAssert(dequeueAndVerify(consumer, kFramesPerBlock + 10, 2 * kFramesPerBlock - 10));
+    AETestAssert(TPCircularBufferNextBufferList(consumer, NULL) == NULL);
+    
+    TPCircularBufferCloseShared(consumer);
+}
+
+static void testPartialConsumeWhileProducing(void) {
+    TPCircularBuffer *producer = TPCircularBufferCreateShared(sharedName, 16384);
+    AETestAssert(producer);
+    TPCircularBuffer *consumer = TPCircularBufferOpenShared(sharedName);
+    AETestAssert(consumer);
+    
+    UInt32 produced = 0;
+    UInt32 consumed = 0;
+    for ( int cycle=0; cycle<500; cycle++ ) {
+        // Consume in steps that don't line up with the blocks, so the queue wraps with partly-consumed blocks at the tail
+        while ( produced - consumed < 3 * kFramesPerBlock ) {
+            if ( !produceBlock(producer, produced) ) break;
+            produced += kFramesPerBlock;
+        }
+        UInt32 frames = 37 + (cycle % 5) * 11;
+        AETestAssert(dequeueAndVerify(consumer, consumed, frames));
+        consumed += frames;
+        
+        AudioBufferList *bufferList = TPCircularBufferNextBufferList(consumer, NULL);
+        AETestAssert(bufferList && isWithinMapping(consumer, bufferList->mBuffers[kChannels-1].mData));
+        AETestAssert(((float*)bufferList->mBuffers[kChannels-1].mData)[0] == sampleValue(kChannels-1, consumed));
+    }
+    
+    TPCircularBufferCloseShared(consumer);
+    TPCircularBufferCloseShared(producer);
+}
+
+int main(int argc, char *argv[]) {
+    snprintf(sharedName, sizeof(sharedName), "/AETests.%d", (int)getpid());
+    AETestRun(testConsumerReadsThroughItsOwnMapping);
+    AETestRun(testPartialConsumeWhileProducing);
+    TPCircularBufferUnlinkShared(sharedName);
+    return AETestExitStatus();
+}
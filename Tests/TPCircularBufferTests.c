@@ -0,0 +1,327 @@
+//
+//  TPCircularBufferTests.c
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+// The byte-level TPCircularBuffer: the mirrored mapping, throughput against a conventional
+// ring that wraps its indices with a modulo and splits copies at the end, and messages
+// passed between two threads, one at a time and in batches.
+
+#include "AETest.h"
+#include "TPCircularBuffer.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#define kBufferLength 65536
+#define kBenchmarkBytes (256 * 1024 * 1024)
+#define kPingPongRoundTrips 100000
+#define kStreamedMessages 2000000
+#define kBatchLength 32
+
+typedef struct {
+    uint64_t sequence;
+    uint64_t payload;
+} message_t;
+
+// A ring without the mirror: indices count up forever and are reduced modulo the length,
+// and a record that crosses the end of the memory is copied in two parts
+typedef struct {
+    char *memory;
+    uint32_t length;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+} modulo_ring_t;
+
+static bool moduloRingProduceBytes(modulo_ring_t *ring, const void *src, uint32_t len) {
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if ( ring->length - (head - tail) < len ) return false;
+    uint32_t offset = head % ring->length;
+    uint32_t first = ring->length - offset < len ? ring->length - offset : len;
+    memcpy(ring->memory + offset, src, first);
+    memcpy(ring->memory, (const char*)src + first, len - first);
+    __atomic_store_n(&ring->head, head + len, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool moduloRingConsumeBytes(modulo_ring_t *ring, void *dst, uint32_t len) {
+    uint32_t tail = ring->tail;
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if ( head - tail < len ) return false;
+    uint32_t offset = tail % ring->length;
+    uint32_t first = ring->length - offset < len ? ring->length - offset : len;
+    memcpy(dst, ring->memory + offset, first);
+    memcpy((char*)dst + first, ring->memory, len - first);
+    __atomic_store_n(&ring->tail, tail + len, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool circularBufferConsumeBytes(TPCircularBuffer *buffer, void *dst, int32_t len) {
+    int32_t available;
+    void *tail = TPCircularBufferTail(buffer, &available);
+    if ( available < len ) return false;
+    memcpy(dst, tail, len);
+    TPCircularBufferConsume(buffer, len);
+    return true;
+}
+
+static void fillRecord(char *record, uint32_t length, uint32_t sequence) {
+    for ( uint32_t i=0; i<length; i++ ) {
+        record[i] = (char)(sequence + i);
+    }
+}
+
+static void testMirrorPresentsWrappedDataContiguously(void) {
+    TPCircularBuffer buffer;
+    AETestAssert(TPCircularBufferInit(&buffer, kBufferLength));
+    AETestAssert(buffer.length >= kBufferLength);
+
+    // Move the tail to just before the end of the memory, then write a record across it
+    char filler[1000];
+    char record[3000];
+    char readBack[3000];
+    memset(filler, 0, sizeof(filler));
+    int32_t offset = 0;
+    while ( offset + (int32_t)sizeof(filler) < buffer.length - 100 ) {
+        AETestAssert(TPCircularBufferProduceBytes(&buffer, filler, sizeof(filler)));
+        AETestAssert(circularBufferConsumeBytes(&buffer, readBack, sizeof(filler)));
+        offset += sizeof(filler);
+    }
+    fillRecord(record, sizeof(record), 7);
+    AETestAssert(TPCircularBufferProduceBytes(&buffer, record, sizeof(record)));
+
+    int32_t available;
+    char *tail = (char*)TPCircularBufferTail(&buffer, &available);
+    AETestAssert(available == sizeof(record));
+    AETestAssert(memcmp(tail, record, sizeof(record)) == 0);
+
+    // The part past the end is the start of the same memory
+    AETestAssert(tail + sizeof(record) > (char*)_TPCircularBufferPointer(&buffer, 0) + buffer.length);
+    AETestAssert(*((char*)_TPCircularBufferPointer(&buffer, 0)) == record[buffer.length - offset]);
+
+    TPCircularBufferCleanup(&buffer);
+}
+
+static bool onSeparateCacheLines(const volatile void *a, size_t aLength, const volatile void *b, size_t bLength) {
+    uintptr_t aFirst = (uintptr_t)a / kTPCircularBufferCacheLineSize, aLast = ((uintptr_t)a + aLength - 1) / kTPCircularBufferCacheLineSize;
+    uintptr_t bFirst = (uintptr_t)b / kTPCircularBufferCacheLineSize, bLast = ((uintptr_t)b + bLength - 1) / kTPCircularBufferCacheLineSize;
+    return aLast < bFirst || bLast < aFirst;
+}
+
+static void testIndicesStayApartWithinMallocedStructures(void) {
+    // Embedded at every 8-byte offset within a malloc'd structure, as in the engine's channel
+    // records and Objective-C ivars, which only guarantee 16-byte alignment
+    for ( size_t offset=0; offset<kTPCircularBufferCacheLineSize; offset += 8 ) {
+        char *memory = (char*)malloc(offset + sizeof(TPCircularBuffer) + kTPCircularBufferCacheLineSize);
+        TPCircularBuffer *buffer = (TPCircularBuffer*)(memory + offset);
+        char *following = (char*)(buffer + 1);
+
+        AETestAssert(onSeparateCacheLines(&buffer->length, sizeof(buffer->length), &buffer->tail, sizeof(buffer->tail)));
+        AETestAssert(onSeparateCacheLines(&buffer->tail, 2 * sizeof(int32_t), &buffer->head, sizeof(buffer->head)));
+        AETestAssert(onSeparateCacheLines(&buffer->tail, 2 * sizeof(int32_t), &buffer->overruns, sizeof(buffer->overruns)));
+        AETestAssert(onSeparateCacheLines(&buffer->head, (char*)&buffer->overruns + sizeof(buffer->overruns) - (char*)&buffer->head, following, 1));
+
+        free(memory);
+    }
+}
+
+static void benchmarkThroughputAgainstModuloRing(void) {
+    // Records that don't divide the buffer length, so copies regularly cross its end
+    const uint32_t recordLengths[] = { 24, 200, 1500, 4100 };
+    char *record = (char*)malloc(8192);
+    char *readBack = (char*)malloc(8192);
+
+    for ( int r=0; r<sizeof(recordLengths)/sizeof(recordLengths[0]); r++ ) {
+        uint32_t length = recordLengths[r];
+        int records = kBenchmarkBytes / length;
+        fillRecord(record, length, r);
+
+        // Keep the ring about half full, as a producer ahead of its consumer would
+        int lead = (kBufferLength / 2) / length;
+
+        TPCircularBuffer buffer;
+        AETestAssert(TPCircularBufferInit(&buffer, kBufferLength));
+        for ( int i=0; i<lead; i++ ) TPCircularBufferProduceBytes(&buffer, record, length);
+        uint64_t mirroredChecksum = 0;
+        double start = AETestSeconds();
+        for ( int i=0; i<records; i++ ) {
+            TPCircularBufferProduceBytes(&buffer, record, length);
+            circularBufferConsumeBytes(&buffer, readBack, length);
+            mirroredChecksum += (unsigned char)readBack[i % length];
+        }
+        double mirroredSeconds = AETestSeconds() - start;
+        TPCircularBufferCleanup(&buffer);
+
+        modulo_ring_t ring = { .memory = (char*)malloc(kBufferLength), .length = kBufferLength };
+        for ( int i=0; i<lead; i++ ) moduloRingProduceBytes(&ring, record, length);
+        uint64_t moduloChecksum = 0;
+        start = AETestSeconds();
+        for ( int i=0; i<records; i++ ) {
+            moduloRingProduceBytes(&ring, record, length);
+            moduloRingConsumeBytes(&ring, readBack, length);
+            moduloChecksum += (unsigned char)readBack[i % length];
+        }
+        double moduloSeconds = AETestSeconds() - start;
+        free(ring.memory);
+
+        AETestAssert(mirroredChecksum == moduloChecksum);
+
+        double bytes = (double)records * length;
+        printf("     %4u-byte records: mirrored %6.0f MB/s, %5.1f ns per record; modulo ring %6.0f MB/s, %5.1f ns per record (%.2fx)\n",
+               length,
+               bytes / mirroredSeconds / 1.0e6, mirroredSeconds / records * 1.0e9,
+               bytes / moduloSeconds / 1.0e6, moduloSeconds / records * 1.0e9,
+               moduloSeconds / mirroredSeconds);
+    }
+
+    free(record);
+    free(readBack);
+}
+
+typedef struct {
+    TPCircularBuffer *ping;
+    TPCircularBuffer *pong;
+    int count;
+    int batchLength;
+    uint64_t checksum;
+} messaging_t;
+
+static void *echoThread(void *userInfo) {
+    // Sends each message straight back
+    messaging_t *messaging = (messaging_t*)userInfo;
+    for ( int i=0; i<messaging->count; i++ ) {
+        int32_t available;
+        message_t *message;
+        while ( !(message = (message_t*)TPCircularBufferTail(messaging->ping, &available)) ) sched_yield();
+        message_t reply = *message;
+        TPCircularBufferConsume(messaging->ping, sizeof(message_t));
+        while ( !TPCircularBufferProduceBytes(messaging->pong, &reply, sizeof(reply)) ) sched_yield();
+    }
+    return NULL;
+}
+
+static void benchmarkTwoThreadPingPong(void) {
+    TPCircularBuffer ping, pong;
+    AETestAssert(TPCircularBufferInit(&ping, 4096) && TPCircularBufferInit(&pong, 4096));
+    messaging_t messaging = { .ping = &ping, .pong = &pong, .count = kPingPongRoundTrips };
+    pthread_t thread;
+    pthread_create(&thread, NULL, echoThread, &messaging);
+
+    bool inOrder = true;
+    double start = AETestSeconds();
+    for ( int i=0; i<kPingPongRoundTrips; i++ ) {
+        message_t message = { .sequence = i, .payload = i * 3 };
+        while ( !TPCircularBufferProduceBytes(&ping, &message, sizeof(message)) ) sched_yield();
+        int32_t available;
+        message_t *reply;
+        while ( !(reply = (message_t*)TPCircularBufferTail(&pong, &available)) ) sched_yield();
+        if ( reply->sequence != i || reply->payload != i * 3 ) inOrder = false;
+        TPCircularBufferConsume(&pong, sizeof(message_t));
+    }
+    double seconds = AETestSeconds() - start;
+    pthread_join(thread, NULL);
+
+    AETestAssert(inOrder);
+    printf("     Ping-pong: %.0f round trips per second, %.2f us per round trip\n",
+           kPingPongRoundTrips / seconds, seconds / kPingPongRoundTrips * 1.0e6);
+
+    TPCircularBufferCleanup(&ping);
+    TPCircularBufferCleanup(&pong);
+}
+
+static void *streamConsumerThread(void *userInfo) {
+    // Reads messages in whatever batches are available, releasing each batch with one consume
+    messaging_t *messaging = (messaging_t*)userInfo;
+    int received = 0;
+    while ( received < messaging->count ) {
+        int32_t batchBytes = 0;
+        message_t *message;
+        while ( (message = (message_t*)TPCircularBufferBatchTail(messaging->ping, batchBytes, sizeof(message_t))) ) {
+            messaging->checksum += message->sequence ^ message->payload;
+            batchBytes += sizeof(message_t);
+            received++;
+        }
+        if ( batchBytes ) {
+            TPCircularBufferConsume(messaging->ping, batchBytes);
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static double streamMessages(int batchLength, uint64_t *outChecksum) {
+    TPCircularBuffer buffer;
+    if ( !TPCircularBufferInit(&buffer, 4096) ) return 0;
+    messaging_t messaging = { .ping = &buffer, .count = kStreamedMessages, .batchLength = batchLength };
+    pthread_t thread;
+    pthread_create(&thread, NULL, streamConsumerThread, &messaging);
+
+    double start = AETestSeconds();
+    for ( int i=0; i<kStreamedMessages; ) {
+        // Publish each batch with one release store
+        int32_t batchBytes = 0;
+        for ( int j=0; j<batchLength && i<kStreamedMessages; ) {
+            message_t message = { .sequence = i, .payload = i * 3 };
+            if ( TPCircularBufferBatchProduceBytes(&buffer, &message, sizeof(message), &batchBytes) ) {
+                i++;
+                j++;
+            } else if ( batchBytes ) {
+                break;
+            } else {
+                sched_yield();
+            }
+        }
+        TPCircularBufferProduce(&buffer, batchBytes);
+    }
+    pthread_join(thread, NULL);
+    double seconds = AETestSeconds() - start;
+
+    *outChecksum = messaging.checksum;
+    TPCircularBufferCleanup(&buffer);
+    return seconds;
+}
+
+static void benchmarkTwoThreadStreaming(void) {
+    uint64_t expectedChecksum = 0;
+    for ( uint64_t i=0; i<kStreamedMessages; i++ ) expectedChecksum += i ^ (i * 3);
+
+    uint64_t singleChecksum, batchedChecksum;
+    double singleSeconds = streamMessages(1, &singleChecksum);
+    double batchedSeconds = streamMessages(kBatchLength, &batchedChecksum);
+    AETestAssert(singleSeconds > 0 && batchedSeconds > 0);
+    AETestAssert(singleChecksum == expectedChecksum && batchedChecksum == expectedChecksum);
+
+    printf("     Streaming %d-byte messages: %.1fM per second one at a time, %.1fM per second in batches of %d (%.2fx)\n",
+           (int)sizeof(message_t),
+           kStreamedMessages / singleSeconds / 1.0e6, kStreamedMessages / batchedSeconds / 1.0e6, kBatchLength,
+           singleSeconds / batchedSeconds);
+}
+
+int main(int argc, char *argv[]) {
+    AETestRun(testMirrorPresentsWrappedDataContiguously);
+    AETestRun(testIndicesStayApartWithinMallocedStructures);
+    AETestRun(benchmarkThroughputAgainstModuloRing);
+    AETestRun(benchmarkTwoThreadPingPong);
+    AETestRun(benchmarkTwoThreadStreaming);
+    return AETestExitStatus();
+}
@@ -0,0 +1,296 @@
+//
+//  TPMultiProducerCircularBufferTests.c
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+// Several producer threads feeding one consumer: every record must arrive whole, exactly
+// once, and in each producer's order, through the reserve/commit path and the AudioBufferList
+// utilities. The benchmark measures throughput with 1, 2, 4 and 8 producers.
+
+#include "AETest.h"
+#include "TPMultiProducerCircularBuffer.h"
+#include "TPCircularBuffer+AudioBufferList.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#define kMaxProducers 8
+#define kRecordsPerProducer 50000
+#define kBenchmarkRecords 1000000
+#define kRecordAlignment 16
+#define kMaxRecordLength 128
+#define kChannels 2
+#define kFramesPerBlock 64
+#define kBlocksPerProducer 5000
+
+typedef struct {
+    uint32_t length;
+    uint32_t producer;
+    uint32_t sequence;
+    uint32_t check;
+    uint8_t  payload[];
+} record_t;
+
+typedef struct {
+    TPMultiProducerCircularBuffer *buffer;
+    uint32_t producer;
+    int records;
+    bool variableLength;
+    volatile int *startFlag;
+} producer_t;
+
+static const AudioStreamBasicDescription kAudioDescription = {
+    .mSampleRate       = 44100.0,
+    .mFormatID         = kAudioFormatLinearPCM,
+    .mFormatFlags      = kAudioFormatFlagsNativeFloatPacked | kAudioFormatFlagIsNonInterleaved,
+    .mBytesPerPacket   = sizeof(float),
+    .mFramesPerPacket  = 1,
+    .mBytesPerFrame    = sizeof(float),
+    .mChannelsPerFrame = kChannels,
+    .mBitsPerChannel   = 32
+};
+
+static uint32_t recordCheck(uint32_t producer, uint32_t sequence) {
+    return (producer * 2654435761u) ^ (sequence * 40503u);
+}
+
+static uint8_t payloadByte(uint32_t producer, uint32_t sequence, uint32_t index) {
+    return (uint8_t)(producer * 31 + sequence + index);
+}
+
+static void waitForStart(volatile int *startFlag) {
+    while ( !__atomic_load_n(startFlag, __ATOMIC_ACQUIRE) ) sched_yield();
+}
+
+static void *recordProducerThread(void *userInfo) {
+    producer_t *producer = (producer_t*)userInfo;
+    waitForStart(producer->startFlag);
+    for ( int i=0; i<producer->records; i++ ) {
+        uint32_t length = producer->variableLength
+            ? kRecordAlignment * (1 + (producer->producer + i) % (kMaxRecordLength / kRecordAlignment))
+            : kRecordAlignment;
+        record_t *record;
+        while ( !(record = (record_t*)TPMultiProducerCircularBufferReserve(producer->buffer, length)) ) sched_yield();
+        record->length = length;
+        record->producer = producer->producer;
+        record->sequence = i;
+        record->check = recordCheck(producer->producer, i);
+        for ( uint32_t j=0; j<length - sizeof(record_t); j++ ) {
+            record->payload[j] = payloadByte(producer->producer, i, j);
+        }
+        TPMultiProducerCircularBufferCommit(producer->buffer, record, length);
+    }
+    return NULL;
+}
+
+typedef struct {
+    int received;
+    int corrupt;
+    int outOfOrder;
+    uint32_t nextSequence[kMaxProducers];
+} consumer_state_t;
+
+static void consumeRecords(TPMultiProducerCircularBuffer *buffer, consumer_state_t *state, int total, bool verifyPayload) {
+    // The consumer uses the ordinary single-consumer functions on the embedded buffer, in batches
+    TPCircularBuffer *ring = &buffer->buffer;
+    while ( state->received < total ) {
+        int32_t batchBytes = 0;
+        record_t *record;
+        while ( (record = (record_t*)TPCircularBufferBatchTail(ring, batchBytes, sizeof(record_t))) ) {
+            if ( record->producer >= kMaxProducers || record->check != recordCheck(record->producer, record->sequence) ) {
+                state->corrupt++;
+                return;
+            }
+            if ( verifyPayload ) {
+                for ( uint32_t j=0; j<record->length - sizeof(record_t); j++ ) {
+                    if ( record->payload[j] != payloadByte(record->producer, record->sequence, j) ) {
+                        state->corrupt++;
+                        break;
+                    }
+                }
+            }
+            if ( record->sequence != state->nextSequence[record->producer] ) state->outOfOrder++;
+            state->nextSequence[record->producer] = record->sequence + 1;
+            batchBytes += record->length;
+            state->received++;
+        }
+        if ( batchBytes ) {
+            TPCircularBufferConsume(ring, batchBytes);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+static double runProducers(TPMultiProducerCircularBuffer *buffer, int producerCount, int recordsPerProducer,
+                           bool variableLength, bool verifyPayload, consumer_state_t *state) {
+    pthread_t threads[kMaxProducers];
+    producer_t producers[kMaxProducers];
+    volatile int startFlag = 0;
+    for ( int i=0; i<producerCount; i++ ) {
+        producers[i] = (producer_t){ .buffer = buffer, .producer = i, .records = recordsPerProducer,
+                                     .variableLength = variableLength, .startFlag = &startFlag };
+        pthread_create(&threads[i], NULL, recordProducerThread, &producers[i]);
+    }
+
+    double start = AETestSeconds();
+    __atomic_store_n(&startFlag, 1, __ATOMIC_RELEASE);
+    consumeRecords(buffer, state, producerCount * recordsPerProducer, verifyPayload);
+    double seconds = AETestSeconds() - start;
+
+    for ( int i=0; i<producerCount; i++ ) {
+        pthread_join(threads[i], NULL);
+    }
+    return seconds;
+}
+
+static void testConcurrentProducersDeliverEveryRecordInOrder(void) {
+    // A small buffer, so producers regularly find it full and reservations wrap the end
+    TPMultiProducerCircularBuffer buffer;
+    AETestAssert(TPMultiProducerCircularBufferInit(&buffer, 4096));
+
+    consumer_state_t state = { 0 };
+    runProducers(&buffer, 4, kRecordsPerProducer, true, true, &state);
+
+    AETestAssert(state.corrupt == 0);
+    AETestAssert(state.outOfOrder == 0);
+    AETestAssert(state.received == 4 * kRecordsPerProducer);
+    for ( int i=0; i<4; i++ ) {
+        AETestAssert(state.nextSequence[i] == kRecordsPerProducer);
+    }
+    int32_t available;
+    AETestAssert(TPCircularBufferTail(&buffer.buffer, &available) == NULL);
+
+    TPMultiProducerCircularBufferCleanup(&buffer);
+}
+
+static void *bufferListProducerThread(void *userInfo) {
+    producer_t *producer = (producer_t*)userInfo;
+    float data[kChannels][kFramesPerBlock];
+    AudioBufferList *bufferList = (AudioBufferList*)malloc(sizeof(AudioBufferList) + (kChannels-1) * sizeof(AudioBuffer));
+    bufferList->mNumberBuffers = kChannels;
+    waitForStart(producer->startFlag);
+    for ( int i=0; i<producer->records; i++ ) {
+        // Every sample in a buffer list identifies its producer, sequence and channel
+        for ( int channel=0; channel<kChannels; channel++ ) {
+            for ( int frame=0; frame<kFramesPerBlock; frame++ ) {
+                data[channel][frame] = producer->producer * 1.0e6f + i * 10.0f + channel;
+            }
+            bufferList->mBuffers[channel].mNumberChannels = 1;
+            bufferList->mBuffers[channel].mDataByteSize = sizeof(data[channel]);
+            bufferList->mBuffers[channel].mData = data[channel];
+        }
+        AudioTimeStamp timestamp = { .mSampleTime = i, .mHostTime = producer->producer,
+                                     .mFlags = kAudioTimeStampSampleTimeValid | kAudioTimeStampHostTimeValid };
+        while ( !TPMultiProducerCircularBufferCopyAudioBufferList(producer->buffer, bufferList, &timestamp,
+                                                                  kTPCircularBufferCopyAll, &kAudioDescription) ) {
+            sched_yield();
+        }
+    }
+    free(bufferList);
+    return NULL;
+}
+
+static void testConcurrentProducersQueueWholeBufferLists(void) {
+    TPMultiProducerCircularBuffer buffer;
+    AETestAssert(TPMultiProducerCircularBufferInit(&buffer, 16384));
+
+    pthread_t threads[4];
+    producer_t producers[4];
+    volatile int startFlag = 0;
+    for ( int i=0; i<4; i++ ) {
+        producers[i] = (producer_t){ .buffer = &buffer, .producer = i, .records = kBlocksPerProducer, .startFlag = &startFlag };
+        pthread_create(&threads[i], NULL, bufferListProducerThread, &producers[i]);
+    }
+    __atomic_store_n(&startFlag, 1, __ATOMIC_RELEASE);
+
+    int received = 0, corrupt = 0, outOfOrder = 0;
+    UInt32 nextSequence[4] = { 0 };
+    while ( received < 4 * kBlocksPerProducer ) {
+        AudioTimeStamp timestamp;
+        AudioBufferList *bufferList = TPCircularBufferNextBufferList(&buffer.buffer, &timestamp);
+        if ( !bufferList ) {
+            sched_yield();
+            continue;
+        }
+        UInt32 producer = (UInt32)timestamp.mHostTime;
+        UInt32 sequence = (UInt32)timestamp.mSampleTime;
+        if ( producer >= 4 || bufferList->mNumberBuffers != kChannels ) {
+            corrupt++;
+            break;
+        }
+        for ( int channel=0; channel<kChannels; channel++ ) {
+            float expected = producer * 1.0e6f + sequence * 10.0f + channel;
+            const float *samples = (const float*)bufferList->mBuffers[channel].mData;
+            if ( bufferList->mBuffers[channel].mDataByteSize != kFramesPerBlock * sizeof(float)
+                    || samples[0] != expected || samples[kFramesPerBlock-1] != expected ) {
+                corrupt++;
+            }
+        }
+        if ( sequence != nextSequence[producer] ) outOfOrder++;
+        nextSequence[producer] = sequence + 1;
+        TPCircularBufferConsumeNextBufferList(&buffer.buffer);
+        received++;
+    }
+
+    for ( int i=0; i<4; i++ ) {
+        pthread_join(threads[i], NULL);
+    }
+
+    AETestAssert(corrupt == 0);
+    AETestAssert(outOfOrder == 0);
+    AETestAssert(received == 4 * kBlocksPerProducer);
+    AETestAssert(TPCircularBufferPeek(&buffer.buffer, NULL, &kAudioDescription) == 0);
+
+    TPMultiProducerCircularBufferCleanup(&buffer);
+}
+
+static void benchmarkProducerContention(void) {
+    double singleProducerRate = 0;
+    for ( int producerCount=1; producerCount<=kMaxProducers; producerCount *= 2 ) {
+        TPMultiProducerCircularBuffer buffer;
+        AETestAssert(TPMultiProducerCircularBufferInit(&buffer, 65536));
+
+        consumer_state_t state = { 0 };
+        int recordsPerProducer = kBenchmarkRecords / producerCount;
+        double seconds = runProducers(&buffer, producerCount, recordsPerProducer, false, false, &state);
+        AETestAssert(state.corrupt == 0 && state.outOfOrder == 0);
+        AETestAssert(state.received == producerCount * recordsPerProducer);
+
+        double rate = state.received / seconds;
+        if ( producerCount == 1 ) singleProducerRate = rate;
+        printf("     %d producer%s: %.1fM %d-byte records per second, %.0f ns per record (%.2fx one producer)\n",
+               producerCount, producerCount == 1 ? " " : "s", rate / 1.0e6, kRecordAlignment,
+               1.0e9 / rate, rate / singleProducerRate);
+
+        // Producers that outnumber the cores mustn't fall into taking turns, a context switch per record
+        AETestAssert(rate > singleProducerRate * 0.1);
+
+        TPMultiProducerCircularBufferCleanup(&buffer);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    AETestRun(testConcurrentProducersDeliverEveryRecordInOrder);
+    AETestRun(testConcurrentProducersQueueWholeBufferLists);
+    AETestRun(benchmarkProducerContention);
+    return AETestExitStatus();
+}
@@ -31,6 +31,8 @@ extern "C" {
 #import <AudioUnit/AudioUnit.h>
 #import <Foundation/Foundation.h>
 #import "AEMessageQueue.h"
+#import "AERenderWorkerPool.h"
+#import "AERenderProfile.h"
 
 @class AEAudioController;
 
@@ -385,6 +387,38 @@ typedef AEAudioFilterCallback AEAudioControllerFilterCallback; // Temporary alia
  */
 - (void)teardown;
 
+/*!
+ * Whether the filter is stateless
+ *
+ *  Return YES if silent input always produces silent output from this filter - that is,
+ *  it keeps no state (such as a delay line or reverb tail) that would sound after the
+ *  input falls silent. While the audio a stateless filter would process is flagged as
+ *  silent (see @link AEAudioController::AEAudioControllerReportOutputIsSilent AEAudioControllerReportOutputIsSilent @endlink),
+ *  the filter callback is skipped altogether.
+ *
+ *  A stateless filter must produce the same number of frames it is asked for, and must
+ *  call the producer before writing to the output buffer.
+ *
+ *  Filters that don't implement this are assumed to be stateful, and are always run.
+ */
+@property (nonatomic, readonly) BOOL filterIsStateless;
+
+/*!
+ * The latency the filter adds, in frames
+ *
+ *  Filters that delay the audio passing through them, such as look-ahead limiters,
+ *  should report by how much, at the audio controller's sample rate. The audio controller
+ *  then delays the filter's siblings to match, so that channels stay in phase when they
+ *  are mixed, and advances the timestamps its output receivers are given, to reflect when
+ *  the audio will be heard.
+ *
+ *  If the latency changes, post a key-value observing notification for this property.
+ *  The latency of input filters is not compensated for.
+ *
+ *  Filters that don't implement this are assumed to add no latency.
+ */
+@property (nonatomic, readonly) UInt32 filterLatency;
+
 @end
 
 
@@ -664,6 +698,85 @@ typedef enum {
                       error:(NSError**)error;
 
 
+///@}
+#pragma mark - Offline rendering
+/** @name Offline rendering */
+///@{
+
+/*!
+ * Begin offline rendering
+ *
+ *  Puts the audio controller into offline mode, in which the audio hardware is not used and
+ *  audio is instead pulled from the channel tree by calls to AEAudioControllerRenderOffline,
+ *  as fast as the CPU allows. This is useful for bouncing mixes, regression renders, or
+ *  benchmarking on machines without an audio device.
+ *
+ *  The engine must not be running. While rendering offline, messages sent via the
+ *  @link messageQueue @endlink are queued and processed at the start of each rendered
+ *  slice, exactly as for a live render cycle, rather than being performed immediately.
+ *  Synchronous message exchanges are the exception: they're performed on the calling
+ *  thread between renders, after any queued messages, waiting for a call to
+ *  AEAudioControllerRenderOffline in progress to return, and holding off the next one
+ *  until they're done. The engine's own exchanges, made when channels, groups, filters
+ *  and receivers are added or removed, work the same way, so the channel tree can be
+ *  changed between renders without a render thread servicing them.
+ *  Audio input is not available offline.
+ *
+ * @param error On output, if not NULL, the error
+ * @return YES on success, NO on failure
+ */
+- (BOOL)startOfflineRendering:(NSError**)error;
+
+/*!
+ * End offline rendering
+ *
+ *  Returns the audio controller to its normal, stopped state. Call @link start: @endlink
+ *  afterwards to resume realtime operation.
+ */
+- (void)stopOfflineRendering;
+
+/*!
+ * Render audio offline
+ *
+ *  Renders the given number of frames from the channel tree into the buffer list, in the
+ *  audio controller's @link audioDescription @endlink format. Each slice of up to 4096 frames
+ *  runs a full render cycle: the message queue is processed, timing receivers are called,
+ *  then channels, filters and output receivers are rendered as they would be live.
+ *  Timestamps begin at sample time zero and advance continuously across calls, with host
+ *  times synthesized from the sample time as if playing back in realtime.
+ *
+ *  Call this on the thread you intend to use as the render thread. Synchronous message
+ *  exchanges made from other threads while this is rendering wait for it to return
+ *  (see @link startOfflineRendering: @endlink).
+ *
+ * @param audioController The audio controller, in offline mode
+ * @param bufferList      Buffer list to render into, with enough space for the given frames
+ * @param frames          Number of frames to render
+ * @return noErr on success, or an error code
+ */
+OSStatus AEAudioControllerRenderOffline(__unsafe_unretained AEAudioController *audioController,
+                                        AudioBufferList                       *bufferList,
+                                        UInt32                                 frames);
+
+/*!
+ * Whether the audio controller is in offline rendering mode
+ */
+@property (nonatomic, readonly) BOOL renderingOffline;
+
+/*!
+ * Number of frames rendered since offline rendering began
+ */
+@property (nonatomic, readonly) UInt64 offlineFramesRendered;
+
+/*!
+ * Achieved offline render speed, as a multiple of realtime
+ *
+ *  The duration of audio rendered since offline rendering began, divided by the time spent
+ *  inside AEAudioControllerRenderOffline. A value of 10 means audio was produced ten times
+ *  faster than it would play back.
+ */
+@property (nonatomic, readonly) double offlineRenderSpeed;
+
 ///@}
 #pragma mark - Channel and channel group management
 /** @name Channel and channel group management */
@@ -834,6 +947,161 @@ typedef enum {
  */
 - (BOOL)channelGroupIsMuted:(AEChannelGroupRef)group;
 
+///@}
+#pragma mark - Automation
+/** @name Automation */
+///@{
+
+/*!
+ * Add a volume automation point to a channel
+ *
+ *  Automation lets you schedule volume and pan changes ahead of time, sample-accurately,
+ *  instead of setting them block by block. Each point is reached by a linear ramp from the
+ *  point before it; the first point ramps from the current volume, starting when the audio
+ *  thread first sees it. For a fade, add a point with the starting value at the time the
+ *  fade should begin, then one with the final value at the time it should end. After the
+ *  last point, the channel holds that volume until you add more points or set its volume
+ *  directly, which discards any automation not yet reached.
+ *
+ *  Times are in output sample time: see @link outputSampleTime @endlink. Schedule points at
+ *  least a buffer duration ahead; points already in the past take effect immediately.
+ *
+ *  Automation is applied by the engine's own mixer, so requires
+ *  @link nativeGroupMixingEnabled @endlink.
+ *
+ * @param volume     Volume (0 - 1)
+ * @param sampleTime Output sample time at which to reach the volume
+ * @param channel    The channel
+ * @return YES if the point was added; NO if native group mixing is disabled, the point is
+ *         earlier than the last one added, or too many points are waiting to be reached
+ */
+- (BOOL)addVolumeAutomationPoint:(float)volume atSampleTime:(Float64)sampleTime forChannel:(id<AEAudioPlayable>)channel;
+
+/*!
+ * Add a pan automation point to a channel
+ *
+ *  See @link addVolumeAutomationPoint:atSampleTime:forChannel: @endlink. Setting the channel's
+ *  pan directly discards any pan automation not yet reached.
+ *
+ * @param pan        Pan (-1.0 - 1.0)
+ * @param sampleTime Output sample time at which to reach the pan
+ * @param channel    The channel
+ * @return YES if the point was added
+ */
+- (BOOL)addPanAutomationPoint:(float)pan atSampleTime:(Float64)sampleTime forChannel:(id<AEAudioPlayable>)channel;
+
+/*!
+ * Add a volume automation point to a channel group
+ *
+ *  See @link addVolumeAutomationPoint:atSampleTime:forChannel: @endlink. Calling
+ *  @link setVolume:forChannelGroup: @endlink discards any volume automation not yet reached.
+ *
+ * @param volume     Group volume (0 - 1)
+ * @param sampleTime Output sample time at which to reach the volume
+ * @param group      Group identifier
+ * @return YES if the point was added
+ */
+- (BOOL)addVolumeAutomationPoint:(float)volume atSampleTime:(Float64)sampleTime forChannelGroup:(AEChannelGroupRef)group;
+
+/*!
+ * Add a pan automation point to a channel group
+ *
+ *  See @link addVolumeAutomationPoint:atSampleTime:forChannel: @endlink. Calling
+ *  @link setPan:forChannelGroup: @endlink discards any pan automation not yet reached.
+ *
+ * @param pan        Group pan (-1.0 - 1.0)
+ * @param sampleTime Output sample time at which to reach the pan
+ * @param group      Group identifier
+ * @return YES if the point was added
+ */
+- (BOOL)addPanAutomationPoint:(float)pan atSampleTime:(Float64)sampleTime forChannelGroup:(AEChannelGroupRef)group;
+
+/*!
+ * The output sample time of the next render cycle
+ *
+ *  The time base for automation points. Updated at the start of each render cycle, and
+ *  zero until the first cycle after the audio controller starts.
+ */
+@property (nonatomic, readonly) Float64 outputSampleTime;
+
+///@}
+#pragma mark - Aux buses
+/** @name Aux buses */
+///@{
+
+/*!
+ * Create an aux bus within a channel group
+ *
+ *  An aux bus is a channel group that, instead of containing channels, sums the audio that
+ *  channels and groups send to it. Use it to share one expensive effect, like a reverb,
+ *  between many channels: add the filter to the bus with
+ *  @link addFilter:toChannelGroup: @endlink, then send to the bus from each channel with
+ *  @link setSendLevel:toAuxBus:forChannel: @endlink. The bus's filters run once per render
+ *  cycle, however many channels send to it, and its output is mixed into the group it was
+ *  created within, like any other subgroup.
+ *
+ *  The bus is an ordinary channel group in every other respect: set its volume to control
+ *  the return level, add output receivers or monitor its levels, and remove it with
+ *  @link removeChannelGroup: @endlink. You can't add channels or groups to it.
+ *
+ *  Aux buses are mixed by the engine's own mixer, so require
+ *  @link nativeGroupMixingEnabled @endlink.
+ *
+ * @param group The group to mix the bus's output into
+ * @return An identifier for the bus, or NULL if native group mixing is disabled
+ */
+- (AEChannelGroupRef)createAuxBusWithinChannelGroup:(AEChannelGroupRef)group;
+
+/*!
+ * Set the level at which a channel sends to an aux bus
+ *
+ *  Sends are post-fader: the channel sends its audio after its filters, scaled by its volume
+ *  and the send level and panned as it is in its own group, so fades and mutes carry over to
+ *  the bus. Level changes ramp across the next buffer.
+ *
+ *  A channel can send to any bus created within a group that contains it, directly or
+ *  further up the tree. Set a level of zero to stop sending; the send stays in place until
+ *  the channel or bus is removed.
+ *
+ * @param level   Send level (0 - 1)
+ * @param bus     The aux bus, from @link createAuxBusWithinChannelGroup: @endlink
+ * @param channel The channel
+ * @return YES if the level was set; NO if native group mixing is disabled, or the channel
+ *         isn't beneath the group the bus was created within
+ */
+- (BOOL)setSendLevel:(float)level toAuxBus:(AEChannelGroupRef)bus forChannel:(id<AEAudioPlayable>)channel;
+
+/*!
+ * Set the level at which a channel group sends to an aux bus
+ *
+ *  See @link setSendLevel:toAuxBus:forChannel: @endlink. The group sends its mixed output,
+ *  after its own filters. Aux buses can't send to one another.
+ *
+ * @param level   Send level (0 - 1)
+ * @param bus     The aux bus
+ * @param group   Group identifier
+ * @return YES if the level was set
+ */
+- (BOOL)setSendLevel:(float)level toAuxBus:(AEChannelGroupRef)bus forChannelGroup:(AEChannelGroupRef)group;
+
+/*!
+ * Get the level at which a channel sends to an aux bus
+ *
+ * @param bus     The aux bus
+ * @param channel The channel
+ * @return The send level, or zero if the channel doesn't send to the bus
+ */
+- (float)sendLevelToAuxBus:(AEChannelGroupRef)bus forChannel:(id<AEAudioPlayable>)channel;
+
+/*!
+ * Get the level at which a channel group sends to an aux bus
+ *
+ * @param bus     The aux bus
+ * @param group   Group identifier
+ * @return The send level, or zero if the group doesn't send to the bus
+ */
+- (float)sendLevelToAuxBus:(AEChannelGroupRef)bus forChannelGroup:(AEChannelGroupRef)group;
+
 ///@}
 #pragma mark - Filters
 /** @name Filters */
@@ -952,6 +1220,44 @@ typedef enum {
  */
 - (NSArray*)inputFilters;
 
+///@}
+#pragma mark - Silence propagation
+/** @name Silence propagation */
+///@{
+
+/*!
+ * Flag the audio just produced as silent
+ *
+ *  Call this from within an AEAudioRenderCallback, or an AEAudioFilterCallback, when the
+ *  buffer you are returning contains only silence. The audio controller will then skip
+ *  downstream stateless filters (see @link AEAudioFilter::filterIsStateless filterIsStateless @endlink),
+ *  skip format conversion for any Audiobus sender port, and tell the mixer it can skip
+ *  the channel's bus, so that idle channels cost next to nothing.
+ *
+ *  Render callbacks are given a zeroed buffer, so a silent channel can simply return
+ *  after calling this. Filters must leave their output buffer zeroed.
+ *
+ *  Channels that never call this are always treated as audible, as are filters: a
+ *  stateful filter such as a reverb should call this only once its input is silent
+ *  (see @link AEAudioControllerFilterInputIsSilent @endlink) and its tail has decayed.
+ *  Filters must call this after calling their producer, as producing audio upstream
+ *  clears any report made before it.
+ *
+ * @param audioController The audio controller
+ */
+void AEAudioControllerReportOutputIsSilent(__unsafe_unretained AEAudioController *audioController);
+
+/*!
+ * Determine whether a filter's input audio is silent
+ *
+ *  Call this from within an AEAudioFilterCallback, after calling the producer, to find
+ *  out whether the audio it produced was flagged as silent.
+ *
+ * @param audioController The audio controller
+ * @return YES if the audio most recently produced for the current filter is silent
+ */
+BOOL AEAudioControllerFilterInputIsSilent(__unsafe_unretained AEAudioController *audioController);
+
 ///@}
 #pragma mark - Output receivers
 /** @name Output receivers */
@@ -1140,7 +1446,7 @@ typedef enum {
  * The asynchronous message queue used for safe communication between main and realtime thread
  *
  *  If @link running @endlink is NO, then message blocks passed to this instance will be performed 
- *  on the main thread instead of the realtime thread.
+ *  on the main thread instead of the realtime thread, unless @link renderingOffline @endlink is YES.
  */
 @property (nonatomic, readonly, strong) AEMessageQueue *messageQueue;
 
@@ -1534,6 +1840,15 @@ BOOL AECurrentThreadIsAudioThread(void);
 @property (nonatomic, readonly) NSTimeInterval outputLatency;
 #endif
 
+/*!
+ * Output filter latency (in seconds)
+ *
+ *  The latency added by filters on the output path, as reported through
+ *  @link AEAudioFilter::filterLatency filterLatency @endlink: that of the slowest path
+ *  from any channel to the output, which the others are delayed to match.
+ */
+@property (nonatomic, readonly) NSTimeInterval outputFilterLatency;
+
 /*!
  * Whether to automatically account for input/output latency
  *
@@ -1550,10 +1865,124 @@ BOOL AECurrentThreadIsAudioThread(void);
 @property (nonatomic, assign) BOOL automaticLatencyManagement;
 #endif
 
+/*!
+ * Whether to render sibling channel groups in parallel
+ *
+ *  When enabled, the channel groups within each group are rendered concurrently on a pool of
+ *  time-constrained worker threads (one fewer than the number of processor cores), alongside
+ *  the audio thread. When a group's mixer pulls its first subgroup in a render cycle, all of
+ *  its playing subgroups are rendered into their own buffers at once, and the mixer then sums
+ *  them in the usual order, so output is identical to serial rendering. Nested groups fan out
+ *  again from whichever thread renders them.
+ *
+ *  Channels, filters and receivers within different groups may then be called at the same time
+ *  on different threads, so any state they share must be thread-safe. Individual channels
+ *  (as opposed to groups) are still rendered by their group's mixer, one after another.
+ *
+ *  The engine functions meant for render callbacks are safe to call from the worker threads:
+ *  @link AEAudioControllerSendAsynchronousMessageToMainThread @endlink (and the underlying
+ *  AEMessageQueueSendMessageToMainThread and AEMessageQueueSendTypedMessageToMainThread, which
+ *  accept messages from several threads at once), @link AEAudioControllerReportOutputIsSilent @endlink,
+ *  @link AEAudioControllerFilterInputIsSilent @endlink, the audio description and latency accessors,
+ *  and @link AEAudioControllerCurrentAudioTimestamp @endlink. AEMessageQueueProcessMessagesOnRealtimeThread
+ *  and @link AEAudioControllerRenderOffline @endlink remain for the audio thread only.
+ *
+ *  Default is NO.
+ */
+@property (nonatomic, assign) BOOL parallelRenderingEnabled;
+
+/*!
+ * Get parallel render load information since this method was last called
+ *
+ *  The first entry describes work done on the audio thread itself, followed by one entry
+ *  for each worker thread.
+ *
+ * @param loads Array to fill with per-thread load information
+ * @param count Number of entries available in loads
+ * @return Number of entries filled, or 0 if parallel rendering is disabled
+ */
+- (int)parallelRenderWorkerLoad:(AERenderWorkerLoad*)loads count:(int)count;
+
+/*!
+ * Whether to mix channel groups with the engine's own mixer
+ *
+ *  When enabled, channel groups are mixed by @link AEGroupMixer.h AEGroupMixer @endlink
+ *  instead of a Core Audio multichannel mixer unit each. Every channel in a group is
+ *  rendered in turn, converted to floating point if necessary, and accumulated in place
+ *  into the group's output with vectorised kernels, with volume and pan changes ramped
+ *  across each block rather than stepped. Channels that report silence (see
+ *  @link AEAudioControllerReportOutputIsSilent @endlink) aren't mixed at all.
+ *
+ *  Adding and removing channels and groups doesn't wait for the audio thread either: each
+ *  group's membership is published to the audio thread as an immutable snapshot, swapped in
+ *  at the start of a render cycle, and removed channels are released once the audio thread
+ *  can no longer be rendering them.
+ *
+ *  Channels whose audio description has a different sample rate to the audio controller's
+ *  are pulled through a sample rate converter of their own, as the Core Audio mixer would
+ *  convert them. They're always mixed, even when they report silence.
+ *
+ *  Aux buses (see @link createAuxBusWithinChannelGroup: @endlink) are only available with
+ *  the engine's mixer.
+ *
+ *  Changing this recreates the audio graph. Default is NO.
+ */
+@property (nonatomic, assign) BOOL nativeGroupMixingEnabled;
+
+/*!
+ * Whether to gather render timings
+ *
+ *  When enabled, the time taken by each channel, group, filter and receiver is measured
+ *  as it renders, along with the render cycle as a whole and the servicing of audio input,
+ *  and gathered on the audio thread without locks for @link renderProfile @endlink. This
+ *  costs a couple of host clock reads per node per render.
+ *
+ *  Default is YES.
+ */
+@property (nonatomic, assign) BOOL renderProfilingEnabled;
+
+/*!
+ * Get render timings since this method was last called
+ *
+ *  Returns a tree of AERenderProfile nodes that mirrors the channel hierarchy. The root
+ *  times the whole output render cycle; beneath it are audio input (if enabled) with its
+ *  filters and receivers, then the top-level channel group. Each group contains its filters,
+ *  in the order they run, its receivers, then its channels and subgroups.
+ *
+ *  Group and channel timings include everything beneath them, while filter timings leave
+ *  out the time spent producing the audio the filter pulls from upstream. A render misses
+ *  its deadline if it finishes more than one buffer duration after its render cycle began.
+ *
+ *  Call this on the main thread, periodically: once a second is plenty.
+ *
+ * @return The profile of the output render cycle
+ */
+- (AERenderProfile*)renderProfile;
+
+/*!
+ * Get render load statistics since this method was last called
+ *
+ *  Gives the distribution of output render cycle durations, as a fraction of the buffer
+ *  duration, from a histogram the audio thread maintains while @link renderProfilingEnabled
+ *  @endlink is set: the median, 99th and 99.9th percentiles, the maximum, and the number of
+ *  cycles that overran.
+ *
+ *  It also counts xruns, detected as jumps in the output timestamps' sample time, which
+ *  happen when the hardware runs out of audio, whatever the cause. Xruns are counted even
+ *  with render profiling disabled.
+ *
+ *  This only reads counters the audio thread updates atomically, so it's cheap enough to
+ *  poll once a second. Call it on the main thread.
+ *
+ * @return Render load statistics
+ */
+- (AERenderLoadStatistics)renderLoadStatistics;
+
 /*!
  * Determine whether the audio engine is running
  *
- *  This is affected by calling start and stop on the audio controller.
+ *  This is affected by calling start and stop on the audio controller. It is NO while
+ *  rendering offline; see @link renderingOffline @endlink.
  */
 @property (nonatomic, readonly) BOOL running;
 
@@ -38,13 +38,15 @@
 #import "AEAudioController+AudiobusStub.h"
 #import "AEFloatConverter.h"
 #import "AEBlockChannel.h"
+#import "AERenderWorkerPool.h"
+#import "AEGroupMixer.h"
+#import "AEAutomationLane.h"
+#import "AERenderProfile.h"
+#import "AECallbackTable.h"
+#import "AERenderList.h"
 #import <pthread.h>
 
-// Uncomment the following or define the following symbol as part of your build process to enable per-second performance reports
-// #define TAAE_REPORT_RENDER_TIME
-
-static const int kMaximumChannelsPerGroup              = 100;
-static const int kMaximumCallbacksPerSource            = 15;
+static const int kInitialChannelsPerGroup              = 16;
 static const int kMessageBufferLength                  = 8192;
 static const UInt32 kMaxFramesPerSlice                 = 4096;
 static const int kScratchBufferFrames                  = kMaxFramesPerSlice;
@@ -53,12 +55,14 @@ static const int kLevelMonitorScratchBufferSize        = kMaxFramesPerSlice;
 static const int kMaximumMonitoringChannels            = 16;
 #if TARGET_OS_IPHONE
 static const NSTimeInterval kMaxBufferDurationWithVPIO = 0.01;
+static const NSTimeInterval kDefaultRenderWorkerPeriod = 0.01;
 static const float kBoostForBuiltInMicInMeasurementMode= 4.0;
 static const Float32 kNoValue                          = -1.0;
 #endif
 #define kNoAudioErr                            -2222
 
 static void * kChannelPropertyChanged = &kChannelPropertyChanged;
+static void * kFilterLatencyChanged = &kFilterLatencyChanged;
 
 #if TARGET_OS_IPHONE
 static Float32 __cachedInputLatency = kNoValue;
@@ -67,6 +71,11 @@ static Float32 __cachedOutputLatency = kNoValue;
 
 static pthread_t __audioThread = NULL;
 
+/*
+ * The channel currently being rendered on this thread
+ */
+static __thread AEChannelRef __channelBeingRendered = NULL;
+
 NSString * const AEAudioControllerSessionInterruptionBeganNotification = @"com.theamazingaudioengine.AEAudioControllerSessionInterruptionBeganNotification";
 NSString * const AEAudioControllerSessionInterruptionEndedNotification = @"com.theamazingaudioengine.AEAudioControllerSessionInterruptionEndedNotification";
 NSString * const AEAudioControllerSessionRouteChangeNotification = @"com.theamazingaudioengine.AEAudioControllerRouteChangeNotification";
@@ -98,34 +107,24 @@ static BOOL __AEAllocated = NO;
 
 #pragma mark - Core types
 
-enum {
-    kFilterFlag               = 1<<0,
-    kReceiverFlag             = 1<<1,
-    kAudiobusSenderPortFlag   = 1<<3
-};
-
 /*!
- * Callback
+ * Silence state for a producer chain
+ *
+ *  'reported' is set by AEAudioControllerReportOutputIsSilent while a render callback or
+ *  filter runs; once it returns, the result moves to 'outputIsSilent' for the next stage.
  */
-typedef struct __callback_t {
-    void *callback;
-    void *userInfo;
-    uint8_t flags;
-} callback_t;
+typedef struct __silence_state_t {
+    BOOL reported;
+    BOOL outputIsSilent;
+} silence_state_t;
 
-/*!
- * Callback table
- */
-typedef struct __callback_table_t {
-    int count;
-    callback_t callbacks[kMaximumCallbacksPerSource];
-} callback_table_t;
+static __thread silence_state_t *__silenceState = NULL;
 
 /*!
  * Mulichannel input callback table
  */
 typedef struct __input_callback_table_t {
-    callback_table_t    callbacks;
+    AECallbackTable     callbacks;
     void               *channelMap;
     AudioStreamBasicDescription audioDescription;
     AudioBufferList    *audioBufferList;
@@ -160,6 +159,75 @@ typedef enum {
     kChannelTypeGroup
 } ChannelType;
 
+/*!
+ * Channel parameters, sent to the realtime thread with setParameterValue:forKey:target:handler:
+ */
+enum {
+    kChannelParameterVolume,
+    kChannelParameterPan
+};
+
+/*!
+ * Latency compensation
+ *
+ *  Delays a channel's output to line it up with the slowest path among its siblings, and
+ *  offsets the timestamps its receivers see by the delay still to come before the output.
+ *  Built on the main thread and swapped in whole. The delay line holds 'delayFrames' frames
+ *  of raw audio per buffer, so it works in any linear PCM format.
+ */
+typedef struct {
+    UInt32  delayFrames;
+    UInt32  receiverOffsetFrames;
+    UInt64  receiverOffsetTicks;
+    UInt32  bytesPerFrame;
+    UInt32  position;
+    UInt32  silentFrames;       //!< Trailing silent frames written to the delay line
+    int     bufferCount;
+    char   *buffers[];
+} latency_compensation_t;
+
+/*!
+ * Aux bus input
+ *
+ *  Sends from the channels of one group sum into the same input. Each group's channels are
+ *  mixed on one thread, so sibling groups rendering in parallel never write to the same buffer.
+ */
+typedef struct {
+    AEChannelGroupRef sourceGroup;
+    AudioBufferList  *buffer;       //!< Non-interleaved float, in the controller's channel count
+    Float64           sampleTime;   //!< Render time of the audio in the buffer, or -1 if there's none
+    UInt32            frames;
+} aux_bus_input_t;
+
+/*!
+ * Aux bus
+ *
+ *  The inputs that a bus group sums before running its own filters. Built on the main thread
+ *  along with the send tables that feed it, and swapped in whole.
+ */
+typedef struct {
+    int             inputCount;
+    aux_bus_input_t inputs[];
+} aux_bus_t;
+
+/*!
+ * Aux send
+ */
+typedef struct {
+    AEChannelGroupRef bus;
+    float             level;        //!< Set in place by the main thread
+    AEGroupMixerInput mixerInput;
+    aux_bus_input_t  *input;
+} aux_send_t;
+
+/*!
+ * Aux send table
+ */
+typedef struct {
+    int        count;
+    aux_send_t sends[];
+} aux_send_table_t;
+
 /*!
  * Channel
  */
@@ -171,9 +239,11 @@ typedef struct __channel_t {
     BOOL             playing;
     float            volume;
     float            pan;
+    float            queuedVolume; // Main thread only: the volume most recently sent to the realtime thread
+    float            queuedPan;    // Main thread only: the pan most recently sent to the realtime thread
     BOOL             muted;
     AudioStreamBasicDescription audioDescription;
-    callback_table_t callbacks;
+    AECallbackTable  callbacks;
     AudioTimeStamp   timeStamp;
     
     BOOL             setRenderNotification;
@@ -182,6 +252,33 @@ typedef struct __channel_t {
     void             *audiobusSenderPort;
     void             *audiobusFloatConverter;
     AudioBufferList *audiobusScratchBuffer;
+    
+    AudioBufferList *parallelRenderBuffer;
+    AudioStreamBasicDescription parallelRenderAudioDescription;
+    AudioBufferList *queuedParallelRenderBuffer; // Main thread only: the buffer most recently sent to the realtime thread
+    AudioStreamBasicDescription queuedParallelRenderAudioDescription;
+    BOOL             parallelRenderValid;
+    Float64          parallelRenderSampleTime;
+    UInt32           parallelRenderFrames;
+    AudioUnitRenderActionFlags parallelRenderFlags;
+    OSStatus         parallelRenderStatus;
+    
+    AEGroupMixerInput mixerInput;
+    AEAutomationLane volumeAutomation;
+    AEAutomationLane panAutomation;
+    AudioBufferList *mixSourceBuffer;
+    void            *mixSourceConverter;
+    void            *queuedMixSourceConverter; // Main thread only: the converter most recently sent to the realtime thread
+    AudioConverterRef mixSampleRateConverter;
+    AudioConverterRef queuedMixSampleRateConverter; // Main thread only: the sample rate converter most recently sent to the realtime thread
+    
+    AERenderProfileAccumulator profile;
+    
+    UInt32           latency;   // Main thread only: latency of the channel's output, in frames
+    latency_compensation_t *latencyCompensation;
+    
+    aux_send_table_t *auxSends;
+    aux_send_table_t *queuedAuxSends; // Main thread only: the sends most recently sent to the realtime thread
 } channel_t, *AEChannelRef;
 
 /*!
@@ -191,10 +288,21 @@ typedef struct _channel_group_t {
     AEChannelRef        channel;
     AUNode              mixerNode;
     AudioUnit           mixerAudioUnit;
-    AEChannelRef        channels[kMaximumChannelsPerGroup];
+    AEChannelRef       *channels;
+    AEChannelRef       *parallelRenderChannels;
     int                 channelCount;
+    int                 channelCapacity;
     AUNode              converterNode;
     AudioUnit           converterUnit;
+    AudioBufferList    *mixScratchBuffer;
+    AudioBufferList    *mixOutputBuffer;
+    void               *mixOutputConverter;
+    AudioBufferList    *queuedMixScratchBuffer;    // Main thread only: as most recently sent to the realtime thread
+    void               *queuedMixOutputConverter;
+    AERenderList       *renderList;
+    BOOL                isAuxBus;
+    aux_bus_t          *auxBus;
+    aux_bus_t          *queuedAuxBus;              // Main thread only: the bus most recently sent to the realtime thread
     audio_level_monitor_t level_monitor_data;
 } channel_group_t;
 
@@ -220,6 +328,14 @@ typedef struct _channel_group_t {
     BOOL                _interrupted;
     BOOL                _hardwareInputAvailable;
     BOOL                _hasSystemError;
+    BOOL                _renderingOffline;
+    BOOL                _topChannelUsesRenderCallback;
+    BOOL                _nativeGroupMixing;
+    AudioTimeStamp      _offlineTimeStamp;
+    uint64_t            _offlineStartHostTime;
+    uint64_t            _offlineRenderDuration;
+    UInt64              _offlineFramesRendered;
+    pthread_mutex_t     _offlineRenderMutex;
 #if !TARGET_OS_IPHONE
     AudioUnit           _iAudioUnit;
 #endif
@@ -227,7 +343,7 @@ typedef struct _channel_group_t {
     AEChannelGroupRef   _topGroup;
     AEChannelRef        _topChannel;
     
-    callback_table_t    _timingCallbacks;
+    AECallbackTable     _timingCallbacks;
     
     input_callback_table_t *_inputCallbacks;
     int                 _inputCallbackCount;
@@ -243,21 +359,30 @@ typedef struct _channel_group_t {
 
     audio_level_monitor_t _inputLevelMonitorData;
     BOOL                _usingAudiobusInput;
-    AEChannelRef        _channelBeingRendered;
+    AERenderWorkerPool *_renderWorkerPool;
     
     AudioBufferList    *_audiobusMonitorBuffer;
 
     BOOL                _useHardwareSampleRate;
 
-#ifdef DEBUG
-    uint64_t            _renderStartTime[2];
-    uint64_t            _renderDuration[2];
-#endif
+    BOOL                _renderProfiling;
+    uint64_t            _renderStartTime;
+    uint64_t            _renderDeadline;
+    uint64_t            _inputRenderDeadline;
+    AERenderProfileAccumulator _outputRenderProfile;
+    AERenderProfileAccumulator _inputRenderProfile;
+    AERenderLoadHistogram _renderLoadHistogram;
+    Float64             _nextOutputSampleTime;
+    volatile uint64_t   _xrunCount;
+    volatile uint64_t   _xrunDroppedFrames;
+    uint64_t            _reportedXrunCount;
+    uint64_t            _reportedXrunDroppedFrames;
 }
 
 - (BOOL)mustUpdateVoiceProcessingSettings;
 - (void)replaceIONode;
 - (BOOL)updateInputDeviceStatus;
+- (void)performMessageExchangeBetweenOfflineRendersWithBlock:(void (^)())block;
 
 @property (nonatomic, assign, readwrite) NSTimeInterval currentBufferDuration;
 @property (nonatomic, readwrite) BOOL inputEnabled;
@@ -303,28 +428,102 @@ typedef struct __channel_producer_arg_t {
     AEChannelRef channel;
     AudioTimeStamp timeStamp;
     AudioTimeStamp originalTimeStamp;
-    AudioUnitRenderActionFlags *ioActionFlags;
+    silence_state_t silence;
     int nextFilterIndex;
 } channel_producer_arg_t;
 
+typedef struct __timed_producer_arg_t {
+    AEAudioFilterProducer producer;
+    void *token;
+    uint64_t ticks;
+} timed_producer_arg_t;
+
+static OSStatus timedProducer(void *userInfo, AudioBufferList *audio, UInt32 *frames) {
+    // Measures the time a filter spends waiting on upstream audio, so it's not counted against the filter
+    timed_producer_arg_t *arg = (timed_producer_arg_t*)userInfo;
+    uint64_t startTime = AECurrentTimeInHostTicks();
+    OSStatus status = arg->producer(arg->token, audio, frames);
+    arg->ticks += AECurrentTimeInHostTicks() - startTime;
+    return status;
+}
+
+static OSStatus runFilter(AECallback *filter, void *audioController, AEAudioFilterProducer producer, void *producerToken, silence_state_t *silence, uint64_t deadline, const AudioTimeStamp *time, UInt32 frames, AudioBufferList *audio) {
+    __unsafe_unretained AEAudioController *THIS = (__bridge AEAudioController *)audioController;
+    silence->reported = NO;
+    
+    OSStatus status;
+    if ( THIS->_renderProfiling ) {
+        timed_producer_arg_t timed = { .producer = producer, .token = producerToken, .ticks = 0 };
+        uint64_t startTime = AECurrentTimeInHostTicks();
+        status = ((AEAudioFilterCallback)filter->callback)((__bridge id)filter->userInfo, THIS, &timedProducer, &timed, time, frames, audio);
+        uint64_t endTime = AECurrentTimeInHostTicks();
+        AERenderProfileAccumulatorAdd(&filter->profile, endTime - startTime - MIN(timed.ticks, endTime - startTime), deadline && endTime > deadline);
+    } else {
+        status = ((AEAudioFilterCallback)filter->callback)((__bridge id)filter->userInfo, THIS, producer, producerToken, time, frames, audio);
+    }
+    
+    // Filters are audible unless they say otherwise, so reverb tails and the like keep sounding
+    silence->outputIsSilent = silence->reported;
+    silence->reported = NO;
+    return status;
+}
+
+static void runReceiver(AECallback *receiver, __unsafe_unretained AEAudioController *THIS, void *source, uint64_t deadline, const AudioTimeStamp *time, UInt32 frames, AudioBufferList *audio) {
+    if ( THIS->_renderProfiling ) {
+        uint64_t startTime = AECurrentTimeInHostTicks();
+        ((AEAudioReceiverCallback)receiver->callback)((__bridge id)receiver->userInfo, THIS, source, time, frames, audio);
+        uint64_t endTime = AECurrentTimeInHostTicks();
+        AERenderProfileAccumulatorAdd(&receiver->profile, endTime - startTime, deadline && endTime > deadline);
+    } else {
+        ((AEAudioReceiverCallback)receiver->callback)((__bridge id)receiver->userInfo, THIS, source, time, frames, audio);
+    }
+}
+
+typedef struct __produced_audio_arg_t {
+    AudioBufferList *audio;
+    UInt32 frames;
+} produced_audio_arg_t;
+
+static OSStatus producedAudioProducer(void *userInfo, AudioBufferList *audio, UInt32 *frames) {
+    // Hands a stateless filter the input we already produced for it
+    produced_audio_arg_t *arg = (produced_audio_arg_t*)userInfo;
+    *frames = MIN(*frames, arg->frames);
+    if ( audio != arg->audio ) {
+        for ( int i=0; i<audio->mNumberBuffers && i<arg->audio->mNumberBuffers; i++ ) {
+            audio->mBuffers[i].mDataByteSize = MIN(audio->mBuffers[i].mDataByteSize, arg->audio->mBuffers[i].mDataByteSize);
+            if ( audio->mBuffers[i].mData != arg->audio->mBuffers[i].mData ) {
+                memcpy(audio->mBuffers[i].mData, arg->audio->mBuffers[i].mData, audio->mBuffers[i].mDataByteSize);
+            }
+        }
+    }
+    return noErr;
+}
+
+static OSStatus mixChannelGroup(__unsafe_unretained AEAudioController *THIS, AEChannelGroupRef group, const AudioTimeStamp *inTimeStamp, UInt32 inNumberFrames, AudioBufferList *audio, BOOL *outputIsSilent);
+
 static OSStatus channelAudioProducer(void *userInfo, AudioBufferList *audio, UInt32 *frames) {
     channel_producer_arg_t *arg = (channel_producer_arg_t*)userInfo;
     AEChannelRef channel = arg->channel;
+    __unsafe_unretained AEAudioController * THIS = (__bridge AEAudioController*)channel->audioController;
     
     OSStatus status = noErr;
     
-    // See if there's another filter
-    for ( int i=channel->callbacks.count-1, filterIndex=0; i>=0; i-- ) {
-        callback_t *callback = &channel->callbacks.callbacks[i];
-        if ( callback->flags & kFilterFlag ) {
-            if ( filterIndex == arg->nextFilterIndex ) {
-                // Run this filter
-                channel_producer_arg_t filterArg = *arg;
-                filterArg.nextFilterIndex = filterIndex+1;
-                return ((AEAudioFilterCallback)callback->callback)((__bridge id)callback->userInfo, (__bridge AEAudioController *)channel->audioController, &channelAudioProducer, (void*)&filterArg, &arg->timeStamp, *frames, audio);
+    if ( arg->nextFilterIndex < channel->callbacks.filterCount ) {
+        // Run the next filter, which pulls from the one after it (or the source) through this same producer
+        AECallback *filter = channel->callbacks.filters[arg->nextFilterIndex];
+        arg->nextFilterIndex++;
+        if ( filter->flags & kAECallbackStatelessFilterFlag ) {
+            // Produce the filter's input up front, so we can skip the filter altogether if it's silent
+            status = channelAudioProducer(userInfo, audio, frames);
+            if ( status == noErr && !arg->silence.outputIsSilent ) {
+                produced_audio_arg_t produced = { .audio = audio, .frames = *frames };
+                status = runFilter(filter, channel->audioController, &producedAudioProducer, &produced, &arg->silence, THIS->_renderDeadline, &arg->timeStamp, *frames, audio);
             }
-            filterIndex++;
+        } else {
+            status = runFilter(filter, channel->audioController, &channelAudioProducer, arg, &arg->silence, THIS->_renderDeadline, &arg->timeStamp, *frames, audio);
         }
+        arg->nextFilterIndex--;
+        return status;
     }
 
     for ( int i=0; i<audio->mNumberBuffers; i++ ) {
@@ -335,15 +534,29 @@ static OSStatus channelAudioProducer(void *userInfo, AudioBufferList *audio, UIn
         AEAudioRenderCallback callback = (AEAudioRenderCallback) channel->ptr;
         __unsafe_unretained id<AEAudioPlayable> channelObj = (__bridge id<AEAudioPlayable>) channel->object;
         
-        status = callback(channelObj, (__bridge AEAudioController*)channel->audioController, &channel->timeStamp, *frames, audio);
+        arg->silence.reported = NO;
+        status = callback(channelObj, THIS, &channel->timeStamp, *frames, audio);
+        arg->silence.outputIsSilent = arg->silence.reported;
+        arg->silence.reported = NO;
         channel->timeStamp.mSampleTime += *frames;
         
     } else if ( channel->type == kChannelTypeGroup ) {
         AEChannelGroupRef group = (AEChannelGroupRef)channel->ptr;
         
-        // Tell mixer/mixer's converter unit to render into audio
-        status = AudioUnitRender(group->converterUnit ? group->converterUnit : group->mixerAudioUnit, arg->ioActionFlags, &arg->originalTimeStamp, 0, *frames, audio);
-        if ( !AECheckOSStatus(status, "AudioUnitRender") ) return status;
+        if ( THIS->_nativeGroupMixing ) {
+            // Mix the group's channels ourselves
+            BOOL silent = YES;
+            status = mixChannelGroup(THIS, group, &arg->originalTimeStamp, *frames, audio, &silent);
+            arg->silence.outputIsSilent = silent;
+        } else {
+            // Tell mixer/mixer's converter unit to render into audio
+            AudioUnitRenderActionFlags flags = 0;
+            status = AudioUnitRender(group->converterUnit ? group->converterUnit : group->mixerAudioUnit, &flags, &arg->originalTimeStamp, 0, *frames, audio);
+            if ( !AECheckOSStatus(status, "AudioUnitRender") ) return status;
+            
+            // The mixer flags its output as silent when all of its inputs were
+            arg->silence.outputIsSilent = (flags & kAudioUnitRenderAction_OutputIsSilence) != 0;
+        }
         
         if ( group->level_monitor_data.monitoringEnabled ) {
             performLevelMonitoring(&group->level_monitor_data, audio, *frames);
@@ -357,9 +570,58 @@ static OSStatus channelAudioProducer(void *userInfo, AudioBufferList *audio, UIn
     return status;
 }
 
-static OSStatus renderCallback(void *inRefCon, AudioUnitRenderActionFlags *ioActionFlags, const AudioTimeStamp *inTimeStamp, UInt32 inBusNumber, UInt32 inNumberFrames, AudioBufferList *ioData) {
-    AEChannelRef channel = (AEChannelRef)inRefCon;
+static void swapBytes(char *a, char *b, size_t length) {
+    char temp[256];
+    while ( length > 0 ) {
+        size_t chunk = MIN(length, sizeof(temp));
+        memcpy(temp, a, chunk);
+        memcpy(a, b, chunk);
+        memcpy(b, temp, chunk);
+        a += chunk;
+        b += chunk;
+        length -= chunk;
+    }
+}
+
+static BOOL applyLatencyCompensation(latency_compensation_t *compensation, AudioBufferList *audio, UInt32 frames, BOOL silent) {
+    if ( audio->mNumberBuffers != compensation->bufferCount
+            || audio->mBuffers[0].mDataByteSize < frames * compensation->bytesPerFrame ) {
+        // The format's changed, and a matching delay line is on its way
+        return silent;
+    }
+    
+    if ( silent ) {
+        if ( compensation->silentFrames >= compensation->delayFrames ) {
+            // The delay line holds nothing but silence, so the output is silent too
+            return YES;
+        }
+        for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+            memset(audio->mBuffers[i].mData, 0, MIN(audio->mBuffers[i].mDataByteSize, frames * compensation->bytesPerFrame));
+        }
+        compensation->silentFrames += frames;
+    } else {
+        compensation->silentFrames = 0;
+    }
+    
+    // Swap the audio through the delay line in place, a chunk at a time up to the end of the line
+    UInt32 offset = 0;
+    UInt32 position = compensation->position;
+    while ( offset < frames ) {
+        UInt32 chunk = MIN(frames - offset, compensation->delayFrames - position);
+        for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+            swapBytes((char*)audio->mBuffers[i].mData + offset * compensation->bytesPerFrame,
+                      compensation->buffers[i] + position * compensation->bytesPerFrame,
+                      chunk * compensation->bytesPerFrame);
+        }
+        offset += chunk;
+        position = (position + chunk) % compensation->delayFrames;
+    }
+    compensation->position = position;
     
+    return NO;
+}
+
+static OSStatus renderChannel(AEChannelRef channel, AudioUnitRenderActionFlags *ioActionFlags, const AudioTimeStamp *inTimeStamp, UInt32 inNumberFrames, AudioBufferList *ioData) {
     __unsafe_unretained AEAudioController * THIS = (__bridge AEAudioController*)channel->audioController;
 
     if ( channel == NULL || channel->ptr == NULL || !channel->playing ) {
@@ -368,9 +630,11 @@ static OSStatus renderCallback(void *inRefCon, AudioUnitRenderActionFlags *ioAct
         return noErr;
     }
     
+    uint64_t startTime = THIS->_renderProfiling ? AECurrentTimeInHostTicks() : 0;
+    
     AudioTimeStamp timestamp = *inTimeStamp;
 #if TARGET_OS_IPHONE
-    if ( THIS->_automaticLatencyManagement ) {
+    if ( THIS->_automaticLatencyManagement && !THIS->_renderingOffline ) {
         // Adjust timestamp to factor in hardware output latency
         timestamp.mHostTime += AEHostTicksFromSeconds(AEAudioControllerOutputLatency(THIS));
     }
@@ -386,21 +650,42 @@ static OSStatus renderCallback(void *inRefCon, AudioUnitRenderActionFlags *ioAct
         .channel = channel,
         .timeStamp = timestamp,
         .originalTimeStamp = *inTimeStamp,
-        .ioActionFlags = ioActionFlags,
         .nextFilterIndex = 0
     };
     
-    THIS->_channelBeingRendered = channel;
+    __channelBeingRendered = channel;
     
+    silence_state_t *outerSilenceState = __silenceState;
+    __silenceState = &arg.silence;
     OSStatus result = channelAudioProducer((void*)&arg, ioData, &inNumberFrames);
+    __silenceState = outerSilenceState;
     
-    handleCallbacksForChannel(channel, &timestamp, inNumberFrames, ioData);
+    BOOL silent = result == noErr && arg.silence.outputIsSilent;
     
-    THIS->_channelBeingRendered = NULL;
+    latency_compensation_t *compensation = channel->latencyCompensation;
+    if ( compensation && compensation->receiverOffsetFrames ) {
+        // Tell receivers when this audio will actually be heard, after the delays still to come
+        AudioTimeStamp receiverTimestamp = timestamp;
+        receiverTimestamp.mHostTime += compensation->receiverOffsetTicks;
+        receiverTimestamp.mSampleTime += compensation->receiverOffsetFrames;
+        handleCallbacksForChannel(channel, &receiverTimestamp, inNumberFrames, ioData);
+    } else {
+        handleCallbacksForChannel(channel, &timestamp, inNumberFrames, ioData);
+    }
+    
+    if ( compensation && compensation->delayFrames ) {
+        silent = applyLatencyCompensation(compensation, ioData, inNumberFrames, silent);
+    }
+    
+    __channelBeingRendered = NULL;
     
     if ( channel->audiobusSenderPort && ABSenderPortIsConnected((__bridge id)channel->audiobusSenderPort) && channel->audiobusFloatConverter ) {
-        // Convert the audio to float, and apply volume/pan if necessary
-        if ( AEFloatConverterToFloatBufferList((__bridge AEFloatConverter*)channel->audiobusFloatConverter, ioData, channel->audiobusScratchBuffer, inNumberFrames) ) {
+        if ( silent ) {
+            // Nothing to convert
+            for ( int i=0; i<channel->audiobusScratchBuffer->mNumberBuffers; i++ ) {
+                memset(channel->audiobusScratchBuffer->mBuffers[i].mData, 0, MIN(channel->audiobusScratchBuffer->mBuffers[i].mDataByteSize, inNumberFrames * sizeof(float)));
+            }
+        } else if ( AEFloatConverterToFloatBufferList((__bridge AEFloatConverter*)channel->audiobusFloatConverter, ioData, channel->audiobusScratchBuffer, inNumberFrames) ) {
             if ( fabs(1.0 - channel->volume) > 0.01 || fabs(0.0 - channel->pan) > 0.01 ) {
                 float volume = channel->volume;
                 for ( int i=0; i<channel->audiobusScratchBuffer->mNumberBuffers; i++ ) {
@@ -416,7 +701,8 @@ static OSStatus renderCallback(void *inRefCon, AudioUnitRenderActionFlags *ioAct
         // Send via Audiobus
         ABSenderPortSend((__bridge id)channel->audiobusSenderPort, channel->audiobusScratchBuffer, inNumberFrames, &timestamp);
         
-        if ( !ABSenderPortIsMuted((__bridge id)channel->audiobusSenderPort)
+        if ( !silent
+                && !ABSenderPortIsMuted((__bridge id)channel->audiobusSenderPort)
                 && upstreamChannelsMutedByAudiobus(channel)
                 && THIS->_audiobusMonitorBuffer ) {
             
@@ -432,16 +718,283 @@ static OSStatus renderCallback(void *inRefCon, AudioUnitRenderActionFlags *ioAct
         // Silence output
         *ioActionFlags |= kAudioUnitRenderAction_OutputIsSilence;
         for ( int i=0; i<ioData->mNumberBuffers; i++ ) memset(ioData->mBuffers[i].mData, 0, ioData->mBuffers[i].mDataByteSize);
+    } else if ( silent ) {
+        // Let the mixer skip this bus
+        *ioActionFlags |= kAudioUnitRenderAction_OutputIsSilence;
+    }
+    
+    if ( startTime ) {
+        uint64_t endTime = AECurrentTimeInHostTicks();
+        AERenderProfileAccumulatorAdd(&channel->profile, endTime - startTime, THIS->_renderDeadline && endTime > THIS->_renderDeadline);
     }
     
     return result;
 }
 
+typedef struct __parallel_render_t {
+    AEChannelRef *channels;
+    int          count;
+    AudioTimeStamp timeStamp;
+    UInt32       frames;
+} parallel_render_t;
+
+static void parallelRenderTask(void *context, int index) {
+    parallel_render_t *render = (parallel_render_t*)context;
+    AEChannelRef channel = render->channels[index];
+    
+    AEAudioBufferListCopyOnStack(bufferList, channel->parallelRenderBuffer, 0);
+    AEAudioBufferListSetLength(bufferList, channel->parallelRenderAudioDescription, render->frames);
+    
+    AudioUnitRenderActionFlags flags = 0;
+    channel->parallelRenderStatus = renderChannel(channel, &flags, &render->timeStamp, render->frames, bufferList);
+    channel->parallelRenderFlags = flags;
+    channel->parallelRenderSampleTime = render->timeStamp.mSampleTime;
+    channel->parallelRenderFrames = render->frames;
+    channel->parallelRenderValid = YES;
+}
+
+static void renderSiblingGroupsInParallel(__unsafe_unretained AEAudioController *THIS, AEChannelGroupRef group, const AudioTimeStamp *inTimeStamp, UInt32 inNumberFrames) {
+    // With native mixing, the audio thread only sees the group's render list
+    AERenderList *list = THIS->_nativeGroupMixing ? group->renderList : NULL;
+    if ( THIS->_nativeGroupMixing && !list ) return;
+    AEChannelRef *channels = list ? (AEChannelRef*)list->channels : group->channels;
+    int channelCount = list ? list->count : group->channelCount;
+    
+    parallel_render_t render = { .channels = list ? (AEChannelRef*)list->parallelChannels : group->parallelRenderChannels, .count = 0, .timeStamp = *inTimeStamp, .frames = inNumberFrames };
+    
+    // Gather the sibling groups that the mixer is about to pull, in bus order
+    for ( int i=0; i<channelCount; i++ ) {
+        AEChannelRef channel = channels[i];
+        if ( channel && channel->type == kChannelTypeGroup && channel->parallelRenderBuffer && channel->playing ) {
+            channel->parallelRenderValid = NO;
+            render.channels[render.count++] = channel;
+        }
+    }
+    
+    // Render them all into their own buffers, then join before the mixer sums them
+    AERenderWorkerPoolRun(THIS->_renderWorkerPool, parallelRenderTask, &render, render.count);
+}
+
+static OSStatus renderCallback(void *inRefCon, AudioUnitRenderActionFlags *ioActionFlags, const AudioTimeStamp *inTimeStamp, UInt32 inBusNumber, UInt32 inNumberFrames, AudioBufferList *ioData) {
+    AEChannelRef channel = (AEChannelRef)inRefCon;
+    
+    if ( channel && channel->parallelRenderBuffer && channel->parentGroup && channel->playing && inNumberFrames <= kMaxFramesPerSlice ) {
+        __unsafe_unretained AEAudioController * THIS = (__bridge AEAudioController*)channel->audioController;
+        
+        if ( THIS->_renderWorkerPool ) {
+            if ( !channel->parallelRenderValid
+                    || channel->parallelRenderSampleTime != inTimeStamp->mSampleTime
+                    || channel->parallelRenderFrames != inNumberFrames ) {
+                // First sibling pulled this cycle: render all sibling groups in parallel
+                renderSiblingGroupsInParallel(THIS, channel->parentGroup, inTimeStamp, inNumberFrames);
+            }
+            
+            if ( channel->parallelRenderValid && channel->parallelRenderSampleTime == inTimeStamp->mSampleTime ) {
+                // Hand over the audio we rendered earlier
+                for ( int i=0; i<ioData->mNumberBuffers && i<channel->parallelRenderBuffer->mNumberBuffers; i++ ) {
+                    memcpy(ioData->mBuffers[i].mData, channel->parallelRenderBuffer->mBuffers[i].mData,
+                           MIN(ioData->mBuffers[i].mDataByteSize, inNumberFrames * channel->parallelRenderAudioDescription.mBytesPerFrame));
+                }
+                *ioActionFlags |= channel->parallelRenderFlags;
+                channel->parallelRenderValid = NO;
+                return channel->parallelRenderStatus;
+            }
+        }
+    }
+    
+    return renderChannel(channel, ioActionFlags, inTimeStamp, inNumberFrames, ioData);
+}
+
+static void sendToAuxBuses(AEChannelRef channel, aux_send_table_t *sends, Float64 sampleTime, const float * const *sources, int sourceChannels, UInt32 frames) {
+    // Sends are post-fader, following the channel's volume, pan and mute as of the end of the block
+    double end = sampleTime + frames - 1;
+    float volume = channel->muted ? 0.0 : AEAutomationLaneValue(&channel->volumeAutomation, end, channel->volume);
+    float pan = AEAutomationLaneValue(&channel->panAutomation, end, channel->pan);
+    
+    for ( int i=0; i<sends->count; i++ ) {
+        aux_send_t *send = &sends->sends[i];
+        aux_bus_input_t *input = send->input;
+        int busChannels = input->buffer->mNumberBuffers;
+        float *outputs[busChannels];
+        for ( int j=0; j<busChannels; j++ ) {
+            outputs[j] = (float*)input->buffer->mBuffers[j].mData;
+        }
+        
+        if ( input->sampleTime != sampleTime || input->frames != frames ) {
+            // First send to this input this cycle
+            AEGroupMixerClear(outputs, busChannels, frames);
+            input->sampleTime = sampleTime;
+            input->frames = frames;
+        }
+        
+        AEGroupMixerAccumulate(&send->mixerInput, volume * send->level, pan, sources, sourceChannels, outputs, busChannels, frames);
+    }
+}
+
+typedef struct {
+    AEChannelRef channel;
+    AudioTimeStamp timeStamp;
+    OSStatus status;
+} resampled_channel_source_t;
+
+static OSStatus resampledChannelInputProc(AudioConverterRef             inAudioConverter,
+                                          UInt32                        *ioNumberDataPackets,
+                                          AudioBufferList               *ioData,
+                                          AudioStreamPacketDescription  **outDataPacketDescription,
+                                          void                          *inUserData) {
+    resampled_channel_source_t *source = (resampled_channel_source_t*)inUserData;
+    AEChannelRef channel = source->channel;
+    
+    // Render the channel at its own rate into its source buffer, as much as the converter asks for
+    UInt32 frames = MIN(*ioNumberDataPackets, kMaxFramesPerSlice);
+    for ( int i=0; i<ioData->mNumberBuffers && i<channel->mixSourceBuffer->mNumberBuffers; i++ ) {
+        ioData->mBuffers[i].mData = channel->mixSourceBuffer->mBuffers[i].mData;
+        ioData->mBuffers[i].mDataByteSize = MIN(frames * channel->audioDescription.mBytesPerFrame, channel->mixSourceBuffer->mBuffers[i].mDataByteSize);
+    }
+    
+    AudioUnitRenderActionFlags flags = 0;
+    OSStatus status = renderCallback(channel, &flags, &source->timeStamp, 0, frames, ioData);
+    if ( status != noErr ) {
+        source->status = status;
+        *ioNumberDataPackets = 0;
+        return status;
+    }
+    if ( flags & kAudioUnitRenderAction_OutputIsSilence ) {
+        for ( int i=0; i<ioData->mNumberBuffers; i++ ) {
+            memset(ioData->mBuffers[i].mData, 0, ioData->mBuffers[i].mDataByteSize);
+        }
+    }
+    
+    source->timeStamp.mSampleTime += frames;
+    source->timeStamp.mHostTime += AEHostTicksFromSeconds(frames / channel->audioDescription.mSampleRate);
+    *ioNumberDataPackets = frames;
+    return noErr;
+}
+
+static OSStatus renderResampledChannel(__unsafe_unretained AEAudioController *THIS, AEChannelRef channel, const AudioTimeStamp *inTimeStamp, UInt32 inNumberFrames, AudioBufferList *audio) {
+    // The converter keeps what it pulls beyond this block for the next one, so the channel is rendered in
+    // time with the group, though not in step with its blocks. It never reports silence for the same reason.
+    resampled_channel_source_t source = { .channel = channel, .timeStamp = *inTimeStamp, .status = noErr };
+    source.timeStamp.mSampleTime = inTimeStamp->mSampleTime * channel->audioDescription.mSampleRate / THIS->_audioDescription.mSampleRate;
+    
+    UInt32 frames = inNumberFrames;
+    OSStatus result = AudioConverterFillComplexBuffer(channel->mixSampleRateConverter, resampledChannelInputProc, &source, &frames, audio, NULL);
+    if ( source.status != noErr ) return source.status;
+    if ( !AECheckOSStatus(result, "AudioConverterFillComplexBuffer") ) return result;
+    
+    for ( int i=0; frames < inNumberFrames && i<audio->mNumberBuffers; i++ ) {
+        memset((float*)audio->mBuffers[i].mData + frames, 0, (inNumberFrames - frames) * sizeof(float));
+    }
+    return noErr;
+}
+
+static OSStatus mixChannelGroup(__unsafe_unretained AEAudioController *THIS, AEChannelGroupRef group, const AudioTimeStamp *inTimeStamp, UInt32 inNumberFrames, AudioBufferList *audio, BOOL *outputIsSilent) {
+    *outputIsSilent = YES;
+    
+    AudioBufferList *scratch = group->mixScratchBuffer;
+    AERenderList *list = group->renderList;
+    if ( !scratch || !list || inNumberFrames > kMaxFramesPerSlice ) {
+        for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+            memset(audio->mBuffers[i].mData, 0, audio->mBuffers[i].mDataByteSize);
+        }
+        return noErr;
+    }
+    
+    // Mix straight into the output if it's floating-point, or into our own buffer for conversion if not
+    AudioBufferList *mix = group->mixOutputConverter ? group->mixOutputBuffer : audio;
+    int outputChannels = mix->mNumberBuffers;
+    float *outputs[outputChannels];
+    for ( int i=0; i<outputChannels; i++ ) {
+        outputs[i] = (float*)mix->mBuffers[i].mData;
+    }
+    AEGroupMixerClear(outputs, outputChannels, inNumberFrames);
+    
+    float outputGain = group == THIS->_topGroup ? THIS->_masterOutputVolume : 1.0;
+    
+    aux_bus_t *auxBus = group->auxBus;
+    if ( auxBus ) {
+        // Sum what was sent to this bus this cycle; its siblings, and everything beneath them, have already rendered
+        for ( int i=0; i<auxBus->inputCount; i++ ) {
+            aux_bus_input_t *input = &auxBus->inputs[i];
+            if ( input->sampleTime != inTimeStamp->mSampleTime || input->frames != inNumberFrames ) continue;
+            for ( int j=0; j<outputChannels && j<input->buffer->mNumberBuffers; j++ ) {
+                vDSP_vadd(outputs[j], 1, (float*)input->buffer->mBuffers[j].mData, 1, outputs[j], 1, inNumberFrames);
+            }
+            *outputIsSilent = NO;
+        }
+    }
+    
+    for ( int i=0; i<list->count; i++ ) {
+        AEChannelRef channel = list->channels[i];
+        
+        AudioStreamBasicDescription *format = channel->audioDescription.mSampleRate ? &channel->audioDescription : &THIS->_audioDescription;
+        BOOL resampled = format->mSampleRate != THIS->_audioDescription.mSampleRate;
+        if ( !channel->playing || (resampled && !channel->mixSampleRateConverter) ) {
+            // Start from the target gains when we resume, or once the channel's sample rate converter arrives
+            AEGroupMixerInputReset(&channel->mixerInput);
+            continue;
+        }
+        
+        // Render floating-point channels straight into the scratch buffer, and others into their own buffer for conversion.
+        // Channels at another sample rate are pulled through their sample rate converter, which also converts to floating-point.
+        AudioBufferList *source = channel->mixSourceConverter ? channel->mixSourceBuffer : scratch;
+        int sourceChannels = MIN((int)format->mChannelsPerFrame, (int)scratch->mNumberBuffers);
+        AEAudioBufferListCopyOnStack(channelAudio, source, 0);
+        if ( !channel->mixSourceConverter ) {
+            channelAudio->mNumberBuffers = sourceChannels;
+        }
+        AEAudioBufferListSetLength(channelAudio, resampled ? AEAudioStreamBasicDescriptionNonInterleavedFloatStereo : *format, inNumberFrames);
+        
+        AudioUnitRenderActionFlags flags = 0;
+        OSStatus status = resampled
+            ? renderResampledChannel(THIS, channel, inTimeStamp, inNumberFrames, channelAudio)
+            : renderCallback(channel, &flags, inTimeStamp, i, inNumberFrames, channelAudio);
+        if ( status != noErr || (flags & kAudioUnitRenderAction_OutputIsSilence) ) {
+            // Nothing to mix
+            continue;
+        }
+        
+        float *sources[sourceChannels];
+        for ( int j=0; j<sourceChannels; j++ ) {
+            sources[j] = (float*)scratch->mBuffers[j].mData;
+        }
+        
+        if ( channel->mixSourceConverter ) {
+            if ( !AEFloatConverterToFloat((__bridge AEFloatConverter*)channel->mixSourceConverter, channelAudio, sources, inNumberFrames) ) continue;
+        }
+        
+        AEGroupMixerAccumulateAutomated(&channel->mixerInput,
+                                        &channel->volumeAutomation, channel->volume,
+                                        &channel->panAutomation, channel->pan,
+                                        channel->muted ? 0.0 : outputGain, inTimeStamp->mSampleTime,
+                                        (const float * const *)sources, sourceChannels, outputs, outputChannels, inNumberFrames);
+        *outputIsSilent = NO;
+        
+        aux_send_table_t *sends = channel->auxSends;
+        if ( sends ) {
+            sendToAuxBuses(channel, sends, inTimeStamp->mSampleTime, (const float * const *)sources, sourceChannels, inNumberFrames);
+        }
+    }
+    
+    if ( group->mixOutputConverter ) {
+        // Convert the mix to the output format
+        if ( *outputIsSilent ) {
+            for ( int i=0; i<audio->mNumberBuffers; i++ ) {
+                memset(audio->mBuffers[i].mData, 0, audio->mBuffers[i].mDataByteSize);
+            }
+        } else {
+            AEFloatConverterFromFloat((__bridge AEFloatConverter*)group->mixOutputConverter, outputs, audio, inNumberFrames);
+        }
+    }
+    
+    return noErr;
+}
+
 typedef struct __input_producer_arg_t {
     void *THIS;
     input_callback_table_t *table;
     AudioTimeStamp inTimeStamp;
-    AudioUnitRenderActionFlags *ioActionFlags;
+    silence_state_t silence;
     int nextFilterIndex;
 } input_producer_arg_t;
 
@@ -449,20 +1002,17 @@ static OSStatus inputAudioProducer(void *userInfo, AudioBufferList *audio, UInt3
     input_producer_arg_t *arg = (input_producer_arg_t*)userInfo;
     __unsafe_unretained AEAudioController *THIS = (__bridge AEAudioController*)arg->THIS;
     
-    // See if there's another filter
-    for ( int i=arg->table->callbacks.count-1, filterIndex=0; i>=0; i-- ) {
-        callback_t *callback = &arg->table->callbacks.callbacks[i];
-        if ( callback->flags & kFilterFlag ) {
-            if ( filterIndex == arg->nextFilterIndex ) {
-                // Run this filter
-                input_producer_arg_t filterArg = *arg;
-                filterArg.nextFilterIndex = filterIndex+1;
-                return ((AEAudioFilterCallback)callback->callback)((__bridge id)callback->userInfo, THIS, &inputAudioProducer, (void*)&filterArg, &arg->inTimeStamp, *frames, audio);
-            }
-            filterIndex++;
-        }
+    if ( arg->nextFilterIndex < arg->table->callbacks.filterCount ) {
+        // Run the next filter, which pulls from the one after it (or the input) through this same producer
+        AECallback *filter = arg->table->callbacks.filters[arg->nextFilterIndex];
+        arg->nextFilterIndex++;
+        OSStatus status = runFilter(filter, arg->THIS, &inputAudioProducer, arg, &arg->silence, THIS->_inputRenderDeadline, &arg->inTimeStamp, *frames, audio);
+        arg->nextFilterIndex--;
+        return status;
     }
     
+    arg->silence.outputIsSilent = NO;
+    
     if ( !THIS->_inputAudioBufferList ) {
         return noErr;
     }
@@ -518,11 +1068,11 @@ static OSStatus groupRenderNotifyCallback(void *inRefCon, AudioUnitRenderActionF
     
     if ( !(*ioActionFlags & kAudioUnitRenderAction_PreRender) ) {
         // After render
-        THIS->_channelBeingRendered = channel;
+        __channelBeingRendered = channel;
         
         handleCallbacksForChannel(channel, inTimeStamp, inNumberFrames, ioData);
         
-        THIS->_channelBeingRendered = NULL;
+        __channelBeingRendered = NULL;
         
         if ( group->level_monitor_data.monitoringEnabled ) {
             performLevelMonitoring(&group->level_monitor_data, ioData, inNumberFrames);
@@ -546,7 +1096,7 @@ static OSStatus topRenderNotifyCallback(void *inRefCon, AudioUnitRenderActionFla
         
         // Service input
 #if TARGET_OS_IPHONE
-        if ( THIS->_inputEnabled ) {
+        if ( THIS->_inputEnabled && !THIS->_renderingOffline ) {
             serviceAudioInput(THIS, inTimeStamp, &THIS->_lastInputBusTimeStamp, THIS->_lastAvailableInputFrames);
         }
 #endif
@@ -554,7 +1104,7 @@ static OSStatus topRenderNotifyCallback(void *inRefCon, AudioUnitRenderActionFla
         // Perform timing callbacks
         AudioTimeStamp timestamp = *inTimeStamp;
 #if TARGET_OS_IPHONE
-        if ( THIS->_automaticLatencyManagement ) {
+        if ( THIS->_automaticLatencyManagement && !THIS->_renderingOffline ) {
             // Adjust timestamp to factor in hardware output latency
             timestamp.mHostTime += AEHostTicksFromSeconds(AEAudioControllerOutputLatency(THIS));
         }
@@ -563,7 +1113,7 @@ static OSStatus topRenderNotifyCallback(void *inRefCon, AudioUnitRenderActionFla
         THIS->_lastInputOrOutputBusTimeStamp = timestamp;
         
         for ( int i=0; i<THIS->_timingCallbacks.count; i++ ) {
-            callback_t *callback = &THIS->_timingCallbacks.callbacks[i];
+            AECallback *callback = &THIS->_timingCallbacks.callbacks[i];
             ((AEAudioTimingCallback)callback->callback)((__bridge id)callback->userInfo, THIS, &timestamp, inNumberFrames, AEAudioTimingContextOutput);
         }
     } else {
@@ -578,6 +1128,21 @@ static OSStatus topRenderNotifyCallback(void *inRefCon, AudioUnitRenderActionFla
     return noErr;
 }
 
+static OSStatus nativeMixTopRenderCallback(void *inRefCon, AudioUnitRenderActionFlags *ioActionFlags, const AudioTimeStamp *inTimeStamp, UInt32 inBusNumber, UInt32 inNumberFrames, AudioBufferList *ioData) {
+    __unsafe_unretained AEAudioController *THIS = (__bridge AEAudioController *)inRefCon;
+    
+    // With no top mixer unit to notify us, bracket the render ourselves
+    AudioUnitRenderActionFlags notifyFlags = kAudioUnitRenderAction_PreRender;
+    topRenderNotifyCallback(inRefCon, &notifyFlags, inTimeStamp, 0, inNumberFrames, ioData);
+    
+    OSStatus result = renderCallback(THIS->_topChannel, ioActionFlags, inTimeStamp, 0, inNumberFrames, ioData);
+    
+    notifyFlags = kAudioUnitRenderAction_PostRender;
+    topRenderNotifyCallback(inRefCon, &notifyFlags, inTimeStamp, 0, inNumberFrames, ioData);
+    
+    return result;
+}
+
 static void serviceAudioInput(__unsafe_unretained AEAudioController * THIS, const AudioTimeStamp *outputBusTimeStamp, const AudioTimeStamp *inputBusTimeStamp, UInt32 inNumberFrames) {
     
     if ( !THIS->_inputAudioBufferList ) {
@@ -585,9 +1150,8 @@ static void serviceAudioInput(__unsafe_unretained AEAudioController * THIS, cons
         return;
     }
     
-#ifdef DEBUG
-    THIS->_renderStartTime[1] = AECurrentTimeInHostTicks();
-#endif
+    uint64_t startTime = AECurrentTimeInHostTicks();
+    THIS->_inputRenderDeadline = startTime + AEHostTicksFromSeconds(inNumberFrames / THIS->_audioDescription.mSampleRate);
     
     AudioTimeStamp timestamp;
     
@@ -618,7 +1182,7 @@ static void serviceAudioInput(__unsafe_unretained AEAudioController * THIS, cons
     THIS->_lastInputOrOutputBusTimeStamp = timestamp;
     
     for ( int i=0; i<THIS->_timingCallbacks.count; i++ ) {
-        callback_t *callback = &THIS->_timingCallbacks.callbacks[i];
+        AECallback *callback = &THIS->_timingCallbacks.callbacks[i];
         ((AEAudioTimingCallback)callback->callback)((__bridge id)callback->userInfo, THIS, &timestamp, inNumberFrames, AEAudioTimingContextInput);
     }
     
@@ -682,7 +1246,6 @@ static void serviceAudioInput(__unsafe_unretained AEAudioController * THIS, cons
                 .THIS = (__bridge void*)THIS,
                 .table = table,
                 .inTimeStamp = timestamp,
-                .ioActionFlags = 0,
                 .nextFilterIndex = 0
             };
             
@@ -690,14 +1253,17 @@ static void serviceAudioInput(__unsafe_unretained AEAudioController * THIS, cons
                 table->audioBufferList->mBuffers[i].mDataByteSize = inNumberFrames * table->audioDescription.mBytesPerFrame;
             }
             
+            silence_state_t *outerSilenceState = __silenceState;
+            __silenceState = &arg.silence;
             result = inputAudioProducer((void*)&arg, table->audioBufferList, &inNumberFrames);
+            __silenceState = outerSilenceState;
             
             // Pass audio to callbacks
             for ( int i=0; i<table->callbacks.count; i++ ) {
-                callback_t *callback = &table->callbacks.callbacks[i];
-                if ( !(callback->flags & kReceiverFlag) ) continue;
+                AECallback *callback = &table->callbacks.callbacks[i];
+                if ( !(callback->flags & kAECallbackReceiverFlag) ) continue;
                 
-                ((AEAudioReceiverCallback)callback->callback)((__bridge id)callback->userInfo, THIS, AEAudioSourceInput, &timestamp, inNumberFrames, table->audioBufferList);
+                runReceiver(callback, THIS, AEAudioSourceInput, THIS->_inputRenderDeadline, &timestamp, inNumberFrames, table->audioBufferList);
             }
         }
         
@@ -712,64 +1278,60 @@ static void serviceAudioInput(__unsafe_unretained AEAudioController * THIS, cons
         AEMessageQueueProcessMessagesOnRealtimeThread(THIS->_messageQueue);
     }
     
-#ifdef DEBUG
-    uint64_t renderEndTime = AECurrentTimeInHostTicks();
-    THIS->_renderDuration[1] = renderEndTime - THIS->_renderStartTime[1];
-#endif
+    if ( THIS->_renderProfiling ) {
+        uint64_t endTime = AECurrentTimeInHostTicks();
+        AERenderProfileAccumulatorAdd(&THIS->_inputRenderProfile, endTime - startTime, endTime > THIS->_inputRenderDeadline);
+    }
 }
 
-#ifdef DEBUG
-
-// Performance monitoring in debug mode
+// Render cycle timing, for profiling
 static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderActionFlags *ioActionFlags, const AudioTimeStamp *inTimeStamp, UInt32 inBusNumber, UInt32 inNumberFrames, AudioBufferList *ioData) {
     
     __unsafe_unretained AEAudioController * THIS = (__bridge AEAudioController*)inRefCon;
     
-    if ( inBusNumber == 0 && *ioActionFlags & kAudioUnitRenderAction_PreRender ) {
-        // Remember the time we started rendering
-        THIS->_renderStartTime[0] = AECurrentTimeInHostTicks();
+    if ( inBusNumber != 0 ) return noErr;
+    
+    if ( *ioActionFlags & kAudioUnitRenderAction_PreRender ) {
+        // Remember the time we started rendering, and when we need to be done
+        THIS->_renderStartTime = AECurrentTimeInHostTicks();
+        THIS->_renderDeadline = THIS->_renderStartTime + AEHostTicksFromSeconds(inNumberFrames / THIS->_audioDescription.mSampleRate);
         
-    } else if ( inBusNumber == 0 && *ioActionFlags & kAudioUnitRenderAction_PostRender ) {
+        if ( inTimeStamp->mFlags & kAudioTimeStampSampleTimeValid ) {
+            // A jump in the output timeline means the hardware ran out of audio
+            if ( THIS->_nextOutputSampleTime && inTimeStamp->mSampleTime != THIS->_nextOutputSampleTime ) {
+                __atomic_fetch_add(&THIS->_xrunCount, 1, __ATOMIC_RELAXED);
+                if ( inTimeStamp->mSampleTime > THIS->_nextOutputSampleTime ) {
+                    __atomic_fetch_add(&THIS->_xrunDroppedFrames, (uint64_t)(inTimeStamp->mSampleTime - THIS->_nextOutputSampleTime), __ATOMIC_RELAXED);
+                }
+            }
+            THIS->_nextOutputSampleTime = inTimeStamp->mSampleTime + inNumberFrames;
+        }
+        
+    } else if ( *ioActionFlags & kAudioUnitRenderAction_PostRender && THIS->_renderStartTime ) {
         // Calculate total render duration
         uint64_t renderEndTime = AECurrentTimeInHostTicks();
-        THIS->_renderDuration[0] = renderEndTime - THIS->_renderStartTime[MIN(1, inBusNumber)];
+        uint64_t duration = renderEndTime - THIS->_renderStartTime;
+        THIS->_renderStartTime = 0;
         
-        if ( THIS->_renderDuration[0] && (!THIS->_inputEnabled || THIS->_renderDuration[1]) ) {
-            // Got render duration for all buses
-            uint64_t duration = THIS->_renderDuration[0] + THIS->_renderDuration[1];
-            THIS->_renderDuration[0] = THIS->_renderDuration[1] = THIS->_renderStartTime[0] = THIS->_renderStartTime[1] = 0;
-            // Warn if total render takes longer than 50% of buffer duration (gives us a bit of headroom)
-            NSTimeInterval threshold = THIS->_currentBufferDuration * 0.5;
-            if ( duration >= AEHostTicksFromSeconds(threshold) && AERateLimit() ) {
-                dispatch_async(dispatch_get_main_queue(), ^{
-                    NSLog(@"TAAE: Warning: render took too long (%lfs, should be less than %lfs). Expect glitches.", AESecondsFromHostTicks(duration), threshold);
-                });
-            }
+        if ( THIS->_renderProfiling ) {
+            AERenderProfileAccumulatorAdd(&THIS->_outputRenderProfile, duration, renderEndTime > THIS->_renderDeadline);
+            AERenderLoadHistogramAdd(&THIS->_renderLoadHistogram, duration, THIS->_renderDeadline - (renderEndTime - duration));
+        }
         
-#ifdef TAAE_REPORT_RENDER_TIME
-            // Define the above symbol to report ongoing (max) render time every second
-            static uint64_t max = 0;
-            static uint64_t lastReport = 0;
-            if ( duration > max ) {
-                max = duration;
-            }
-            if ( renderEndTime > lastReport + AEHostTicksFromSeconds(1.0) ) {
-                uint64_t value = max;
-                dispatch_async(dispatch_get_main_queue(), ^{
-                    NSLog(@"TAAE: Render time %lfs", AESecondsFromHostTicks(value));
-                });
-                lastReport = renderEndTime;
-                max = 0;
-            }
-#endif
+#ifdef DEBUG
+        // Warn if total render takes longer than 50% of buffer duration (gives us a bit of headroom)
+        NSTimeInterval threshold = THIS->_currentBufferDuration * 0.5;
+        if ( duration >= AEHostTicksFromSeconds(threshold) && AERateLimit() ) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                NSLog(@"TAAE: Warning: render took too long (%lfs, should be less than %lfs). Expect glitches.", AESecondsFromHostTicks(duration), threshold);
+            });
         }
+#endif
     }
     
     return noErr;
 }
 
-#endif
-
 #pragma mark - Setup and start/stop
 
 + (AudioStreamBasicDescription)interleaved16BitStereoAudioDescription {
@@ -852,12 +1414,19 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     _inputEnabled = enableInput;
     _outputEnabled = enableOutput;
     _masterOutputVolume = 1.0;
+    _renderProfiling = YES;
     _useHardwareSampleRate = options & AEAudioControllerOptionUseHardwareSampleRate;
     _inputMode = AEInputModeFixedAudioFormat;
     _voiceProcessingOnlyForSpeakerAndMicrophone = YES;
     _inputCallbacks = (input_callback_table_t*)calloc(sizeof(input_callback_table_t), 1);
     _inputCallbackCount = 1;
     
+    pthread_mutexattr_t mutexAttributes;
+    pthread_mutexattr_init(&mutexAttributes);
+    pthread_mutexattr_settype(&mutexAttributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&_offlineRenderMutex, &mutexAttributes);
+    pthread_mutexattr_destroy(&mutexAttributes);
+    
 #if TARGET_OS_IPHONE
     [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(applicationWillEnterForeground:) name:UIApplicationWillEnterForegroundNotification object:nil];
 #endif
@@ -983,10 +1552,18 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     
     [[NSNotificationCenter defaultCenter] removeObserver:self];
     
+    [self stopOfflineRendering];
     [self stop];
     [self teardown];
     
     [self releaseResourcesForChannel:_topChannel];
+    
+    pthread_mutex_destroy(&_offlineRenderMutex);
+    
+    if ( _renderWorkerPool ) {
+        AERenderWorkerPoolDestroy(_renderWorkerPool);
+        _renderWorkerPool = NULL;
+    }
 
     if ( _inputLevelMonitorData.scratchBuffer ) {
         AEAudioBufferListFree(_inputLevelMonitorData.scratchBuffer);
@@ -1010,9 +1587,12 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
         if ( _inputCallbacks[i].channelMap ) {
             CFBridgingRelease(_inputCallbacks[i].channelMap);
         }
+        AECallbackTableCleanup(&_inputCallbacks[i].callbacks);
     }
     free(_inputCallbacks);
     
+    AECallbackTableCleanup(&_timingCallbacks);
+    
     if ( _audiobusMonitorBuffer ) AEAudioBufferListFree(_audiobusMonitorBuffer);
 }
 
@@ -1025,6 +1605,12 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     
     NSLog(@"TAAE: Starting Engine");
     
+    if ( _renderingOffline ) {
+        NSError *startError = [NSError audioControllerErrorWithMessage:@"Can't start audio engine while rendering offline" OSStatus:kAudioUnitErr_CannotDoInCurrentContext];
+        if ( error ) *error = startError;
+        return NO;
+    }
+    
     if ( !_audioGraph ) {
         if ( error ) *error = _lastError;
         self.lastError = nil;
@@ -1060,6 +1646,7 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     [_messageQueue startPolling];
     
     __audioThread = NULL;
+    _nextOutputSampleTime = 0;
     
     @synchronized ( self ) {
         status = AUGraphStart(_audioGraph);
@@ -1148,6 +1735,118 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     [_messageQueue stopPolling];
 }
 
+#pragma mark - Offline rendering
+
+- (BOOL)startOfflineRendering:(NSError**)error {
+    if ( _renderingOffline ) return YES;
+    
+    if ( !_audioGraph || self.running ) {
+        NSError *offlineError = [NSError audioControllerErrorWithMessage:@"Can't render offline while the audio engine is running" OSStatus:kAudioUnitErr_CannotDoInCurrentContext];
+        if ( error ) *error = offlineError;
+        return NO;
+    }
+    
+    NSLog(@"TAAE: Starting offline rendering");
+    
+    memset(&_offlineTimeStamp, 0, sizeof(_offlineTimeStamp));
+    _offlineTimeStamp.mFlags = kAudioTimeStampSampleTimeValid | kAudioTimeStampHostTimeValid;
+    _offlineStartHostTime = AECurrentTimeInHostTicks();
+    _offlineRenderDuration = 0;
+    _offlineFramesRendered = 0;
+    
+    // The first thread to render becomes the audio thread
+    __audioThread = NULL;
+    
+    [_messageQueue startPolling];
+    
+    _renderingOffline = YES;
+    
+    return YES;
+}
+
+- (void)stopOfflineRendering {
+    if ( !_renderingOffline ) return;
+    
+    NSLog(@"TAAE: Stopping offline rendering (%lfx realtime)", self.offlineRenderSpeed);
+    
+    _renderingOffline = NO;
+    
+    pthread_mutex_lock(&_offlineRenderMutex);
+    AEMessageQueueProcessMessagesOnRealtimeThread(_messageQueue);
+    pthread_mutex_unlock(&_offlineRenderMutex);
+    [_messageQueue stopPolling];
+    
+    __audioThread = NULL;
+}
+
+OSStatus AEAudioControllerRenderOffline(__unsafe_unretained AEAudioController *THIS, AudioBufferList *bufferList, UInt32 frames) {
+    if ( !THIS->_renderingOffline ) {
+        return kAudioUnitErr_CannotDoInCurrentContext;
+    }
+    
+    // Synchronous message exchanges from other threads wait until the render is done
+    pthread_mutex_lock(&THIS->_offlineRenderMutex);
+    
+    uint64_t startTime = AECurrentTimeInHostTicks();
+    
+    // There's no deadline when rendering offline
+    THIS->_renderDeadline = 0;
+    
+    OSStatus result = noErr;
+    UInt32 framesRendered = 0;
+    while ( framesRendered < frames ) {
+        UInt32 sliceFrames = MIN(frames - framesRendered, kMaxFramesPerSlice);
+        AEAudioBufferListCopyOnStack(sliceBufferList, bufferList, framesRendered * THIS->_audioDescription.mBytesPerFrame);
+        AEAudioBufferListSetLength(sliceBufferList, THIS->_audioDescription, sliceFrames);
+        
+        // Synthesize a host time as if we were playing back in realtime
+        THIS->_offlineTimeStamp.mHostTime = THIS->_offlineStartHostTime
+            + AEHostTicksFromSeconds(THIS->_offlineTimeStamp.mSampleTime / THIS->_audioDescription.mSampleRate);
+        
+        // Pull from the top of the tree, as the output unit would. The top mixer's render notification
+        // processes messages and runs timing receivers; output receivers are run by the group's callbacks.
+        AudioUnitRenderActionFlags flags = 0;
+        if ( THIS->_nativeGroupMixing ) {
+            result = nativeMixTopRenderCallback((__bridge void*)THIS, &flags, &THIS->_offlineTimeStamp, 0, sliceFrames, sliceBufferList);
+        } else if ( THIS->_topChannelUsesRenderCallback ) {
+            result = renderCallback(THIS->_topChannel, &flags, &THIS->_offlineTimeStamp, 0, sliceFrames, sliceBufferList);
+        } else {
+            AEChannelGroupRef group = THIS->_topGroup;
+            result = AudioUnitRender(group->converterUnit ? group->converterUnit : group->mixerAudioUnit, &flags, &THIS->_offlineTimeStamp, 0, sliceFrames, sliceBufferList);
+        }
+        
+        if ( !AECheckOSStatus(result, "AudioUnitRender") ) break;
+        
+        THIS->_offlineTimeStamp.mSampleTime += sliceFrames;
+        framesRendered += sliceFrames;
+    }
+    
+    THIS->_offlineFramesRendered += framesRendered;
+    THIS->_offlineRenderDuration += AECurrentTimeInHostTicks() - startTime;
+    
+    pthread_mutex_unlock(&THIS->_offlineRenderMutex);
+    
+    return result;
+}
+
+- (void)performMessageExchangeBetweenOfflineRendersWithBlock:(void (^)())block {
+    // Nothing renders between calls to AEAudioControllerRenderOffline, which may never come, so rather than
+    // waiting for the next one, perform the exchange here, after any messages sent before it
+    pthread_mutex_lock(&_offlineRenderMutex);
+    AEMessageQueueProcessMessagesOnRealtimeThread(_messageQueue);
+    if ( block ) block();
+    pthread_mutex_unlock(&_offlineRenderMutex);
+}
+
+-(UInt64)offlineFramesRendered {
+    return _offlineFramesRendered;
+}
+
+-(double)offlineRenderSpeed {
+    if ( !_offlineRenderDuration ) return 0.0;
+    return ((double)_offlineFramesRendered / _audioDescription.mSampleRate) / AESecondsFromHostTicks(_offlineRenderDuration);
+}
+
 #pragma mark - Channel and channel group management
 
 - (void)addChannels:(NSArray*)channels {
@@ -1155,16 +1854,17 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
 }
 
 - (void)addChannels:(NSArray*)channels toChannelGroup:(AEChannelGroupRef)group {
+    NSAssert(!group->isAuxBus, @"Aux buses can't contain channels");
+    
     // Remove the channels from the system, if they're already added
     [self removeChannels:channels];
     
+    if ( ![self reserveCapacity:group->channelCount + (int)channels.count forChannelGroup:group] ) {
+        return;
+    }
+    
     // Add to group's channel array
     for ( id<AEAudioPlayable> channel in channels ) {
-        if ( group->channelCount == kMaximumChannelsPerGroup ) {
-            NSLog(@"TAAE: Warning: Channel limit reached");
-            break;
-        }
-        
         if ( [channel respondsToSelector:@selector(setupWithAudioController:)] ) {
             [channel setupWithAudioController:self];
         }
@@ -1181,6 +1881,8 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
         channelElement->playing     = [channel respondsToSelector:@selector(channelIsPlaying)] ? channel.channelIsPlaying : YES;
         channelElement->volume      = [channel respondsToSelector:@selector(volume)] ? channel.volume : 1.0;
         channelElement->pan         = [channel respondsToSelector:@selector(pan)] ? channel.pan : 0.0;
+        channelElement->queuedVolume = channelElement->volume;
+        channelElement->queuedPan   = channelElement->pan;
         channelElement->muted       = [channel respondsToSelector:@selector(channelIsMuted)] ? channel.channelIsMuted : NO;
         if ( [channel respondsToSelector:@selector(audioDescription)] && channel.audioDescription.mSampleRate ) {
             channelElement->audioDescription = channel.audioDescription;
@@ -1194,7 +1896,11 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     // Configure each channel
     [self configureChannelsInRange:NSMakeRange(group->channelCount - channels.count, channels.count) forGroup:group];
     
-    AECheckOSStatus([self updateGraph], "Update graph");
+    if ( !_nativeGroupMixing ) {
+        AECheckOSStatus([self updateGraph], "Update graph");
+    }
+    
+    [self updateLatencyCompensation];
 }
 
 - (void)removeChannels:(NSArray *)channels {
@@ -1238,6 +1944,26 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     AEChannelRef removedChannels[count];
     memset(removedChannels, 0, sizeof(removedChannels));
     AEChannelRef *removedChannels_p = removedChannels;
+    
+    for ( int i=0; i<group->channelCount; i++ ) {
+        for ( int j=0; j<count; j++ ) {
+            if ( group->channels[i] && group->channels[i]->ptr == ptrMatchArray[j] && group->channels[i]->object == objectMatchArray[j] ) {
+                [self removeParameterValuesForChannel:group->channels[i]];
+            }
+        }
+    }
+    
+    if ( _nativeGroupMixing ) {
+        // Remove the channels here, then publish the group without them and release them once the realtime thread has moved on
+        removeChannelsFromGroup(self, group, ptrMatchArray, objectMatchArray, removedChannels, count);
+        free(ptrMatchArray);
+        free(objectMatchArray);
+        [self updateAuxRoutingRemovingChannels:removedChannels count:count];
+        [self publishRenderListForGroup:group releasingChannels:removedChannels count:count];
+        [self updateLatencyCompensation];
+        return;
+    }
+    
     int priorCount = group->channelCount;
     [self performSynchronousMessageExchangeWithBlock:^{
         removeChannelsFromGroup(self, group, ptrMatchArray, objectMatchArray, removedChannels_p, count);
@@ -1249,10 +1975,12 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     
     AECheckOSStatus([self updateGraph], "Update graph");
     
-    // Set new bus count of group
-    UInt32 busCount = group->channelCount;
-    if ( !AECheckOSStatus(AudioUnitSetProperty(group->mixerAudioUnit, kAudioUnitProperty_ElementCount, kAudioUnitScope_Input, 0, &busCount, sizeof(busCount)),
-                      "AudioUnitSetProperty(kAudioUnitProperty_ElementCount)") ) return;
+    if ( group->mixerAudioUnit ) {
+        // Set new bus count of group
+        UInt32 busCount = group->channelCount;
+        if ( !AECheckOSStatus(AudioUnitSetProperty(group->mixerAudioUnit, kAudioUnitProperty_ElementCount, kAudioUnitScope_Input, 0, &busCount, sizeof(busCount)),
+                          "AudioUnitSetProperty(kAudioUnitProperty_ElementCount)") ) return;
+    }
 
     
     // Release channel resources
@@ -1261,6 +1989,8 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
             [self releaseResourcesForChannel:removedChannels[i]];
         }
     }
+    
+    [self updateLatencyCompensation];
 }
 
 - (void)removeChannelGroup:(AEChannelGroupRef)group {
@@ -1270,6 +2000,17 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     AEChannelGroupRef parentGroup = (group == _topGroup ? NULL : [self searchForGroupContainingChannelMatchingPtr:group userInfo:NULL index:&index]);
     NSAssert(group == _topGroup || parentGroup != NULL, @"Channel group not found");
     
+    [self removeParameterValuesForChannel:group->channel];
+    
+    if ( parentGroup && _nativeGroupMixing ) {
+        // Remove the group here, then publish the parent without it and release it once the realtime thread has moved on
+        removeChannelsFromGroup(self, parentGroup, (void*[1]){ group }, (void*[1]){ NULL }, NULL, 1);
+        [self updateAuxRoutingRemovingChannels:(AEChannelRef[1]){ group->channel } count:1];
+        [self publishRenderListForGroup:parentGroup releasingChannels:(AEChannelRef[1]){ group->channel } count:1];
+        [self updateLatencyCompensation];
+        return;
+    }
+    
     if ( parentGroup ) {
         // Remove the group from the parent group's table, on the core audio thread
         [self performSynchronousMessageExchangeWithBlock:^{
@@ -1281,6 +2022,10 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     }
     
     [self releaseResourcesForChannel:group->channel];
+    
+    if ( parentGroup ) {
+        [self updateLatencyCompensation];
+    }
 }
 
 -(NSArray *)channels {
@@ -1305,13 +2050,19 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
 }
 
 - (AEChannelGroupRef)createChannelGroupWithinChannelGroup:(AEChannelGroupRef)parentGroup {
-    if ( parentGroup->channelCount == kMaximumChannelsPerGroup ) {
-        NSLog(@"TAAE: Maximum channels reached in group %p\n", parentGroup);
+    return [self createChannelGroupWithinChannelGroup:parentGroup auxBus:NO];
+}
+
+- (AEChannelGroupRef)createChannelGroupWithinChannelGroup:(AEChannelGroupRef)parentGroup auxBus:(BOOL)auxBus {
+    NSAssert(!parentGroup->isAuxBus, @"Aux buses can't contain channel groups");
+    
+    if ( ![self reserveCapacity:parentGroup->channelCount + 1 forChannelGroup:parentGroup] ) {
         return NULL;
     }
     
     // Allocate group
     AEChannelGroupRef group = (AEChannelGroupRef)calloc(1, sizeof(channel_group_t));
+    group->isAuxBus = auxBus;
     
     // Add group as a channel to the parent group
     int groupIndex = parentGroup->channelCount;
@@ -1324,6 +2075,8 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     channel->playing = YES;
     channel->volume  = 1.0;
     channel->pan     = 0.0;
+    channel->queuedVolume = 1.0;
+    channel->queuedPan = 0.0;
     channel->muted   = NO;
     channel->audioController = (__bridge void *)self;
     
@@ -1332,13 +2085,19 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     
     parentGroup->channelCount++;
     
-    // Set bus count
-    UInt32 busCount = parentGroup->channelCount;
-    OSStatus result = AudioUnitSetProperty(parentGroup->mixerAudioUnit, kAudioUnitProperty_ElementCount, kAudioUnitScope_Input, 0, &busCount, sizeof(busCount));
-    if ( !AECheckOSStatus(result, "AudioUnitSetProperty(kAudioUnitProperty_ElementCount)") ) return NULL;
+    if ( parentGroup->mixerAudioUnit ) {
+        // Set bus count
+        UInt32 busCount = parentGroup->channelCount;
+        OSStatus result = AudioUnitSetProperty(parentGroup->mixerAudioUnit, kAudioUnitProperty_ElementCount, kAudioUnitScope_Input, 0, &busCount, sizeof(busCount));
+        if ( !AECheckOSStatus(result, "AudioUnitSetProperty(kAudioUnitProperty_ElementCount)") ) return NULL;
+    }
 
     [self configureChannelsInRange:NSMakeRange(groupIndex, 1) forGroup:parentGroup];
-    AECheckOSStatus([self updateGraph], "Update graph");
+    if ( !_nativeGroupMixing ) {
+        AECheckOSStatus([self updateGraph], "Update graph");
+    }
+    
+    [self updateLatencyCompensation];
     
     return group;
 }
@@ -1357,18 +2116,41 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     return groups;
 }
 
+static void channelParameterHandler(void *target, int key, double value) {
+    AEChannelRef channel = (AEChannelRef)target;
+    if ( key == kChannelParameterVolume ) {
+        channel->volume = (float)value;
+    } else if ( key == kChannelParameterPan ) {
+        channel->pan = (float)value;
+    }
+}
+
+- (void)removeParameterValuesForChannel:(AEChannelRef)channel {
+    // Stop sending volume and pan to the channel, and anything beneath it, before it's released
+    if ( channel->type == kChannelTypeGroup ) {
+        [self iterateChannelsBeneathGroup:(AEChannelGroupRef)channel->ptr block:^(AEChannelRef member) {
+            [_messageQueue removeParameterValuesForTarget:member];
+        }];
+    } else {
+        [_messageQueue removeParameterValuesForTarget:channel];
+    }
+}
+
 - (void)setVolume:(float)volume forChannelGroup:(AEChannelGroupRef)group {
     int index;
     AEChannelGroupRef parentGroup = [self searchForGroupContainingChannelMatchingPtr:group userInfo:NULL index:&index];
     NSAssert(parentGroup != NULL, @"Channel not found");
     
-    AudioUnitParameterValue value = group->channel->volume = volume;
+    AudioUnitParameterValue value = group->channel->queuedVolume = volume;
+    [_messageQueue setParameterValue:volume forKey:kChannelParameterVolume target:group->channel handler:channelParameterHandler];
+    AEAutomationLaneReset(&group->channel->volumeAutomation);
+    if ( !parentGroup->mixerAudioUnit ) return;
     OSStatus result = AudioUnitSetParameter(parentGroup->mixerAudioUnit, kMultiChannelMixerParam_Volume, kAudioUnitScope_Input, index, value, 0);
     AECheckOSStatus(result, "AudioUnitSetParameter(kMultiChannelMixerParam_Volume)");
 }
 
 -(float)volumeForChannelGroup:(AEChannelGroupRef)group {
-    return group->channel->volume;
+    return group->channel->queuedVolume;
 }
 
 - (void)setPan:(float)pan forChannelGroup:(AEChannelGroupRef)group {
@@ -1376,13 +2158,16 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     AEChannelGroupRef parentGroup = [self searchForGroupContainingChannelMatchingPtr:group userInfo:NULL index:&index];
     NSAssert(parentGroup != NULL, @"Channel not found");
     
-    AudioUnitParameterValue value = group->channel->pan = pan;
+    AudioUnitParameterValue value = group->channel->queuedPan = pan;
+    [_messageQueue setParameterValue:pan forKey:kChannelParameterPan target:group->channel handler:channelParameterHandler];
+    AEAutomationLaneReset(&group->channel->panAutomation);
+    if ( !parentGroup->mixerAudioUnit ) return;
     OSStatus result = AudioUnitSetParameter(parentGroup->mixerAudioUnit, kMultiChannelMixerParam_Pan, kAudioUnitScope_Input, index, value, 0);
     AECheckOSStatus(result, "AudioUnitSetParameter(kMultiChannelMixerParam_Pan)");
 }
 
 -(float)panForChannelGroup:(AEChannelGroupRef)group {
-    return group->channel->pan;
+    return group->channel->queuedPan;
 }
 
 - (void)setPlaying:(BOOL)playing forChannelGroup:(AEChannelGroupRef)group {
@@ -1391,6 +2176,7 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     NSAssert(parentGroup != NULL, @"Channel not found");
     group->channel->playing = playing;
     AudioUnitParameterValue value = group->channel->playing;
+    if ( !parentGroup->mixerAudioUnit ) return;
     OSStatus result = AudioUnitSetParameter(parentGroup->mixerAudioUnit, kMultiChannelMixerParam_Enable, kAudioUnitScope_Input, index, value, 0);
     AECheckOSStatus(result, "AudioUnitSetParameter(kMultiChannelMixerParam_Enable)");
 }
@@ -1404,7 +2190,8 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     AEChannelGroupRef parentGroup = [self searchForGroupContainingChannelMatchingPtr:group userInfo:NULL index:&index];
     NSAssert(parentGroup != NULL, @"Channel not found");
     group->channel->muted = muted;
-    AudioUnitParameterValue value = muted ? 0.0 : group->channel->volume;
+    AudioUnitParameterValue value = muted ? 0.0 : group->channel->queuedVolume;
+    if ( !parentGroup->mixerAudioUnit ) return;
     OSStatus result = AudioUnitSetParameter(parentGroup->mixerAudioUnit, kMultiChannelMixerParam_Volume, kAudioUnitScope_Input, index, value, 0);
     AECheckOSStatus(result, "AudioUnitSetParameter(kMultiChannelMixerParam_Volume)");
 }
@@ -1413,14 +2200,328 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     return group->channel->muted;
 }
 
+#pragma mark - Automation
+
+- (BOOL)addVolumeAutomationPoint:(float)volume atSampleTime:(Float64)sampleTime forChannel:(id<AEAudioPlayable>)channel {
+    AEChannelRef channelElement = [self channelElementForChannel:channel];
+    if ( !channelElement || !_nativeGroupMixing ) return NO;
+    return AEAutomationLaneAddPoint(&channelElement->volumeAutomation, sampleTime, volume);
+}
+
+- (BOOL)addPanAutomationPoint:(float)pan atSampleTime:(Float64)sampleTime forChannel:(id<AEAudioPlayable>)channel {
+    AEChannelRef channelElement = [self channelElementForChannel:channel];
+    if ( !channelElement || !_nativeGroupMixing ) return NO;
+    return AEAutomationLaneAddPoint(&channelElement->panAutomation, sampleTime, pan);
+}
+
+- (BOOL)addVolumeAutomationPoint:(float)volume atSampleTime:(Float64)sampleTime forChannelGroup:(AEChannelGroupRef)group {
+    if ( !_nativeGroupMixing ) return NO;
+    return AEAutomationLaneAddPoint(&group->channel->volumeAutomation, sampleTime, volume);
+}
+
+- (BOOL)addPanAutomationPoint:(float)pan atSampleTime:(Float64)sampleTime forChannelGroup:(AEChannelGroupRef)group {
+    if ( !_nativeGroupMixing ) return NO;
+    return AEAutomationLaneAddPoint(&group->channel->panAutomation, sampleTime, pan);
+}
+
+- (Float64)outputSampleTime {
+    return _nextOutputSampleTime;
+}
+
+- (AEChannelRef)channelElementForChannel:(id<AEAudioPlayable>)channel {
+    int index;
+    AEChannelGroupRef group = [self searchForGroupContainingChannelMatchingPtr:channel.renderCallback userInfo:(__bridge void*)channel index:&index];
+    return group ? group->channels[index] : NULL;
+}
+
+#pragma mark - Aux buses
+
+static BOOL isAuxBusChannel(AEChannelRef channel) {
+    return channel->type == kChannelTypeGroup && ((AEChannelGroupRef)channel->ptr)->isAuxBus;
+}
+
+static aux_send_t *findAuxSend(aux_send_table_t *sends, AEChannelGroupRef bus) {
+    for ( int i=0; sends && i<sends->count; i++ ) {
+        if ( sends->sends[i].bus == bus ) return &sends->sends[i];
+    }
+    return NULL;
+}
+
+static void freeAuxBus(aux_bus_t *bus) {
+    if ( !bus ) return;
+    for ( int i=0; i<bus->inputCount; i++ ) {
+        AEAudioBufferListFree(bus->inputs[i].buffer);
+    }
+    free(bus);
+}
+
+- (AEChannelGroupRef)createAuxBusWithinChannelGroup:(AEChannelGroupRef)group {
+    if ( !_nativeGroupMixing ) {
+        NSLog(@"TAAE: Aux buses require native group mixing");
+        return NULL;
+    }
+    return [self createChannelGroupWithinChannelGroup:group auxBus:YES];
+}
+
+- (BOOL)setSendLevel:(float)level toAuxBus:(AEChannelGroupRef)bus forChannel:(id<AEAudioPlayable>)channel {
+    AEChannelRef channelElement = [self channelElementForChannel:channel];
+    if ( !channelElement ) return NO;
+    return [self setSendLevel:level toAuxBus:bus forChannelElement:channelElement];
+}
+
+- (BOOL)setSendLevel:(float)level toAuxBus:(AEChannelGroupRef)bus forChannelGroup:(AEChannelGroupRef)group {
+    return [self setSendLevel:level toAuxBus:bus forChannelElement:group->channel];
+}
+
+- (float)sendLevelToAuxBus:(AEChannelGroupRef)bus forChannel:(id<AEAudioPlayable>)channel {
+    AEChannelRef channelElement = [self channelElementForChannel:channel];
+    aux_send_t *send = channelElement ? findAuxSend(channelElement->queuedAuxSends, bus) : NULL;
+    return send ? send->level : 0.0;
+}
+
+- (float)sendLevelToAuxBus:(AEChannelGroupRef)bus forChannelGroup:(AEChannelGroupRef)group {
+    aux_send_t *send = findAuxSend(group->channel->queuedAuxSends, bus);
+    return send ? send->level : 0.0;
+}
+
+- (BOOL)setSendLevel:(float)level toAuxBus:(AEChannelGroupRef)bus forChannelElement:(AEChannelRef)channel {
+    if ( !_nativeGroupMixing || !bus->isAuxBus ) return NO;
+    if ( isAuxBusChannel(channel) ) return NO;
+    
+    // The bus mixes after its siblings, so it can only take sends from beneath the group it's in
+    AEChannelGroupRef busParent = bus->channel->parentGroup;
+    AEChannelGroupRef ancestor = channel->parentGroup;
+    while ( ancestor && ancestor != busParent ) {
+        ancestor = ancestor->channel->parentGroup;
+    }
+    if ( !ancestor ) return NO;
+    
+    aux_send_t *send = findAuxSend(channel->queuedAuxSends, bus);
+    if ( send ) {
+        // The realtime thread picks this up as it's either using this table, or about to
+        send->level = level;
+        return YES;
+    }
+    
+    [self updateAuxRoutingRemovingChannels:NULL count:0 addingSendFrom:channel toAuxBus:bus level:level];
+    return YES;
+}
+
+- (void)updateAuxRouting {
+    [self updateAuxRoutingRemovingChannels:NULL count:0 addingSendFrom:NULL toAuxBus:NULL level:0.0];
+}
+
+- (void)updateAuxRoutingRemovingChannels:(AEChannelRef*)removedChannels count:(int)removedCount {
+    [self updateAuxRoutingRemovingChannels:removedChannels count:removedCount addingSendFrom:NULL toAuxBus:NULL level:0.0];
+}
+
+- (void)updateAuxRoutingRemovingChannels:(AEChannelRef*)removedChannels
+                                   count:(int)removedCount
+                          addingSendFrom:(AEChannelRef)newSender
+                                toAuxBus:(AEChannelGroupRef)newSendBus
+                                   level:(float)newSendLevel {
+    if ( !_topGroup ) return;
+    
+    // Find the buses, and the channels sending to them
+    NSMutableArray *busValues = [NSMutableArray array];
+    NSMutableArray *senderValues = [NSMutableArray array];
+    [self iterateChannelsBeneathGroup:_topGroup block:^(AEChannelRef channel) {
+        if ( isAuxBusChannel(channel) ) {
+            [busValues addObject:[NSValue valueWithPointer:channel->ptr]];
+        }
+        if ( channel->queuedAuxSends || channel == newSender ) {
+            [senderValues addObject:[NSValue valueWithPointer:channel]];
+        }
+    }];
+    int busCount = (int)busValues.count;
+    int senderCount = (int)senderValues.count;
+    
+    // Disconnect anything that's been removed from the tree, before it's unpublished and released
+    for ( int i=0; i<removedCount; i++ ) {
+        if ( !removedChannels[i] ) continue;
+        void (^detach)(AEChannelRef channel) = ^(AEChannelRef channel) {
+            if ( isAuxBusChannel(channel) ) {
+                [busValues addObject:[NSValue valueWithPointer:channel->ptr]];
+            }
+            if ( channel->queuedAuxSends ) {
+                [senderValues addObject:[NSValue valueWithPointer:channel]];
+            }
+        };
+        if ( removedChannels[i]->type == kChannelTypeGroup ) {
+            [self iterateChannelsBeneathGroup:(AEChannelGroupRef)removedChannels[i]->ptr block:detach];
+        } else {
+            detach(removedChannels[i]);
+        }
+    }
+    
+    if ( busValues.count == 0 && senderValues.count == 0 ) return;
+    
+    int totalBusCount = (int)busValues.count;
+    AEChannelGroupRef *buses = (AEChannelGroupRef*)malloc(MAX(1, totalBusCount) * sizeof(AEChannelGroupRef));
+    aux_bus_t **busTables = (aux_bus_t**)calloc(MAX(1, totalBusCount), sizeof(aux_bus_t*));
+    aux_bus_t **oldBusTables = (aux_bus_t**)calloc(MAX(1, totalBusCount), sizeof(aux_bus_t*));
+    for ( int i=0; i<totalBusCount; i++ ) {
+        buses[i] = (AEChannelGroupRef)[busValues[i] pointerValue];
+        if ( i < busCount ) {
+            busTables[i] = (aux_bus_t*)calloc(1, sizeof(aux_bus_t) + senderCount * sizeof(aux_bus_input_t));
+        }
+    }
+    
+    AudioStreamBasicDescription busFormat = AEAudioStreamBasicDescriptionNonInterleavedFloatStereo;
+    AEAudioStreamBasicDescriptionSetChannelsPerFrame(&busFormat, _audioDescription.mChannelsPerFrame);
+    busFormat.mSampleRate = _audioDescription.mSampleRate;
+    
+    // Rebuild each sender's table, dropping sends to buses that have gone, and giving each sending group its own input
+    int totalSenderCount = (int)senderValues.count;
+    AEChannelRef *senders = (AEChannelRef*)malloc(MAX(1, totalSenderCount) * sizeof(AEChannelRef));
+    aux_send_table_t **sendTables = (aux_send_table_t**)calloc(MAX(1, totalSenderCount), sizeof(aux_send_table_t*));
+    aux_send_table_t **oldSendTables = (aux_send_table_t**)calloc(MAX(1, totalSenderCount), sizeof(aux_send_table_t*));
+    for ( int i=0; i<totalSenderCount; i++ ) {
+        AEChannelRef sender = (AEChannelRef)[senderValues[i] pointerValue];
+        senders[i] = sender;
+        if ( i >= senderCount ) {
+            sender->queuedAuxSends = NULL;
+            continue;
+        }
+        
+        aux_send_table_t *queued = sender->queuedAuxSends;
+        int capacity = (queued ? queued->count : 0) + (sender == newSender ? 1 : 0);
+        aux_send_table_t *table = (aux_send_table_t*)malloc(sizeof(aux_send_table_t) + capacity * sizeof(aux_send_t));
+        table->count = 0;
+        
+        for ( int j=0; j<capacity; j++ ) {
+            BOOL isNewSend = !queued || j == queued->count;
+            AEChannelGroupRef bus = isNewSend ? newSendBus : queued->sends[j].bus;
+            
+            int busIndex = 0;
+            while ( busIndex < busCount && buses[busIndex] != bus ) busIndex++;
+            if ( busIndex == busCount ) continue;
+            
+            aux_bus_t *busTable = busTables[busIndex];
+            aux_bus_input_t *input = NULL;
+            for ( int k=0; k<busTable->inputCount && !input; k++ ) {
+                if ( busTable->inputs[k].sourceGroup == sender->parentGroup ) input = &busTable->inputs[k];
+            }
+            if ( !input ) {
+                input = &busTable->inputs[busTable->inputCount++];
+                input->sourceGroup = sender->parentGroup;
+                input->buffer = NULL;
+                input->sampleTime = -1;
+                
+                // Carry over the buffer from the bus's current input for this group, if there is one
+                aux_bus_t *queuedBus = buses[busIndex]->queuedAuxBus;
+                for ( int k=0; queuedBus && k<queuedBus->inputCount; k++ ) {
+                    if ( queuedBus->inputs[k].sourceGroup == input->sourceGroup
+                            && queuedBus->inputs[k].buffer->mNumberBuffers == busFormat.mChannelsPerFrame ) {
+                        input->buffer = queuedBus->inputs[k].buffer;
+                        break;
+                    }
+                }
+                if ( !input->buffer ) {
+                    input->buffer = AEAudioBufferListCreate(busFormat, kMaxFramesPerSlice);
+                }
+            }
+            
+            aux_send_t *send = &table->sends[table->count++];
+            send->bus = bus;
+            send->level = isNewSend ? newSendLevel : queued->sends[j].level;
+            send->input = input;
+            AEGroupMixerInputReset(&send->mixerInput);
+            if ( isNewSend ) {
+                // Fade in, rather than starting at full level
+                send->mixerInput.primed = true;
+            }
+        }
+        
+        if ( table->count == 0 ) {
+            free(table);
+            table = NULL;
+        }
+        
+        sendTables[i] = table;
+        sender->queuedAuxSends = table;
+    }
+    
+    for ( int i=0; i<busCount; i++ ) {
+        if ( busTables[i]->inputCount == 0 ) {
+            free(busTables[i]);
+            busTables[i] = NULL;
+        }
+    }
+    
+    // Find the input buffers that weren't carried over, to free once the realtime thread is done with them
+    int droppedBufferCount = 0;
+    for ( int i=0; i<totalBusCount; i++ ) {
+        droppedBufferCount += buses[i]->queuedAuxBus ? buses[i]->queuedAuxBus->inputCount : 0;
+    }
+    AudioBufferList **droppedBuffers = (AudioBufferList**)malloc(MAX(1, droppedBufferCount) * sizeof(AudioBufferList*));
+    droppedBufferCount = 0;
+    for ( int i=0; i<totalBusCount; i++ ) {
+        aux_bus_t *queuedBus = buses[i]->queuedAuxBus;
+        for ( int j=0; queuedBus && j<queuedBus->inputCount; j++ ) {
+            BOOL carried = NO;
+            for ( int k=0; busTables[i] && k<busTables[i]->inputCount && !carried; k++ ) {
+                carried = busTables[i]->inputs[k].buffer == queuedBus->inputs[j].buffer;
+            }
+            if ( !carried ) {
+                droppedBuffers[droppedBufferCount++] = queuedBus->inputs[j].buffer;
+            }
+        }
+        buses[i]->queuedAuxBus = busTables[i];
+    }
+    
+    // Swap the buses and their senders over together, taking the old tables as we go
+    [self performAsynchronousMessageExchangeWithBlock:^{
+        for ( int i=0; i<totalBusCount; i++ ) {
+            oldBusTables[i] = buses[i]->auxBus;
+            buses[i]->auxBus = busTables[i];
+        }
+        for ( int i=0; i<totalSenderCount; i++ ) {
+            oldSendTables[i] = senders[i]->auxSends;
+            senders[i]->auxSends = sendTables[i];
+            
+            // Sends that survive keep their ramp state, so their gains don't jump
+            for ( int j=0; sendTables[i] && j<sendTables[i]->count; j++ ) {
+                aux_send_t *oldSend = findAuxSend(oldSendTables[i], sendTables[i]->sends[j].bus);
+                if ( oldSend ) {
+                    sendTables[i]->sends[j].mixerInput = oldSend->mixerInput;
+                }
+            }
+        }
+    } responseBlock:^{
+        for ( int i=0; i<totalBusCount; i++ ) {
+            free(oldBusTables[i]);
+        }
+        for ( int i=0; i<droppedBufferCount; i++ ) {
+            AEAudioBufferListFree(droppedBuffers[i]);
+        }
+        for ( int i=0; i<totalSenderCount; i++ ) {
+            free(oldSendTables[i]);
+        }
+        free(droppedBuffers);
+        free(buses);
+        free(busTables);
+        free(oldBusTables);
+        free(senders);
+        free(sendTables);
+        free(oldSendTables);
+    }];
+}
+
 #pragma mark - Filters
 
+- (int)callbackFlagsForFilter:(id<AEAudioFilter>)filter {
+    return kAECallbackFilterFlag | ([filter respondsToSelector:@selector(filterIsStateless)] && filter.filterIsStateless ? kAECallbackStatelessFilterFlag : 0);
+}
+
 - (void)addFilter:(id<AEAudioFilter>)filter {
     if ( [filter respondsToSelector:@selector(setupWithAudioController:)] ) {
         [filter setupWithAudioController:self];
     }
-    if ( [self addCallback:filter.filterCallback userInfo:(__bridge void *)filter flags:kFilterFlag forChannelGroup:_topGroup] ) {
+    if ( [self addCallback:filter.filterCallback userInfo:(__bridge void *)filter flags:[self callbackFlagsForFilter:filter] forChannelGroup:_topGroup] ) {
         CFBridgingRetain(filter);
+        [self startObservingLatencyOfFilter:filter];
+        [self updateLatencyCompensation];
     }
 }
 
@@ -1428,8 +2529,10 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     if ( [filter respondsToSelector:@selector(setupWithAudioController:)] ) {
         [filter setupWithAudioController:self];
     }
-    if ( [self addCallback:filter.filterCallback userInfo:(__bridge void *)filter flags:kFilterFlag forChannel:channel] ) {
+    if ( [self addCallback:filter.filterCallback userInfo:(__bridge void *)filter flags:[self callbackFlagsForFilter:filter] forChannel:channel] ) {
         CFBridgingRetain(filter);
+        [self startObservingLatencyOfFilter:filter];
+        [self updateLatencyCompensation];
     }
 }
 
@@ -1437,8 +2540,10 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     if ( [filter respondsToSelector:@selector(setupWithAudioController:)] ) {
         [filter setupWithAudioController:self];
     }
-    if ( [self addCallback:filter.filterCallback userInfo:(__bridge void *)filter flags:kFilterFlag forChannelGroup:group] ) {
+    if ( [self addCallback:filter.filterCallback userInfo:(__bridge void *)filter flags:[self callbackFlagsForFilter:filter] forChannelGroup:group] ) {
         CFBridgingRetain(filter);
+        [self startObservingLatencyOfFilter:filter];
+        [self updateLatencyCompensation];
     }
 }
 
@@ -1454,7 +2559,7 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
         [filter setupWithAudioController:self];
     }
     void *callback = filter.filterCallback;
-    if ( [self addCallback:callback userInfo:(__bridge void *)filter flags:kFilterFlag forInputChannels:channels] ) {
+    if ( [self addCallback:callback userInfo:(__bridge void *)filter flags:[self callbackFlagsForFilter:filter] forInputChannels:channels] ) {
         CFBridgingRetain(filter);
     }
 }
@@ -1464,7 +2569,9 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
         if ( [filter respondsToSelector:@selector(teardown)] ) {
             [filter teardown];
         }
+        [self stopObservingLatencyOfFilter:filter];
         CFBridgingRelease((__bridge CFTypeRef)filter);
+        [self updateLatencyCompensation];
     }
 }
 
@@ -1473,7 +2580,9 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
         if ( [filter respondsToSelector:@selector(teardown)] ) {
             [filter teardown];
         }
+        [self stopObservingLatencyOfFilter:filter];
         CFBridgingRelease((__bridge CFTypeRef)filter);
+        [self updateLatencyCompensation];
     }
 }
 
@@ -1482,7 +2591,21 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
         if ( [filter respondsToSelector:@selector(teardown)] ) {
             [filter teardown];
         }
+        [self stopObservingLatencyOfFilter:filter];
         CFBridgingRelease((__bridge CFTypeRef)filter);
+        [self updateLatencyCompensation];
+    }
+}
+
+- (void)startObservingLatencyOfFilter:(id<AEAudioFilter>)filter {
+    if ( [filter respondsToSelector:@selector(filterLatency)] ) {
+        [(NSObject*)filter addObserver:self forKeyPath:@"filterLatency" options:0 context:kFilterLatencyChanged];
+    }
+}
+
+- (void)stopObservingLatencyOfFilter:(id<AEAudioFilter>)filter {
+    if ( [filter respondsToSelector:@selector(filterLatency)] ) {
+        [(NSObject*)filter removeObserver:self forKeyPath:@"filterLatency" context:kFilterLatencyChanged];
     }
 }
 
@@ -1491,7 +2614,7 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     __block BOOL found = NO;
     [self performSynchronousMessageExchangeWithBlock:^{
         for ( int i=0; i<_inputCallbackCount; i++ ) {
-            removeCallbackFromTable(self, &_inputCallbacks[i].callbacks, callback, (__bridge void *)filter, &found);
+            if ( AECallbackTableRemove(&_inputCallbacks[i].callbacks, callback, (__bridge void *)filter) ) found = YES;
         }
     }];
     
@@ -1504,21 +2627,21 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
 }
 
 - (NSArray*)filters {
-    return [self associatedObjectsWithFlags:kFilterFlag];
+    return [self associatedObjectsWithFlags:kAECallbackFilterFlag];
 }
 
 - (NSArray*)filtersForChannel:(id<AEAudioPlayable>)channel {
-    return [self associatedObjectsWithFlags:kFilterFlag forChannel:channel];
+    return [self associatedObjectsWithFlags:kAECallbackFilterFlag forChannel:channel];
 }
 
 - (NSArray*)filtersForChannelGroup:(AEChannelGroupRef)group {
-    return [self associatedObjectsWithFlags:kFilterFlag forChannelGroup:group];
+    return [self associatedObjectsWithFlags:kAECallbackFilterFlag forChannelGroup:group];
 }
 
 -(NSArray *)inputFilters {
     NSMutableArray *result = [NSMutableArray array];
     for ( int i=0; i<_inputCallbackCount; i++ ) {
-        [result addObjectsFromArray:[self associatedObjectsFromTable:&_inputCallbacks[i].callbacks matchingFlag:kFilterFlag]];
+        [result addObjectsFromArray:[self associatedObjectsFromTable:&_inputCallbacks[i].callbacks matchingFlag:kAECallbackFilterFlag]];
     }
     return result;
 }
@@ -1526,19 +2649,19 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
 #pragma mark - Output receivers
 
 - (void)addOutputReceiver:(id<AEAudioReceiver>)receiver {
-    if ( [self addCallback:receiver.receiverCallback userInfo:(__bridge void *)receiver flags:kReceiverFlag forChannelGroup:_topGroup] ) {
+    if ( [self addCallback:receiver.receiverCallback userInfo:(__bridge void *)receiver flags:kAECallbackReceiverFlag forChannelGroup:_topGroup] ) {
         CFBridgingRetain(receiver);
     }
 }
 
 - (void)addOutputReceiver:(id<AEAudioReceiver>)receiver forChannel:(id<AEAudioPlayable>)channel {
-    if ( [self addCallback:receiver.receiverCallback userInfo:(__bridge void *)receiver flags:kReceiverFlag forChannel:channel] ) {
+    if ( [self addCallback:receiver.receiverCallback userInfo:(__bridge void *)receiver flags:kAECallbackReceiverFlag forChannel:channel] ) {
         CFBridgingRetain(receiver);
     }
 }
 
 - (void)addOutputReceiver:(id<AEAudioReceiver>)receiver forChannelGroup:(AEChannelGroupRef)group {
-    if ( [self addCallback:receiver.receiverCallback userInfo:(__bridge void *)receiver flags:kReceiverFlag forChannelGroup:group] ) {
+    if ( [self addCallback:receiver.receiverCallback userInfo:(__bridge void *)receiver flags:kAECallbackReceiverFlag forChannelGroup:group] ) {
         CFBridgingRetain(receiver);
     }
 }
@@ -1562,15 +2685,15 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
 }
 
 - (NSArray*)outputReceivers {
-    return [self associatedObjectsWithFlags:kReceiverFlag];
+    return [self associatedObjectsWithFlags:kAECallbackReceiverFlag];
 }
 
 - (NSArray*)outputReceiversForChannel:(id<AEAudioPlayable>)channel {
-    return [self associatedObjectsWithFlags:kReceiverFlag forChannel:channel];
+    return [self associatedObjectsWithFlags:kAECallbackReceiverFlag forChannel:channel];
 }
 
 - (NSArray*)outputReceiversForChannelGroup:(AEChannelGroupRef)group {
-    return [self associatedObjectsWithFlags:kReceiverFlag forChannelGroup:group];
+    return [self associatedObjectsWithFlags:kAECallbackReceiverFlag forChannelGroup:group];
 }
 
 #pragma mark - Input receivers
@@ -1582,7 +2705,7 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
 - (void)addInputReceiver:(id<AEAudioReceiver>)receiver forChannels:(NSArray *)channels {
     void *callback = receiver.receiverCallback;
     
-    if ( [self addCallback:callback userInfo:(__bridge void *)receiver flags:kReceiverFlag forInputChannels:channels] ) {
+    if ( [self addCallback:callback userInfo:(__bridge void *)receiver flags:kAECallbackReceiverFlag forInputChannels:channels] ) {
         CFBridgingRetain(receiver);
     }
 }
@@ -1592,9 +2715,7 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     __block int instanceCount = 0;
     [self performSynchronousMessageExchangeWithBlock:^{
         for ( int i=0; i<_inputCallbackCount; i++ ) {
-            BOOL found = NO;
-            removeCallbackFromTable(self, &_inputCallbacks[i].callbacks, callback, (__bridge void *)receiver, &found);
-            if ( found ) instanceCount++;
+            if ( AECallbackTableRemove(&_inputCallbacks[i].callbacks, callback, (__bridge void *)receiver) ) instanceCount++;
         }
     }];
     
@@ -1613,7 +2734,7 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
             __block BOOL found = NO;
             
             [self performSynchronousMessageExchangeWithBlock:^{
-                removeCallbackFromTable(self, &_inputCallbacks[i].callbacks, callback, (__bridge void *)receiver, &found);
+                found = AECallbackTableRemove(&_inputCallbacks[i].callbacks, callback, (__bridge void *)receiver);
             }];
 
             if ( found ) {
@@ -1628,7 +2749,7 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
 -(NSArray *)inputReceivers {
     NSMutableArray *result = [NSMutableArray array];
     for ( int i=0; i<_inputCallbackCount; i++ ) {
-        [result addObjectsFromArray:[self associatedObjectsFromTable:&_inputCallbacks[i].callbacks matchingFlag:kReceiverFlag]];
+        [result addObjectsFromArray:[self associatedObjectsFromTable:&_inputCallbacks[i].callbacks matchingFlag:kAECallbackReceiverFlag]];
     }
     return result;
 }
@@ -1636,8 +2757,7 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
 #pragma mark - Timing receivers
 
 - (void)addTimingReceiver:(id<AEAudioTimingReceiver>)receiver {
-    if ( _timingCallbacks.count == kMaximumCallbacksPerSource ) {
-        NSLog(@"TAAE: Warning: Maximum number of callbacks reached");
+    if ( ![self reserveCapacity:_timingCallbacks.count + 1 forCallbackTable:&_timingCallbacks] ) {
         return;
     }
     
@@ -1645,7 +2765,7 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     
     void *callback = receiver.timingReceiverCallback;
     [self performSynchronousMessageExchangeWithBlock:^{
-        addCallbackToTable(self, &_timingCallbacks, callback, (__bridge void *)receiver, 0);
+        AECallbackTableAdd(&_timingCallbacks, callback, (__bridge void *)receiver, 0);
     }];
 }
 
@@ -1653,7 +2773,7 @@ static OSStatus ioUnitRenderNotifyCallback(void *inRefCon, AudioUnitRenderAction
     void *callback = receiver.timingReceiverCallback;
     __block BOOL found = NO;
     [self performSynchronousMessageExchangeWithBlock:^{
-        removeCallbackFromTable(self, &_timingCallbacks, callback, (__bridge void *)receiver, &found);
+        found = AECallbackTableRemove(&_timingCallbacks, callback, (__bridge void *)receiver);
     }];
     
     if ( found ) {
@@ -1820,7 +2940,17 @@ NSTimeInterval AEConvertFramesToSeconds(__unsafe_unretained AEAudioController *T
 }
 
 BOOL AECurrentThreadIsAudioThread(void) {
-    return __audioThread == pthread_self();
+    return __audioThread == pthread_self() || AERenderWorkerPoolCurrentThreadIsWorker();
+}
+
+void AEAudioControllerReportOutputIsSilent(__unsafe_unretained AEAudioController *THIS) {
+    if ( __silenceState ) {
+        __silenceState->reported = YES;
+    }
+}
+
+BOOL AEAudioControllerFilterInputIsSilent(__unsafe_unretained AEAudioController *THIS) {
+    return __silenceState && __silenceState->outputIsSilent;
 }
 
 #pragma mark - Setters, getters
@@ -1902,11 +3032,130 @@ BOOL AECurrentThreadIsAudioThread(void) {
 -(void)setMasterOutputVolume:(float)masterOutputVolume {
     _masterOutputVolume = masterOutputVolume;
     
+    if ( !_topGroup->mixerAudioUnit ) return;
+    
     AudioUnitParameterValue value = _masterOutputVolume;
     OSStatus result = AudioUnitSetParameter(_topGroup->mixerAudioUnit, kMultiChannelMixerParam_Volume, kAudioUnitScope_Output, 0, value, 0);
     AECheckOSStatus(result, "AudioUnitSetParameter(kMultiChannelMixerParam_Volume)");
 }
 
+-(void)setParallelRenderingEnabled:(BOOL)parallelRenderingEnabled {
+    if ( parallelRenderingEnabled == (_renderWorkerPool != NULL) ) return;
+    
+    if ( parallelRenderingEnabled ) {
+        int workerCount = MAX(0, MIN((int)[[NSProcessInfo processInfo] activeProcessorCount] - 1, kAERenderWorkerPoolMaxWorkers));
+        AERenderWorkerPool *pool = AERenderWorkerPoolCreate(workerCount, _currentBufferDuration ? _currentBufferDuration : kDefaultRenderWorkerPeriod);
+        if ( !pool ) {
+            NSLog(@"TAAE: Couldn't create render worker pool");
+            return;
+        }
+        [self performSynchronousMessageExchangeWithBlock:^{ _renderWorkerPool = pool; }];
+        
+        // Route all sibling groups through our render callback, with their own render buffers
+        [self configureChannelsInRange:NSMakeRange(0, 1) forGroup:NULL];
+        AECheckOSStatus([self updateGraph], "Update graph");
+    } else {
+        AERenderWorkerPool *pool = _renderWorkerPool;
+        [self performSynchronousMessageExchangeWithBlock:^{ _renderWorkerPool = NULL; }];
+        
+        [self configureChannelsInRange:NSMakeRange(0, 1) forGroup:NULL];
+        AECheckOSStatus([self updateGraph], "Update graph");
+        
+        AERenderWorkerPoolDestroy(pool);
+    }
+}
+
+-(void)setNativeGroupMixingEnabled:(BOOL)nativeGroupMixingEnabled {
+    if ( nativeGroupMixingEnabled == _nativeGroupMixing ) return;
+    [self reinitializeWithChanges:^{ _nativeGroupMixing = nativeGroupMixingEnabled; } error:NULL];
+}
+
+-(BOOL)nativeGroupMixingEnabled {
+    return _nativeGroupMixing;
+}
+
+-(void)setRenderProfilingEnabled:(BOOL)renderProfilingEnabled {
+    _renderProfiling = renderProfilingEnabled;
+}
+
+-(BOOL)renderProfilingEnabled {
+    return _renderProfiling;
+}
+
+-(AERenderProfile *)renderProfile {
+    NSMutableArray *children = [NSMutableArray array];
+    
+    if ( _inputEnabled ) {
+        NSMutableArray *inputChildren = [NSMutableArray array];
+        for ( int i=0; i<_inputCallbackCount; i++ ) {
+            [inputChildren addObjectsFromArray:[self renderProfilesForCallbackTable:&_inputCallbacks[i].callbacks]];
+        }
+        [children addObject:[[AERenderProfile alloc] initWithType:AERenderProfileNodeInput object:nil accumulator:&_inputRenderProfile children:inputChildren]];
+    }
+    
+    if ( _topChannel ) {
+        [children addObject:[self renderProfileForChannel:_topChannel]];
+    }
+    
+    return [[AERenderProfile alloc] initWithType:AERenderProfileNodeOutput object:nil accumulator:&_outputRenderProfile children:children];
+}
+
+-(AERenderLoadStatistics)renderLoadStatistics {
+    AERenderLoadStatistics statistics;
+    AERenderLoadHistogramCollect(&_renderLoadHistogram, &statistics);
+    
+    uint64_t xrunCount = __atomic_load_n(&_xrunCount, __ATOMIC_RELAXED);
+    uint64_t droppedFrames = __atomic_load_n(&_xrunDroppedFrames, __ATOMIC_RELAXED);
+    statistics.xrunCount = xrunCount - _reportedXrunCount;
+    statistics.droppedFrames = droppedFrames - _reportedXrunDroppedFrames;
+    _reportedXrunCount = xrunCount;
+    _reportedXrunDroppedFrames = droppedFrames;
+    
+    return statistics;
+}
+
+- (AERenderProfile*)renderProfileForChannel:(AEChannelRef)channel {
+    NSMutableArray *children = [NSMutableArray arrayWithArray:[self renderProfilesForCallbackTable:&channel->callbacks]];
+    
+    if ( channel->type == kChannelTypeGroup ) {
+        AEChannelGroupRef group = (AEChannelGroupRef)channel->ptr;
+        for ( int i=0; i<group->channelCount; i++ ) {
+            if ( group->channels[i] ) {
+                [children addObject:[self renderProfileForChannel:group->channels[i]]];
+            }
+        }
+        return [[AERenderProfile alloc] initWithType:AERenderProfileNodeGroup object:[NSValue valueWithPointer:group] accumulator:&channel->profile children:children];
+    }
+    
+    return [[AERenderProfile alloc] initWithType:AERenderProfileNodeChannel object:(__bridge id)channel->object accumulator:&channel->profile children:children];
+}
+
+- (NSArray*)renderProfilesForCallbackTable:(AECallbackTable*)table {
+    NSMutableArray *profiles = [NSMutableArray array];
+    
+    // Filters in the order they run, then receivers
+    for ( int i=0; i<table->filterCount; i++ ) {
+        AECallback *filter = table->filters[i];
+        [profiles addObject:[[AERenderProfile alloc] initWithType:AERenderProfileNodeFilter object:(__bridge id)filter->userInfo accumulator:&filter->profile children:nil]];
+    }
+    for ( int i=0; i<table->count; i++ ) {
+        AECallback *receiver = &table->callbacks[i];
+        if ( !(receiver->flags & kAECallbackReceiverFlag) ) continue;
+        [profiles addObject:[[AERenderProfile alloc] initWithType:AERenderProfileNodeReceiver object:(__bridge id)receiver->userInfo accumulator:&receiver->profile children:nil]];
+    }
+    
+    return profiles;
+}
+
+-(BOOL)parallelRenderingEnabled {
+    return _renderWorkerPool != NULL;
+}
+
+-(int)parallelRenderWorkerLoad:(AERenderWorkerLoad *)loads count:(int)count {
+    if ( !_renderWorkerPool ) return 0;
+    return AERenderWorkerPoolGetLoad(_renderWorkerPool, loads, count);
+}
+
 - (BOOL)running {
     Boolean topAudioUnitIsRunning;
     UInt32 size = sizeof(topAudioUnitIsRunning);
@@ -2018,7 +3267,7 @@ NSTimeInterval AEAudioControllerInputLatency(__unsafe_unretained AEAudioControll
 
 NSTimeInterval AEAudioControllerOutputLatency(__unsafe_unretained AEAudioController *THIS) {
     if ( AECurrentThreadIsAudioThread() ) {
-        AEChannelRef channelBeingRendered = THIS->_channelBeingRendered;
+        AEChannelRef channelBeingRendered = __channelBeingRendered;
         if ( !channelBeingRendered ) channelBeingRendered = THIS->_topChannel;
         
         __unsafe_unretained ABSenderPort * upstreamSenderPort = (__bridge ABSenderPort*)firstUpstreamAudiobusSenderPort(channelBeingRendered);
@@ -2175,19 +3424,23 @@ AudioTimeStamp AEAudioControllerCurrentAudioTimestamp(__unsafe_unretained AEAudi
         AEChannelRef channelElement = group->channels[index];
         
         if ( [keyPath isEqualToString:@"volume"] ) {
-            channelElement->volume = channel.volume;
+            channelElement->queuedVolume = channel.volume;
+            [_messageQueue setParameterValue:channelElement->queuedVolume forKey:kChannelParameterVolume target:channelElement handler:channelParameterHandler];
+            AEAutomationLaneReset(&channelElement->volumeAutomation);
             
             if ( group->mixerAudioUnit ) {
-                AudioUnitParameterValue value = channelElement->muted ? 0.0 : channelElement->volume;
+                AudioUnitParameterValue value = channelElement->muted ? 0.0 : channelElement->queuedVolume;
                 OSStatus result = AudioUnitSetParameter(group->mixerAudioUnit, kMultiChannelMixerParam_Volume, kAudioUnitScope_Input, index, value, 0);
                 AECheckOSStatus(result, "AudioUnitSetParameter(kMultiChannelMixerParam_Volume)");
             }
             
         } else if ( [keyPath isEqualToString:@"pan"] ) {
-            channelElement->pan = channel.pan;
+            channelElement->queuedPan = channel.pan;
+            [_messageQueue setParameterValue:channelElement->queuedPan forKey:kChannelParameterPan target:channelElement handler:channelParameterHandler];
+            AEAutomationLaneReset(&channelElement->panAutomation);
             
             if ( group->mixerAudioUnit ) {
-                AudioUnitParameterValue value = channelElement->pan;
+                AudioUnitParameterValue value = channelElement->queuedPan;
                 OSStatus result = AudioUnitSetParameter(group->mixerAudioUnit, kMultiChannelMixerParam_Pan, kAudioUnitScope_Input, index, value, 0);
                 AECheckOSStatus(result, "AudioUnitSetParameter(kMultiChannelMixerParam_Pan)");
             }
@@ -2207,7 +3460,7 @@ AudioTimeStamp AEAudioControllerCurrentAudioTimestamp(__unsafe_unretained AEAudi
             channelElement->muted = channel.channelIsMuted;
             
             if ( group->mixerAudioUnit ) {
-                AudioUnitParameterValue value = channelElement->muted ? 0.0 : channelElement->volume;
+                AudioUnitParameterValue value = channelElement->muted ? 0.0 : channelElement->queuedVolume;
                 OSStatus result = AudioUnitSetParameter(group->mixerAudioUnit, kMultiChannelMixerParam_Volume, kAudioUnitScope_Input, index, value, 0);
                 AECheckOSStatus(result, "AudioUnitSetParameter(kMultiChannelMixerParam_Volume)");
             }
@@ -2220,13 +3473,23 @@ AudioTimeStamp AEAudioControllerCurrentAudioTimestamp(__unsafe_unretained AEAudi
                 AECheckOSStatus(result, "AudioUnitSetProperty(kAudioUnitProperty_StreamFormat)");
             }
             
+            if ( _nativeGroupMixing ) {
+                [self updateMixResourcesForGroup:group];
+                [self updateMixResourcesForChannel:channelElement];
+            }
+            
             if ( channelElement->audiobusFloatConverter ) {
                 void *newFloatConverter = (__bridge_retained void*)[[AEFloatConverter alloc] initWithSourceFormat:channel.audioDescription];
                 void *oldFloatConverter = channelElement->audiobusFloatConverter;
                 [self performSynchronousMessageExchangeWithBlock:^{ channelElement->audiobusFloatConverter = newFloatConverter; }];
                 CFBridgingRelease(oldFloatConverter);
             }
+            
+            // The delay line holds audio in the channel's format
+            [self updateLatencyCompensation];
         }
+    } else if ( context == kFilterLatencyChanged ) {
+        [self updateLatencyCompensation];
     } else {
         [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
     }
@@ -2528,10 +3791,8 @@ static void interAppConnectedChangeCallback(void *inRefCon, AudioUnit inUnit, Au
     result = AUGraphNodeInfo(_audioGraph, _ioNode, NULL, &_ioAudioUnit);
     if ( !AECheckOSStatus(result, "AUGraphNodeInfo") ) return NO;
 
-#ifdef DEBUG
-    // Add a render notify to the top audio unit, for the purposes of performance profiling
+    // Add a render notify to the output unit, to time the render cycle
     AECheckOSStatus(AudioUnitAddRenderNotify(_ioAudioUnit, &ioUnitRenderNotifyCallback, (__bridge void*)self), "AudioUnitAddRenderNotify");
-#endif
     
 #if !TARGET_OS_IPHONE
     if ( _inputEnabled ) {
@@ -2565,6 +3826,8 @@ static void interAppConnectedChangeCallback(void *inRefCon, AudioUnit inUnit, Au
         _topChannel->playing  = YES;
         _topChannel->volume   = 1.0;
         _topChannel->pan      = 0.0;
+        _topChannel->queuedVolume = 1.0;
+        _topChannel->queuedPan = 0.0;
         _topChannel->muted    = NO;
         _topChannel->audioController = (__bridge void *)self;
         _topGroup->channel   = _topChannel;
@@ -2576,13 +3839,17 @@ static void interAppConnectedChangeCallback(void *inRefCon, AudioUnit inUnit, Au
     
     // Initialise group
     [self configureChannelsInRange:NSMakeRange(0, 1) forGroup:NULL];
+    [self updateLatencyCompensation];
+    [self updateAuxRouting];
     
-    // Register a callback to be notified when the main mixer unit renders
-    AECheckOSStatus(AudioUnitAddRenderNotify(_topGroup->mixerAudioUnit, &topRenderNotifyCallback, (__bridge void*)self), "AudioUnitAddRenderNotify");
-    
-    // Set the master volume
-    AudioUnitParameterValue value = _masterOutputVolume;
-    AECheckOSStatus(AudioUnitSetParameter(_topGroup->mixerAudioUnit, kMultiChannelMixerParam_Volume, kAudioUnitScope_Output, 0, value, 0), "AudioUnitSetParameter(kMultiChannelMixerParam_Volume)");
+    if ( !_nativeGroupMixing ) {
+        // Register a callback to be notified when the main mixer unit renders
+        AECheckOSStatus(AudioUnitAddRenderNotify(_topGroup->mixerAudioUnit, &topRenderNotifyCallback, (__bridge void*)self), "AudioUnitAddRenderNotify");
+        
+        // Set the master volume
+        AudioUnitParameterValue value = _masterOutputVolume;
+        AECheckOSStatus(AudioUnitSetParameter(_topGroup->mixerAudioUnit, kMultiChannelMixerParam_Volume, kAudioUnitScope_Output, 0, value, 0), "AudioUnitSetParameter(kMultiChannelMixerParam_Volume)");
+    }
     
     // Initialize the graph
     result = AUGraphInitialize(_audioGraph);
@@ -2659,6 +3926,8 @@ static void interAppConnectedChangeCallback(void *inRefCon, AudioUnit inUnit, Au
         return;
     }
     
+    AECheckOSStatus(AudioUnitAddRenderNotify(_ioAudioUnit, &ioUnitRenderNotifyCallback, (__bridge void*)self), "AudioUnitAddRenderNotify");
+    
     [self configureAudioUnit];
     
     OSStatus result = AUGraphUpdate(_audioGraph, NULL);
@@ -2673,10 +3942,13 @@ static void interAppConnectedChangeCallback(void *inRefCon, AudioUnit inUnit, Au
     
     
     [self configureChannelsInRange:NSMakeRange(0, 1) forGroup:NULL];
+    [self updateLatencyCompensation];
+    [self updateAuxRouting];
     
     AECheckOSStatus([self updateGraph], "Update graph");
     
     __audioThread = NULL;
+    _nextOutputSampleTime = 0;
     
     if ( wasRunning ) {
         @synchronized ( self ) {
@@ -3320,16 +4592,35 @@ static void interAppConnectedChangeCallback(void *inRefCon, AudioUnit inUnit, Au
 
 - (void)configureChannelsInRange:(NSRange)range forGroup:(AEChannelGroupRef)group {
     
+    if ( _nativeGroupMixing ) {
+        [self configureChannelsForNativeMixingInRange:range forGroup:group];
+        return;
+    }
+    
     if ( group ) {
         // Ensure that we have enough input buses in the mixer
         UInt32 busCount = group->channelCount;
         AECheckOSStatus(AudioUnitSetProperty(group->mixerAudioUnit, kAudioUnitProperty_ElementCount, kAudioUnitScope_Input, 0, &busCount, sizeof(busCount)), "AudioUnitSetProperty(kAudioUnitProperty_ElementCount)");
     }
     
-    // Load existing interactions
-    UInt32 numInteractions = kMaximumChannelsPerGroup*2;
-    AUNodeInteraction interactions[numInteractions];
-    AECheckOSStatus(AUGraphGetNodeInteractions(_audioGraph, group ? group->mixerNode : _ioNode, &numInteractions, interactions), "AUGraphGetNodeInteractions");
+    // Load existing interactions, and index the upstream ones by bus
+    AUNode node = group ? group->mixerNode : _ioNode;
+    UInt32 numInteractions = 0;
+    AECheckOSStatus(AUGraphCountNodeInteractions(_audioGraph, node, &numInteractions), "AUGraphCountNodeInteractions");
+    AUNodeInteraction *interactions = (AUNodeInteraction*)malloc(MAX(1, numInteractions) * sizeof(AUNodeInteraction));
+    AECheckOSStatus(AUGraphGetNodeInteractions(_audioGraph, node, &numInteractions, interactions), "AUGraphGetNodeInteractions");
+    
+    int busLimit = (int)(range.location + range.length);
+    AUNodeInteraction **upstreamInteractions = (AUNodeInteraction**)calloc(MAX(1, busLimit), sizeof(AUNodeInteraction*));
+    for ( int j=0; j<numInteractions; j++ ) {
+        if ( interactions[j].nodeInteractionType == kAUNodeInteraction_Connection && interactions[j].nodeInteraction.connection.destNode == node ) {
+            UInt32 bus = interactions[j].nodeInteraction.connection.destInputNumber;
+            if ( bus < busLimit && !upstreamInteractions[bus] ) upstreamInteractions[bus] = &interactions[j];
+        } else if ( interactions[j].nodeInteractionType == kAUNodeInteraction_InputCallback && interactions[j].nodeInteraction.inputCallback.destNode == node ) {
+            UInt32 bus = interactions[j].nodeInteraction.inputCallback.destInputNumber;
+            if ( bus < busLimit && !upstreamInteractions[bus] ) upstreamInteractions[bus] = &interactions[j];
+        }
+    }
     
     for ( int i = (int)range.location; i < range.location+range.length; i++ ) {
         AEChannelRef channel = group ? group->channels[i] : _topChannel;
@@ -3337,13 +4628,9 @@ static void interAppConnectedChangeCallback(void *inRefCon, AudioUnit inUnit, Au
         // Find the existing upstream connection
         BOOL hasUpstreamInteraction = NO;
         AUNodeInteraction upstreamInteraction;
-        for ( int j=0; j<numInteractions; j++ ) {
-            if ( (interactions[j].nodeInteractionType == kAUNodeInteraction_Connection && interactions[j].nodeInteraction.connection.destNode == (group ? group->mixerNode : _ioNode) && interactions[j].nodeInteraction.connection.destInputNumber == i) ||
-                (interactions[j].nodeInteractionType == kAUNodeInteraction_InputCallback && interactions[j].nodeInteraction.inputCallback.destNode == (group ? group->mixerNode : _ioNode) && interactions[j].nodeInteraction.inputCallback.destInputNumber == i) ) {
-                upstreamInteraction = interactions[j];
-                hasUpstreamInteraction = YES;
-                break;
-            }
+        if ( upstreamInteractions[i] ) {
+            upstreamInteraction = *upstreamInteractions[i];
+            hasUpstreamInteraction = YES;
         }
         
         AUNode targetNode = group ? group->mixerNode : _ioNode;
@@ -3373,9 +4660,9 @@ static void interAppConnectedChangeCallback(void *inRefCon, AudioUnit inUnit, Au
             // Determine if we have filters or receivers
             BOOL hasReceivers=NO, hasFilters=NO;
             for ( int i=0; i<channel->callbacks.count && (!hasReceivers || !hasFilters); i++ ) {
-                if ( channel->callbacks.callbacks[i].flags & kFilterFlag ) {
+                if ( channel->callbacks.callbacks[i].flags & kAECallbackFilterFlag ) {
                     hasFilters = YES;
-                } else if ( channel->callbacks.callbacks[i].flags & kReceiverFlag ) {
+                } else if ( channel->callbacks.callbacks[i].flags & kAECallbackReceiverFlag ) {
                     hasReceivers = YES;
                 }
             }
@@ -3474,33 +4761,14 @@ static void interAppConnectedChangeCallback(void *inRefCon, AudioUnit inUnit, Au
                 channel->audioDescription = mixerOutputDescription;
             }
             
-            if ( channel->audiobusFloatConverter ) {
-                // Update Audiobus output converter to reflect new audio format
-                AudioStreamBasicDescription converterFormat = ((__bridge AEFloatConverter*)channel->audiobusFloatConverter).sourceFormat;
-                if ( memcmp(&converterFormat, &channel->audioDescription, sizeof(channel->audioDescription)) != 0 ) {
-                    void *newFloatConverter = (__bridge_retained void*)[[AEFloatConverter alloc] initWithSourceFormat:channel->audioDescription];
-                    void *oldFloatConverter = channel->audiobusFloatConverter;
-                    [self performAsynchronousMessageExchangeWithBlock:^{ channel->audiobusFloatConverter = newFloatConverter; }
-                                                        responseBlock:^{ CFBridgingRelease(oldFloatConverter); }];
-                }
-            }
-            
-            if ( subgroup->level_monitor_data.monitoringEnabled ) {
-                // Update level monitoring converter to reflect new audio format
-                AudioStreamBasicDescription converterFormat = ((__bridge AEFloatConverter*)subgroup->level_monitor_data.floatConverter).sourceFormat;
-                if ( memcmp(&converterFormat, &channel->audioDescription, sizeof(channel->audioDescription)) != 0 ) {
-                    void *newFloatConverter = (__bridge_retained void*)[[AEFloatConverter alloc] initWithSourceFormat:channel->audioDescription];
-                    void *oldFloatConverter = subgroup->level_monitor_data.floatConverter;
-                    [self performAsynchronousMessageExchangeWithBlock:^{ subgroup->level_monitor_data.floatConverter = newFloatConverter; }
-                                                        responseBlock:^{ CFBridgingRelease(oldFloatConverter); }];
-                }
-            }
+            [self updateFormatDependentResourcesForGroupChannel:channel inGroup:group];
             
             AUNode sourceNode = subgroup->converterNode ? subgroup->converterNode : subgroup->mixerNode;
             AudioUnit sourceUnit = subgroup->converterUnit ? subgroup->converterUnit : subgroup->mixerAudioUnit;
             
-            if ( hasFilters || channel->audiobusSenderPort ) {
-                // We need to use our own render callback, because we're either filtering, or sending via Audiobus (and we may need to adjust timestamp)
+            if ( hasFilters || channel->audiobusSenderPort || (_renderWorkerPool && group) ) {
+                // We need to use our own render callback, because we're either filtering, sending via Audiobus (and we may need to adjust timestamp),
+                // or rendering in parallel with sibling groups
                 
                 if ( channel->setRenderNotification ) {
                     // Remove render notification if there was one set
@@ -3551,15 +4819,19 @@ static void interAppConnectedChangeCallback(void *inRefCon, AudioUnit inUnit, Au
             [self configureChannelsInRange:NSMakeRange(0, busCount) forGroup:subgroup];
         }
         
+        if ( !group ) {
+            // Remember how the output unit pulls from the top channel, for offline rendering
+            _topChannelUsesRenderCallback = upstreamInteraction.nodeInteractionType == kAUNodeInteraction_InputCallback;
+        }
         
         if ( group ) {
             // Set volume
-            AudioUnitParameterValue volumeValue = channel->muted ? 0.0 : channel->volume;
+            AudioUnitParameterValue volumeValue = channel->muted ? 0.0 : channel->queuedVolume;
             AECheckOSStatus(AudioUnitSetParameter(group->mixerAudioUnit, kMultiChannelMixerParam_Volume, kAudioUnitScope_Input, i, volumeValue, 0),
                         "AudioUnitSetParameter(kMultiChannelMixerParam_Volume)");
             
             // Set pan
-            AudioUnitParameterValue panValue = channel->pan;
+            AudioUnitParameterValue panValue = channel->queuedPan;
             AECheckOSStatus(AudioUnitSetParameter(group->mixerAudioUnit, kMultiChannelMixerParam_Pan, kAudioUnitScope_Input, i, panValue, 0),
                         "AudioUnitSetParameter(kMultiChannelMixerParam_Pan)");
             
@@ -3576,6 +4848,293 @@ static void interAppConnectedChangeCallback(void *inRefCon, AudioUnit inUnit, Au
             }
         }
     }
+    
+    free(upstreamInteractions);
+    free(interactions);
+}
+
+- (void)configureChannelsForNativeMixingInRange:(NSRange)range forGroup:(AEChannelGroupRef)group {
+    if ( group ) {
+        [self updateMixResourcesForGroup:group];
+    } else {
+        // Have the output unit pull the mix directly from us
+        AURenderCallbackStruct rcbs = { .inputProc = &nativeMixTopRenderCallback, .inputProcRefCon = (__bridge void*)self };
+        
+        UInt32 numInteractions = 0;
+        AECheckOSStatus(AUGraphCountNodeInteractions(_audioGraph, _ioNode, &numInteractions), "AUGraphCountNodeInteractions");
+        AUNodeInteraction *interactions = (AUNodeInteraction*)malloc(MAX(1, numInteractions) * sizeof(AUNodeInteraction));
+        AECheckOSStatus(AUGraphGetNodeInteractions(_audioGraph, _ioNode, &numInteractions, interactions), "AUGraphGetNodeInteractions");
+        
+        BOOL hasUpstreamInteraction = NO;
+        BOOL connected = NO;
+        for ( int j=0; j<numInteractions; j++ ) {
+            if ( interactions[j].nodeInteractionType == kAUNodeInteraction_Connection
+                    && interactions[j].nodeInteraction.connection.destNode == _ioNode
+                    && interactions[j].nodeInteraction.connection.destInputNumber == 0 ) {
+                hasUpstreamInteraction = YES;
+            } else if ( interactions[j].nodeInteractionType == kAUNodeInteraction_InputCallback
+                    && interactions[j].nodeInteraction.inputCallback.destNode == _ioNode
+                    && interactions[j].nodeInteraction.inputCallback.destInputNumber == 0 ) {
+                hasUpstreamInteraction = YES;
+                connected = memcmp(&interactions[j].nodeInteraction.inputCallback.cback, &rcbs, sizeof(rcbs)) == 0;
+            }
+        }
+        free(interactions);
+        
+        if ( !connected ) {
+            if ( hasUpstreamInteraction ) {
+                AECheckOSStatus(AUGraphDisconnectNodeInput(_audioGraph, _ioNode, 0), "AUGraphDisconnectNodeInput");
+            }
+            AECheckOSStatus(AudioUnitSetProperty(_ioAudioUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Input, 0, &_audioDescription, sizeof(_audioDescription)), "AudioUnitSetProperty(kAudioUnitProperty_StreamFormat)");
+            AECheckOSStatus(AUGraphSetNodeInputCallback(_audioGraph, _ioNode, 0, &rcbs), "AUGraphSetNodeInputCallback");
+        }
+    }
+    
+    for ( int i = (int)range.location; i < range.location+range.length; i++ ) {
+        AEChannelRef channel = group ? group->channels[i] : _topChannel;
+        if ( !channel ) continue;
+        
+        if ( channel->type == kChannelTypeGroup ) {
+            AEChannelGroupRef subgroup = (AEChannelGroupRef)channel->ptr;
+            
+            // Groups always mix in the controller's format
+            channel->audioDescription = _audioDescription;
+            [self updateFormatDependentResourcesForGroupChannel:channel inGroup:group];
+            
+            [self configureChannelsForNativeMixingInRange:NSMakeRange(0, subgroup->channelCount) forGroup:subgroup];
+        }
+        
+        [self updateMixResourcesForChannel:channel];
+    }
+    
+    if ( group ) {
+        // Publish the group's channels, now they're ready to render
+        [self publishRenderListForGroup:group releasingChannels:NULL count:0];
+    }
+}
+
+static bool renderListChannelIsLast(void *channel) {
+    // Aux buses go last, so they mix after every channel that can send to them
+    return isAuxBusChannel((AEChannelRef)channel);
+}
+
+static void releaseRenderListChannel(void *channel, void *userInfo) {
+    [(__bridge AEAudioController*)userInfo releaseResourcesForChannel:(AEChannelRef)channel];
+}
+
+- (void)publishRenderListForGroup:(AEChannelGroupRef)group releasingChannels:(AEChannelRef*)channels count:(int)count {
+    AERenderList *list = _nativeGroupMixing ? AERenderListCreate((void**)group->channels, group->channelCount, renderListChannelIsLast) : NULL;
+    AERenderListUpdate *update = _nativeGroupMixing && !list ? NULL : AERenderListUpdateCreate(&group->renderList, list, (void**)channels, count);
+    if ( !update ) {
+        NSLog(@"TAAE: Couldn't allocate render list");
+        free(list);
+        return;
+    }
+    
+    // Swap the list in on the realtime thread, after any resource changes already queued for the group's channels;
+    // once that's happened the old list, and the channels no longer in the new one, are unreachable
+    [self performAsynchronousMessageExchangeWithBlock:^{
+        AERenderListUpdateApply(update);
+    } responseBlock:^{
+        AERenderListUpdateFinish(update, releaseRenderListChannel, (__bridge void*)self);
+    }];
+}
+
+static AudioStreamBasicDescription mixSourceFormat(AEChannelRef channel, AudioStreamBasicDescription defaultFormat) {
+    return channel->type != kChannelTypeGroup && channel->audioDescription.mSampleRate ? channel->audioDescription : defaultFormat;
+}
+
+static BOOL formatIsNonInterleavedFloat(AudioStreamBasicDescription format) {
+    return format.mFormatID == kAudioFormatLinearPCM
+        && (format.mFormatFlags & kAudioFormatFlagIsFloat)
+        && (format.mFormatFlags & kAudioFormatFlagIsNonInterleaved)
+        && format.mBitsPerChannel == 32;
+}
+
+static BOOL audioConverterHasFormats(AudioConverterRef converter, AudioStreamBasicDescription source, AudioStreamBasicDescription destination) {
+    AudioStreamBasicDescription converterSource, converterDestination;
+    UInt32 size = sizeof(AudioStreamBasicDescription);
+    if ( !AECheckOSStatus(AudioConverterGetProperty(converter, kAudioConverterCurrentInputStreamDescription, &size, &converterSource),
+                          "AudioConverterGetProperty(kAudioConverterCurrentInputStreamDescription)") ) return NO;
+    size = sizeof(AudioStreamBasicDescription);
+    if ( !AECheckOSStatus(AudioConverterGetProperty(converter, kAudioConverterCurrentOutputStreamDescription, &size, &converterDestination),
+                          "AudioConverterGetProperty(kAudioConverterCurrentOutputStreamDescription)") ) return NO;
+    return memcmp(&converterSource, &source, sizeof(source)) == 0 && memcmp(&converterDestination, &destination, sizeof(destination)) == 0;
+}
+
+- (void)updateMixResourcesForChannel:(AEChannelRef)channel {
+    // Channels that don't produce non-interleaved float need converting before they can be mixed, and channels
+    // at another sample rate need a sample rate converter, which converts to non-interleaved float too
+    AudioStreamBasicDescription format = mixSourceFormat(channel, _audioDescription);
+    BOOL needsSampleRateConverter = _nativeGroupMixing && channel->parentGroup && format.mSampleRate != _audioDescription.mSampleRate;
+    BOOL needsConverter = _nativeGroupMixing && channel->parentGroup && !needsSampleRateConverter && !formatIsNonInterleavedFloat(format);
+    
+    AudioStreamBasicDescription resampledFormat = AEAudioStreamBasicDescriptionNonInterleavedFloatStereo;
+    AEAudioStreamBasicDescriptionSetChannelsPerFrame(&resampledFormat, format.mChannelsPerFrame);
+    resampledFormat.mSampleRate = _audioDescription.mSampleRate;
+    
+    // Decide against what's already been sent, as the realtime thread may not have taken it yet
+    AEFloatConverter *converter = (__bridge AEFloatConverter*)channel->queuedMixSourceConverter;
+    BOOL converterValid = needsConverter ? converter != nil : converter == nil;
+    if ( needsConverter && converter ) {
+        AudioStreamBasicDescription converterFormat = converter.sourceFormat;
+        converterValid = memcmp(&converterFormat, &format, sizeof(format)) == 0;
+    }
+    AudioConverterRef sampleRateConverter = channel->queuedMixSampleRateConverter;
+    BOOL sampleRateConverterValid = needsSampleRateConverter
+        ? sampleRateConverter && audioConverterHasFormats(sampleRateConverter, format, resampledFormat)
+        : sampleRateConverter == NULL;
+    if ( converterValid && sampleRateConverterValid ) return;
+    
+    AudioConverterRef newSampleRateConverter = NULL;
+    if ( needsSampleRateConverter ) {
+        if ( AECheckOSStatus(AudioConverterNew(&format, &resampledFormat, &newSampleRateConverter), "AudioConverterNew") ) {
+            UInt32 primeMethod = kConverterPrimeMethod_None;
+            AECheckOSStatus(AudioConverterSetProperty(newSampleRateConverter, kAudioConverterPrimeMethod, sizeof(primeMethod), &primeMethod), "AudioConverterSetProperty(kAudioConverterPrimeMethod)");
+        } else {
+            NSLog(@"TAAE: Couldn't create a sample rate converter for channel %@; it will be silent", (__bridge id)channel->object);
+            newSampleRateConverter = NULL;
+        }
+    }
+    
+    void *newConverter = needsConverter ? (__bridge_retained void*)[[AEFloatConverter alloc] initWithSourceFormat:format] : NULL;
+    AudioBufferList *newBuffer = newConverter || newSampleRateConverter ? AEAudioBufferListCreate(format, kMaxFramesPerSlice) : NULL;
+    channel->queuedMixSourceConverter = newConverter;
+    channel->queuedMixSampleRateConverter = newSampleRateConverter;
+    
+    // Take the old resources as we swap, in case an earlier swap is still on its way
+    __block void *oldConverter = NULL;
+    __block AudioConverterRef oldSampleRateConverter = NULL;
+    __block AudioBufferList *oldBuffer = NULL;
+    [self performAsynchronousMessageExchangeWithBlock:^{
+        oldConverter = channel->mixSourceConverter;
+        oldSampleRateConverter = channel->mixSampleRateConverter;
+        oldBuffer = channel->mixSourceBuffer;
+        channel->mixSourceConverter = newConverter;
+        channel->mixSampleRateConverter = newSampleRateConverter;
+        channel->mixSourceBuffer = newBuffer;
+    } responseBlock:^{
+        if ( oldConverter ) CFBridgingRelease(oldConverter);
+        if ( oldSampleRateConverter ) AudioConverterDispose(oldSampleRateConverter);
+        if ( oldBuffer ) AEAudioBufferListFree(oldBuffer);
+    }];
+}
+
+- (void)updateMixResourcesForGroup:(AEChannelGroupRef)group {
+    // Decide against what's already been sent, as the realtime thread may not have taken it yet
+    AudioBufferList *oldScratchBuffer = group->queuedMixScratchBuffer;
+    AudioBufferList *newScratchBuffer = NULL;
+    if ( _nativeGroupMixing ) {
+        // Children are rendered into the scratch buffer one at a time, so it needs to be as wide as the widest
+        int scratchChannels = _audioDescription.mChannelsPerFrame;
+        for ( int i=0; i<group->channelCount; i++ ) {
+            if ( !group->channels[i] ) continue;
+            scratchChannels = MAX(scratchChannels, (int)mixSourceFormat(group->channels[i], _audioDescription).mChannelsPerFrame);
+        }
+        
+        if ( oldScratchBuffer && oldScratchBuffer->mNumberBuffers >= scratchChannels ) {
+            newScratchBuffer = oldScratchBuffer;
+        } else {
+            AudioStreamBasicDescription scratchFormat = AEAudioStreamBasicDescriptionNonInterleavedFloatStereo;
+            AEAudioStreamBasicDescriptionSetChannelsPerFrame(&scratchFormat, scratchChannels);
+            scratchFormat.mSampleRate = _audioDescription.mSampleRate;
+            newScratchBuffer = AEAudioBufferListCreate(scratchFormat, kMaxFramesPerSlice);
+        }
+    }
+    
+    // If the controller's format isn't non-interleaved float, mix into a separate buffer and convert afterwards
+    BOOL needsOutputConverter = _nativeGroupMixing && !formatIsNonInterleavedFloat(_audioDescription);
+    AEFloatConverter *oldOutputConverter = (__bridge AEFloatConverter*)group->queuedMixOutputConverter;
+    BOOL outputConverterValid = needsOutputConverter ? oldOutputConverter != nil : oldOutputConverter == nil;
+    if ( needsOutputConverter && oldOutputConverter ) {
+        AudioStreamBasicDescription converterFormat = oldOutputConverter.sourceFormat;
+        outputConverterValid = memcmp(&converterFormat, &_audioDescription, sizeof(_audioDescription)) == 0;
+    }
+    
+    if ( newScratchBuffer == oldScratchBuffer && outputConverterValid ) return;
+    
+    void *newConverter = NULL;
+    AudioBufferList *newOutputBuffer = NULL;
+    if ( !outputConverterValid && needsOutputConverter ) {
+        AEFloatConverter *converter = [[AEFloatConverter alloc] initWithSourceFormat:_audioDescription];
+        newOutputBuffer = AEAudioBufferListCreate(converter.floatingPointAudioDescription, kMaxFramesPerSlice);
+        newConverter = (__bridge_retained void*)converter;
+    }
+    group->queuedMixScratchBuffer = newScratchBuffer;
+    if ( !outputConverterValid ) group->queuedMixOutputConverter = newConverter;
+    
+    // Take the old resources as we swap, in case an earlier swap is still on its way
+    __block AudioBufferList *oldScratchBuffer = NULL;
+    __block void *oldConverter = NULL;
+    __block AudioBufferList *oldOutputBuffer = NULL;
+    [self performAsynchronousMessageExchangeWithBlock:^{
+        oldScratchBuffer = group->mixScratchBuffer;
+        group->mixScratchBuffer = newScratchBuffer;
+        if ( !outputConverterValid ) {
+            oldConverter = group->mixOutputConverter;
+            oldOutputBuffer = group->mixOutputBuffer;
+            group->mixOutputConverter = newConverter;
+            group->mixOutputBuffer = newOutputBuffer;
+        }
+    } responseBlock:^{
+        if ( oldScratchBuffer && oldScratchBuffer != newScratchBuffer ) AEAudioBufferListFree(oldScratchBuffer);
+        if ( oldConverter ) CFBridgingRelease(oldConverter);
+        if ( oldOutputBuffer ) AEAudioBufferListFree(oldOutputBuffer);
+    }];
+}
+
+- (void)updateFormatDependentResourcesForGroupChannel:(AEChannelRef)channel inGroup:(AEChannelGroupRef)group {
+    AEChannelGroupRef subgroup = (AEChannelGroupRef)channel->ptr;
+    
+    if ( _renderWorkerPool && group && !subgroup->isAuxBus ) {
+        // Aux buses render after their siblings, once those have sent to them
+        // Decide against what's already been sent, as the realtime thread may not have taken it yet
+        if ( !channel->queuedParallelRenderBuffer || memcmp(&channel->queuedParallelRenderAudioDescription, &channel->audioDescription, sizeof(channel->audioDescription)) != 0 ) {
+            // Allocate a buffer to render this group into while in parallel with its siblings
+            AudioBufferList *newBuffer = AEAudioBufferListCreate(channel->audioDescription, kMaxFramesPerSlice);
+            AudioStreamBasicDescription audioDescription = channel->audioDescription;
+            channel->queuedParallelRenderBuffer = newBuffer;
+            channel->queuedParallelRenderAudioDescription = audioDescription;
+            
+            // Take the old buffer as we swap, in case an earlier swap is still on its way
+            __block AudioBufferList *oldBuffer = NULL;
+            [self performAsynchronousMessageExchangeWithBlock:^{
+                oldBuffer = channel->parallelRenderBuffer;
+                channel->parallelRenderValid = NO;
+                channel->parallelRenderAudioDescription = audioDescription;
+                channel->parallelRenderBuffer = newBuffer;
+            } responseBlock:^{ if ( oldBuffer ) AEAudioBufferListFree(oldBuffer); }];
+        }
+    } else if ( channel->queuedParallelRenderBuffer ) {
+        channel->queuedParallelRenderBuffer = NULL;
+        __block AudioBufferList *oldBuffer = NULL;
+        [self performAsynchronousMessageExchangeWithBlock:^{
+            oldBuffer = channel->parallelRenderBuffer;
+            channel->parallelRenderBuffer = NULL;
+        } responseBlock:^{ if ( oldBuffer ) AEAudioBufferListFree(oldBuffer); }];
+    }
+    
+    if ( channel->audiobusFloatConverter ) {
+        // Update Audiobus output converter to reflect new audio format
+        AudioStreamBasicDescription converterFormat = ((__bridge AEFloatConverter*)channel->audiobusFloatConverter).sourceFormat;
+        if ( memcmp(&converterFormat, &channel->audioDescription, sizeof(channel->audioDescription)) != 0 ) {
+            void *newFloatConverter = (__bridge_retained void*)[[AEFloatConverter alloc] initWithSourceFormat:channel->audioDescription];
+            void *oldFloatConverter = channel->audiobusFloatConverter;
+            [self performAsynchronousMessageExchangeWithBlock:^{ channel->audiobusFloatConverter = newFloatConverter; }
+                                                responseBlock:^{ CFBridgingRelease(oldFloatConverter); }];
+        }
+    }
+    
+    if ( subgroup->level_monitor_data.monitoringEnabled ) {
+        // Update level monitoring converter to reflect new audio format
+        AudioStreamBasicDescription converterFormat = ((__bridge AEFloatConverter*)subgroup->level_monitor_data.floatConverter).sourceFormat;
+        if ( memcmp(&converterFormat, &channel->audioDescription, sizeof(channel->audioDescription)) != 0 ) {
+            void *newFloatConverter = (__bridge_retained void*)[[AEFloatConverter alloc] initWithSourceFormat:channel->audioDescription];
+            void *oldFloatConverter = subgroup->level_monitor_data.floatConverter;
+            [self performAsynchronousMessageExchangeWithBlock:^{ subgroup->level_monitor_data.floatConverter = newFloatConverter; }
+                                                responseBlock:^{ CFBridgingRelease(oldFloatConverter); }];
+        }
+    }
 }
 
 static void removeChannelsFromGroup(__unsafe_unretained AEAudioController *THIS, AEChannelGroupRef group, void **ptrs, void **objects, AEChannelRef *outChannelReferences, int count) {
@@ -3584,7 +5143,7 @@ static void removeChannelsFromGroup(__unsafe_unretained AEAudioController *THIS,
         // Find the channel in our fixed array
         int index = 0;
         for ( index=0; index < group->channelCount; index++ ) {
-            if ( group->channels[index] && group->channels[index]->ptr == ptrs[i] && group->channels[index]->object == objects[i] ) {
+            if ( group->mixerAudioUnit && group->channels[index] && group->channels[index]->ptr == ptrs[i] && group->channels[index]->object == objects[i] ) {
                 // Disable this channel until we update the graph
                 AudioUnitParameterValue enabledValue = 0;
                 AECheckOSStatus(AudioUnitSetParameter(group->mixerAudioUnit, kMultiChannelMixerParam_Enable, kAudioUnitScope_Input, index, enabledValue, 0),
@@ -3666,7 +5225,7 @@ static void removeChannelsFromGroup(__unsafe_unretained AEAudioController *THIS,
 
 - (void)sendTeardownToChannelsAndFilters {
     [self iterateChannelsBeneathGroup:_topGroup block:^(AEChannelRef channel) {
-        for ( id<AEAudioFilter> filter in [self associatedObjectsFromTable:&channel->callbacks matchingFlag:kFilterFlag] ) {
+        for ( id<AEAudioFilter> filter in [self associatedObjectsFromTable:&channel->callbacks matchingFlag:kAECallbackFilterFlag] ) {
             if ( [filter respondsToSelector:@selector(teardown)] ) {
                 [filter teardown];
             }
@@ -3679,7 +5238,7 @@ static void removeChannelsFromGroup(__unsafe_unretained AEAudioController *THIS,
 
 - (void)sendSetupToChannelsAndFilters {
     [self iterateChannelsBeneathGroup:_topGroup block:^(AEChannelRef channel) {
-        for ( id<AEAudioFilter> filter in [self associatedObjectsFromTable:&channel->callbacks matchingFlag:kFilterFlag] ) {
+        for ( id<AEAudioFilter> filter in [self associatedObjectsFromTable:&channel->callbacks matchingFlag:kAECallbackFilterFlag] ) {
             if ( [filter respondsToSelector:@selector(setupWithAudioController:)] ) {
                 [filter setupWithAudioController:self];
             }
@@ -3690,8 +5249,48 @@ static void removeChannelsFromGroup(__unsafe_unretained AEAudioController *THIS,
     }];
 }
 
+static void freeChannelMixResources(AEChannelRef channel) {
+    if ( channel->mixSourceConverter ) {
+        CFBridgingRelease(channel->mixSourceConverter);
+        channel->mixSourceConverter = NULL;
+    }
+    if ( channel->mixSourceBuffer ) {
+        AEAudioBufferListFree(channel->mixSourceBuffer);
+        channel->mixSourceBuffer = NULL;
+    }
+    if ( channel->mixSampleRateConverter ) {
+        AudioConverterDispose(channel->mixSampleRateConverter);
+        channel->mixSampleRateConverter = NULL;
+    }
+    channel->queuedMixSourceConverter = NULL;
+    channel->queuedMixSampleRateConverter = NULL;
+    AEGroupMixerInputReset(&channel->mixerInput);
+}
+
+static void freeGroupMixResources(AEChannelGroupRef group) {
+    if ( group->renderList ) {
+        free(group->renderList);
+        group->renderList = NULL;
+    }
+    if ( group->mixScratchBuffer ) {
+        AEAudioBufferListFree(group->mixScratchBuffer);
+        group->mixScratchBuffer = NULL;
+    }
+    if ( group->mixOutputConverter ) {
+        CFBridgingRelease(group->mixOutputConverter);
+        group->mixOutputConverter = NULL;
+    }
+    if ( group->mixOutputBuffer ) {
+        AEAudioBufferListFree(group->mixOutputBuffer);
+        group->mixOutputBuffer = NULL;
+    }
+    group->queuedMixScratchBuffer = NULL;
+    group->queuedMixOutputConverter = NULL;
+}
+
 - (void)releaseResourcesForChannel:(AEChannelRef)channel {
-    for ( id<AEAudioFilter> filter in [self associatedObjectsFromTable:&channel->callbacks matchingFlag:kFilterFlag] ) {
+    for ( id<AEAudioFilter> filter in [self associatedObjectsFromTable:&channel->callbacks matchingFlag:kAECallbackFilterFlag] ) {
+        [self stopObservingLatencyOfFilter:filter];
         if ( [filter respondsToSelector:@selector(teardown)] ) {
             [filter teardown];
         }
@@ -3709,6 +5308,17 @@ static void removeChannelsFromGroup(__unsafe_unretained AEAudioController *THIS,
         channel->audiobusFloatConverter = NULL;
     }
     
+    if ( channel->parallelRenderBuffer ) {
+        AEAudioBufferListFree(channel->parallelRenderBuffer);
+        channel->parallelRenderBuffer = NULL;
+    }
+    channel->queuedParallelRenderBuffer = NULL;
+    
+    freeChannelMixResources(channel);
+    AECallbackTableCleanup(&channel->callbacks);
+    free(channel->latencyCompensation);
+    free(channel->auxSends);
+    
     if ( channel->type == kChannelTypeGroup ) {
         [self releaseResourcesForGroup:(AEChannelGroupRef)channel->ptr];
     } else if ( channel->type == kChannelTypeChannel ) {
@@ -3737,6 +5347,11 @@ static void removeChannelsFromGroup(__unsafe_unretained AEAudioController *THIS,
         group->converterUnit = NULL;
     }
     
+    freeGroupMixResources(group);
+    freeAuxBus(group->auxBus);
+    group->auxBus = NULL;
+    group->queuedAuxBus = NULL;
+    
     // Release channel resources too
     for ( int i=0; i<group->channelCount; i++ ) {
         if ( group->channels[i] ) {
@@ -3744,6 +5359,8 @@ static void removeChannelsFromGroup(__unsafe_unretained AEAudioController *THIS,
         }
     }
     
+    free(group->channels);
+    free(group->parallelRenderChannels);
     free(group);
 }
 
@@ -3760,11 +5377,13 @@ static void removeChannelsFromGroup(__unsafe_unretained AEAudioController *THIS,
         CFBridgingRelease(group->level_monitor_data.floatConverter);
     }
     memset(&group->level_monitor_data, 0, sizeof(audio_level_monitor_t));
+    freeGroupMixResources(group);
     
     for ( int i=0; i<group->channelCount; i++ ) {
         AEChannelRef channel = group->channels[i];
         if ( !channel ) continue;
         channel->setRenderNotification = NO;
+        freeChannelMixResources(channel);
         if ( channel->type == kChannelTypeGroup ) {
             [self markGroupTorndown:(AEChannelGroupRef)channel->ptr];
         }
@@ -3805,40 +5424,162 @@ static void removeChannelsFromGroup(__unsafe_unretained AEAudioController *THIS,
     return NO;
 }
 
-#pragma mark - Callback management
+#pragma mark - Latency compensation
+
+- (UInt32)filterLatencyForChannel:(AEChannelRef)channel {
+    UInt32 latency = 0;
+    for ( id<AEAudioFilter> filter in [self associatedObjectsFromTable:&channel->callbacks matchingFlag:kAECallbackFilterFlag] ) {
+        if ( [filter respondsToSelector:@selector(filterLatency)] ) {
+            latency += filter.filterLatency;
+        }
+    }
+    return latency;
+}
 
-static callback_t *addCallbackToTable(__unsafe_unretained AEAudioController *THIS, callback_table_t *table, void *callback, void *userInfo, int flags) {
-    callback_t *callback_struct = &table->callbacks[table->count];
-    callback_struct->callback = callback;
-    callback_struct->userInfo = userInfo;
-    callback_struct->flags = flags;
-    table->count++;
-    return callback_struct;
+- (UInt32)measureLatencyOfChannel:(AEChannelRef)channel {
+    // A group's output is as late as its latest channel, which the others are delayed to match
+    UInt32 latency = 0;
+    if ( channel->type == kChannelTypeGroup ) {
+        AEChannelGroupRef group = (AEChannelGroupRef)channel->ptr;
+        for ( int i=0; i<group->channelCount; i++ ) {
+            if ( group->channels[i] ) {
+                latency = MAX(latency, [self measureLatencyOfChannel:group->channels[i]]);
+            }
+        }
+    }
+    
+    channel->latency = latency + [self filterLatencyForChannel:channel];
+    return channel->latency;
 }
 
-static void removeCallbackFromTable(__unsafe_unretained AEAudioController *THIS, callback_table_t *table, void *callback, void *userInfo, BOOL *found_p) {
-    BOOL found = NO;
+- (void)compensateLatencyForChannel:(AEChannelRef)channel delay:(UInt32)delay downstreamLatency:(UInt32)downstreamLatency {
+    [self setLatencyCompensationForChannel:channel delay:delay receiverOffset:delay + downstreamLatency];
     
-    // Find the item in our fixed array
-    int index = 0;
-    for ( index=0; index<table->count; index++ ) {
-        if ( table->callbacks[index].callback == callback && table->callbacks[index].userInfo == userInfo ) {
-            found = YES;
-            break;
+    if ( channel->type == kChannelTypeGroup ) {
+        AEChannelGroupRef group = (AEChannelGroupRef)channel->ptr;
+        UInt32 filterLatency = [self filterLatencyForChannel:channel];
+        UInt32 mixLatency = channel->latency - filterLatency;
+        for ( int i=0; i<group->channelCount; i++ ) {
+            if ( group->channels[i] ) {
+                [self compensateLatencyForChannel:group->channels[i]
+                                            delay:mixLatency - group->channels[i]->latency
+                                downstreamLatency:filterLatency + delay + downstreamLatency];
+            }
         }
     }
-    if ( found ) {
-        // Now shuffle the later elements backwards one space
-        table->count--;
-        for ( int i=index; i<table->count; i++ ) {
-            table->callbacks[i] = table->callbacks[i+1];
+}
+
+- (void)setLatencyCompensationForChannel:(AEChannelRef)channel delay:(UInt32)delay receiverOffset:(UInt32)receiverOffset {
+    AudioStreamBasicDescription format = channel->audioDescription.mSampleRate ? channel->audioDescription : _audioDescription;
+    int bufferCount = (format.mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? format.mChannelsPerFrame : 1;
+    
+    latency_compensation_t *oldCompensation = channel->latencyCompensation;
+    if ( oldCompensation
+            ? (oldCompensation->delayFrames == delay && oldCompensation->receiverOffsetFrames == receiverOffset
+                && oldCompensation->bytesPerFrame == format.mBytesPerFrame && oldCompensation->bufferCount == bufferCount)
+            : (delay == 0 && receiverOffset == 0) ) {
+        // Nothing's changed
+        return;
+    }
+    
+    latency_compensation_t *compensation = NULL;
+    if ( delay || receiverOffset ) {
+        size_t bufferSize = (size_t)delay * format.mBytesPerFrame;
+        compensation = (latency_compensation_t*)calloc(1, sizeof(latency_compensation_t) + bufferCount * (sizeof(char*) + bufferSize));
+        if ( !compensation ) {
+            NSLog(@"TAAE: Couldn't allocate %u frame delay line for latency compensation", (unsigned int)delay);
+            return;
+        }
+        compensation->delayFrames = delay;
+        compensation->receiverOffsetFrames = receiverOffset;
+        compensation->receiverOffsetTicks = AEHostTicksFromSeconds(receiverOffset / _audioDescription.mSampleRate);
+        compensation->bytesPerFrame = format.mBytesPerFrame;
+        compensation->silentFrames = delay;
+        compensation->bufferCount = bufferCount;
+        char *storage = (char*)&compensation->buffers[bufferCount];
+        for ( int i=0; i<bufferCount; i++ ) {
+            compensation->buffers[i] = storage + i * bufferSize;
         }
     }
     
-    if ( found_p ) *found_p = found;
+    // Only the main thread assigns this, and the render path reads it once per cycle, so swap it directly
+    OSMemoryBarrier();
+    channel->latencyCompensation = compensation;
+    if ( oldCompensation ) {
+        [_messageQueue releaseWhenSafeWithBlock:^{
+            free(oldCompensation);
+        }];
+    }
+}
+
+- (void)updateLatencyCompensation {
+    if ( !_topChannel ) return;
+    [self measureLatencyOfChannel:_topChannel];
+    [self compensateLatencyForChannel:_topChannel delay:0 downstreamLatency:0];
+}
+
+-(NSTimeInterval)outputFilterLatency {
+    return _topChannel && _audioDescription.mSampleRate ? _topChannel->latency / _audioDescription.mSampleRate : 0;
+}
+
+#pragma mark - Callback management
+
+- (BOOL)reserveCapacity:(int)capacity forCallbackTable:(AECallbackTable*)table {
+    if ( capacity <= table->capacity ) return YES;
+    
+    // Build larger arrays here, then swap them in on the realtime thread, so it never sees a partial resize
+    __block AECallbackTable grown;
+    if ( !AECallbackTableBuildGrown(table, capacity, &grown) ) {
+        NSLog(@"TAAE: Couldn't allocate callback table");
+        return NO;
+    }
+    
+    if ( ![self performSynchronousMessageExchangeWithBlock:^{ AECallbackTableSwap(table, &grown); }] ) {
+        // The swap is still queued, and either set of arrays may be in use once it happens, so leave them be
+        return NO;
+    }
+    
+    // Now holding the old arrays
+    AECallbackTableCleanup(&grown);
+    
+    return YES;
+}
+
+- (BOOL)reserveCapacity:(int)capacity forChannelGroup:(AEChannelGroupRef)group {
+    if ( capacity <= group->channelCapacity ) return YES;
+    
+    int newCapacity = MAX(capacity, MAX(kInitialChannelsPerGroup, group->channelCapacity * 2));
+    AEChannelRef *channels = (AEChannelRef*)calloc(newCapacity, sizeof(AEChannelRef));
+    AEChannelRef *parallelRenderChannels = (AEChannelRef*)calloc(newCapacity, sizeof(AEChannelRef));
+    if ( !channels || !parallelRenderChannels ) {
+        NSLog(@"TAAE: Couldn't allocate channel table for group %p", group);
+        free(channels);
+        free(parallelRenderChannels);
+        return NO;
+    }
+    
+    if ( group->channelCount ) memcpy(channels, group->channels, group->channelCount * sizeof(AEChannelRef));
+    
+    AEChannelRef *oldChannels = group->channels;
+    AEChannelRef *oldParallelRenderChannels = group->parallelRenderChannels;
+    void (^swapBlock)() = ^{
+        group->channels = channels;
+        group->parallelRenderChannels = parallelRenderChannels;
+        group->channelCapacity = newCapacity;
+    };
+    if ( _nativeGroupMixing ) {
+        // The realtime thread only sees the group's render list, so no need to wait for it
+        swapBlock();
+    } else {
+        [self performSynchronousMessageExchangeWithBlock:swapBlock];
+    }
+    free(oldChannels);
+    free(oldParallelRenderChannels);
+    
+    return YES;
 }
 
-- (NSArray *)associatedObjectsFromTable:(callback_table_t*)table matchingFlag:(uint8_t)flag {
+- (NSArray *)associatedObjectsFromTable:(AECallbackTable*)table matchingFlag:(uint8_t)flag {
     // Construct NSArray response
     NSMutableArray *result = [NSMutableArray array];
     for ( int i=0; i<table->count; i++ ) {
@@ -3857,26 +5598,24 @@ static void removeCallbackFromTable(__unsafe_unretained AEAudioController *THIS,
     
     AEChannelRef channel = parentGroup->channels[index];
     
-    if ( channel->callbacks.count == kMaximumCallbacksPerSource ) {
-        NSLog(@"TAAE: Warning: Maximum number of callbacks reached");
+    if ( ![self reserveCapacity:channel->callbacks.count + 1 forCallbackTable:&channel->callbacks] ) {
         return NO;
     }
     
     [self performSynchronousMessageExchangeWithBlock:^{
-        addCallbackToTable(self, &channel->callbacks, callback, userInfo, flags);
+        AECallbackTableAdd(&channel->callbacks, callback, userInfo, flags);
     }];
     
     return YES;
 }
 
 - (BOOL)addCallback:(void*)callback userInfo:(void*)userInfo flags:(uint8_t)flags forChannelGroup:(AEChannelGroupRef)group {
-    if ( group->channel->callbacks.count == kMaximumCallbacksPerSource ) {
-        NSLog(@"TAAE: Warning: Maximum number of callbacks reached");
+    if ( ![self reserveCapacity:group->channel->callbacks.count + 1 forCallbackTable:&group->channel->callbacks] ) {
         return NO;
     }
     
     [self performSynchronousMessageExchangeWithBlock:^{
-        addCallbackToTable(self, &group->channel->callbacks, callback, userInfo, flags);
+        AECallbackTableAdd(&group->channel->callbacks, callback, userInfo, flags);
     }];
 
     AEChannelGroupRef parentGroup = NULL;
@@ -3893,7 +5632,7 @@ static void removeCallbackFromTable(__unsafe_unretained AEAudioController *THIS,
 }
 
 - (BOOL)addCallback:(void*)callback userInfo:(void*)userInfo flags:(uint8_t)flags forInputChannels:(NSArray*)channels {
-    callback_table_t *callbackTable = NULL;
+    AECallbackTable *callbackTable = NULL;
     input_callback_table_t *inputCallbacks = NULL;
     int inputCallbackCount = _inputCallbackCount;
     input_callback_table_t *oldMultichannelInputCallbacks = _inputCallbacks;
@@ -3925,8 +5664,11 @@ static void removeCallbackFromTable(__unsafe_unretained AEAudioController *THIS,
         }
     }
     
-    if ( callbackTable->count == kMaximumCallbacksPerSource ) {
-        NSLog(@"TAAE: Warning: Maximum number of callbacks reached");
+    if ( ![self reserveCapacity:callbackTable->count + 1 forCallbackTable:callbackTable] ) {
+        if ( inputCallbacks ) {
+            CFBridgingRelease(inputCallbacks[inputCallbackCount-1].channelMap);
+            free(inputCallbacks);
+        }
         return NO;
     }
     [self performSynchronousMessageExchangeWithBlock:^{
@@ -3935,7 +5677,7 @@ static void removeCallbackFromTable(__unsafe_unretained AEAudioController *THIS,
             _inputCallbackCount = inputCallbackCount;
         }
         
-        addCallbackToTable(self, callbackTable, callback, userInfo, flags);
+        AECallbackTableAdd(callbackTable, callback, userInfo, flags);
     }];
     
     if ( inputCallbacks ) {
@@ -3957,7 +5699,7 @@ static void removeCallbackFromTable(__unsafe_unretained AEAudioController *THIS,
     
     __block BOOL found = NO;
     [self performSynchronousMessageExchangeWithBlock:^{
-        removeCallbackFromTable(self, &channel->callbacks, callback, userInfo, &found);
+        found = AECallbackTableRemove(&channel->callbacks, callback, userInfo);
     }];
     
     return found;
@@ -3966,7 +5708,7 @@ static void removeCallbackFromTable(__unsafe_unretained AEAudioController *THIS,
 - (BOOL)removeCallback:(void*)callback userInfo:(void*)userInfo fromChannelGroup:(AEChannelGroupRef)group {
     __block BOOL found = NO;
     [self performSynchronousMessageExchangeWithBlock:^{
-        removeCallbackFromTable(self, &group->channel->callbacks, callback, userInfo, &found);
+        found = AECallbackTableRemove(&group->channel->callbacks, callback, userInfo);
     }];
     
     if ( !found ) return NO;
@@ -4004,11 +5746,13 @@ static void removeCallbackFromTable(__unsafe_unretained AEAudioController *THIS,
 }
 
 static void handleCallbacksForChannel(AEChannelRef channel, const AudioTimeStamp *inTimeStamp, UInt32 inNumberFrames, AudioBufferList *ioData) {
+    __unsafe_unretained AEAudioController * THIS = (__bridge AEAudioController*)channel->audioController;
+    
     // Pass audio to output callbacks
     for ( int i=0; i<channel->callbacks.count; i++ ) {
-        callback_t *callback = &channel->callbacks.callbacks[i];
-        if ( callback->flags & kReceiverFlag ) {
-            ((AEAudioReceiverCallback)callback->callback)((__bridge id)callback->userInfo, (__bridge AEAudioController*)channel->audioController, channel->ptr, inTimeStamp, inNumberFrames, ioData);
+        AECallback *callback = &channel->callbacks.callbacks[i];
+        if ( callback->flags & kAECallbackReceiverFlag ) {
+            runReceiver(callback, THIS, channel->ptr, THIS->_renderDeadline, inTimeStamp, inNumberFrames, ioData);
         }
     }
 }
@@ -4139,8 +5883,13 @@ static void * firstUpstreamAudiobusSenderPort(AEChannelRef channel) {
 
 @implementation AEAudioControllerMessageQueue
 
+- (BOOL)realtimeThreadActive {
+    AEAudioController *audioController = _audioController;
+    return audioController.running || audioController.renderingOffline;
+}
+
 - (void)performAsynchronousMessageExchangeWithBlock:(void (^)())block responseBlock:(void (^)())responseBlock {
-    if ( _audioController.running ) {
+    if ( [self realtimeThreadActive] ) {
         [super performAsynchronousMessageExchangeWithBlock:block responseBlock:responseBlock];
     } else {
         if ( block ) block();
@@ -4149,7 +5898,10 @@ static void * firstUpstreamAudiobusSenderPort(AEChannelRef channel) {
 }
 
 - (BOOL)performSynchronousMessageExchangeWithBlock:(void (^)())block {
-    if ( _audioController.running ) {
+    AEAudioController *audioController = _audioController;
+    if ( audioController.renderingOffline ) {
+        [audioController performMessageExchangeBetweenOfflineRendersWithBlock:block];
+    } else if ( [self realtimeThreadActive] ) {
         return [super performSynchronousMessageExchangeWithBlock:block];
     } else if ( block ) {
         block();
@@ -4157,4 +5909,20 @@ static void * firstUpstreamAudiobusSenderPort(AEChannelRef channel) {
     return YES;
 }
 
+- (void)setParameterValue:(double)value forKey:(int)key target:(void *)target handler:(AEMessageQueueParameterHandler)handler {
+    if ( [self realtimeThreadActive] ) {
+        [super setParameterValue:value forKey:key target:target handler:handler];
+    } else {
+        handler(target, key, value);
+    }
+}
+
+- (void)releaseWhenSafeWithBlock:(void (^)())releaseBlock {
+    if ( [self realtimeThreadActive] ) {
+        [super releaseWhenSafeWithBlock:releaseBlock];
+    } else {
+        releaseBlock();
+    }
+}
+
 @end
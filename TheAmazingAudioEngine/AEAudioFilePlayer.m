@@ -261,11 +261,16 @@ static OSStatus renderCallback(__unsafe_unretained AEAudioFilePlayer *THIS,
                                UInt32                    frames,
                                AudioBufferList          *audio) {
     
-    if ( !THIS->_running ) return noErr;
+    if ( !THIS->_running ) {
+        // Stopped, or past the end: the buffer we were given is already zeroed
+        AEAudioControllerReportOutputIsSilent(audioController);
+        return noErr;
+    }
     
     uint64_t hostTimeAtBufferEnd = time->mHostTime + AEHostTicksFromSeconds((double)frames / THIS->_unitOutputDescription.mSampleRate);
     if ( THIS->_startTime && THIS->_startTime > hostTimeAtBufferEnd ) {
         // Start time not yet reached: emit silence
+        AEAudioControllerReportOutputIsSilent(audioController);
         return noErr;
     }
     
@@ -302,6 +307,9 @@ static OSStatus renderCallback(__unsafe_unretained AEAudioFilePlayer *THIS,
             // Silence the rest of the buffer past the end
             memset((char*)audio->mBuffers[i].mData + (THIS->_unitOutputDescription.mBytesPerFrame * finalFrames), 0, (THIS->_unitOutputDescription.mBytesPerFrame * (frames - finalFrames)));
         }
+        if ( finalFrames == 0 && silentFrames == 0 ) {
+            AEAudioControllerReportOutputIsSilent(audioController);
+        }
         
         // Reset the unit, to cease playback
         AECheckOSStatus(AudioUnitReset(AEAudioUnitChannelGetAudioUnit(THIS), kAudioUnitScope_Global, 0), "AudioUnitReset");
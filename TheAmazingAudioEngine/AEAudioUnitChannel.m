@@ -199,11 +199,16 @@ static OSStatus renderCallback(__unsafe_unretained AEAudioUnitChannel *THIS,
                                AudioBufferList          *audio) {
     
     if ( !THIS->_audioUnit ) {
+        AEAudioControllerReportOutputIsSilent(audioController);
         return noErr;
     }
     
     AudioUnitRenderActionFlags flags = 0;
-    AECheckOSStatus(AudioUnitRender(THIS->_converterUnit ? THIS->_converterUnit : THIS->_audioUnit, &flags, time, 0, frames, audio), "AudioUnitRender");
+    OSStatus result = AudioUnitRender(THIS->_converterUnit ? THIS->_converterUnit : THIS->_audioUnit, &flags, time, 0, frames, audio);
+    if ( AECheckOSStatus(result, "AudioUnitRender") && (flags & kAudioUnitRenderAction_OutputIsSilence) ) {
+        // The unit flags its output as silent when it has nothing to play, as the file player unit does when idle
+        AEAudioControllerReportOutputIsSilent(audioController);
+    }
     return noErr;
 }
 
@@ -0,0 +1,95 @@
+//
+//  AEAutomationLane.c
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include "AEAutomationLane.h"
+
+bool AEAutomationLaneAddPoint(AEAutomationLane *lane, double sampleTime, float value) {
+    if ( lane->hasPoints && sampleTime < lane->lastSampleTime ) return false;
+
+    uint32_t head = lane->head;
+    if ( head - __atomic_load_n(&lane->tail, __ATOMIC_ACQUIRE) >= kAEAutomationLaneCapacity ) return false;
+
+    lane->points[head % kAEAutomationLaneCapacity] = (AEAutomationPoint){ sampleTime, value };
+    __atomic_store_n(&lane->head, head + 1, __ATOMIC_RELEASE);
+
+    lane->lastSampleTime = sampleTime;
+    lane->hasPoints = true;
+    return true;
+}
+
+void AEAutomationLaneReset(AEAutomationLane *lane) {
+    __atomic_store_n(&lane->resetPosition, lane->head, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&lane->resetCount, 1, __ATOMIC_RELEASE);
+    lane->hasPoints = false;
+}
+
+int32_t AEAutomationLaneAdvance(AEAutomationLane *lane, double sampleTime, float value) {
+    uint32_t tail = lane->tail;
+
+    uint32_t resetCount = __atomic_load_n(&lane->resetCount, __ATOMIC_ACQUIRE);
+    if ( resetCount != lane->seenResetCount ) {
+        // Skip the points added before the reset. We may see a later reset's position before its
+        // count, so never move backwards over points we've already passed.
+        lane->seenResetCount = resetCount;
+        uint32_t resetPosition = __atomic_load_n(&lane->resetPosition, __ATOMIC_RELAXED);
+        if ( (int32_t)(resetPosition - tail) > 0 ) tail = resetPosition;
+        lane->visibleHead = tail;
+        lane->active = false;
+    }
+
+    uint32_t head = __atomic_load_n(&lane->head, __ATOMIC_ACQUIRE);
+    if ( head != tail && lane->visibleHead == tail ) {
+        // New points after an idle or holding period: ramp to them from where we are now
+        if ( !lane->active ) {
+            lane->origin.value = value;
+            lane->active = true;
+        }
+        lane->origin.sampleTime = sampleTime - 1;
+    }
+    lane->visibleHead = head;
+
+    while ( tail != head && lane->points[tail % kAEAutomationLaneCapacity].sampleTime < sampleTime ) {
+        lane->origin = lane->points[tail % kAEAutomationLaneCapacity];
+        tail++;
+    }
+    __atomic_store_n(&lane->tail, tail, __ATOMIC_RELEASE);
+
+    if ( tail == head ) return INT32_MAX;
+
+    double frames = lane->points[tail % kAEAutomationLaneCapacity].sampleTime - sampleTime + 1;
+    return frames < (double)INT32_MAX ? (int32_t)frames : INT32_MAX;
+}
+
+float AEAutomationLaneValue(const AEAutomationLane *lane, double sampleTime, float value) {
+    if ( !lane->active ) return value;
+
+    uint32_t tail = lane->tail;
+    if ( tail == lane->visibleHead ) return lane->origin.value;
+
+    const AEAutomationPoint *next = &lane->points[tail % kAEAutomationLaneCapacity];
+    double span = next->sampleTime - lane->origin.sampleTime;
+    if ( sampleTime >= next->sampleTime || span <= 0 ) return next->value;
+
+    return lane->origin.value + (next->value - lane->origin.value) * (float)((sampleTime - lane->origin.sampleTime) / span);
+}
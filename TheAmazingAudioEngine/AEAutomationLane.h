@@ -0,0 +1,129 @@
+//
+//  AEAutomationLane.h
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef AEAutomationLane_h
+#define AEAutomationLane_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Number of points a lane can hold that the audio thread hasn't yet reached
+ */
+#define kAEAutomationLaneCapacity 64
+
+/*!
+ * Automation point
+ */
+typedef struct {
+    double sampleTime;  //!< Output sample time at which the parameter reaches the value
+    float  value;       //!< Parameter value
+} AEAutomationPoint;
+
+/*!
+ * Automation lane
+ *
+ *  A queue of breakpoints for one parameter, describing a piecewise-linear curve in output
+ *  sample time. The main thread adds points with AEAutomationLaneAddPoint, and the audio
+ *  thread follows the curve with AEAutomationLaneAdvance and AEAutomationLaneValue. There's
+ *  one writer and one reader, so no locks are needed. Zero-initialise before use.
+ *
+ *  Each point is reached by ramping from the one before it. The first point after the lane
+ *  has been idle ramps from the parameter's current value, starting when the audio thread
+ *  first sees it. After the last point, the parameter holds that point's value until more
+ *  points are added or the lane is reset.
+ */
+typedef struct {
+    AEAutomationPoint points[kAEAutomationLaneCapacity];
+    volatile uint32_t head;             //!< Points added; written by the main thread
+    volatile uint32_t tail;             //!< Points passed; written by the audio thread
+    volatile uint32_t resetCount;       //!< Resets requested; written by the main thread
+    volatile uint32_t resetPosition;    //!< Value of head at the last reset; written by the main thread
+    double            lastSampleTime;   //!< Main thread only: time of the last point added
+    bool              hasPoints;        //!< Main thread only: whether lastSampleTime is valid
+    uint32_t          seenResetCount;   //!< Audio thread only
+    uint32_t          visibleHead;      //!< Audio thread only: value of head as of the last advance
+    bool              active;           //!< Audio thread only: whether the lane is overriding the parameter
+    AEAutomationPoint origin;           //!< Audio thread only: the point the current ramp starts from
+} AEAutomationLane;
+
+/*!
+ * Add a point
+ *
+ *  Call on the main thread. Points must be added in time order.
+ *
+ * @param lane       The lane
+ * @param sampleTime Output sample time at which to reach the value
+ * @param value      Parameter value
+ * @return Whether the point was added: false if it's earlier than the previous point, or the lane is full
+ */
+bool AEAutomationLaneAddPoint(AEAutomationLane *lane, double sampleTime, float value);
+
+/*!
+ * Reset a lane
+ *
+ *  Discards the points the audio thread hasn't yet reached, and stops the lane overriding
+ *  the parameter, once the audio thread next advances it. Call on the main thread, when
+ *  setting the parameter directly.
+ *
+ * @param lane The lane
+ */
+void AEAutomationLaneReset(AEAutomationLane *lane);
+
+/*!
+ * Advance a lane
+ *
+ *  Moves past the points before the given time, and reports how far away the next one is,
+ *  so the caller can split its block at each point. Call on the audio thread, with times
+ *  that never go backwards, before taking values with AEAutomationLaneValue.
+ *
+ * @param lane       The lane
+ * @param sampleTime Sample time of the first frame about to be processed
+ * @param value      The parameter's value when not automated
+ * @return Number of frames up to and including the next point, or INT32_MAX if there's none
+ */
+int32_t AEAutomationLaneAdvance(AEAutomationLane *lane, double sampleTime, float value);
+
+/*!
+ * Get the value of a lane
+ *
+ *  Call on the audio thread, after AEAutomationLaneAdvance, with a time no later than
+ *  the next point.
+ *
+ * @param lane       The lane
+ * @param sampleTime Sample time
+ * @param value      The parameter's value when not automated
+ * @return The parameter value at the given time
+ */
+float AEAutomationLaneValue(const AEAutomationLane *lane, double sampleTime, float value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
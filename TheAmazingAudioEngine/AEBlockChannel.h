@@ -34,6 +34,22 @@ typedef void (^AEBlockChannelBlock)(const AudioTimeStamp     *time,
                                     UInt32                    frames,
                                     AudioBufferList          *audio);
 
+/*!
+ * Channel block that reports silence
+ *
+ *  As AEBlockChannelBlock, but the block returns YES if it left the (zeroed) buffer
+ *  silent, so the audio controller can skip stateless filters and mixing for the channel.
+ *  See AEAudioControllerReportOutputIsSilent.
+ *
+ * @param time      The time the audio will be played
+ * @param frames    The number of frames to generate
+ * @param audio     The audio buffer list to write to, zeroed beforehand
+ * @return YES if the output is silent
+ */
+typedef BOOL (^AEBlockChannelSilenceReportingBlock)(const AudioTimeStamp     *time,
+                                                    UInt32                    frames,
+                                                    AudioBufferList          *audio);
+
 /*!
  * Block channel: Utility class to allow use of a block to generate audio
  */
@@ -46,6 +62,13 @@ typedef void (^AEBlockChannelBlock)(const AudioTimeStamp     *time,
  */
 + (AEBlockChannel*)channelWithBlock:(AEBlockChannelBlock)block;
 
+/*!
+ * Create a new channel with a block that reports when its output is silent
+ *
+ * @param block Block to use for audio generation
+ */
++ (AEBlockChannel*)channelWithSilenceReportingBlock:(AEBlockChannelSilenceReportingBlock)block;
+
 /*!
  * Track volume
  *
@@ -27,10 +27,11 @@
 
 @interface AEBlockChannel ()
 @property (nonatomic, copy) AEBlockChannelBlock block;
+@property (nonatomic, copy) AEBlockChannelSilenceReportingBlock silenceReportingBlock;
 @end
 
 @implementation AEBlockChannel
-@synthesize block = _block;
+@synthesize block = _block, silenceReportingBlock = _silenceReportingBlock;
 
 - (id)initWithBlock:(AEBlockChannelBlock)block {
     if ( !(self = [super init]) ) self = nil;
@@ -46,13 +47,25 @@
     return [[AEBlockChannel alloc] initWithBlock:block];
 }
 
++ (AEBlockChannel*)channelWithSilenceReportingBlock:(AEBlockChannelSilenceReportingBlock)block {
+    AEBlockChannel *channel = [[AEBlockChannel alloc] initWithBlock:nil];
+    channel.silenceReportingBlock = block;
+    return channel;
+}
+
 
 static OSStatus renderCallback(__unsafe_unretained AEBlockChannel *THIS,
                                __unsafe_unretained AEAudioController *audioController,
                                const AudioTimeStamp     *time,
                                UInt32                    frames,
                                AudioBufferList          *audio) {
-    THIS->_block(time, frames, audio);
+    if ( THIS->_silenceReportingBlock ) {
+        if ( THIS->_silenceReportingBlock(time, frames, audio) ) {
+            AEAudioControllerReportOutputIsSilent(audioController);
+        }
+    } else {
+        THIS->_block(time, frames, audio);
+    }
     return noErr;
 }
 
@@ -71,6 +71,15 @@ typedef void (^AEBlockFilterBlock)(AEAudioFilterProducer producer,
  */
 @property (nonatomic, assign) AudioStreamBasicDescription audioDescription;
 
+/*!
+ * Whether the filter is stateless
+ *
+ *  Set this to YES, before adding the filter, if the block produces silence from silent
+ *  input and keeps no state between calls, so the filter is skipped while its input is
+ *  silent. See AEAudioFilter's filterIsStateless. Default is NO.
+ */
+@property (nonatomic, assign) BOOL filterIsStateless;
+
 @end
 
 #ifdef __cplusplus
@@ -0,0 +1,98 @@
+//
+//  AECallbackTable.c
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "AECallbackTable.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+static void updateFilterChain(AECallbackTable *table) {
+    // Filters run newest first
+    table->filterCount = 0;
+    for ( int i=table->count-1; i>=0; i-- ) {
+        if ( table->callbacks[i].flags & kAECallbackFilterFlag ) {
+            table->filters[table->filterCount++] = &table->callbacks[i];
+        }
+    }
+}
+
+AECallback *AECallbackTableAdd(AECallbackTable *table, void *callback, void *userInfo, uint8_t flags) {
+    assert(table->count < table->capacity);
+    
+    AECallback *entry = &table->callbacks[table->count];
+    entry->callback = callback;
+    entry->userInfo = userInfo;
+    entry->flags = flags;
+    memset(&entry->profile, 0, sizeof(entry->profile));
+    table->count++;
+    updateFilterChain(table);
+    return entry;
+}
+
+bool AECallbackTableRemove(AECallbackTable *table, void *callback, void *userInfo) {
+    int index;
+    for ( index=0; index<table->count; index++ ) {
+        if ( table->callbacks[index].callback == callback && table->callbacks[index].userInfo == userInfo ) break;
+    }
+    if ( index == table->count ) return false;
+    
+    // Shuffle the later entries back one space
+    table->count--;
+    memmove(&table->callbacks[index], &table->callbacks[index+1], (table->count - index) * sizeof(AECallback));
+    updateFilterChain(table);
+    return true;
+}
+
+bool AECallbackTableBuildGrown(const AECallbackTable *table, int capacity, AECallbackTable *grown) {
+    int newCapacity = table->capacity * 2;
+    if ( newCapacity < kAECallbackTableInitialCapacity ) newCapacity = kAECallbackTableInitialCapacity;
+    if ( newCapacity < capacity ) newCapacity = capacity;
+    
+    memset(grown, 0, sizeof(AECallbackTable));
+    grown->callbacks = (AECallback*)calloc(newCapacity, sizeof(AECallback));
+    grown->filters = (AECallback**)calloc(newCapacity, sizeof(AECallback*));
+    if ( !grown->callbacks || !grown->filters ) {
+        AECallbackTableCleanup(grown);
+        return false;
+    }
+    
+    grown->capacity = newCapacity;
+    grown->count = table->count;
+    if ( table->count ) memcpy(grown->callbacks, table->callbacks, table->count * sizeof(AECallback));
+    updateFilterChain(grown);
+    return true;
+}
+
+void AECallbackTableSwap(AECallbackTable *table, AECallbackTable *other) {
+    AECallbackTable swap = *table;
+    *table = *other;
+    *other = swap;
+}
+
+void AECallbackTableCleanup(AECallbackTable *table) {
+    free(table->callbacks);
+    free(table->filters);
+    table->callbacks = NULL;
+    table->filters = NULL;
+    table->count = table->filterCount = table->capacity = 0;
+}
@@ -0,0 +1,157 @@
+//
+//  AECallbackTable.h
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef AECallbackTable_h
+#define AECallbackTable_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "AERenderProfile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Capacity of a table when it first grows
+ */
+#define kAECallbackTableInitialCapacity 4
+
+/*!
+ * Callback flags
+ */
+enum {
+    kAECallbackFilterFlag             = 1<<0,
+    kAECallbackReceiverFlag           = 1<<1,
+    kAECallbackStatelessFilterFlag    = 1<<2,
+    kAECallbackAudiobusSenderPortFlag = 1<<3
+};
+
+/*!
+ * Callback
+ *
+ *  A filter, receiver or timing receiver attached to a channel, group or input.
+ */
+typedef struct {
+    void *callback;
+    void *userInfo;
+    uint8_t flags;
+    AERenderProfileAccumulator profile;
+} AECallback;
+
+/*!
+ * Callback table
+ *
+ *  'filters' points to the filter callbacks in the order they're run (most recently added
+ *  first), rebuilt whenever the table changes so the render thread needn't rescan. The
+ *  render thread walks it by index: filter n pulls its input from filter n+1, and the
+ *  last filter pulls from the source.
+ *
+ *  Both arrays hold 'capacity' entries, and are replaced together when the table grows.
+ *  Zero-initialise before use.
+ */
+typedef struct {
+    int count;
+    int capacity;
+    AECallback *callbacks;
+    int filterCount;
+    AECallback **filters;
+} AECallbackTable;
+
+/*!
+ * Add a callback
+ *
+ *  The table must have room for it. Call on the render thread, or while it isn't rendering
+ *  from the table, such as from a synchronous message exchange.
+ *
+ * @param table     The table
+ * @param callback  The callback function
+ * @param userInfo  The callback's user info
+ * @param flags     The callback's flags
+ * @return The added callback
+ */
+AECallback *AECallbackTableAdd(AECallbackTable *table, void *callback, void *userInfo, uint8_t flags);
+
+/*!
+ * Remove a callback
+ *
+ *  Call on the render thread, or while it isn't rendering from the table.
+ *
+ * @param table     The table
+ * @param callback  The callback function
+ * @param userInfo  The callback's user info
+ * @return Whether the callback was found and removed
+ */
+bool AECallbackTableRemove(AECallbackTable *table, void *callback, void *userInfo);
+
+/*!
+ * Build a larger copy of a table
+ *
+ *  Fills 'grown' with new arrays holding at least 'capacity' entries, and at least twice as
+ *  many as the table holds now, and copies the table's callbacks and filter chain into them. The render
+ *  thread never sees these until AECallbackTableSwap puts them in place, so it never sees a
+ *  partial resize:
+ *
+ *  @code
+ *  AECallbackTable grown;
+ *  if ( !AECallbackTableBuildGrown(table, capacity, &grown) ) return NO;
+ *  [audioController performSynchronousMessageExchangeWithBlock:^{ AECallbackTableSwap(table, &grown); }];
+ *  AECallbackTableCleanup(&grown); // Now the old arrays
+ *  @endcode
+ *
+ *  Allocates memory, so don't call on the render thread.
+ *
+ * @param table     The table
+ * @param capacity  The number of callbacks needed
+ * @param grown     On output, the larger copy
+ * @return true on success, false if memory couldn't be allocated
+ */
+bool AECallbackTableBuildGrown(const AECallbackTable *table, int capacity, AECallbackTable *grown);
+
+/*!
+ * Exchange the contents of two tables
+ *
+ *  Call on the render thread, or while it isn't rendering from either table, to put a table
+ *  built with AECallbackTableBuildGrown in place. The other table is left holding the arrays
+ *  that were replaced, to free with AECallbackTableCleanup once the render thread can no
+ *  longer be using them.
+ *
+ * @param table The table
+ * @param other The other table
+ */
+void AECallbackTableSwap(AECallbackTable *table, AECallbackTable *other);
+
+/*!
+ * Free a table's arrays
+ *
+ *  The table is left empty, and may be used again.
+ *
+ * @param table The table
+ */
+void AECallbackTableCleanup(AECallbackTable *table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
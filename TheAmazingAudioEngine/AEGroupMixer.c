@@ -0,0 +1,192 @@
+//
+//  AEGroupMixer.c
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "AEGroupMixer.h"
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+// Four-wide float vectors; the compiler maps these onto NEON or SSE
+typedef float vfloat4 __attribute__((vector_size(16)));
+#define kVectorWidth 4
+#endif
+
+void AEGroupMixerInputReset(AEGroupMixerInput *input) {
+    input->gains[0] = input->gains[1] = 0.0f;
+    input->primed = false;
+}
+
+void AEGroupMixerClear(float * const *output, int channels, int frames) {
+    for ( int i=0; i<channels; i++ ) {
+        memset(output[i], 0, frames * sizeof(float));
+    }
+}
+
+/*!
+ * output += source * gain, with gain moving linearly from 'from' to reach 'to' on the last frame
+ */
+static void accumulate(const float *source, float *output, float from, float to, int frames) {
+    if ( from == 0.0f && to == 0.0f ) return;
+
+    float step = (to - from) / (float)frames;
+    float gain = from + step;
+    int i = 0;
+
+#ifdef kVectorWidth
+    if ( step == 0.0f ) {
+        vfloat4 gains = { gain, gain, gain, gain };
+        for ( ; i+kVectorWidth <= frames; i += kVectorWidth ) {
+            vfloat4 in, out;
+            memcpy(&in, source+i, sizeof(in));
+            memcpy(&out, output+i, sizeof(out));
+            out += in * gains;
+            memcpy(output+i, &out, sizeof(out));
+        }
+    } else {
+        vfloat4 gains = { gain, gain + step, gain + 2*step, gain + 3*step };
+        float vectorStep = kVectorWidth * step;
+        vfloat4 steps = { vectorStep, vectorStep, vectorStep, vectorStep };
+        for ( ; i+kVectorWidth <= frames; i += kVectorWidth ) {
+            vfloat4 in, out;
+            memcpy(&in, source+i, sizeof(in));
+            memcpy(&out, output+i, sizeof(out));
+            out += in * gains;
+            memcpy(output+i, &out, sizeof(out));
+            gains += steps;
+        }
+        gain = from + step * (float)(i+1);
+    }
+#endif
+
+    for ( ; i<frames; i++, gain += step ) {
+        output[i] += source[i] * gain;
+    }
+}
+
+/*!
+ * Left and right gains for a volume and pan
+ */
+static void gainsForVolumeAndPan(float volume, float pan, int outputChannels, float gains[2]) {
+    gains[0] = gains[1] = volume;
+    if ( outputChannels == 2 ) {
+        gains[0] = volume * (pan <= 0.0f ? 1.0f : 1.0f - pan);
+        gains[1] = volume * (pan >= 0.0f ? 1.0f : 1.0f + pan);
+    }
+}
+
+/*!
+ * Mix frames [offset, offset+frames) of one input, ramping from the input's last gains to those for the given volume and pan
+ */
+static void mixSegment(AEGroupMixerInput *input,
+                       float              volume,
+                       float              pan,
+                       const float * const *source,
+                       int                sourceChannels,
+                       float * const     *output,
+                       int                outputChannels,
+                       int                offset,
+                       int                frames) {
+
+    float targets[2];
+    gainsForVolumeAndPan(volume, pan, outputChannels, targets);
+
+    float starts[2] = { targets[0], targets[1] };
+    if ( input->primed ) {
+        starts[0] = input->gains[0];
+        starts[1] = input->gains[1];
+    }
+    input->gains[0] = targets[0];
+    input->gains[1] = targets[1];
+    input->primed = true;
+
+    if ( outputChannels == 2 ) {
+        accumulate(source[0]+offset, output[0]+offset, starts[0], targets[0], frames);
+        accumulate(source[sourceChannels > 1 ? 1 : 0]+offset, output[1]+offset, starts[1], targets[1], frames);
+    } else if ( outputChannels == 1 ) {
+        float scale = 1.0f / (float)sourceChannels;
+        for ( int i=0; i<sourceChannels; i++ ) {
+            accumulate(source[i]+offset, output[0]+offset, starts[0] * scale, targets[0] * scale, frames);
+        }
+    } else {
+        for ( int i=0; i<sourceChannels && i<outputChannels; i++ ) {
+            accumulate(source[i]+offset, output[i]+offset, starts[0], targets[0], frames);
+        }
+    }
+}
+
+void AEGroupMixerAccumulate(AEGroupMixerInput *input,
+                            float              volume,
+                            float              pan,
+                            const float * const *source,
+                            int                sourceChannels,
+                            float * const     *output,
+                            int                outputChannels,
+                            int                frames) {
+
+    if ( frames <= 0 || sourceChannels <= 0 || outputChannels <= 0 ) return;
+
+    mixSegment(input, volume, pan, source, sourceChannels, output, outputChannels, 0, frames);
+}
+
+void AEGroupMixerAccumulateAutomated(AEGroupMixerInput *input,
+                                     AEAutomationLane  *volumeLane,
+                                     float              volume,
+                                     AEAutomationLane  *panLane,
+                                     float              pan,
+                                     float              gain,
+                                     double             sampleTime,
+                                     const float * const *source,
+                                     int                sourceChannels,
+                                     float * const     *output,
+                                     int                outputChannels,
+                                     int                frames) {
+
+    if ( frames <= 0 || sourceChannels <= 0 || outputChannels <= 0 ) return;
+
+    if ( !input->primed ) {
+        // Start from where the lanes are now, rather than at the end of the first segment
+        AEAutomationLaneAdvance(volumeLane, sampleTime, volume);
+        AEAutomationLaneAdvance(panLane, sampleTime, pan);
+        gainsForVolumeAndPan(AEAutomationLaneValue(volumeLane, sampleTime - 1, volume) * gain,
+                             AEAutomationLaneValue(panLane, sampleTime - 1, pan),
+                             outputChannels, input->gains);
+        input->primed = true;
+    }
+
+    // Split the block at each breakpoint of either lane, ramping linearly between them
+    int offset = 0;
+    while ( offset < frames ) {
+        double time = sampleTime + offset;
+        int32_t length = frames - offset;
+        int32_t volumeLength = AEAutomationLaneAdvance(volumeLane, time, volume);
+        int32_t panLength = AEAutomationLaneAdvance(panLane, time, pan);
+        if ( volumeLength < length ) length = volumeLength;
+        if ( panLength < length ) length = panLength;
+
+        double end = time + (length - 1);
+        mixSegment(input,
+                   AEAutomationLaneValue(volumeLane, end, volume) * gain,
+                   AEAutomationLaneValue(panLane, end, pan),
+                   source, sourceChannels, output, outputChannels, offset, length);
+        offset += length;
+    }
+}
@@ -0,0 +1,136 @@
+//
+//  AEGroupMixer.h
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef AEGroupMixer_h
+#define AEGroupMixer_h
+
+#include <stdbool.h>
+#include "AEAutomationLane.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Mixer input state
+ *
+ *  Holds the gains an input reached at the end of the last block it was mixed in, so
+ *  that volume and pan changes ramp smoothly across the next block rather than stepping.
+ *  Initialise with AEGroupMixerInputReset. Only the thread doing the mixing should touch this.
+ */
+typedef struct {
+    float gains[2]; //!< Left and right gain at the end of the last block
+    bool  primed;   //!< Whether gains are valid; if not, the next block starts at its target gains
+} AEGroupMixerInput;
+
+/*!
+ * Reset an input
+ *
+ *  The next block mixed for this input will start at its target gains, without a ramp.
+ *
+ * @param input The input
+ */
+void AEGroupMixerInputReset(AEGroupMixerInput *input);
+
+/*!
+ * Clear a mix buffer
+ *
+ * @param output    Non-interleaved output channels
+ * @param channels  Number of output channels
+ * @param frames    Number of frames
+ */
+void AEGroupMixerClear(float * const *output, int channels, int frames);
+
+/*!
+ * Mix one input into the output
+ *
+ *  Scales the source audio by the given volume and pan and adds it to the output in
+ *  place. If the volume or pan differ from the last block, the gains ramp linearly from
+ *  the previous values to the new ones across this block.
+ *
+ *  For stereo output, pan balances between the left and right channels, as the
+ *  Core Audio multichannel mixer does: a mono source feeds both sides, and a stereo
+ *  source feeds its own channels. Mono output takes the average of the source channels.
+ *  With more than two output channels, each source channel feeds the matching output
+ *  channel and pan is ignored.
+ *
+ *  Uses vector instructions where the compiler supports them, and doesn't allocate
+ *  memory or take locks, so it is safe to use on the audio thread.
+ *
+ * @param input          Input state, for ramping
+ * @param volume         Target volume, 0 to 1
+ * @param pan            Target pan, -1 (left) to 1 (right)
+ * @param source         Non-interleaved source channels
+ * @param sourceChannels Number of source channels
+ * @param output         Non-interleaved output channels, to accumulate into
+ * @param outputChannels Number of output channels
+ * @param frames         Number of frames
+ */
+void AEGroupMixerAccumulate(AEGroupMixerInput *input,
+                            float              volume,
+                            float              pan,
+                            const float * const *source,
+                            int                sourceChannels,
+                            float * const     *output,
+                            int                outputChannels,
+                            int                frames);
+
+/*!
+ * Mix one input into the output, following automation lanes
+ *
+ *  As AEGroupMixerAccumulate, but the volume and pan follow the given lanes where they're
+ *  active, and otherwise take the given values. The block is split at each breakpoint that
+ *  falls within it, and the gains ramp linearly between breakpoints, so fades are
+ *  sample-accurate rather than stepping from one block to the next.
+ *
+ * @param input          Input state, for ramping
+ * @param volumeLane     Volume automation
+ * @param volume         Volume, 0 to 1, when not automated
+ * @param panLane        Pan automation
+ * @param pan            Pan, -1 (left) to 1 (right), when not automated
+ * @param gain           Additional gain, applied on top of the volume
+ * @param sampleTime     Output sample time of the first frame
+ * @param source         Non-interleaved source channels
+ * @param sourceChannels Number of source channels
+ * @param output         Non-interleaved output channels, to accumulate into
+ * @param outputChannels Number of output channels
+ * @param frames         Number of frames
+ */
+void AEGroupMixerAccumulateAutomated(AEGroupMixerInput *input,
+                                     AEAutomationLane  *volumeLane,
+                                     float              volume,
+                                     AEAutomationLane  *panLane,
+                                     float              pan,
+                                     float              gain,
+                                     double             sampleTime,
+                                     const float * const *source,
+                                     int                sourceChannels,
+                                     float * const     *output,
+                                     int                outputChannels,
+                                     int                frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -128,11 +128,15 @@ static OSStatus renderCallback(__unsafe_unretained AEMemoryBufferPlayer *THIS, _
     int32_t playhead = THIS->_playhead;
     int32_t originalPlayhead = playhead;
     
-    if ( !THIS->_channelIsPlaying ) return noErr;
+    if ( !THIS->_channelIsPlaying ) {
+        AEAudioControllerReportOutputIsSilent(audioController);
+        return noErr;
+    }
     
     uint64_t hostTimeAtBufferEnd = time->mHostTime + AEHostTicksFromSeconds((double)frames / THIS->_audioDescription.mSampleRate);
     if ( THIS->_startTime && THIS->_startTime > hostTimeAtBufferEnd ) {
         // Start time not yet reached: emit silence
+        AEAudioControllerReportOutputIsSilent(audioController);
         return noErr;
     }
     
@@ -157,6 +161,9 @@ static OSStatus renderCallback(__unsafe_unretained AEMemoryBufferPlayer *THIS, _
         // Notify main thread that playback has finished
         AEAudioControllerSendAsynchronousMessageToMainThread(audioController, notifyPlaybackStopped, &THIS, sizeof(AEMemoryBufferPlayer*));
         THIS->_channelIsPlaying = NO;
+        if ( silentFrames == 0 ) {
+            AEAudioControllerReportOutputIsSilent(audioController);
+        }
         return noErr;
     }
     
@@ -25,6 +25,7 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "AETypedMessageQueue.h"
 
 @class AEMessageQueue;
 
@@ -44,6 +45,43 @@
  */
 typedef void (*AEMessageQueueMessageHandler)(void *userInfo, int userInfoLength);
 
+/*!
+ * Realtime thread parameter handler function
+ *
+ *  Create functions of this type to apply parameter values on the realtime thread, then
+ *  pass a pointer to them to @link AEMessageQueue::setParameterValue:forKey:target:handler: setParameterValue:forKey:target:handler: @endlink.
+ *
+ * @param target            The target passed to setParameterValue:forKey:target:handler:
+ * @param key               The parameter key
+ * @param value             The newest value for the parameter
+ */
+typedef void (*AEMessageQueueParameterHandler)(void *target, int key, double value);
+
+/*!
+ * Number of buckets in the message queue delay histograms
+ */
+#define AEMessageQueueHistogramBucketCount 24
+
+/*!
+ * Message queue statistics
+ *
+ *  Counters are cumulative from when the message queue was created. The delay histograms
+ *  count messages by delay on a logarithmic scale: bucket n counts delays from 2^n to 2^(n+1)
+ *  microseconds, except that the first bucket also counts delays under 2 microseconds, and the
+ *  last also counts anything longer.
+ */
+typedef struct {
+    uint64_t messagesSent;                  //!< Messages sent to the realtime thread
+    uint64_t messagesProcessed;             //!< Messages performed on the realtime thread
+    uint64_t messagesDropped;               //!< Messages not sent because the realtime thread queue was full
+    uint64_t mainThreadMessagesSent;        //!< Messages sent from the realtime thread with AEMessageQueueSendMessageToMainThread
+    uint64_t mainThreadMessagesDropped;     //!< Messages not sent from the realtime thread because the main thread queue was full
+    int32_t  peakFillBytes;                 //!< Most bytes queued for the realtime thread at once
+    int32_t  mainThreadPeakFillBytes;       //!< Most bytes queued for the main thread at once
+    uint32_t processingDelayHistogram[AEMessageQueueHistogramBucketCount]; //!< Delay from sending a message to performing it on the realtime thread
+    uint32_t responseDelayHistogram[AEMessageQueueHistogramBucketCount];   //!< Delay from performing a message on the realtime thread to handling its response
+} AEMessageQueueStatistics;
+
 /*!
  * Message Queue
  *
@@ -78,6 +116,9 @@ typedef void (*AEMessageQueueMessageHandler)(void *userInfo, int userInfoLength)
  *  AEMessageQueueProcessMessagesOnRealtimeThread periodically.
  *  The polling must be active for freeing up message resources, even if you don't
  *  explicitly use any responseBlocks or AEMessageQueueSendMessageToMainThread.
+ *
+ *  The polling thread sleeps until the realtime thread sends or processes messages, so
+ *  responses are delivered without waiting for a polling interval.
  */
 - (void)startPolling;
 
@@ -109,6 +150,45 @@ typedef void (*AEMessageQueueMessageHandler)(void *userInfo, int userInfoLength)
 - (void)performAsynchronousMessageExchangeWithBlock:(void (^)())block
                                       responseBlock:(void (^)())responseBlock;
 
+/*!
+ * Send a parameter value to the realtime thread, replacing any value not yet applied
+ *
+ *  Use this for rapidly-changing values such as those from slider drags. Unlike
+ *  performAsynchronousMessageExchangeWithBlock:responseBlock:, each (target, key) pair
+ *  has a single slot holding its newest value, so sending many updates per render cycle
+ *  doesn't fill up the message buffer, and the realtime thread calls the handler at most
+ *  once per pair at the next call to AEMessageQueueProcessMessagesOnRealtimeThread.
+ *
+ *  Pending parameter updates are applied before any pending messages. Once a target
+ *  has been used, always pass the same handler for it and the key, until it's removed
+ *  with removeParameterValuesForTarget:.
+ *
+ *  Slots persist until their target is removed. If they run out, values are sent as
+ *  ordinary messages instead.
+ *
+ * @param value         The value
+ * @param key           The parameter key
+ * @param target        A pointer identifying the object the parameter belongs to, passed to the handler
+ * @param handler       A function to apply the value, called on the realtime thread
+ */
+- (void)setParameterValue:(double)value forKey:(int)key target:(void*)target handler:(AEMessageQueueParameterHandler)handler;
+
+/*!
+ * Stop sending parameter values to a target
+ *
+ *  Call this before releasing a target passed to setParameterValue:forKey:target:handler:.
+ *  Values not yet applied are discarded, and the realtime thread stops calling the handler
+ *  for the target as soon as this returns, although it may be part-way through a call
+ *  already. So release the target only once the realtime thread has moved on: with
+ *  releaseWhenSafeWithBlock:, or after a message exchange sent after calling this.
+ *
+ *  The target's slots are then freed for reuse, so the same address may be used for a
+ *  new target, with a different handler.
+ *
+ * @param target        The target passed to setParameterValue:forKey:target:handler:
+ */
+- (void)removeParameterValuesForTarget:(void*)target;
+
 /*!
  * Send a message to the realtime thread synchronously
  *
@@ -123,21 +203,51 @@ typedef void (*AEMessageQueueMessageHandler)(void *userInfo, int userInfoLength)
  *
  *  This method will block the current thread until the block has been processed on the realtime thread.
  *  You may pass information from the realtime thread to the calling thread via the use of __block variables.
+ *  The calling thread sleeps on a semaphore, which the realtime thread signals without blocking as soon as
+ *  the block has been performed.
  *
- *  If the block is not processed within a timeout interval, this method will return NO.
+ *  If the block is not processed within a timeout interval, this method will return NO. The block remains
+ *  queued, and will still be performed when the realtime thread next processes messages.
  *
  * @param block         A block to be performed on the realtime thread.
  * @return              YES if the block could be performed, NO otherwise.
  */
 - (BOOL)performSynchronousMessageExchangeWithBlock:(void (^)())block;
 
+/*!
+ * Release something once the realtime thread can no longer be using it
+ *
+ *  Use this to free state that has been swapped out of the render path, in place of a
+ *  synchronous message exchange. Store the pointer to the new state atomically (for example,
+ *  assign it after an OSMemoryBarrier) so the realtime thread sees either the old or new state,
+ *  then pass a block that frees the old state.
+ *
+ *  Each call to AEMessageQueueProcessMessagesOnRealtimeThread begins a new epoch. Once the realtime
+ *  thread has begun an epoch later than the one in which this method was called, it cannot still
+ *  hold a pointer to the old state, and the block is performed on the message queue's polling thread.
+ *  This relies on the realtime thread only reading such pointers between calls to
+ *  AEMessageQueueProcessMessagesOnRealtimeThread, as is the case for render callbacks.
+ *
+ *  Releases still pending when polling stops are performed once the realtime thread
+ *  has moved on, or when the message queue is deallocated.
+ *
+ * @param releaseBlock  A block that releases the old state, performed on a background thread
+ */
+- (void)releaseWhenSafeWithBlock:(void (^)())releaseBlock;
+
 /*!
  * Send a message to the main thread asynchronously
  *
  *  This is a synchronization mechanism that allows the realtime thread to schedule actions to be performed
  *  on the main thread, without any locking or memory allocation.  Pass in a function pointer and
  *  optionally a pointer to data to be copied and passed to the handler, and the function will 
- *  be called on the main thread at the next polling interval.
+ *  be called on the main thread shortly afterwards: the message queue's polling thread is woken
+ *  with a non-blocking signal, and otherwise sleeps while there are no messages. If the main thread
+ *  queue is full, the message is dropped, and counted in the @link statistics @endlink.
+ *
+ *  This may be called from any thread, including several at once, such as the realtime thread
+ *  and the parallel render workers of AEAudioController; messages from one thread arrive in the
+ *  order they were sent.
  *
  *  Tip: To pass a pointer (including pointers to __unsafe_unretained Objective-C objects) through the 
  *  userInfo parameter, be sure to pass the address to the pointer, using the "&" prefix:
@@ -174,12 +284,63 @@ void AEMessageQueueSendMessageToMainThread(AEMessageQueue               *message
                                            void                         *userInfo,
                                            int                           userInfoLength);
 
+/*!
+ * A snapshot of the message queue statistics
+ *
+ *  The statistics are gathered all the time, without locks. This may be called from any thread.
+ */
+@property (nonatomic, readonly) AEMessageQueueStatistics statistics;
+
+/*!
+ * Send a typed message to the realtime thread
+ *
+ *  This sends a function pointer plus a small payload, copied by value into the queue,
+ *  without the block copy and retain/release of performAsynchronousMessageExchangeWithBlock:responseBlock:.
+ *  The handler is called on the realtime thread at the next call to
+ *  AEMessageQueueProcessMessagesOnRealtimeThread. It may be called from any thread, and
+ *  from C or C++ code. See AETypedMessageQueue for a standalone version with no Foundation dependency.
+ *
+ *  Typed messages are processed after parameter updates and before block messages; there's no
+ *  ordering between typed messages and block messages.
+ *
+ * @param messageQueue    The message queue instance.
+ * @param handler         A function to call on the realtime thread.
+ * @param payload         Payload to copy and pass to the handler, or NULL.
+ * @param payloadLength   Length of payload in bytes, up to kAETypedMessageMaxPayloadLength.
+ * @return YES on success, NO if the queue is full.
+ */
+BOOL AEMessageQueueSendTypedMessageToRealtimeThread(AEMessageQueue         *messageQueue,
+                                                    AETypedMessageHandler   handler,
+                                                    const void             *payload,
+                                                    int                     payloadLength);
+
+/*!
+ * Send a typed message to the main thread
+ *
+ *  The realtime thread counterpart to AEMessageQueueSendTypedMessageToRealtimeThread. Like
+ *  AEMessageQueueSendMessageToMainThread, this may be called from any thread, including several
+ *  at once. The handler is called on the main thread shortly afterwards.
+ *
+ * @param messageQueue    The message queue instance.
+ * @param handler         A function to call on the main thread.
+ * @param payload         Payload to copy and pass to the handler, or NULL.
+ * @param payloadLength   Length of payload in bytes, up to kAETypedMessageMaxPayloadLength.
+ * @return YES on success, NO if the queue is full.
+ */
+BOOL AEMessageQueueSendTypedMessageToMainThread(AEMessageQueue         *messageQueue,
+                                                AETypedMessageHandler   handler,
+                                                const void             *payload,
+                                                int                     payloadLength);
+
 /*!
  * Timeout for when realtime message blocks should be executed automatically
  *
  *  If greater than zero and @link AEMessageQueueProcessMessagesOnRealtimeThread @endlink 
  *  hasn't been called in this many seconds, process the messages anyway on an internal thread. 
  *
+ *  Processing messages this way doesn't begin a new epoch for
+ *  @link releaseWhenSafeWithBlock: @endlink, as the realtime thread may just be running late.
+ *
  *  Default is zero (disabled).
  */
 @property (nonatomic, assign) NSTimeInterval autoProcessTimeout;
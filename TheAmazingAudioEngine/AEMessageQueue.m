@@ -26,9 +26,23 @@
 
 
 #import "AEMessageQueue.h"
+#import "AETypedMessageQueue.h"
 #import "TPCircularBuffer.h"
+#import "TPMultiProducerCircularBuffer.h"
 #import "AEUtilities.h"
 #import <pthread.h>
+#import <mach/mach.h>
+
+/*!
+ * Synchronous message completion
+ *
+ *  Shared by the waiting thread and the message's reply; whichever finishes with it last frees it.
+ */
+typedef struct {
+    semaphore_t                     semaphore;
+    volatile int32_t                completed;
+    volatile int32_t                referenceCount;
+} completion_t;
 
 /*!
  * Message
@@ -38,41 +52,95 @@ typedef struct {
     void                           *responseBlock;
     AEMessageQueueMessageHandler    handler;
     int                             userInfoLength;
-    pthread_t                       sourceThread;
+    completion_t                   *completion;
+    uint64_t                        sendTime;
+    uint64_t                        processTime;
     BOOL                            replyServiced;
 } message_t;
 
+/*!
+ * Parameter update slot, holding the newest value for a target and key
+ */
+typedef struct {
+    void                             *target;
+    int                               key;
+    AEMessageQueueParameterHandler    handler;
+    volatile uint64_t                 value; // Bits of a double, so it can be written atomically
+    volatile int32_t                  pending;
+    volatile int32_t                  removed;  // Set once the target is removed; the realtime thread skips the slot
+    volatile int32_t                  reusable; // Set once the realtime thread can no longer be applying the removed slot
+} parameter_slot_t;
+
+/*!
+ * Deferred release, waiting for the realtime thread to move past the epoch in which it was retired
+ */
+typedef struct retired_t {
+    void                           *releaseBlock;
+    int64_t                         epoch;
+    struct retired_t               *next;
+} retired_t;
+
 static const int kDefaultMessageBufferLength             = 8192;
-static const NSTimeInterval kIdleMessagingPollDuration   = 0.1;
-static const NSTimeInterval kActiveMessagingPollDuration = 0.01;
+static const int kMaximumParameterSlots                  = 128;
 static const NSTimeInterval kSynchronousTimeoutInterval  = 1.0;
 
 @interface AEMessageQueuePollThread : NSThread
 
-- (id)initWithMessageQueue:(AEMessageQueue*)messageQueue;
-
-@property (nonatomic, assign) NSTimeInterval pollInterval;
+- (id)initWithMessageQueue:(AEMessageQueue*)messageQueue wakeSemaphore:(semaphore_t)wakeSemaphore;
 
 @end
 
+static mach_timespec_t AEMessageQueueTimespec(NSTimeInterval interval) {
+    return (mach_timespec_t) { .tv_sec = (unsigned int)interval, .tv_nsec = (clock_res_t)((interval - floor(interval)) * 1.0e9) };
+}
+
+static void AEMessageQueueReleaseCompletion(completion_t *completion) {
+    if ( OSAtomicDecrement32Barrier(&completion->referenceCount) == 0 ) {
+        semaphore_destroy(mach_task_self(), completion->semaphore);
+        free(completion);
+    }
+}
+
 @interface AEMessageQueue ()
 
 @property (nonatomic, readonly) uint64_t lastProcessTime;
 
+- (void)performRetiredReleases;
+
 @end
 
 @implementation AEMessageQueue {
     TPCircularBuffer    _realtimeThreadMessageBuffer;
-    TPCircularBuffer    _mainThreadMessageBuffer;
+    TPMultiProducerCircularBuffer _mainThreadMessageBuffer;
+    AETypedMessageQueue *_typedMessageQueue;
     AEMessageQueuePollThread *_pollThread;
-    int                 _pendingResponses;
+    semaphore_t         _wakeSemaphore;
+    volatile int32_t    _wakePending;
+    parameter_slot_t    _parameterSlots[kMaximumParameterSlots];
+    volatile int32_t    _parameterSlotCount;
+    volatile int32_t    _parameterUpdatesPending;
+    volatile int64_t    _epoch;
+    retired_t          *_retired;
+    volatile int32_t    _retiredCount;
+    AEMessageQueueStatistics _statistics;
 }
 
 - (instancetype)initWithMessageBufferLength:(int32_t)numBytes {
     if ( !(self = [super init]) ) return nil;
     
     TPCircularBufferInit(&_realtimeThreadMessageBuffer, numBytes);
-    TPCircularBufferInit(&_mainThreadMessageBuffer, numBytes);
+    TPMultiProducerCircularBufferInit(&_mainThreadMessageBuffer, numBytes);
+    
+    _typedMessageQueue = AETypedMessageQueueCreate(numBytes);
+    if ( !_typedMessageQueue ) {
+        NSLog(@"AEMessageQueue: Unable to create typed message queue");
+        return nil;
+    }
+    
+    if ( semaphore_create(mach_task_self(), &_wakeSemaphore, SYNC_POLICY_FIFO, 0) != KERN_SUCCESS ) {
+        NSLog(@"AEMessageQueue: Unable to create wake semaphore");
+        return nil;
+    }
     
     return self;
 }
@@ -82,17 +150,27 @@ static const NSTimeInterval kSynchronousTimeoutInterval  = 1.0;
 }
 
 - (void)dealloc {
-    TPCircularBufferCleanup(&_realtimeThreadMessageBuffer);
-    TPCircularBufferCleanup(&_mainThreadMessageBuffer);
     [self stopPolling];
+    
+    // Nothing can be rendering any more, so perform any outstanding releases
+    OSAtomicIncrement64Barrier(&_epoch);
+    [self performRetiredReleases];
+    
+    TPCircularBufferCleanup(&_realtimeThreadMessageBuffer);
+    TPMultiProducerCircularBufferCleanup(&_mainThreadMessageBuffer);
+    if ( _typedMessageQueue ) {
+        AETypedMessageQueueDestroy(_typedMessageQueue);
+    }
+    if ( _wakeSemaphore ) {
+        semaphore_destroy(mach_task_self(), _wakeSemaphore);
+    }
 }
 
 - (void)startPolling {
     if ( !_pollThread ) {
         // Start messaging poll thread
         _lastProcessTime = AECurrentTimeInHostTicks();
-        _pollThread = [[AEMessageQueuePollThread alloc] initWithMessageQueue:self];
-        _pollThread.pollInterval = kIdleMessagingPollDuration;
+        _pollThread = [[AEMessageQueuePollThread alloc] initWithMessageQueue:self wakeSemaphore:_wakeSemaphore];
         OSMemoryBarrier();
         [_pollThread start];
     }
@@ -101,17 +179,81 @@ static const NSTimeInterval kSynchronousTimeoutInterval  = 1.0;
 - (void)stopPolling {
     if ( _pollThread ) {
         [_pollThread cancel];
+        semaphore_signal(_wakeSemaphore);
         while ( [_pollThread isExecuting] ) {
             [NSThread sleepForTimeInterval:0.01];
         }
         _pollThread = nil;
+        
+        // Perform any releases the realtime thread had already cleared, which the poll thread won't now see
+        [self performRetiredReleases];
     }
 }
 
-void AEMessageQueueProcessMessagesOnRealtimeThread(__unsafe_unretained AEMessageQueue *THIS) {
-    // Only call this from the realtime thread, or the main thread if realtime thread not yet running
+static void AEMessageQueueWakePollThread(__unsafe_unretained AEMessageQueue *THIS) {
+    // Signal the poll thread, unless it's already been signalled and hasn't yet looked for messages.
+    // semaphore_signal doesn't block, so this is safe on the realtime thread.
+    if ( OSAtomicCompareAndSwap32Barrier(0, 1, &THIS->_wakePending) ) {
+        semaphore_signal(THIS->_wakeSemaphore);
+    }
+}
 
+static void AEMessageQueueApplyParameterUpdates(__unsafe_unretained AEMessageQueue *THIS) {
+    if ( !OSAtomicCompareAndSwap32Barrier(1, 0, &THIS->_parameterUpdatesPending) ) return;
+    
+    int32_t slotCount = THIS->_parameterSlotCount;
+    OSMemoryBarrier();
+    for ( int i=0; i<slotCount; i++ ) {
+        parameter_slot_t *slot = &THIS->_parameterSlots[i];
+        if ( slot->removed ) continue;
+        // Clear the flag before reading the value, so a newer value arriving meanwhile is applied next time
+        if ( !OSAtomicCompareAndSwap32Barrier(1, 0, &slot->pending) ) continue;
+        uint64_t bits = __atomic_load_n(&slot->value, __ATOMIC_ACQUIRE);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        slot->handler(slot->target, slot->key, value);
+    }
+}
+
+static void AEMessageQueueRecordDelay(volatile uint32_t *histogram, uint64_t startTime, uint64_t endTime) {
+    uint64_t microseconds = endTime > startTime ? (uint64_t)(AESecondsFromHostTicks(endTime - startTime) * 1.0e6) : 0;
+    int bucket = microseconds < 2 ? 0 : 63 - __builtin_clzll(microseconds);
+    if ( bucket >= AEMessageQueueHistogramBucketCount ) bucket = AEMessageQueueHistogramBucketCount-1;
+    OSAtomicIncrement32((volatile int32_t*)&histogram[bucket]);
+}
+
+static void AEMessageQueueRecordFill(volatile int32_t *peak, int32_t fill) {
+    // Messages to the main thread come from several threads at once, so raise the peak with a compare-and-swap
+    int32_t current = *peak;
+    while ( fill > current && !OSAtomicCompareAndSwap32Barrier(current, fill, peak) ) {
+        current = *peak;
+    }
+}
+
+static int32_t AEMessageQueueReservedBytes(TPMultiProducerCircularBuffer *buffer) {
+    // Bytes queued for the consumer or reserved by producers, including the caller's own reservation
+    int32_t reservation = (int32_t)(uint32_t)__atomic_load_n(&buffer->reservation, __ATOMIC_ACQUIRE);
+    return _TPCircularBufferDistance(&buffer->buffer, _TPCircularBufferProducerTail(&buffer->buffer), reservation);
+}
+
+static void AEMessageQueueProcessMessages(__unsafe_unretained AEMessageQueue *THIS, BOOL beginEpoch) {
     THIS->_lastProcessTime = AECurrentTimeInHostTicks();
+    
+    if ( beginEpoch ) {
+        // Enter a new epoch: anything retired before now is no longer in use. Have the poll thread release it.
+        OSAtomicIncrement64Barrier(&THIS->_epoch);
+        if ( THIS->_retiredCount > 0 ) {
+            AEMessageQueueWakePollThread(THIS);
+        }
+    }
+    
+    // Parameter updates come first, so their targets are still valid if removed by a later message
+    AEMessageQueueApplyParameterUpdates(THIS);
+    
+    int typedMessageCount = AETypedMessageQueueProcessOnRealtimeThread(THIS->_typedMessageQueue);
+    if ( typedMessageCount > 0 ) {
+        OSAtomicAdd64(typedMessageCount, (volatile int64_t*)&THIS->_statistics.messagesProcessed);
+    }
 
     int32_t availableBytes;
     message_t *buffer = TPCircularBufferTail(&THIS->_realtimeThreadMessageBuffer, &availableBytes);
@@ -122,64 +264,72 @@ void AEMessageQueueProcessMessagesOnRealtimeThread(__unsafe_unretained AEMessage
         assert(buffer->userInfoLength == 0);
         
         memcpy(&message, buffer, sizeof(message));
-        TPCircularBufferConsume(&THIS->_realtimeThreadMessageBuffer, sizeof(message_t));
+        
+        message.processTime = AECurrentTimeInHostTicks();
+        AEMessageQueueRecordDelay(THIS->_statistics.processingDelayHistogram, message.sendTime, message.processTime);
         
         if ( message.block ) {
             ((__bridge void(^)())message.block)();
         }
+        
+        OSAtomicIncrement64((volatile int64_t*)&THIS->_statistics.messagesProcessed);
+        
+        if ( message.completion ) {
+            // Wake the waiting thread; semaphore_signal doesn't block. The completion stays valid until the reply is handled.
+            OSAtomicCompareAndSwap32Barrier(0, 1, &message.completion->completed);
+            semaphore_signal(message.completion->semaphore);
+        }
 
-        int32_t availableBytes;
-        message_t *reply = TPCircularBufferHead(&THIS->_mainThreadMessageBuffer, &availableBytes);
-        assert(availableBytes >= sizeof(message_t));
+        message_t *reply = TPMultiProducerCircularBufferReserve(&THIS->_mainThreadMessageBuffer, sizeof(message_t));
+        assert(reply);
+        AEMessageQueueRecordFill(&THIS->_statistics.mainThreadPeakFillBytes, AEMessageQueueReservedBytes(&THIS->_mainThreadMessageBuffer));
         memcpy(reply, &message, sizeof(message_t));
-        TPCircularBufferProduce(&THIS->_mainThreadMessageBuffer, sizeof(message_t));
+        TPMultiProducerCircularBufferCommit(&THIS->_mainThreadMessageBuffer, reply, sizeof(message_t));
         
         buffer++;
     }
+    
+    if ( availableBytes > 0 ) {
+        // Release all processed messages at once
+        TPCircularBufferConsume(&THIS->_realtimeThreadMessageBuffer, availableBytes);
+        AEMessageQueueWakePollThread(THIS);
+    }
 }
 
--(void)pollForMessageResponses {
-    pthread_t thread = pthread_self();
-    BOOL isMainThread = [NSThread isMainThread];
+void AEMessageQueueProcessMessagesOnRealtimeThread(__unsafe_unretained AEMessageQueue *THIS) {
+    // Only call this from the realtime thread, or the main thread if realtime thread not yet running
+    AEMessageQueueProcessMessages(THIS, YES);
+}
 
+-(void)pollForMessageResponses {
+    AETypedMessageQueueProcessOnMainThread(_typedMessageQueue);
+    
     while ( 1 ) {
         message_t *message = NULL;
         @synchronized ( self ) {
             // Look for pending messages
             int32_t availableBytes;
-            message_t *buffer = TPCircularBufferTail(&_mainThreadMessageBuffer, &availableBytes);
+            message_t *buffer = TPCircularBufferTail(&_mainThreadMessageBuffer.buffer, &availableBytes);
             if ( !buffer ) {
                 break;
             }
             
             message_t *bufferEnd = (message_t*)(((char*)buffer)+availableBytes);
-            BOOL hasUnservicedMessages = NO;
             
             // Look through pending messages
             while ( buffer < bufferEnd && !message ) {
                 int messageLength = sizeof(message_t) + buffer->userInfoLength;
 
                 if ( !buffer->replyServiced ) {
-                    // This is a message that hasn't yet been serviced
-                    
-                    if ( (buffer->sourceThread && buffer->sourceThread != thread) && (buffer->sourceThread == NULL && !isMainThread) ) {
-                        // Skip this message, it's for a different thread
-                        hasUnservicedMessages = YES;
-                    } else {
-                        // Service this message
-                        message = (message_t*)malloc(messageLength);
-                        memcpy(message, buffer, messageLength);
-                        buffer->replyServiced = YES;
-                    }
+                    // Service this message
+                    message = (message_t*)malloc(messageLength);
+                    memcpy(message, buffer, messageLength);
+                    buffer->replyServiced = YES;
                 }
                 
-                // Advance to next message
+                // Advance to next message, and free up the buffer
                 buffer = (message_t*)(((char*)buffer)+messageLength);
-                
-                if ( !hasUnservicedMessages ) {
-                    // If we're done with all message records so far, free up the buffer
-                    TPCircularBufferConsume(&_mainThreadMessageBuffer, messageLength);
-                }
+                TPCircularBufferConsume(&_mainThreadMessageBuffer.buffer, messageLength);
             }
         }
         
@@ -187,14 +337,13 @@ void AEMessageQueueProcessMessagesOnRealtimeThread(__unsafe_unretained AEMessage
             break;
         }
         
+        if ( message->processTime ) {
+            AEMessageQueueRecordDelay(_statistics.responseDelayHistogram, message->processTime, AECurrentTimeInHostTicks());
+        }
+        
         if ( message->responseBlock ) {
             ((__bridge void(^)())message->responseBlock)();
             CFBridgingRelease(message->responseBlock);
-            
-            _pendingResponses--;
-            if ( _pollThread && _pendingResponses == 0 ) {
-                _pollThread.pollInterval = kIdleMessagingPollDuration;
-            }
         } else if ( message->handler ) {
             message->handler(message->userInfoLength > 0 ? message+1 : NULL,
                              message->userInfoLength);
@@ -204,61 +353,207 @@ void AEMessageQueueProcessMessagesOnRealtimeThread(__unsafe_unretained AEMessage
             CFBridgingRelease(message->block);
         }
         
+        if ( message->completion ) {
+            AEMessageQueueReleaseCompletion(message->completion);
+        }
+        
         free(message);
     }
 }
 
-- (void)performAsynchronousMessageExchangeWithBlock:(void (^)())block
+- (BOOL)performAsynchronousMessageExchangeWithBlock:(void (^)())block
                                       responseBlock:(void (^)())responseBlock
-                                       sourceThread:(pthread_t)sourceThread {
+                                         completion:(completion_t*)completion {
     @synchronized ( self ) {
 
         int32_t availableBytes;
         message_t *message = TPCircularBufferHead(&_realtimeThreadMessageBuffer, &availableBytes);
         
         if ( availableBytes < sizeof(message_t) ) {
+            OSAtomicIncrement64((volatile int64_t*)&_statistics.messagesDropped);
             NSLog(@"AEMessageQueue: Unable to perform message exchange - queue is full.");
-            return;
+            return NO;
         }
         
-        if ( responseBlock ) {
-            _pendingResponses++;
-            
-            if ( _pollThread.pollInterval == kIdleMessagingPollDuration ) {
-                // Perform more rapid active polling while we expect a response
-                _pollThread.pollInterval = kActiveMessagingPollDuration;
-            }
-        }
+        AEMessageQueueRecordFill(&_statistics.peakFillBytes, _realtimeThreadMessageBuffer.length - availableBytes + (int32_t)sizeof(message_t));
+        OSAtomicIncrement64((volatile int64_t*)&_statistics.messagesSent);
         
         memset(message, 0, sizeof(message_t));
         message->block         = block ? (__bridge_retained void*)[block copy] : NULL;
         message->responseBlock = responseBlock ? (__bridge_retained void*)[responseBlock copy] : NULL;
-        message->sourceThread  = sourceThread; // Used only for synchronous message exchange
+        message->completion    = completion; // Used only for synchronous message exchange
+        message->sendTime      = AECurrentTimeInHostTicks();
         
         TPCircularBufferProduce(&_realtimeThreadMessageBuffer, sizeof(message_t));
         
     }
+    return YES;
 }
 
 
+- (void)setParameterValue:(double)value forKey:(int)key target:(void *)target handler:(AEMessageQueueParameterHandler)handler {
+    @synchronized ( self ) {
+        parameter_slot_t *slot = NULL;
+        parameter_slot_t *freeSlot = NULL;
+        for ( int i=0; i<_parameterSlotCount; i++ ) {
+            if ( _parameterSlots[i].removed ) {
+                if ( !freeSlot && _parameterSlots[i].reusable ) freeSlot = &_parameterSlots[i];
+            } else if ( _parameterSlots[i].target == target && _parameterSlots[i].key == key ) {
+                slot = &_parameterSlots[i];
+                break;
+            }
+        }
+        
+        if ( !slot && freeSlot ) {
+            // Reuse a removed slot: the realtime thread skips it until it's enabled again
+            slot = freeSlot;
+            slot->target = target;
+            slot->key = key;
+            slot->handler = handler;
+            slot->pending = 0;
+            slot->reusable = 0;
+            OSMemoryBarrier();
+            slot->removed = 0;
+        } else if ( !slot ) {
+            if ( _parameterSlotCount == kMaximumParameterSlots ) {
+                // Out of slots: fall back to an ordinary message
+                [self performAsynchronousMessageExchangeWithBlock:^{ handler(target, key, value); } responseBlock:nil];
+                return;
+            }
+            
+            // Fill in a new slot, then publish it
+            slot = &_parameterSlots[_parameterSlotCount];
+            slot->target = target;
+            slot->key = key;
+            slot->handler = handler;
+            slot->pending = 0;
+            slot->removed = 0;
+            slot->reusable = 0;
+            OSMemoryBarrier();
+            _parameterSlotCount++;
+        }
+        
+        assert(slot->handler == handler);
+        
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        __atomic_store_n(&slot->value, bits, __ATOMIC_RELEASE);
+        OSAtomicCompareAndSwap32Barrier(0, 1, &slot->pending);
+        OSAtomicCompareAndSwap32Barrier(0, 1, &_parameterUpdatesPending);
+    }
+}
+
+- (void)removeParameterValuesForTarget:(void *)target {
+    @synchronized ( self ) {
+        for ( int i=0; i<_parameterSlotCount; i++ ) {
+            parameter_slot_t *slot = &_parameterSlots[i];
+            if ( slot->removed || slot->target != target ) continue;
+            
+            // Stop the realtime thread applying the slot, discarding any value not yet applied
+            OSAtomicCompareAndSwap32Barrier(0, 1, &slot->removed);
+            __atomic_store_n(&slot->pending, 0, __ATOMIC_RELEASE);
+            
+            // It may be part-way through applying it now, so only reuse the slot once it's moved on
+            [self releaseWhenSafeWithBlock:^{
+                OSAtomicCompareAndSwap32Barrier(0, 1, &slot->reusable);
+            }];
+        }
+    }
+}
+
 - (void)performAsynchronousMessageExchangeWithBlock:(void (^)())block responseBlock:(void (^)())responseBlock {
-    [self performAsynchronousMessageExchangeWithBlock:block responseBlock:responseBlock sourceThread:NULL];
+    [self performAsynchronousMessageExchangeWithBlock:block responseBlock:responseBlock completion:NULL];
+}
+
+- (AEMessageQueueStatistics)statistics {
+    // Each field is read atomically; the snapshot as a whole may be slightly inconsistent while messages are in flight
+    AEMessageQueueStatistics statistics;
+    statistics.messagesSent = OSAtomicAdd64(0, (volatile int64_t*)&_statistics.messagesSent);
+    statistics.messagesProcessed = OSAtomicAdd64(0, (volatile int64_t*)&_statistics.messagesProcessed);
+    statistics.messagesDropped = OSAtomicAdd64(0, (volatile int64_t*)&_statistics.messagesDropped);
+    statistics.mainThreadMessagesSent = OSAtomicAdd64(0, (volatile int64_t*)&_statistics.mainThreadMessagesSent);
+    statistics.mainThreadMessagesDropped = OSAtomicAdd64(0, (volatile int64_t*)&_statistics.mainThreadMessagesDropped);
+    statistics.peakFillBytes = _statistics.peakFillBytes;
+    statistics.mainThreadPeakFillBytes = _statistics.mainThreadPeakFillBytes;
+    for ( int i=0; i<AEMessageQueueHistogramBucketCount; i++ ) {
+        statistics.processingDelayHistogram[i] = _statistics.processingDelayHistogram[i];
+        statistics.responseDelayHistogram[i] = _statistics.responseDelayHistogram[i];
+    }
+    return statistics;
+}
+
+- (void)releaseWhenSafeWithBlock:(void (^)())releaseBlock {
+    retired_t *retired = (retired_t*)malloc(sizeof(retired_t));
+    retired->releaseBlock = (__bridge_retained void*)[releaseBlock copy];
+    
+    // Read the epoch after the caller's pointer swap; once the realtime thread enters a later one, it can't hold the old pointer
+    retired->epoch = __atomic_load_n(&_epoch, __ATOMIC_SEQ_CST);
+    
+    @synchronized ( self ) {
+        retired->next = _retired;
+        _retired = retired;
+        OSAtomicIncrement32Barrier(&_retiredCount);
+    }
+}
+
+- (void)performRetiredReleases {
+    if ( _retiredCount == 0 ) return;
+    
+    int64_t epoch = __atomic_load_n(&_epoch, __ATOMIC_SEQ_CST);
+    
+    // Detach the releases the realtime thread has moved past
+    retired_t *ready = NULL;
+    @synchronized ( self ) {
+        retired_t **link = &_retired;
+        while ( *link ) {
+            retired_t *retired = *link;
+            if ( retired->epoch < epoch ) {
+                *link = retired->next;
+                retired->next = ready;
+                ready = retired;
+                OSAtomicDecrement32Barrier(&_retiredCount);
+            } else {
+                link = &retired->next;
+            }
+        }
+    }
+    
+    while ( ready ) {
+        retired_t *next = ready->next;
+        void (^releaseBlock)() = (__bridge_transfer void(^)())ready->releaseBlock;
+        releaseBlock();
+        free(ready);
+        ready = next;
+    }
 }
 
 - (BOOL)performSynchronousMessageExchangeWithBlock:(void (^)())block {
-    __block BOOL finished = NO;
-    [self performAsynchronousMessageExchangeWithBlock:block
-                                        responseBlock:^{ finished = YES; }
-                                         sourceThread:pthread_self()];
+    completion_t *completion = (completion_t*)calloc(1, sizeof(completion_t));
+    if ( semaphore_create(mach_task_self(), &completion->semaphore, SYNC_POLICY_FIFO, 0) != KERN_SUCCESS ) {
+        NSLog(@"AEMessageQueue: Unable to create semaphore for synchronous message exchange");
+        free(completion);
+        return NO;
+    }
+    completion->referenceCount = 2; // Held by this thread, and by the message until its reply is handled
+    
+    if ( ![self performAsynchronousMessageExchangeWithBlock:block responseBlock:nil completion:completion] ) {
+        AEMessageQueueReleaseCompletion(completion);
+        AEMessageQueueReleaseCompletion(completion);
+        return NO;
+    }
 
-    // Wait for response
+    // Wait for the realtime thread to signal that the block has been performed
     uint64_t giveUpTime = AECurrentTimeInHostTicks() + AEHostTicksFromSeconds(kSynchronousTimeoutInterval);
-    while ( !finished && AECurrentTimeInHostTicks() < giveUpTime ) {
-        [self pollForMessageResponses];
-        if ( finished ) break;
-        [NSThread sleepForTimeInterval: kActiveMessagingPollDuration];
+    while ( !completion->completed ) {
+        uint64_t now = AECurrentTimeInHostTicks();
+        if ( now >= giveUpTime ) break;
+        semaphore_timedwait(completion->semaphore, AEMessageQueueTimespec(AESecondsFromHostTicks(giveUpTime - now)));
     }
     
+    OSMemoryBarrier();
+    BOOL finished = completion->completed;
+    AEMessageQueueReleaseCompletion(completion);
+    
     if ( !finished ) {
         NSLog(@"AEMessageQueue: Timed out while performing synchronous message exchange");
     }
@@ -271,9 +566,15 @@ void AEMessageQueueSendMessageToMainThread(__unsafe_unretained AEMessageQueue *T
                                            void                               *userInfo,
                                            int                                 userInfoLength) {
     
-    int32_t availableBytes;
-    message_t *message = TPCircularBufferHead(&THIS->_mainThreadMessageBuffer, &availableBytes);
-    assert(availableBytes >= sizeof(message_t) + userInfoLength);
+    // Reserve space, as render worker threads may send at the same time as the realtime thread
+    int32_t length = (int32_t)sizeof(message_t) + userInfoLength;
+    message_t *message = TPMultiProducerCircularBufferReserve(&THIS->_mainThreadMessageBuffer, length);
+    if ( !message ) {
+        OSAtomicIncrement64((volatile int64_t*)&THIS->_statistics.mainThreadMessagesDropped);
+        return;
+    }
+    AEMessageQueueRecordFill(&THIS->_statistics.mainThreadPeakFillBytes, AEMessageQueueReservedBytes(&THIS->_mainThreadMessageBuffer));
+    OSAtomicIncrement64((volatile int64_t*)&THIS->_statistics.mainThreadMessagesSent);
     memset(message, 0, sizeof(message_t));
     message->handler                = handler;
     message->userInfoLength         = userInfoLength;
@@ -282,12 +583,44 @@ void AEMessageQueueSendMessageToMainThread(__unsafe_unretained AEMessageQueue *T
         memcpy((message+1), userInfo, userInfoLength);
     }
     
-    TPCircularBufferProduce(&THIS->_mainThreadMessageBuffer, sizeof(message_t) + userInfoLength);
+    TPMultiProducerCircularBufferCommit(&THIS->_mainThreadMessageBuffer, message, length);
+    AEMessageQueueWakePollThread(THIS);
+}
+
+static void AEMessageQueueClearWakePending(__unsafe_unretained AEMessageQueue *THIS) {
+    // Clear before looking for messages, so any sent from here on signal the poll thread again
+    OSAtomicCompareAndSwap32Barrier(1, 0, &THIS->_wakePending);
+}
+
+BOOL AEMessageQueueSendTypedMessageToRealtimeThread(__unsafe_unretained AEMessageQueue *THIS,
+                                                    AETypedMessageHandler               handler,
+                                                    const void                         *payload,
+                                                    int                                 payloadLength) {
+    if ( !AETypedMessageQueueSendToRealtimeThread(THIS->_typedMessageQueue, handler, payload, payloadLength) ) {
+        OSAtomicIncrement64((volatile int64_t*)&THIS->_statistics.messagesDropped);
+        return NO;
+    }
+    OSAtomicIncrement64((volatile int64_t*)&THIS->_statistics.messagesSent);
+    return YES;
+}
+
+BOOL AEMessageQueueSendTypedMessageToMainThread(__unsafe_unretained AEMessageQueue *THIS,
+                                                AETypedMessageHandler               handler,
+                                                const void                         *payload,
+                                                int                                 payloadLength) {
+    if ( !AETypedMessageQueueSendToMainThread(THIS->_typedMessageQueue, handler, payload, payloadLength) ) {
+        OSAtomicIncrement64((volatile int64_t*)&THIS->_statistics.mainThreadMessagesDropped);
+        return NO;
+    }
+    OSAtomicIncrement64((volatile int64_t*)&THIS->_statistics.mainThreadMessagesSent);
+    AEMessageQueueWakePollThread(THIS);
+    return YES;
 }
 
 static BOOL AEMessageQueueHasPendingMainThreadMessages(__unsafe_unretained AEMessageQueue *THIS) {
     int32_t ignore;
-    return TPCircularBufferTail(&THIS->_mainThreadMessageBuffer, &ignore) != NULL;
+    return TPCircularBufferTail(&THIS->_mainThreadMessageBuffer.buffer, &ignore) != NULL
+            || AETypedMessageQueueHasMainThreadMessages(THIS->_typedMessageQueue);
 }
 
 @end
@@ -295,24 +628,41 @@ static BOOL AEMessageQueueHasPendingMainThreadMessages(__unsafe_unretained AEMes
 
 @implementation AEMessageQueuePollThread {
     __weak AEMessageQueue *_messageQueue;
+    semaphore_t _wakeSemaphore;
 }
-- (id)initWithMessageQueue:(AEMessageQueue *)messageQueue {
+- (id)initWithMessageQueue:(AEMessageQueue *)messageQueue wakeSemaphore:(semaphore_t)wakeSemaphore {
     if ( !(self = [super init]) ) return nil;
     _messageQueue = messageQueue;
+    _wakeSemaphore = wakeSemaphore;
     return self;
 }
 - (void)main {
     @autoreleasepool {
         pthread_setname_np("com.theamazingaudioengine.AEMessageQueuePollThread");
         while ( !self.isCancelled ) {
+            NSTimeInterval autoProcessTimeout;
             @autoreleasepool {
-                if ( _messageQueue.autoProcessTimeout > 0 && AESecondsFromHostTicks(AECurrentTimeInHostTicks() - _messageQueue.lastProcessTime) > _messageQueue.autoProcessTimeout ) {
-                    AEMessageQueueProcessMessagesOnRealtimeThread(_messageQueue);
+                AEMessageQueue *messageQueue = _messageQueue;
+                if ( !messageQueue ) break;
+                
+                AEMessageQueueClearWakePending(messageQueue);
+                
+                autoProcessTimeout = messageQueue.autoProcessTimeout;
+                if ( autoProcessTimeout > 0 && AESecondsFromHostTicks(AECurrentTimeInHostTicks() - messageQueue.lastProcessTime) > autoProcessTimeout ) {
+                    // Don't begin a new epoch: the realtime thread may only be running late, and still mid-cycle
+                    AEMessageQueueProcessMessages(messageQueue, NO);
                 }
-                if ( AEMessageQueueHasPendingMainThreadMessages(_messageQueue) ) {
-                    [_messageQueue performSelectorOnMainThread:@selector(pollForMessageResponses) withObject:nil waitUntilDone:NO];
+                if ( AEMessageQueueHasPendingMainThreadMessages(messageQueue) ) {
+                    [messageQueue performSelectorOnMainThread:@selector(pollForMessageResponses) withObject:nil waitUntilDone:NO];
                 }
-                usleep(_pollInterval*1.0e6);
+                [messageQueue performRetiredReleases];
+            }
+            
+            // Sleep until the realtime thread sends something; wake periodically only if we may need to process messages ourselves
+            if ( autoProcessTimeout > 0 ) {
+                semaphore_timedwait(_wakeSemaphore, AEMessageQueueTimespec(autoProcessTimeout));
+            } else {
+                semaphore_wait(_wakeSemaphore);
             }
         }
     }
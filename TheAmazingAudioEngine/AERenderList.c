@@ -0,0 +1,79 @@
+//
+//  AERenderList.c
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "AERenderList.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct _AERenderListUpdate {
+    AERenderList **slot;
+    AERenderList  *list;
+    int            releasingCount;
+    void          *releasing[];
+};
+
+AERenderList *AERenderListCreate(void * const *channels, int count, AERenderListLastPredicate isLast) {
+    int capacity = count > 0 ? count : 1;
+    AERenderList *list = (AERenderList*)malloc(sizeof(AERenderList) + 2 * capacity * sizeof(void*));
+    if ( !list ) return NULL;
+    
+    list->count = 0;
+    for ( int i=0; i<count; i++ ) {
+        if ( channels[i] && !(isLast && isLast(channels[i])) ) list->channels[list->count++] = channels[i];
+    }
+    if ( isLast ) {
+        for ( int i=0; i<count; i++ ) {
+            if ( channels[i] && isLast(channels[i]) ) list->channels[list->count++] = channels[i];
+        }
+    }
+    list->parallelChannels = &list->channels[capacity];
+    return list;
+}
+
+AERenderListUpdate *AERenderListUpdateCreate(AERenderList **slot, AERenderList *list, void * const *releasing, int count) {
+    AERenderListUpdate *update = (AERenderListUpdate*)malloc(sizeof(AERenderListUpdate) + count * sizeof(void*));
+    if ( !update ) return NULL;
+    
+    update->slot = slot;
+    update->list = list;
+    update->releasingCount = 0;
+    for ( int i=0; i<count; i++ ) {
+        if ( releasing[i] ) update->releasing[update->releasingCount++] = releasing[i];
+    }
+    return update;
+}
+
+void AERenderListUpdateApply(AERenderListUpdate *update) {
+    AERenderList *oldList = *update->slot;
+    *update->slot = update->list;
+    update->list = oldList;
+}
+
+void AERenderListUpdateFinish(AERenderListUpdate *update, AERenderListReleaseCallback release, void *userInfo) {
+    // The render thread has moved on to the new list, so the old one, and the channels dropped from it, are unreachable
+    free(update->list);
+    for ( int i=0; i<update->releasingCount; i++ ) {
+        release(update->releasing[i], userInfo);
+    }
+    free(update);
+}
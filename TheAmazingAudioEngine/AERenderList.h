@@ -0,0 +1,142 @@
+//
+//  AERenderList.h
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef AERenderList_h
+#define AERenderList_h
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Render list
+ *
+ *  An immutable snapshot of a group's channels, used for native group mixing. The main thread
+ *  builds a new one whenever the group's membership changes, and an AERenderListUpdate swaps it
+ *  in with a single pointer assignment on the realtime thread, so the audio thread never sees
+ *  the channel array mid-change and never waits on the main thread. 'parallelChannels' is
+ *  scratch space for the audio thread, with room for every channel, for gathering subgroups to
+ *  render in parallel.
+ *
+ *  Channels are opaque here; AEAudioController stores its channel records.
+ */
+typedef struct {
+    int    count;
+    void **parallelChannels;
+    void  *channels[];
+} AERenderList;
+
+/*!
+ * Predicate for channels that must render after the others
+ *
+ * @param channel The channel
+ * @return Whether the channel goes at the end of the list
+ */
+typedef bool (*AERenderListLastPredicate)(void *channel);
+
+/*!
+ * Callback to release a channel
+ *
+ * @param channel   The channel
+ * @param userInfo  The user info given to AERenderListUpdateFinish
+ */
+typedef void (*AERenderListReleaseCallback)(void *channel, void *userInfo);
+
+/*!
+ * Create a render list
+ *
+ *  Lists the given channels in order, skipping NULL entries, except that channels matching
+ *  'isLast' go after all the others, also in order. AEAudioController uses this to put aux
+ *  buses after every channel that can send to them.
+ *
+ *  Allocates memory, so don't call on the render thread. Free with free().
+ *
+ * @param channels  The group's channels; may contain NULL entries
+ * @param count     Number of entries in 'channels'
+ * @param isLast    Predicate for channels to put last, or NULL
+ * @return The new list, or NULL if memory couldn't be allocated
+ */
+AERenderList *AERenderListCreate(void * const *channels, int count, AERenderListLastPredicate isLast);
+
+/*!
+ * Render list update
+ *
+ *  Publishes a new render list and releases the channels it drops, once the render thread can
+ *  no longer reach them:
+ *
+ *  @code
+ *  AERenderListUpdate *update = AERenderListUpdateCreate(&group->renderList, list, removedChannels, count);
+ *  [audioController performAsynchronousMessageExchangeWithBlock:^{
+ *      AERenderListUpdateApply(update);
+ *  } responseBlock:^{
+ *      AERenderListUpdateFinish(update, releaseChannel, userInfo);
+ *  }];
+ *  @endcode
+ *
+ *  Updates must be applied in the order they were created, and finished in the order they were
+ *  applied, as a message queue does.
+ */
+typedef struct _AERenderListUpdate AERenderListUpdate;
+
+/*!
+ * Create an update
+ *
+ *  Allocates memory, so don't call on the render thread.
+ *
+ * @param slot      Where the render thread finds the list
+ * @param list      The new list, or NULL to stop rendering from the slot
+ * @param releasing Channels to release once the render thread has moved on; NULL entries are skipped
+ * @param count     Number of entries in 'releasing'
+ * @return The update, or NULL if memory couldn't be allocated
+ */
+AERenderListUpdate *AERenderListUpdateCreate(AERenderList **slot, AERenderList *list, void * const *releasing, int count);
+
+/*!
+ * Apply an update
+ *
+ *  Call on the render thread, at the start of a render cycle. Puts the new list in the slot,
+ *  keeping the old one for AERenderListUpdateFinish to free.
+ *
+ * @param update The update
+ */
+void AERenderListUpdateApply(AERenderListUpdate *update);
+
+/*!
+ * Finish an update
+ *
+ *  Call on the main thread once the update has been applied. Frees the old list, releases the
+ *  channels in the order they were given, and frees the update.
+ *
+ * @param update    The update
+ * @param release   Callback to release each channel
+ * @param userInfo  User info for the callback
+ */
+void AERenderListUpdateFinish(AERenderListUpdate *update, AERenderListReleaseCallback release, void *userInfo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
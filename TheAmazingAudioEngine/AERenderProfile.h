@@ -0,0 +1,210 @@
+//
+//  AERenderProfile.h
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __OBJC__
+#import <Foundation/Foundation.h>
+#endif
+#include <stdbool.h>
+#include <stdint.h>
+
+/*!
+ * Render profile node types
+ */
+typedef enum {
+    AERenderProfileNodeOutput,      //!< The whole output render cycle
+    AERenderProfileNodeInput,       //!< Servicing audio input
+    AERenderProfileNodeGroup,       //!< A channel group, including everything within it
+    AERenderProfileNodeChannel,     //!< A channel, including its filters and receivers
+    AERenderProfileNodeFilter,      //!< A filter, not counting the audio it pulls from upstream
+    AERenderProfileNodeReceiver     //!< An audio receiver
+} AERenderProfileNodeType;
+
+/*!
+ * Render timing accumulator
+ *
+ *  Gathers the render durations of one node. It's updated on the render thread with
+ *  AERenderProfileAccumulatorAdd, using atomic operations rather than locks, and
+ *  collected on the main thread by AERenderProfile. Zero-initialise before use.
+ */
+typedef struct {
+    volatile uint64_t count;
+    volatile uint64_t totalTicks;
+    volatile uint64_t minimumTicks;     //!< Zero if nothing has been recorded since the last collection
+    volatile uint64_t maximumTicks;
+    volatile uint64_t deadlineMisses;
+    uint64_t          reportedCount;    //!< Main thread only, as of the last collection
+    uint64_t          reportedTotalTicks;
+    uint64_t          reportedDeadlineMisses;
+} AERenderProfileAccumulator;
+
+/*!
+ * Record one render
+ *
+ *  Safe to call on the audio thread.
+ *
+ * @param accumulator    The accumulator
+ * @param ticks          Duration of the render, in host ticks
+ * @param missedDeadline Whether the render finished after the render cycle's deadline
+ */
+void AERenderProfileAccumulatorAdd(AERenderProfileAccumulator *accumulator, uint64_t ticks, bool missedDeadline);
+
+/*!
+ * Histogram resolution, in buckets per buffer duration
+ */
+#define kAERenderLoadHistogramBucketsPerBuffer 256
+
+/*!
+ * Number of histogram buckets; loads of twice the buffer duration or more share the last
+ */
+#define kAERenderLoadHistogramBuckets (2 * kAERenderLoadHistogramBucketsPerBuffer + 1)
+
+/*!
+ * Render load histogram
+ *
+ *  Counts render cycles by how much of the buffer duration they took. It's updated on the
+ *  render thread with AERenderLoadHistogramAdd, using atomic operations rather than locks,
+ *  and collected on the main thread with AERenderLoadHistogramCollect. Zero-initialise
+ *  before use.
+ */
+typedef struct {
+    volatile uint64_t buckets[kAERenderLoadHistogramBuckets];
+    volatile uint64_t maximumLoad;                              //!< In 1/65536ths of the buffer duration
+    uint64_t          reportedBuckets[kAERenderLoadHistogramBuckets]; //!< Main thread only, as of the last collection
+} AERenderLoadHistogram;
+
+/*!
+ * Render load statistics
+ *
+ *  Loads are the fraction of the buffer duration a render cycle took: above 1.0, the
+ *  cycle was over budget. Percentiles are rounded up to the histogram's resolution.
+ */
+typedef struct {
+    uint64_t renderCount;       //!< Number of render cycles
+    double   medianLoad;        //!< 50th percentile load
+    double   p99Load;           //!< 99th percentile load
+    double   p999Load;          //!< 99.9th percentile load
+    double   maximumLoad;       //!< Highest load
+    uint64_t overBudgetCount;   //!< Number of cycles that took longer than the buffer duration
+    uint64_t xrunCount;         //!< Number of discontinuities in the output timeline
+    uint64_t droppedFrames;     //!< Number of frames skipped over by those discontinuities
+} AERenderLoadStatistics;
+
+/*!
+ * Record one render cycle
+ *
+ *  Safe to call on the audio thread.
+ *
+ * @param histogram   The histogram
+ * @param ticks       Duration of the render, in host ticks
+ * @param budgetTicks The buffer duration, in host ticks
+ */
+void AERenderLoadHistogramAdd(AERenderLoadHistogram *histogram, uint64_t ticks, uint64_t budgetTicks);
+
+/*!
+ * Collect the render cycles recorded since the last collection
+ *
+ *  Fills in all but the xrun fields of the statistics. Call on the main thread.
+ *
+ * @param histogram  The histogram
+ * @param statistics On output, the load statistics
+ */
+void AERenderLoadHistogramCollect(AERenderLoadHistogram *histogram, AERenderLoadStatistics *statistics);
+
+#ifdef __OBJC__
+
+/*!
+ * Render profile
+ *
+ *  Render timings for one node of the audio controller's render tree since the previous
+ *  profile was taken, with the nodes beneath it as children. Obtain one from AEAudioController's
+ *  @link AEAudioController::renderProfile renderProfile @endlink method.
+ */
+@interface AERenderProfile : NSObject
+
+/*!
+ * Initialise, collecting from an accumulator
+ *
+ *  Takes the renders recorded since the accumulator was last collected. Call on the
+ *  main thread.
+ *
+ * @param type        The node type
+ * @param object      The object the node represents, if any
+ * @param accumulator The node's accumulator
+ * @param children    Profiles of the nodes beneath this one
+ */
+- (id)initWithType:(AERenderProfileNodeType)type object:(id)object accumulator:(AERenderProfileAccumulator*)accumulator children:(NSArray*)children;
+
+/*!
+ * The node type
+ */
+@property (nonatomic, readonly) AERenderProfileNodeType type;
+
+/*!
+ * The object the node represents
+ *
+ *  The channel, filter or receiver; for groups, an NSValue containing the AEChannelGroupRef.
+ *  Nil for the output and input nodes.
+ */
+@property (nonatomic, readonly) id object;
+
+/*!
+ * Number of renders
+ */
+@property (nonatomic, readonly) NSUInteger renderCount;
+
+/*!
+ * Shortest render duration, in seconds
+ */
+@property (nonatomic, readonly) NSTimeInterval minimumDuration;
+
+/*!
+ * Longest render duration, in seconds
+ */
+@property (nonatomic, readonly) NSTimeInterval maximumDuration;
+
+/*!
+ * Mean render duration, in seconds
+ */
+@property (nonatomic, readonly) NSTimeInterval meanDuration;
+
+/*!
+ * Number of renders that finished after their render cycle's deadline
+ */
+@property (nonatomic, readonly) NSUInteger deadlineMisses;
+
+/*!
+ * Profiles of the nodes beneath this one, in render order
+ */
+@property (nonatomic, readonly) NSArray *children;
+
+@end
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,143 @@
+//
+//  AERenderProfile.m
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#import "AERenderProfile.h"
+#import "AEUtilities.h"
+
+void AERenderProfileAccumulatorAdd(AERenderProfileAccumulator *accumulator, uint64_t ticks, bool missedDeadline) {
+    // The main thread resets the extremes as it collects them, so update those with compare-and-swap
+    uint64_t minimum = __atomic_load_n(&accumulator->minimumTicks, __ATOMIC_RELAXED);
+    while ( (minimum == 0 || ticks < minimum)
+                && !__atomic_compare_exchange_n(&accumulator->minimumTicks, &minimum, ticks, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED) );
+
+    uint64_t maximum = __atomic_load_n(&accumulator->maximumTicks, __ATOMIC_RELAXED);
+    while ( ticks > maximum
+                && !__atomic_compare_exchange_n(&accumulator->maximumTicks, &maximum, ticks, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED) );
+
+    __atomic_fetch_add(&accumulator->totalTicks, ticks, __ATOMIC_RELAXED);
+    if ( missedDeadline ) {
+        __atomic_fetch_add(&accumulator->deadlineMisses, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&accumulator->count, 1, __ATOMIC_RELEASE);
+}
+
+void AERenderLoadHistogramAdd(AERenderLoadHistogram *histogram, uint64_t ticks, uint64_t budgetTicks) {
+    if ( !budgetTicks ) return;
+
+    uint64_t bucket = (ticks * kAERenderLoadHistogramBucketsPerBuffer) / budgetTicks;
+    __atomic_fetch_add(&histogram->buckets[bucket < kAERenderLoadHistogramBuckets ? bucket : kAERenderLoadHistogramBuckets-1], 1, __ATOMIC_RELAXED);
+
+    uint64_t load = (ticks << 16) / budgetTicks;
+    uint64_t maximum = __atomic_load_n(&histogram->maximumLoad, __ATOMIC_RELAXED);
+    while ( load > maximum
+                && !__atomic_compare_exchange_n(&histogram->maximumLoad, &maximum, load, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED) );
+}
+
+static double percentileLoad(const uint64_t *counts, uint64_t total, double percentile, double maximumLoad) {
+    uint64_t target = (uint64_t)ceil(percentile * (double)total);
+    if ( target == 0 ) target = 1;
+
+    uint64_t cumulative = 0;
+    for ( int i=0; i<kAERenderLoadHistogramBuckets; i++ ) {
+        cumulative += counts[i];
+        if ( cumulative >= target ) {
+            // Report the top of the bucket, except for the open-ended last one
+            return i == kAERenderLoadHistogramBuckets-1 ? maximumLoad : MIN(maximumLoad, (double)(i+1) / kAERenderLoadHistogramBucketsPerBuffer);
+        }
+    }
+    return maximumLoad;
+}
+
+void AERenderLoadHistogramCollect(AERenderLoadHistogram *histogram, AERenderLoadStatistics *statistics) {
+    uint64_t counts[kAERenderLoadHistogramBuckets];
+    uint64_t total = 0;
+    uint64_t overBudget = 0;
+    for ( int i=0; i<kAERenderLoadHistogramBuckets; i++ ) {
+        uint64_t count = __atomic_load_n(&histogram->buckets[i], __ATOMIC_RELAXED);
+        counts[i] = count - histogram->reportedBuckets[i];
+        histogram->reportedBuckets[i] = count;
+        total += counts[i];
+        if ( i >= kAERenderLoadHistogramBucketsPerBuffer ) overBudget += counts[i];
+    }
+    double maximumLoad = (double)__atomic_exchange_n(&histogram->maximumLoad, 0, __ATOMIC_RELAXED) / 65536.0;
+
+    statistics->renderCount = total;
+    statistics->overBudgetCount = overBudget;
+    statistics->maximumLoad = total ? maximumLoad : 0.0;
+    statistics->medianLoad = total ? percentileLoad(counts, total, 0.5, maximumLoad) : 0.0;
+    statistics->p99Load = total ? percentileLoad(counts, total, 0.99, maximumLoad) : 0.0;
+    statistics->p999Load = total ? percentileLoad(counts, total, 0.999, maximumLoad) : 0.0;
+}
+
+@implementation AERenderProfile
+
+- (id)initWithType:(AERenderProfileNodeType)type object:(id)object accumulator:(AERenderProfileAccumulator*)accumulator children:(NSArray*)children {
+    if ( !(self = [super init]) ) return nil;
+
+    _type = type;
+    _object = object;
+    _children = children ? children : @[];
+
+    uint64_t count = __atomic_load_n(&accumulator->count, __ATOMIC_ACQUIRE);
+    uint64_t totalTicks = __atomic_load_n(&accumulator->totalTicks, __ATOMIC_RELAXED);
+    uint64_t deadlineMisses = __atomic_load_n(&accumulator->deadlineMisses, __ATOMIC_RELAXED);
+    uint64_t minimumTicks = __atomic_exchange_n(&accumulator->minimumTicks, 0, __ATOMIC_RELAXED);
+    uint64_t maximumTicks = __atomic_exchange_n(&accumulator->maximumTicks, 0, __ATOMIC_RELAXED);
+
+    _renderCount = (NSUInteger)(count - accumulator->reportedCount);
+    _deadlineMisses = (NSUInteger)(deadlineMisses - accumulator->reportedDeadlineMisses);
+    if ( _renderCount > 0 ) {
+        _minimumDuration = AESecondsFromHostTicks(minimumTicks);
+        _maximumDuration = AESecondsFromHostTicks(maximumTicks);
+        _meanDuration = AESecondsFromHostTicks(totalTicks - accumulator->reportedTotalTicks) / (double)_renderCount;
+    }
+
+    accumulator->reportedCount = count;
+    accumulator->reportedTotalTicks = totalTicks;
+    accumulator->reportedDeadlineMisses = deadlineMisses;
+
+    return self;
+}
+
+- (NSString*)description {
+    NSMutableString *description = [NSMutableString string];
+    [self appendDescriptionTo:description indent:0];
+    return description;
+}
+
+- (void)appendDescriptionTo:(NSMutableString*)description indent:(int)indent {
+    static NSString * const kTypeNames[] = { @"Output", @"Input", @"Group", @"Channel", @"Filter", @"Receiver" };
+
+    [description appendFormat:@"%*s%@", indent * 2, "", kTypeNames[_type]];
+    if ( _object && _type != AERenderProfileNodeGroup ) {
+        [description appendFormat:@" <%@: %p>", NSStringFromClass([_object class]), _object];
+    }
+    [description appendFormat:@": %lu renders, min %.1lfus, mean %.1lfus, max %.1lfus, %lu missed deadlines\n",
+         (unsigned long)_renderCount, _minimumDuration * 1.0e6, _meanDuration * 1.0e6, _maximumDuration * 1.0e6, (unsigned long)_deadlineMisses];
+
+    for ( AERenderProfile *child in _children ) {
+        [child appendDescriptionTo:description indent:indent + 1];
+    }
+}
+
+@end
@@ -0,0 +1,289 @@
+//
+//  AERenderWorkerPool.c
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "AERenderWorkerPool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <mach/thread_policy.h>
+
+#define kMaxActiveBatches 32
+
+/*!
+ * A batch of tasks; lives on the stack of the submitting thread
+ */
+typedef struct {
+    AERenderWorkerTask  task;
+    void               *context;
+    int32_t             taskCount;
+    volatile int32_t    nextTask;
+    volatile int32_t    completedTasks;
+} batch_t;
+
+/*!
+ * Slot through which a batch is published to other threads. 'users' counts threads
+ * currently looking at the batch, so the submitter can wait for them before its
+ * stack frame goes away.
+ */
+typedef struct {
+    batch_t * volatile  batch;
+    volatile int32_t    users;
+} batch_slot_t;
+
+typedef struct {
+    volatile uint64_t   tasksExecuted;
+    volatile uint64_t   busyTicks;
+    uint64_t            reportedTasksExecuted;
+    uint64_t            reportedBusyTicks;
+    uint64_t            reportTime;
+} thread_load_t;
+
+struct _AERenderWorkerPool {
+    int                 workerCount;
+    double              period;
+    pthread_t           threads[kAERenderWorkerPoolMaxWorkers];
+    semaphore_t         semaphore;
+    volatile int32_t    stop;
+    batch_slot_t        slots[kMaxActiveBatches];
+    thread_load_t       loads[kAERenderWorkerPoolMaxWorkers+1];
+    double              ticksToSeconds;
+};
+
+typedef struct {
+    AERenderWorkerPool *pool;
+    int                 index;
+} worker_start_t;
+
+static __thread AERenderWorkerPool *__currentPool = NULL;
+static __thread int __currentWorkerIndex = 0;
+
+static thread_load_t *currentThreadLoad(AERenderWorkerPool *pool) {
+    return &pool->loads[__currentPool == pool ? __currentWorkerIndex : 0];
+}
+
+static void runTask(batch_t *batch, AERenderWorkerTask task, void *context, int index, thread_load_t *load) {
+    uint64_t start = mach_absolute_time();
+    task(context, index);
+    __atomic_fetch_add(&load->busyTicks, mach_absolute_time() - start, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&load->tasksExecuted, 1, __ATOMIC_RELAXED);
+
+    // This is the last access to the batch: once all tasks are complete, the submitter may return
+    __atomic_fetch_add(&batch->completedTasks, 1, __ATOMIC_RELEASE);
+}
+
+static bool runTaskFromSlot(batch_slot_t *slot, thread_load_t *load) {
+    if ( !__atomic_load_n(&slot->batch, __ATOMIC_RELAXED) ) return false;
+
+    __atomic_fetch_add(&slot->users, 1, __ATOMIC_SEQ_CST);
+    batch_t *batch = __atomic_load_n(&slot->batch, __ATOMIC_SEQ_CST);
+    if ( !batch ) {
+        __atomic_fetch_sub(&slot->users, 1, __ATOMIC_RELEASE);
+        return false;
+    }
+
+    int32_t index = __atomic_fetch_add(&batch->nextTask, 1, __ATOMIC_ACQ_REL);
+    if ( index >= batch->taskCount ) {
+        __atomic_fetch_sub(&slot->users, 1, __ATOMIC_RELEASE);
+        return false;
+    }
+
+    // The batch can't complete until we've run this task, so it's safe to stop guarding it
+    AERenderWorkerTask task = batch->task;
+    void *context = batch->context;
+    __atomic_fetch_sub(&slot->users, 1, __ATOMIC_RELEASE);
+
+    runTask(batch, task, context, index, load);
+    return true;
+}
+
+static bool runAnyTask(AERenderWorkerPool *pool, thread_load_t *load, int startSlot) {
+    for ( int i=0; i<kMaxActiveBatches; i++ ) {
+        if ( runTaskFromSlot(&pool->slots[(startSlot + i) % kMaxActiveBatches], load) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void setTimeConstraintPolicy(double period) {
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    double ticksPerSecond = 1.0e9 * (double)timebase.denom / (double)timebase.numer;
+
+    thread_time_constraint_policy_data_t policy = {
+        .period = (uint32_t)(period * ticksPerSecond),
+        .computation = (uint32_t)(period * 0.5 * ticksPerSecond),
+        .constraint = (uint32_t)(period * ticksPerSecond),
+        .preemptible = 1
+    };
+    thread_policy_set(pthread_mach_thread_np(pthread_self()), THREAD_TIME_CONSTRAINT_POLICY, (thread_policy_t)&policy, THREAD_TIME_CONSTRAINT_POLICY_COUNT);
+}
+
+static void *workerThreadEntry(void *arg) {
+    worker_start_t start = *(worker_start_t*)arg;
+    free(arg);
+
+    AERenderWorkerPool *pool = start.pool;
+    __currentPool = pool;
+    __currentWorkerIndex = start.index;
+
+    pthread_setname_np("com.theamazingaudioengine.AERenderWorker");
+    setTimeConstraintPolicy(pool->period);
+
+    thread_load_t *load = &pool->loads[start.index];
+
+    while ( !__atomic_load_n(&pool->stop, __ATOMIC_ACQUIRE) ) {
+        semaphore_wait(pool->semaphore);
+        while ( runAnyTask(pool, load, start.index) );
+    }
+
+    return NULL;
+}
+
+AERenderWorkerPool *AERenderWorkerPoolCreate(int workerCount, double period) {
+    if ( workerCount < 0 || workerCount > kAERenderWorkerPoolMaxWorkers ) return NULL;
+
+    AERenderWorkerPool *pool = (AERenderWorkerPool*)calloc(1, sizeof(AERenderWorkerPool));
+    if ( !pool ) return NULL;
+
+    pool->period = period;
+
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    pool->ticksToSeconds = ((double)timebase.numer / (double)timebase.denom) * 1.0e-9;
+
+    uint64_t now = mach_absolute_time();
+    for ( int i=0; i<=workerCount; i++ ) {
+        pool->loads[i].reportTime = now;
+    }
+
+    if ( semaphore_create(mach_task_self(), &pool->semaphore, SYNC_POLICY_FIFO, 0) != KERN_SUCCESS ) {
+        free(pool);
+        return NULL;
+    }
+
+    for ( int i=0; i<workerCount; i++ ) {
+        worker_start_t *start = (worker_start_t*)malloc(sizeof(worker_start_t));
+        start->pool = pool;
+        start->index = i+1;
+        if ( pthread_create(&pool->threads[i], NULL, workerThreadEntry, start) != 0 ) {
+            free(start);
+            break;
+        }
+        pool->workerCount++;
+    }
+
+    return pool;
+}
+
+void AERenderWorkerPoolDestroy(AERenderWorkerPool *pool) {
+    __atomic_store_n(&pool->stop, 1, __ATOMIC_RELEASE);
+    for ( int i=0; i<pool->workerCount; i++ ) {
+        semaphore_signal(pool->semaphore);
+    }
+    for ( int i=0; i<pool->workerCount; i++ ) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    semaphore_destroy(mach_task_self(), pool->semaphore);
+    free(pool);
+}
+
+int AERenderWorkerPoolGetWorkerCount(AERenderWorkerPool *pool) {
+    return pool->workerCount;
+}
+
+void AERenderWorkerPoolRun(AERenderWorkerPool *pool, AERenderWorkerTask task, void *context, int taskCount) {
+    if ( taskCount <= 0 ) return;
+
+    thread_load_t *load = currentThreadLoad(pool);
+
+    batch_t batch = { .task = task, .context = context, .taskCount = taskCount, .nextTask = 0, .completedTasks = 0 };
+
+    batch_slot_t *slot = NULL;
+    if ( taskCount > 1 && pool->workerCount > 0 ) {
+        for ( int i=0; i<kMaxActiveBatches; i++ ) {
+            batch_t *expected = NULL;
+            if ( __atomic_compare_exchange_n(&pool->slots[i].batch, &expected, &batch, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED) ) {
+                slot = &pool->slots[i];
+                break;
+            }
+        }
+    }
+
+    if ( !slot ) {
+        // Nothing to gain from the pool (or it's saturated with batches): run serially
+        for ( int i=0; i<taskCount; i++ ) {
+            runTask(&batch, task, context, i, load);
+        }
+        return;
+    }
+
+    // Wake enough workers to take the rest of the batch
+    int wakeCount = taskCount-1 < pool->workerCount ? taskCount-1 : pool->workerCount;
+    for ( int i=0; i<wakeCount; i++ ) {
+        semaphore_signal(pool->semaphore);
+    }
+
+    // Work through our own batch
+    while ( 1 ) {
+        int32_t index = __atomic_fetch_add(&batch.nextTask, 1, __ATOMIC_ACQ_REL);
+        if ( index >= taskCount ) break;
+        runTask(&batch, task, context, index, load);
+    }
+
+    // Help with other batches until the workers have finished ours
+    int startSlot = (int)(slot - pool->slots) + 1;
+    while ( __atomic_load_n(&batch.completedTasks, __ATOMIC_ACQUIRE) < taskCount ) {
+        runAnyTask(pool, load, startSlot);
+    }
+
+    // Unpublish, then wait until nobody is looking at the batch any more
+    __atomic_store_n(&slot->batch, NULL, __ATOMIC_SEQ_CST);
+    while ( __atomic_load_n(&slot->users, __ATOMIC_SEQ_CST) > 0 );
+}
+
+int AERenderWorkerPoolGetLoad(AERenderWorkerPool *pool, AERenderWorkerLoad *loads, int count) {
+    uint64_t now = mach_absolute_time();
+    int filled = 0;
+    for ( int i=0; i<=pool->workerCount && filled<count; i++, filled++ ) {
+        thread_load_t *load = &pool->loads[i];
+        uint64_t tasksExecuted = __atomic_load_n(&load->tasksExecuted, __ATOMIC_RELAXED);
+        uint64_t busyTicks = __atomic_load_n(&load->busyTicks, __ATOMIC_RELAXED);
+        uint64_t elapsedTicks = now - load->reportTime;
+
+        loads[i].tasksExecuted = tasksExecuted - load->reportedTasksExecuted;
+        loads[i].busyTime = (double)(busyTicks - load->reportedBusyTicks) * pool->ticksToSeconds;
+        loads[i].load = elapsedTicks ? (double)(busyTicks - load->reportedBusyTicks) / (double)elapsedTicks : 0.0;
+
+        load->reportedTasksExecuted = tasksExecuted;
+        load->reportedBusyTicks = busyTicks;
+        load->reportTime = now;
+    }
+    return filled;
+}
+
+bool AERenderWorkerPoolCurrentThreadIsWorker(void) {
+    return __currentPool != NULL;
+}
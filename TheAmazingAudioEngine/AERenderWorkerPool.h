@@ -0,0 +1,137 @@
+//
+//  AERenderWorkerPool.h
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef AERenderWorkerPool_h
+#define AERenderWorkerPool_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Maximum number of worker threads in a pool
+ */
+#define kAERenderWorkerPoolMaxWorkers 16
+
+/*!
+ * Task function
+ *
+ *  Called once for each index in a batch, on any thread in the pool or on the thread
+ *  that submitted the batch.
+ *
+ * @param context   The context passed to AERenderWorkerPoolRun
+ * @param index     The task index, from 0 to taskCount-1
+ */
+typedef void (*AERenderWorkerTask)(void *context, int index);
+
+/*!
+ * Load for one thread since the last call to AERenderWorkerPoolGetLoad
+ */
+typedef struct {
+    uint64_t tasksExecuted;     //!< Number of tasks run
+    double   busyTime;          //!< Seconds spent running tasks
+    double   load;              //!< Proportion of elapsed time spent running tasks, 0-1
+} AERenderWorkerLoad;
+
+/*!
+ * Render worker pool
+ *
+ *  A fixed set of time-constrained threads that help the audio thread run independent
+ *  render tasks in parallel. A batch of tasks is submitted with AERenderWorkerPoolRun,
+ *  which wakes idle workers and then runs tasks itself until the batch is done; workers
+ *  claim tasks from any active batch, so batches submitted from within a task (nested
+ *  fork/join) are spread across the pool as well, and a thread waiting on its own batch
+ *  steals from the others rather than sitting idle.
+ *
+ *  Running a batch doesn't allocate memory, take locks or make Objective-C calls, so it is
+ *  safe on the audio thread.
+ */
+typedef struct _AERenderWorkerPool AERenderWorkerPool;
+
+/*!
+ * Create a pool
+ *
+ * @param workerCount   Number of worker threads, not counting the audio thread, up to kAERenderWorkerPoolMaxWorkers
+ * @param period        Nominal render period in seconds, used to set the threads' time constraint
+ * @return The new pool, or NULL on error
+ */
+AERenderWorkerPool *AERenderWorkerPoolCreate(int workerCount, double period);
+
+/*!
+ * Destroy a pool
+ *
+ *  Stops and joins the worker threads. Don't call this while a batch is running.
+ *
+ * @param pool The pool
+ */
+void AERenderWorkerPoolDestroy(AERenderWorkerPool *pool);
+
+/*!
+ * Get the number of worker threads
+ *
+ * @param pool The pool
+ * @return The number of worker threads
+ */
+int AERenderWorkerPoolGetWorkerCount(AERenderWorkerPool *pool);
+
+/*!
+ * Run a batch of tasks in parallel
+ *
+ *  Calls task once for each index from 0 to taskCount-1, and returns once all have
+ *  finished. The calling thread takes part. Tasks may themselves call this function.
+ *
+ * @param pool      The pool
+ * @param task      The task function
+ * @param context   Context to pass to the task function
+ * @param taskCount Number of tasks
+ */
+void AERenderWorkerPoolRun(AERenderWorkerPool *pool, AERenderWorkerTask task, void *context, int taskCount);
+
+/*!
+ * Get per-thread load since this function was last called
+ *
+ *  The first entry describes tasks run by threads outside the pool (the audio thread),
+ *  followed by one entry per worker thread.
+ *
+ * @param pool      The pool
+ * @param loads     Array to fill
+ * @param count     Number of entries available in loads
+ * @return Number of entries filled
+ */
+int AERenderWorkerPoolGetLoad(AERenderWorkerPool *pool, AERenderWorkerLoad *loads, int count);
+
+/*!
+ * Determine whether the current thread is a render worker
+ *
+ * @return Whether the current thread belongs to a render worker pool
+ */
+bool AERenderWorkerPoolCurrentThreadIsWorker(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
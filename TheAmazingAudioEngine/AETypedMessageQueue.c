@@ -0,0 +1,122 @@
+//
+//  AETypedMessageQueue.c
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "AETypedMessageQueue.h"
+#include "TPCircularBuffer.h"
+#include "TPMultiProducerCircularBuffer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/*!
+ * Message record; each is the same size, and stays 16-byte aligned within the buffer
+ */
+typedef struct {
+    AETypedMessageHandler   handler;
+    int32_t                 payloadLength;
+    char                    payload[kAETypedMessageMaxPayloadLength] __attribute__((aligned(16)));
+} typed_message_t;
+
+struct _AETypedMessageQueue {
+    TPMultiProducerCircularBuffer realtimeThreadMessageBuffer;
+    TPMultiProducerCircularBuffer mainThreadMessageBuffer;
+};
+
+AETypedMessageQueue *AETypedMessageQueueCreate(int32_t bufferLength) {
+    AETypedMessageQueue *queue = (AETypedMessageQueue*)calloc(1, sizeof(AETypedMessageQueue));
+    if ( !queue ) return NULL;
+    
+    if ( !TPMultiProducerCircularBufferInit(&queue->realtimeThreadMessageBuffer, bufferLength) ) {
+        free(queue);
+        return NULL;
+    }
+    
+    if ( !TPMultiProducerCircularBufferInit(&queue->mainThreadMessageBuffer, bufferLength) ) {
+        TPMultiProducerCircularBufferCleanup(&queue->realtimeThreadMessageBuffer);
+        free(queue);
+        return NULL;
+    }
+    
+    return queue;
+}
+
+void AETypedMessageQueueDestroy(AETypedMessageQueue *queue) {
+    TPMultiProducerCircularBufferCleanup(&queue->realtimeThreadMessageBuffer);
+    TPMultiProducerCircularBufferCleanup(&queue->mainThreadMessageBuffer);
+    free(queue);
+}
+
+static void fillMessage(typed_message_t *message, AETypedMessageHandler handler, const void *payload, int payloadLength) {
+    message->handler = handler;
+    message->payloadLength = payloadLength;
+    if ( payloadLength > 0 ) {
+        memcpy(message->payload, payload, payloadLength);
+    }
+}
+
+static bool sendMessage(TPMultiProducerCircularBuffer *buffer, AETypedMessageHandler handler, const void *payload, int payloadLength) {
+    assert(handler && payloadLength >= 0 && payloadLength <= kAETypedMessageMaxPayloadLength);
+    
+    typed_message_t *message = (typed_message_t*)TPMultiProducerCircularBufferReserve(buffer, sizeof(typed_message_t));
+    if ( !message ) return false;
+    
+    fillMessage(message, handler, payload, payloadLength);
+    TPMultiProducerCircularBufferCommit(buffer, message, sizeof(typed_message_t));
+    return true;
+}
+
+bool AETypedMessageQueueSendToRealtimeThread(AETypedMessageQueue *queue, AETypedMessageHandler handler, const void *payload, int payloadLength) {
+    return sendMessage(&queue->realtimeThreadMessageBuffer, handler, payload, payloadLength);
+}
+
+bool AETypedMessageQueueSendToMainThread(AETypedMessageQueue *queue, AETypedMessageHandler handler, const void *payload, int payloadLength) {
+    return sendMessage(&queue->mainThreadMessageBuffer, handler, payload, payloadLength);
+}
+
+static int processMessages(TPCircularBuffer *buffer) {
+    // Only process the messages present to begin with, then release them all at once
+    int32_t availableBytes;
+    typed_message_t *message = (typed_message_t*)TPCircularBufferTail(buffer, &availableBytes);
+    if ( !message ) return 0;
+    
+    int count = availableBytes / sizeof(typed_message_t);
+    for ( int i=0; i<count; i++ ) {
+        message[i].handler(message[i].payloadLength > 0 ? message[i].payload : NULL, message[i].payloadLength);
+    }
+    
+    TPCircularBufferConsume(buffer, count * (int32_t)sizeof(typed_message_t));
+    return count;
+}
+
+int AETypedMessageQueueProcessOnRealtimeThread(AETypedMessageQueue *queue) {
+    return processMessages(&queue->realtimeThreadMessageBuffer.buffer);
+}
+
+int AETypedMessageQueueProcessOnMainThread(AETypedMessageQueue *queue) {
+    return processMessages(&queue->mainThreadMessageBuffer.buffer);
+}
+
+bool AETypedMessageQueueHasMainThreadMessages(AETypedMessageQueue *queue) {
+    int32_t availableBytes;
+    return TPCircularBufferTail(&queue->mainThreadMessageBuffer.buffer, &availableBytes) != NULL;
+}
@@ -0,0 +1,151 @@
+//
+//  AETypedMessageQueue.h
+//  The Amazing Audio Engine
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef AETypedMessageQueue_h
+#define AETypedMessageQueue_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Largest payload that can be sent with a typed message, in bytes
+ */
+#define kAETypedMessageMaxPayloadLength 64
+
+/*!
+ * Typed message handler
+ *
+ *  Called on the receiving thread with the payload that was sent. The payload is only
+ *  valid for the duration of the call.
+ *
+ * @param payload           The payload, copied from the sender
+ * @param payloadLength     Length of the payload in bytes
+ */
+typedef void (*AETypedMessageHandler)(const void *payload, int payloadLength);
+
+/*!
+ * Typed message queue
+ *
+ *  A two-way queue of messages between a realtime thread and other threads, for C and
+ *  C++ code. Each message is a handler function pointer plus a payload of up to
+ *  kAETypedMessageMaxPayloadLength bytes, copied by value into a fixed-size record in a
+ *  circular buffer. Sending and receiving never allocate memory, and there are no
+ *  Objective-C blocks involved.
+ *
+ *  Receiving is wait-free. Sending reserves space lock-free, with a compare-and-swap, but
+ *  isn't wait-free: messages are published in the order they were reserved, so a sender
+ *  whose reservation follows one another thread hasn't yet committed spins, then yields,
+ *  until it has. The wait is bounded by the time another sender takes to copy in one
+ *  message, unless that sender has been preempted; so for the realtime thread, prefer
+ *  sharing a direction only with senders of the same priority, such as render workers.
+ *
+ *  Any number of threads may send messages in either direction at once, such as the
+ *  realtime thread and the render worker threads rendering in parallel with it. Only one
+ *  thread at a time may process each direction.
+ *
+ *  This has no Foundation dependency, so it can be used on Linux. AEMessageQueue contains
+ *  one of these, and processes it alongside its own messages.
+ */
+typedef struct _AETypedMessageQueue AETypedMessageQueue;
+
+/*!
+ * Create a typed message queue
+ *
+ * @param bufferLength Length of each direction's buffer, in bytes
+ * @return The new queue, or NULL on error
+ */
+AETypedMessageQueue *AETypedMessageQueueCreate(int32_t bufferLength);
+
+/*!
+ * Destroy a typed message queue
+ *
+ *  Pending messages are discarded.
+ *
+ * @param queue The queue
+ */
+void AETypedMessageQueueDestroy(AETypedMessageQueue *queue);
+
+/*!
+ * Send a message to the realtime thread
+ *
+ *  May be called from any thread, including several at once.
+ *
+ * @param queue         The queue
+ * @param handler       Function to call on the realtime thread
+ * @param payload       Payload to copy, or NULL
+ * @param payloadLength Length of payload in bytes, up to kAETypedMessageMaxPayloadLength
+ * @return true on success, false if the queue is full
+ */
+bool AETypedMessageQueueSendToRealtimeThread(AETypedMessageQueue *queue, AETypedMessageHandler handler, const void *payload, int payloadLength);
+
+/*!
+ * Send a message to the main thread
+ *
+ *  May be called from the realtime thread, or any other thread, including several at once.
+ *
+ * @param queue         The queue
+ * @param handler       Function to call on the main thread
+ * @param payload       Payload to copy, or NULL
+ * @param payloadLength Length of payload in bytes, up to kAETypedMessageMaxPayloadLength
+ * @return true on success, false if the queue is full
+ */
+bool AETypedMessageQueueSendToMainThread(AETypedMessageQueue *queue, AETypedMessageHandler handler, const void *payload, int payloadLength);
+
+/*!
+ * Process messages sent to the realtime thread
+ *
+ *  Call this periodically from the realtime thread. Messages sent while this is
+ *  running are left for the next call.
+ *
+ * @param queue The queue
+ * @return The number of messages processed
+ */
+int AETypedMessageQueueProcessOnRealtimeThread(AETypedMessageQueue *queue);
+
+/*!
+ * Process messages sent to the main thread
+ *
+ *  Call this from the main thread, or whichever single thread handles messages from the realtime thread.
+ *
+ * @param queue The queue
+ * @return The number of messages processed
+ */
+int AETypedMessageQueueProcessOnMainThread(AETypedMessageQueue *queue);
+
+/*!
+ * Determine whether there are messages waiting for the main thread
+ *
+ * @param queue The queue
+ * @return Whether there are messages waiting
+ */
+bool AETypedMessageQueueHasMainThreadMessages(AETypedMessageQueue *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
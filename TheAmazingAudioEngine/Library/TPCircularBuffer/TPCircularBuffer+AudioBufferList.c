@@ -43,9 +43,23 @@ static inline long min(long a, long b) {
     return a > b ? b : a;
 }
 
-AudioBufferList *TPCircularBufferPrepareEmptyAudioBufferList(TPCircularBuffer *buffer, int numberOfBuffers, int bytesPerBuffer, const AudioTimeStamp *inTimestamp) {
-    int32_t availableBytes;
-    TPCircularBufferABLBlockHeader *block = (TPCircularBufferABLBlockHeader*)TPCircularBufferHead(buffer, &availableBytes);
+static inline long max(long a, long b) {
+    return a > b ? a : b;
+}
+
+static inline UInt32 loadAudioBytes(TPCircularBuffer *buffer, volatile uint32_t *value) {
+    return buffer->atomic ? __atomic_load_n(value, __ATOMIC_ACQUIRE) : *value;
+}
+
+static inline void storeAudioBytes(TPCircularBuffer *buffer, volatile uint32_t *value, UInt32 newValue) {
+    if ( buffer->atomic ) {
+        __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+    } else {
+        *value = newValue;
+    }
+}
+
+static AudioBufferList *prepareBlock(TPCircularBufferABLBlockHeader *block, int32_t availableBytes, int numberOfBuffers, int bytesPerBuffer, const AudioTimeStamp *inTimestamp) {
     if ( !block || availableBytes < sizeof(TPCircularBufferABLBlockHeader)+((numberOfBuffers-1)*sizeof(AudioBuffer))+(numberOfBuffers*bytesPerBuffer) ) return NULL;
     
     assert(!((unsigned long)block & 0xF) /* Beware unaligned accesses */);
@@ -60,6 +74,8 @@ AudioBufferList *TPCircularBufferPrepareEmptyAudioBufferList(TPCircularBuffer *b
     block->bufferList.mNumberBuffers = numberOfBuffers;
     
     char *dataPtr = (char*)&block->bufferList + sizeof(AudioBufferList)+((numberOfBuffers-1)*sizeof(AudioBuffer));
+    block->dataOffset = (UInt32)(align16byte((long)dataPtr) - (long)block);
+    block->dataStride = (UInt32)align16byte(bytesPerBuffer);
     for ( int i=0; i<numberOfBuffers; i++ ) {
         // Find the next 16-byte aligned memory area
         dataPtr = (char*)align16byte((long)dataPtr);
@@ -84,7 +100,55 @@ AudioBufferList *TPCircularBufferPrepareEmptyAudioBufferList(TPCircularBuffer *b
     return &block->bufferList;
 }
 
+static int32_t blockLength(int numberOfBuffers, int bytesPerBuffer) {
+    // Same layout as prepareBlock; blocks always start 16-byte aligned
+    long length = offsetof(TPCircularBufferABLBlockHeader, bufferList) + sizeof(AudioBufferList) + ((numberOfBuffers-1)*sizeof(AudioBuffer));
+    for ( int i=0; i<numberOfBuffers; i++ ) {
+        length = align16byte(length) + bytesPerBuffer;
+    }
+    return (int32_t)align16byte(length);
+}
+
+static void produceBlock(TPCircularBuffer *buffer, TPCircularBufferABLBlockHeader *block) {
+    // Index the block within the running count of queued audio, noting whether it follows on from the last one
+    UInt32 audioBytes = block->bufferList.mBuffers[0].mDataByteSize;
+    block->audioBytePosition = buffer->audioBytesProduced;
+    block->blockNumber = buffer->blocksProduced;
+    _TPCircularBufferBlockEnds(buffer)[block->blockNumber % buffer->blockEndsCapacity] = _TPCircularBufferAdvanceIndex(buffer, buffer->head, block->totalLength);
+    bool contiguous = buffer->audioBytesPerFrame
+                        && (block->timestamp.mFlags & kAudioTimeStampSampleTimeValid)
+                        && block->timestamp.mSampleTime == buffer->nextSampleTime;
+    if ( buffer->audioBytesPerFrame ) {
+        buffer->nextSampleTime = block->timestamp.mSampleTime + (audioBytes / buffer->audioBytesPerFrame);
+    }
+    
+    TPCircularBufferProduce(buffer, block->totalLength);
+    
+    if ( !contiguous ) {
+        storeAudioBytes(buffer, &buffer->audioBytesAtDiscontinuity, block->audioBytePosition);
+    }
+    storeAudioBytes(buffer, &buffer->audioBytesProduced, block->audioBytePosition + audioBytes);
+    storeAudioBytes(buffer, &buffer->blocksProduced, block->blockNumber + 1);
+}
+
+static bool evictOldestBlock(TPCircularBuffer *buffer) {
+    // Only discard the block at the tail if the consumer hasn't claimed it; if the consumer
+    // claims or consumes it meanwhile, the tail moves and the exchange fails
+    int32_t tail = __atomic_load_n(&buffer->tail, __ATOMIC_ACQUIRE);
+    if ( (tail & kTPCircularBufferTailClaimed) || tail == buffer->head ) return false;
+    TPCircularBufferABLBlockHeader *block = (TPCircularBufferABLBlockHeader*)_TPCircularBufferPointer(buffer, tail);
+    int32_t newTail = _TPCircularBufferAdvanceIndex(buffer, tail, block->totalLength);
+    return __atomic_compare_exchange_n(&buffer->tail, &tail, newTail, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+AudioBufferList *TPCircularBufferPrepareEmptyAudioBufferList(TPCircularBuffer *buffer, int numberOfBuffers, int bytesPerBuffer, const AudioTimeStamp *inTimestamp) {
+    int32_t availableBytes;
+    TPCircularBufferABLBlockHeader *block = (TPCircularBufferABLBlockHeader*)TPCircularBufferHead(buffer, &availableBytes);
+    return prepareBlock(block, availableBytes, numberOfBuffers, bytesPerBuffer, inTimestamp);
+}
+
 AudioBufferList *TPCircularBufferPrepareEmptyAudioBufferListWithAudioFormat(TPCircularBuffer *buffer, const AudioStreamBasicDescription *audioFormat, UInt32 frameCount, const AudioTimeStamp *timestamp) {
+    buffer->audioBytesPerFrame = audioFormat->mBytesPerFrame;
     return TPCircularBufferPrepareEmptyAudioBufferList(buffer,
                                                        (audioFormat->mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? audioFormat->mChannelsPerFrame : 1,
                                                        audioFormat->mBytesPerFrame * frameCount,
@@ -103,7 +167,7 @@ void TPCircularBufferProduceAudioBufferList(TPCircularBuffer *buffer, const Audi
         memcpy(&block->timestamp, inTimestamp, sizeof(AudioTimeStamp));
     }
     
-    UInt32 calculatedLength = (UInt32)(((char*)block->bufferList.mBuffers[block->bufferList.mNumberBuffers-1].mData + block->bufferList.mBuffers[block->bufferList.mNumberBuffers-1].mDataByteSize) - (char*)block);
+    UInt32 calculatedLength = block->dataOffset + ((block->bufferList.mNumberBuffers-1) * block->dataStride) + block->bufferList.mBuffers[block->bufferList.mNumberBuffers-1].mDataByteSize;
 
     // Make sure whole buffer (including timestamp and length value) is 16-byte aligned in length
     calculatedLength = (UInt32)align16byte(calculatedLength);
@@ -112,7 +176,7 @@ void TPCircularBufferProduceAudioBufferList(TPCircularBuffer *buffer, const Audi
     
     block->totalLength = calculatedLength;
     
-    TPCircularBufferProduce(buffer, block->totalLength);
+    produceBlock(buffer, block);
 }
 
 bool TPCircularBufferCopyAudioBufferList(TPCircularBuffer *buffer, const AudioBufferList *inBufferList, const AudioTimeStamp *inTimestamp, UInt32 frames, const AudioStreamBasicDescription *audioDescription) {
@@ -126,7 +190,22 @@ bool TPCircularBufferCopyAudioBufferList(TPCircularBuffer *buffer, const AudioBu
     
     if ( byteCount == 0 ) return true;
     
+    if ( audioDescription ) {
+        buffer->audioBytesPerFrame = audioDescription->mBytesPerFrame;
+    }
+    
     AudioBufferList *bufferList = TPCircularBufferPrepareEmptyAudioBufferList(buffer, inBufferList->mNumberBuffers, byteCount, inTimestamp);
+    if ( !bufferList && buffer->overwriteOldest ) {
+        // Make room by discarding the oldest buffer lists
+        while ( !bufferList && evictOldestBlock(buffer) ) {
+            __atomic_fetch_add(&buffer->overruns, 1, __ATOMIC_RELAXED);
+            bufferList = TPCircularBufferPrepareEmptyAudioBufferList(buffer, inBufferList->mNumberBuffers, byteCount, inTimestamp);
+        }
+        if ( !bufferList ) {
+            // The consumer has claimed the queued audio, so drop this instead
+            __atomic_fetch_add(&buffer->overruns, 1, __ATOMIC_RELAXED);
+        }
+    }
     if ( !bufferList ) return false;
     
     for ( int i=0; i<bufferList->mNumberBuffers; i++ ) {
@@ -138,6 +217,63 @@ bool TPCircularBufferCopyAudioBufferList(TPCircularBuffer *buffer, const AudioBu
     return true;
 }
 
+AudioBufferList *TPMultiProducerCircularBufferPrepareEmptyAudioBufferList(TPMultiProducerCircularBuffer *buffer, int numberOfBuffers, int bytesPerBuffer, const AudioTimeStamp *inTimestamp) {
+    int32_t length = blockLength(numberOfBuffers, bytesPerBuffer);
+    TPCircularBufferABLBlockHeader *block = (TPCircularBufferABLBlockHeader*)TPMultiProducerCircularBufferReserve(buffer, length);
+    if ( !block ) return NULL;
+    AudioBufferList *bufferList = prepareBlock(block, length, numberOfBuffers, bytesPerBuffer, inTimestamp);
+    assert(bufferList && block->totalLength == length);
+    return bufferList;
+}
+
+AudioBufferList *TPMultiProducerCircularBufferPrepareEmptyAudioBufferListWithAudioFormat(TPMultiProducerCircularBuffer *buffer, const AudioStreamBasicDescription *audioFormat, UInt32 frameCount, const AudioTimeStamp *timestamp) {
+    buffer->buffer.audioBytesPerFrame = audioFormat->mBytesPerFrame;
+    return TPMultiProducerCircularBufferPrepareEmptyAudioBufferList(buffer,
+                                                                    (audioFormat->mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? audioFormat->mChannelsPerFrame : 1,
+                                                                    audioFormat->mBytesPerFrame * frameCount,
+                                                                    timestamp);
+}
+
+void TPMultiProducerCircularBufferProduceAudioBufferList(TPMultiProducerCircularBuffer *buffer, AudioBufferList *bufferList, const AudioTimeStamp *inTimestamp) {
+    TPCircularBufferABLBlockHeader *block = (TPCircularBufferABLBlockHeader*)((char*)bufferList - offsetof(TPCircularBufferABLBlockHeader, bufferList));
+    assert(!((unsigned long)block & 0xF) /* Beware unaligned accesses */);
+    
+    if ( inTimestamp ) {
+        memcpy(&block->timestamp, inTimestamp, sizeof(AudioTimeStamp));
+    }
+    
+    // The block keeps its reserved length, as the next reservation starts straight after it
+    _TPMultiProducerCircularBufferAwaitTurn(buffer, block);
+    produceBlock(&buffer->buffer, block);
+}
+
+bool TPMultiProducerCircularBufferCopyAudioBufferList(TPMultiProducerCircularBuffer *buffer, const AudioBufferList *inBufferList, const AudioTimeStamp *inTimestamp, UInt32 frames, const AudioStreamBasicDescription *audioDescription) {
+    if ( frames == 0 ) return true;
+    
+    int byteCount = inBufferList->mBuffers[0].mDataByteSize;
+    if ( frames != kTPCircularBufferCopyAll ) {
+        byteCount = frames * audioDescription->mBytesPerFrame;
+        assert(byteCount <= inBufferList->mBuffers[0].mDataByteSize);
+    }
+    
+    if ( byteCount == 0 ) return true;
+    
+    if ( audioDescription ) {
+        buffer->buffer.audioBytesPerFrame = audioDescription->mBytesPerFrame;
+    }
+    
+    AudioBufferList *bufferList = TPMultiProducerCircularBufferPrepareEmptyAudioBufferList(buffer, inBufferList->mNumberBuffers, byteCount, inTimestamp);
+    if ( !bufferList ) return false;
+    
+    for ( int i=0; i<bufferList->mNumberBuffers; i++ ) {
+        memcpy(bufferList->mBuffers[i].mData, inBufferList->mBuffers[i].mData, byteCount);
+    }
+    
+    TPMultiProducerCircularBufferProduceAudioBufferList(buffer, bufferList, NULL);
+    
+    return true;
+}
+
 AudioBufferList *TPCircularBufferNextBufferListAfter(TPCircularBuffer *buffer, AudioBufferList *bufferList, AudioTimeStamp *outTimestamp) {
     int32_t availableBytes;
     void *tail = TPCircularBufferTail(buffer, &availableBytes);
@@ -156,7 +292,7 @@ AudioBufferList *TPCircularBufferNextBufferListAfter(TPCircularBuffer *buffer, A
         memcpy(outTimestamp, &nextBlock->timestamp, sizeof(AudioTimeStamp));
     }
     
-    return &nextBlock->bufferList;
+    return _TPCircularBufferBlockBufferList(nextBlock);
 }
 
 void TPCircularBufferConsumeNextBufferListPartial(TPCircularBuffer *buffer, int framesToConsume, const AudioStreamBasicDescription *audioFormat) {
@@ -177,9 +313,9 @@ void TPCircularBufferConsumeNextBufferListPartial(TPCircularBuffer *buffer, int
     for ( int i=0; i<block->bufferList.mNumberBuffers; i++ ) {
         assert(bytesToConsume <= block->bufferList.mBuffers[i].mDataByteSize);
         
-        block->bufferList.mBuffers[i].mData = (char*)block->bufferList.mBuffers[i].mData + bytesToConsume;
         block->bufferList.mBuffers[i].mDataByteSize -= bytesToConsume;
     }
+    block->dataOffset += bytesToConsume;
     
     if ( block->timestamp.mFlags & kAudioTimeStampSampleTimeValid ) {
         block->timestamp.mSampleTime += framesToConsume;
@@ -194,15 +330,94 @@ void TPCircularBufferConsumeNextBufferListPartial(TPCircularBuffer *buffer, int
         block->timestamp.mHostTime += ((double)framesToConsume / audioFormat->mSampleRate) * __secondsToHostTicks;
     }
     
+    block->audioBytePosition += bytesToConsume;
+    
     // Reposition block forward, just before the audio data, ensuring 16-byte alignment
     TPCircularBufferABLBlockHeader *newBlock = (TPCircularBufferABLBlockHeader*)(((unsigned long)block + bytesToConsume) & ~0xFul);
     memmove(newBlock, block, sizeof(TPCircularBufferABLBlockHeader) + (block->bufferList.mNumberBuffers-1)*sizeof(AudioBuffer));
     intptr_t bytesFreed = (intptr_t)newBlock - (intptr_t)block;
     newBlock->totalLength -= bytesFreed;
+    newBlock->dataOffset -= bytesFreed;
     TPCircularBufferConsume(buffer, (int32_t)bytesFreed);
 }
 
+static UInt32 _TPCircularBufferSkip(TPCircularBuffer *buffer, bool useSampleTime, Float64 targetSampleTime, UInt32 targetAudioBytePosition, const AudioStreamBasicDescription *audioFormat) {
+    int32_t dontcare;
+    TPCircularBufferABLBlockHeader *firstBlock = (TPCircularBufferABLBlockHeader*)TPCircularBufferTail(buffer, &dontcare);
+    if ( !firstBlock ) return 0;
+    assert(!((unsigned long)firstBlock & 0xF) /* Beware unaligned accesses */);
+    
+    UInt32 firstBlockNumber = firstBlock->blockNumber;
+    UInt32 startPosition = firstBlock->audioBytePosition;
+    
+    // The block count is published after each block, so it may not yet include the block at the tail
+    int32_t blockCount = (int32_t)(loadAudioBytes(buffer, &buffer->blocksProduced) - firstBlockNumber);
+    if ( blockCount < 1 ) blockCount = 1;
+    
+    // Binary search for the last block that starts at or before the target
+    int32_t low = 0;
+    int32_t high = blockCount - 1;
+    while ( low < high ) {
+        int32_t mid = low + (high - low + 1) / 2;
+        TPCircularBufferABLBlockHeader *block = (TPCircularBufferABLBlockHeader*)
+            _TPCircularBufferPointer(buffer, _TPCircularBufferBlockEnds(buffer)[(firstBlockNumber + mid - 1) % buffer->blockEndsCapacity]);
+        assert(!((unsigned long)block & 0xF) /* Beware unaligned accesses */);
+        
+        bool startsBeforeTarget = useSampleTime
+            ? block->timestamp.mSampleTime <= targetSampleTime
+            : (int32_t)(block->audioBytePosition - targetAudioBytePosition) <= 0;
+        if ( startsBeforeTarget ) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    
+    // Consume all the blocks before that one at once
+    if ( low > 0 ) {
+        int32_t end = _TPCircularBufferBlockEnds(buffer)[(firstBlockNumber + low - 1) % buffer->blockEndsCapacity];
+        TPCircularBufferConsume(buffer, _TPCircularBufferDistance(buffer, _TPCircularBufferConsumerTail(buffer), end));
+    }
+    
+    // Then consume the part of the block before the target
+    TPCircularBufferABLBlockHeader *block = (TPCircularBufferABLBlockHeader*)TPCircularBufferTail(buffer, &dontcare);
+    UInt32 blockPosition = block->audioBytePosition;
+    UInt32 blockBytes = block->bufferList.mBuffers[0].mDataByteSize;
+    UInt32 bytesToConsume;
+    if ( useSampleTime ) {
+        Float64 frames = targetSampleTime - block->timestamp.mSampleTime;
+        bytesToConsume = frames <= 0 ? 0 : (UInt32)min((long)frames * audioFormat->mBytesPerFrame, blockBytes);
+    } else {
+        int32_t bytes = (int32_t)(targetAudioBytePosition - blockPosition);
+        bytesToConsume = bytes <= 0 ? 0 : (UInt32)min(bytes, blockBytes);
+    }
+    
+    if ( bytesToConsume == blockBytes ) {
+        TPCircularBufferConsumeNextBufferList(buffer);
+    } else if ( bytesToConsume > 0 ) {
+        TPCircularBufferConsumeNextBufferListPartial(buffer, bytesToConsume / audioFormat->mBytesPerFrame, audioFormat);
+    }
+    
+    return (blockPosition + bytesToConsume - startPosition) / audioFormat->mBytesPerFrame;
+}
+
+UInt32 TPCircularBufferSeekToSampleTime(TPCircularBuffer *buffer, Float64 sampleTime, const AudioStreamBasicDescription *audioFormat) {
+    return _TPCircularBufferSkip(buffer, true, sampleTime, 0, audioFormat);
+}
+
 void TPCircularBufferDequeueBufferListFrames(TPCircularBuffer *buffer, UInt32 *ioLengthInFrames, AudioBufferList *outputBufferList, AudioTimeStamp *outTimestamp, const AudioStreamBasicDescription *audioFormat) {
+    if ( !outputBufferList ) {
+        // Discarding: skip straight to the target position, rather than consuming each buffer list in turn
+        AudioBufferList *bufferList = TPCircularBufferNextBufferList(buffer, outTimestamp);
+        if ( !bufferList ) {
+            *ioLengthInFrames = 0;
+            return;
+        }
+        TPCircularBufferABLBlockHeader *block = (TPCircularBufferABLBlockHeader*)((char*)bufferList - offsetof(TPCircularBufferABLBlockHeader, bufferList));
+        *ioLengthInFrames = _TPCircularBufferSkip(buffer, false, 0, block->audioBytePosition + (*ioLengthInFrames * audioFormat->mBytesPerFrame), audioFormat);
+        return;
+    }
+    
     bool hasTimestamp = false;
     UInt32 bytesToGo = *ioLengthInFrames * audioFormat->mBytesPerFrame;
     UInt32 bytesCopied = 0;
@@ -239,6 +454,14 @@ static UInt32 _TPCircularBufferPeek(TPCircularBuffer *buffer, AudioTimeStamp *ou
         memcpy(outTimestamp, &block->timestamp, sizeof(AudioTimeStamp));
     }
     
+    // Use the running count of queued audio, unless we need to look for discontinuities within the queue.
+    // The count is published just after each block, so it may not yet include the block at the tail.
+    int32_t queuedAudioBytes = (int32_t)(loadAudioBytes(buffer, &buffer->audioBytesProduced) - block->audioBytePosition);
+    if ( contiguousToleranceSampleTime == UINT32_MAX
+            || (int32_t)(loadAudioBytes(buffer, &buffer->audioBytesAtDiscontinuity) - block->audioBytePosition) <= 0 ) {
+        return (UInt32)max(queuedAudioBytes, block->bufferList.mBuffers[0].mDataByteSize) / audioFormat->mBytesPerFrame;
+    }
+    
     void *end = (char*)block + availableBytes;
     
     UInt32 byteCount = 0;
@@ -259,11 +482,15 @@ static UInt32 _TPCircularBufferPeek(TPCircularBuffer *buffer, AudioTimeStamp *ou
 }
 
 UInt32 TPCircularBufferPeek(TPCircularBuffer *buffer, AudioTimeStamp *outTimestamp, const AudioStreamBasicDescription *audioFormat) {
-    return _TPCircularBufferPeek(buffer, outTimestamp, audioFormat, UINT32_MAX);
+    UInt32 frames = _TPCircularBufferPeek(buffer, outTimestamp, audioFormat, UINT32_MAX);
+    _TPCircularBufferReleaseTail(buffer);
+    return frames;
 }
 
 UInt32 TPCircularBufferPeekContiguous(TPCircularBuffer *buffer, AudioTimeStamp *outTimestamp, const AudioStreamBasicDescription *audioFormat, UInt32 contiguousToleranceSampleTime) {
-    return _TPCircularBufferPeek(buffer, outTimestamp, audioFormat, contiguousToleranceSampleTime);
+    UInt32 frames = _TPCircularBufferPeek(buffer, outTimestamp, audioFormat, contiguousToleranceSampleTime);
+    _TPCircularBufferReleaseTail(buffer);
+    return frames;
 }
 
 UInt32 TPCircularBufferGetAvailableSpace(TPCircularBuffer *buffer, const AudioStreamBasicDescription *audioFormat) {
@@ -17,6 +17,9 @@
 //  adapted to Darwin by Kurt Revis (http://www.snoize.com,
 //  http://www.snoize.com/Code/PlayBufferedSoundFile.tar.gz)
 //
+//  On Darwin, the mirror is created with vm_allocate/vm_remap. On other POSIX systems, both halves
+//  are MAP_FIXED mappings of the same anonymous shared memory object (memfd_create on Linux).
+//
 //
 //  Copyright (C) 2012-2013 A Tasty Pixel
 //
@@ -42,21 +45,95 @@
 #ifndef TPCircularBuffer_h
 #define TPCircularBuffer_h
 
-#include <libkern/OSAtomic.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <assert.h>
 
+#ifdef __APPLE__
+#include <libkern/OSAtomic.h>
+#else
+static __inline__ __attribute__((always_inline)) int32_t OSAtomicAdd32Barrier(int32_t amount, volatile int32_t *value) {
+    return __sync_add_and_fetch(value, amount);
+}
+#endif
+
+#ifndef __deprecated_msg
+#define __deprecated_msg(msg) __attribute__((deprecated(msg)))
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
     
+/*!
+ * Cache line size used to keep the producer and consumer indices apart
+ */
+#define kTPCircularBufferCacheLineSize 64
+
+/*!
+ * Padding between fields written by different threads
+ *
+ *  A full cache line, so the fields either side never share one, however the containing
+ *  structure is aligned. Buffers are often embedded in malloc'd structures and Objective-C
+ *  objects, which are only 16-byte aligned, so the type itself isn't over-aligned.
+ */
+#define _TPCircularBufferCacheLinePadding(name) char name[kTPCircularBufferCacheLineSize]
+
+/*!
+ * Lower bound on the length of a block queued by the AudioBufferList utilities, used to size the block index
+ */
+#define kTPCircularBufferMinimumBlockLength 64
+
+/*!
+ * Flag set in the tail index while the consumer has claimed the queued data, in overwrite-oldest mode
+ */
+#define kTPCircularBufferTailClaimed 0x40000000
+
+/*!
+ * Circular buffer
+ *
+ *  The head and tail are byte positions in the range [0, 2*length), so that a full
+ *  buffer can be told apart from an empty one without a shared fill count. The
+ *  consumer owns the tail and the producer owns the head; each is padded onto its own
+ *  cache line, alongside that side's last-seen copy of the other side's index.
+ *
+ *  The audioBytes and block fields are only used by TPCircularBuffer+AudioBufferList, which
+ *  keeps a running count of queued audio so that frame counts can be found without walking
+ *  the queue, and an index of where each queued block ends so the queue can be searched.
+ *
+ *  The buffer memory and block index are located relative to the structure itself, so
+ *  that a buffer in shared memory can be used from processes that map it at different
+ *  addresses. Consequently, the structure must not be moved or copied once initialised.
+ */
 typedef struct {
-    void             *buffer;
+    intptr_t          bufferOffset;
     int32_t           length;
-    int32_t           tail;
-    int32_t           head;
-    volatile int32_t  fillCount;
     bool              atomic;
+    bool              overwriteOldest;
+    intptr_t          blockEndsOffset;
+    uint32_t          blockEndsCapacity;
+    uint32_t          sharedHeaderLength;
+    volatile uint32_t sharedMagic;
+    _TPCircularBufferCacheLinePadding(_padding0);
+    
+    // Consumer side
+    volatile int32_t  tail;
+    int32_t           cachedHead;
+    _TPCircularBufferCacheLinePadding(_padding1);
+    
+    // Producer side
+    volatile int32_t  head;
+    int32_t           cachedTail;
+    
+    // Producer side frame index, maintained by the AudioBufferList utilities
+    volatile uint32_t audioBytesProduced;
+    volatile uint32_t audioBytesAtDiscontinuity;
+    uint32_t          audioBytesPerFrame;
+    double            nextSampleTime;
+    volatile uint32_t blocksProduced;
+    volatile uint32_t overruns;
+    _TPCircularBufferCacheLinePadding(_padding2);
 } TPCircularBuffer;
 
 /*!
@@ -80,6 +157,55 @@ bool _TPCircularBufferInit(TPCircularBuffer *buffer, int32_t length, size_t stru
  */
 void  TPCircularBufferCleanup(TPCircularBuffer *buffer);
 
+/*!
+ * Create a buffer in named shared memory
+ *
+ *  Creates a buffer, including its indices and the AudioBufferList block index, in a
+ *  POSIX shared memory object that other processes can attach to with
+ *  TPCircularBufferOpenShared. One process should produce and one consume; data
+ *  moves between them without system calls, so latency is just the queued audio.
+ *
+ *  Any existing object with the same name is replaced; processes still attached to
+ *  it keep the old buffer, and should close it and open the new one.
+ *
+ *  Both processes must be built with the same version of TPCircularBuffer. Shared
+ *  memory across apps is not available within the iOS sandbox.
+ *
+ * @param name Shared memory object name: a short string beginning with a slash, such as "/myapp.audio"
+ * @param length Length of buffer, rounded up to a whole number of pages
+ * @return The buffer, or NULL on error. Release with TPCircularBufferCloseShared.
+ */
+TPCircularBuffer *TPCircularBufferCreateShared(const char *name, int32_t length);
+
+/*!
+ * Attach to a buffer in named shared memory
+ *
+ * @param name Name passed to TPCircularBufferCreateShared in the other process
+ * @return The buffer, or NULL if it doesn't exist or hasn't finished being created yet. Release with TPCircularBufferCloseShared.
+ */
+TPCircularBuffer *TPCircularBufferOpenShared(const char *name);
+
+/*!
+ * Detach from a buffer in shared memory
+ *
+ *  Unmaps the buffer from this process. The shared memory object itself persists until
+ *  it's removed with TPCircularBufferUnlinkShared and every process has closed it.
+ *
+ * @param buffer Buffer returned from TPCircularBufferCreateShared or TPCircularBufferOpenShared
+ */
+void  TPCircularBufferCloseShared(TPCircularBuffer *buffer);
+
+/*!
+ * Remove a named shared memory buffer
+ *
+ *  Removes the name, so no more processes can attach. Processes that are attached
+ *  can carry on using the buffer until they close it.
+ *
+ * @param name Name passed to TPCircularBufferCreateShared
+ * @return true on success; false if there's no such object
+ */
+bool  TPCircularBufferUnlinkShared(const char *name);
+
 /*!
  * Clear buffer
  *
@@ -106,6 +232,91 @@ void  TPCircularBufferClear(TPCircularBuffer *buffer);
  */
 void  TPCircularBufferSetAtomic(TPCircularBuffer *buffer, bool atomic);
 
+/*!
+ * Set the overflow policy
+ *
+ *  By default, when the buffer is full, new data is refused and the oldest data
+ *  is kept. With overwrite-oldest enabled, TPCircularBufferCopyAudioBufferList instead
+ *  makes room by discarding the oldest whole queued buffer lists, so the newest audio
+ *  is kept. This suits metering and monitoring taps, where stale audio is useless.
+ *
+ *  In this mode, TPCircularBufferTail claims the queued data for the consumer until
+ *  the next TPCircularBufferConsume, so the producer can't discard data that's being
+ *  read. If the buffer is full while data is claimed, the new audio is dropped instead.
+ *  Finding the buffer empty releases the claim, so a consumer that drains the buffer
+ *  and then stalls doesn't stop the producer discarding old audio.
+ *  The TPCircularBuffer+AudioBufferList consumer functions take care of this.
+ *
+ *  Set this before the buffer is in use. Not supported with TPMultiProducerCircularBuffer.
+ *
+ * @param buffer Circular buffer
+ * @param overwriteOldest Whether to discard the oldest data when full (default false)
+ */
+void  TPCircularBufferSetOverwriteOldest(TPCircularBuffer *buffer, bool overwriteOldest);
+
+/*!
+ * Get the number of overruns
+ *
+ *  In overwrite-oldest mode, this counts the buffer lists that were discarded to make room,
+ *  plus those that were dropped because the queued data was claimed by the consumer.
+ *  The count only ever increases; compare successive values to find recent overruns.
+ *
+ *  This may be called from any thread.
+ *
+ * @param buffer Circular buffer
+ * @return The number of buffer lists lost to overruns since the buffer was initialised
+ */
+uint32_t TPCircularBufferGetOverrunCount(TPCircularBuffer *buffer);
+
+int32_t _TPCircularBufferClaimTail(TPCircularBuffer *buffer);
+void _TPCircularBufferReleaseTail(TPCircularBuffer *buffer);
+void _TPCircularBufferConsumeClaimed(TPCircularBuffer *buffer, int32_t amount);
+
+// Internal helpers
+
+static __inline__ __attribute__((always_inline)) int32_t _TPCircularBufferLoadIndex(TPCircularBuffer *buffer, volatile int32_t *index) {
+    return buffer->atomic ? __atomic_load_n(index, __ATOMIC_ACQUIRE) : *index;
+}
+
+static __inline__ __attribute__((always_inline)) void _TPCircularBufferStoreIndex(TPCircularBuffer *buffer, volatile int32_t *index, int32_t value) {
+    if ( buffer->atomic ) {
+        __atomic_store_n(index, value, __ATOMIC_RELEASE);
+    } else {
+        *index = value;
+    }
+}
+
+static __inline__ __attribute__((always_inline)) int32_t _TPCircularBufferAdvanceIndex(TPCircularBuffer *buffer, int32_t index, int32_t amount) {
+    index += amount;
+    return index >= buffer->length * 2 ? index - buffer->length * 2 : index;
+}
+
+static __inline__ __attribute__((always_inline)) int32_t _TPCircularBufferDistance(TPCircularBuffer *buffer, int32_t from, int32_t to) {
+    int32_t distance = to - from;
+    return distance < 0 ? distance + buffer->length * 2 : distance;
+}
+
+static __inline__ __attribute__((always_inline)) void* _TPCircularBufferPointer(TPCircularBuffer *buffer, int32_t index) {
+    return (void*)((uintptr_t)buffer + buffer->bufferOffset + (index >= buffer->length ? index - buffer->length : index));
+}
+
+static __inline__ __attribute__((always_inline)) int32_t* _TPCircularBufferBlockEnds(TPCircularBuffer *buffer) {
+    return (int32_t*)((uintptr_t)buffer + buffer->blockEndsOffset);
+}
+
+static __inline__ __attribute__((always_inline)) int32_t _TPCircularBufferConsumerTail(TPCircularBuffer *buffer) {
+    return buffer->overwriteOldest ? _TPCircularBufferClaimTail(buffer) : buffer->tail;
+}
+
+static __inline__ __attribute__((always_inline)) void _TPCircularBufferConsumerFoundEmpty(TPCircularBuffer *buffer) {
+    // Nothing to read, so there's nothing for the consumer to hold on to
+    if ( buffer->overwriteOldest ) _TPCircularBufferReleaseTail(buffer);
+}
+
+static __inline__ __attribute__((always_inline)) int32_t _TPCircularBufferProducerTail(TPCircularBuffer *buffer) {
+    return _TPCircularBufferLoadIndex(buffer, &buffer->tail) & ~kTPCircularBufferTailClaimed;
+}
+
 // Reading (consuming)
 
 /*!
@@ -119,9 +330,14 @@ void  TPCircularBufferSetAtomic(TPCircularBuffer *buffer, bool atomic);
  * @return Pointer to the first bytes ready for reading, or NULL if buffer is empty
  */
 static __inline__ __attribute__((always_inline)) void* TPCircularBufferTail(TPCircularBuffer *buffer, int32_t* availableBytes) {
-    *availableBytes = buffer->fillCount;
-    if ( *availableBytes == 0 ) return NULL;
-    return (void*)((char*)buffer->buffer + buffer->tail);
+    int32_t tail = _TPCircularBufferConsumerTail(buffer);
+    buffer->cachedHead = _TPCircularBufferLoadIndex(buffer, &buffer->head);
+    *availableBytes = _TPCircularBufferDistance(buffer, tail, buffer->cachedHead);
+    if ( *availableBytes == 0 ) {
+        _TPCircularBufferConsumerFoundEmpty(buffer);
+        return NULL;
+    }
+    return _TPCircularBufferPointer(buffer, tail);
 }
 
 /*!
@@ -133,13 +349,39 @@ static __inline__ __attribute__((always_inline)) void* TPCircularBufferTail(TPCi
  * @param amount Number of bytes to consume
  */
 static __inline__ __attribute__((always_inline)) void TPCircularBufferConsume(TPCircularBuffer *buffer, int32_t amount) {
-    buffer->tail = (buffer->tail + amount) % buffer->length;
-    if ( buffer->atomic ) {
-        OSAtomicAdd32Barrier(-amount, &buffer->fillCount);
-    } else {
-        buffer->fillCount -= amount;
+    if ( buffer->overwriteOldest ) {
+        _TPCircularBufferConsumeClaimed(buffer, amount);
+        return;
     }
-    assert(buffer->fillCount >= 0);
+    assert(amount >= 0 && amount <= _TPCircularBufferDistance(buffer, buffer->tail, _TPCircularBufferLoadIndex(buffer, &buffer->head)));
+    _TPCircularBufferStoreIndex(buffer, &buffer->tail, _TPCircularBufferAdvanceIndex(buffer, buffer->tail, amount));
+}
+
+/*!
+ * Access a record within a batch being read
+ *
+ *  Use this to read several records from the buffer, then release them all at once
+ *  with a single call to TPCircularBufferConsume, passing the total batch length.
+ *  The producer's index is only re-read when the last-seen copy doesn't show enough
+ *  bytes, so walking a batch normally touches only the consumer's own cache line.
+ *
+ * @param buffer Circular buffer
+ * @param batchBytes Number of bytes already read in this batch, but not yet consumed
+ * @param requiredBytes Number of bytes needed at the returned address
+ * @return Pointer to the record following the first batchBytes bytes, or NULL if fewer than requiredBytes are available there
+ */
+static __inline__ __attribute__((always_inline)) void* TPCircularBufferBatchTail(TPCircularBuffer *buffer, int32_t batchBytes, int32_t requiredBytes) {
+    int32_t tail = _TPCircularBufferConsumerTail(buffer);
+    int32_t available = _TPCircularBufferDistance(buffer, tail, buffer->cachedHead) - batchBytes;
+    if ( available < requiredBytes || available <= 0 ) {
+        buffer->cachedHead = _TPCircularBufferLoadIndex(buffer, &buffer->head);
+        available = _TPCircularBufferDistance(buffer, tail, buffer->cachedHead) - batchBytes;
+        if ( available < requiredBytes || available <= 0 ) {
+            if ( batchBytes == 0 ) _TPCircularBufferConsumerFoundEmpty(buffer);
+            return NULL;
+        }
+    }
+    return _TPCircularBufferPointer(buffer, _TPCircularBufferAdvanceIndex(buffer, tail, batchBytes));
 }
 
 /*!
@@ -153,9 +395,10 @@ static __inline__ __attribute__((always_inline)) void TPCircularBufferConsume(TP
  * @return Pointer to the first bytes ready for writing, or NULL if buffer is full
  */
 static __inline__ __attribute__((always_inline)) void* TPCircularBufferHead(TPCircularBuffer *buffer, int32_t* availableBytes) {
-    *availableBytes = (buffer->length - buffer->fillCount);
+    buffer->cachedTail = _TPCircularBufferProducerTail(buffer);
+    *availableBytes = buffer->length - _TPCircularBufferDistance(buffer, buffer->cachedTail, buffer->head);
     if ( *availableBytes == 0 ) return NULL;
-    return (void*)((char*)buffer->buffer + buffer->head);
+    return _TPCircularBufferPointer(buffer, buffer->head);
 }
     
 // Writing (producing)
@@ -169,13 +412,8 @@ static __inline__ __attribute__((always_inline)) void* TPCircularBufferHead(TPCi
  * @param amount Number of bytes to produce
  */
 static __inline__ __attribute__((always_inline)) void TPCircularBufferProduce(TPCircularBuffer *buffer, int32_t amount) {
-    buffer->head = (buffer->head + amount) % buffer->length;
-    if ( buffer->atomic ) {
-        OSAtomicAdd32Barrier(amount, &buffer->fillCount);
-    } else {
-        buffer->fillCount += amount;
-    }
-    assert(buffer->fillCount <= buffer->length);
+    assert(amount >= 0 && _TPCircularBufferDistance(buffer, _TPCircularBufferProducerTail(buffer), buffer->head) + amount <= buffer->length);
+    _TPCircularBufferStoreIndex(buffer, &buffer->head, _TPCircularBufferAdvanceIndex(buffer, buffer->head, amount));
 }
 
 /*!
@@ -197,14 +435,56 @@ static __inline__ __attribute__((always_inline)) bool TPCircularBufferProduceByt
     return true;
 }
 
+/*!
+ * Access space for a record within a batch being written
+ *
+ *  Use this to write several records to the buffer, then publish them all at once
+ *  with a single call to TPCircularBufferProduce, passing the total batch length.
+ *  The consumer's index is only re-read when the last-seen copy doesn't show enough
+ *  space, so filling a batch normally touches only the producer's own cache line.
+ *
+ * @param buffer Circular buffer
+ * @param batchBytes Number of bytes already written in this batch, but not yet produced
+ * @param requiredBytes Number of bytes needed at the returned address
+ * @return Pointer to the space following the first batchBytes bytes, or NULL if there's less than requiredBytes space
+ */
+static __inline__ __attribute__((always_inline)) void* TPCircularBufferBatchHead(TPCircularBuffer *buffer, int32_t batchBytes, int32_t requiredBytes) {
+    int32_t space = buffer->length - _TPCircularBufferDistance(buffer, buffer->cachedTail, buffer->head) - batchBytes;
+    if ( space < requiredBytes || space <= 0 ) {
+        buffer->cachedTail = _TPCircularBufferProducerTail(buffer);
+        space = buffer->length - _TPCircularBufferDistance(buffer, buffer->cachedTail, buffer->head) - batchBytes;
+        if ( space < requiredBytes || space <= 0 ) return NULL;
+    }
+    return _TPCircularBufferPointer(buffer, _TPCircularBufferAdvanceIndex(buffer, buffer->head, batchBytes));
+}
+
+/*!
+ * Helper routine to copy bytes into a batch being written
+ *
+ *  This copies the given bytes after the bytes already in the batch, without
+ *  publishing them. Call TPCircularBufferProduce with the final batch length
+ *  to make the whole batch visible to the consumer at once.
+ *
+ * @param buffer Circular buffer
+ * @param src Source buffer
+ * @param len Number of bytes in source buffer
+ * @param ioBatchBytes On input, the number of bytes already in the batch; on output, incremented by len if the bytes were copied
+ * @return true if bytes copied, false if there was insufficient space
+ */
+static __inline__ __attribute__((always_inline)) bool TPCircularBufferBatchProduceBytes(TPCircularBuffer *buffer, const void* src, int32_t len, int32_t *ioBatchBytes) {
+    void *ptr = TPCircularBufferBatchHead(buffer, *ioBatchBytes, len);
+    if ( !ptr ) return false;
+    memcpy(ptr, src, len);
+    *ioBatchBytes += len;
+    return true;
+}
+
 /*!
  * Deprecated method
  */
 static __inline__ __attribute__((always_inline)) __deprecated_msg("use TPCircularBufferSetAtomic(false) and TPCircularBufferConsume instead")
 void TPCircularBufferConsumeNoBarrier(TPCircularBuffer *buffer, int32_t amount) {
-    buffer->tail = (buffer->tail + amount) % buffer->length;
-    buffer->fillCount -= amount;
-    assert(buffer->fillCount >= 0);
+    buffer->tail = _TPCircularBufferAdvanceIndex(buffer, buffer->tail, amount);
 }
 
 /*!
@@ -212,9 +492,7 @@ void TPCircularBufferConsumeNoBarrier(TPCircularBuffer *buffer, int32_t amount)
  */
 static __inline__ __attribute__((always_inline)) __deprecated_msg("use TPCircularBufferSetAtomic(false) and TPCircularBufferProduce instead")
 void TPCircularBufferProduceNoBarrier(TPCircularBuffer *buffer, int32_t amount) {
-    buffer->head = (buffer->head + amount) % buffer->length;
-    buffer->fillCount += amount;
-    assert(buffer->fillCount <= buffer->length);
+    buffer->head = _TPCircularBufferAdvanceIndex(buffer, buffer->head, amount);
 }
 
 #ifdef __cplusplus
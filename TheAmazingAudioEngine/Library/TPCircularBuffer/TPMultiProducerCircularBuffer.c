@@ -0,0 +1,117 @@
+//
+//  TPMultiProducerCircularBuffer.c
+//  Circular/Ring buffer implementation
+//
+//  https://github.com/michaeltyson/TPCircularBuffer
+//
+//  Copyright (C) 2012-2013 A Tasty Pixel
+//
+//  This software is provided 'as-is', without any express or implied
+//  warranty.  In no event will the authors be held liable for any damages
+//  arising from the use of this software.
+//
+//  Permission is granted to anyone to use this software for any purpose,
+//  including commercial applications, and to alter it and redistribute it
+//  freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//     misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "TPMultiProducerCircularBuffer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+
+static const int kSpinsBeforeYield = 64;
+
+bool _TPMultiProducerCircularBufferInit(TPMultiProducerCircularBuffer *buffer, int32_t length, size_t structSize) {
+    if ( structSize != sizeof(TPMultiProducerCircularBuffer) ) {
+        fprintf(stderr, "TPMultiProducerCircularBuffer: Header version mismatch. Check for old versions of TPCircularBuffer in your project\n");
+        abort();
+    }
+    
+    if ( !TPCircularBufferInit(&buffer->buffer, length) ) {
+        return false;
+    }
+    
+    buffer->reservation = 0;
+    return true;
+}
+
+void TPMultiProducerCircularBufferCleanup(TPMultiProducerCircularBuffer *buffer) {
+    TPCircularBufferCleanup(&buffer->buffer);
+    buffer->reservation = 0;
+}
+
+static void giveWayToStalledReservations(TPMultiProducerCircularBuffer *buffer, uint64_t reservation) {
+    // If reservations made earlier aren't committed promptly, their producers have probably been
+    // preempted. Joining the queue behind them would leave us waiting at commit, then reserving
+    // behind them again: with more producers than cores, every commit would cost a context switch.
+    // Instead, yield once before reserving, so they can finish and the queue can drain.
+    TPCircularBuffer *ring = &buffer->buffer;
+    int32_t target = (int32_t)(uint32_t)reservation;
+    int32_t outstanding = _TPCircularBufferDistance(ring, __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE), target);
+    for ( int spins = 0; outstanding != 0; spins++ ) {
+        int32_t remaining = _TPCircularBufferDistance(ring, __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE), target);
+        if ( remaining == 0 || remaining > outstanding /* committed past it */ ) return;
+        if ( spins >= kSpinsBeforeYield ) {
+            sched_yield();
+            return;
+        }
+    }
+}
+
+void *TPMultiProducerCircularBufferReserve(TPMultiProducerCircularBuffer *buffer, int32_t length) {
+    TPCircularBuffer *ring = &buffer->buffer;
+    assert(length > 0 && length <= ring->length);
+    
+    giveWayToStalledReservations(buffer, __atomic_load_n(&buffer->reservation, __ATOMIC_ACQUIRE));
+    
+    uint64_t reservation = __atomic_load_n(&buffer->reservation, __ATOMIC_ACQUIRE);
+    while ( 1 ) {
+        int32_t index = (int32_t)(uint32_t)reservation;
+        int32_t tail = _TPCircularBufferProducerTail(ring);
+        if ( ring->length - _TPCircularBufferDistance(ring, tail, index) < length ) {
+            return NULL;
+        }
+        
+        // Bump the generation along with the index, so a stale reservation can never be mistaken for a current one
+        uint64_t nextReservation = (((reservation >> 32) + 1) << 32) | (uint32_t)_TPCircularBufferAdvanceIndex(ring, index, length);
+        if ( __atomic_compare_exchange_n(&buffer->reservation, &reservation, nextReservation, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ) {
+            return _TPCircularBufferPointer(ring, index);
+        }
+    }
+}
+
+void _TPMultiProducerCircularBufferAwaitTurn(TPMultiProducerCircularBuffer *buffer, void *reservedSpace) {
+    // Outstanding reservations never span the whole buffer, so comparing addresses is unambiguous
+    TPCircularBuffer *ring = &buffer->buffer;
+    int spins = 0;
+    while ( _TPCircularBufferPointer(ring, __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) != reservedSpace ) {
+        if ( ++spins >= kSpinsBeforeYield ) {
+            sched_yield();
+            spins = 0;
+        }
+    }
+}
+
+void TPMultiProducerCircularBufferCommit(TPMultiProducerCircularBuffer *buffer, void *reservedSpace, int32_t length) {
+    _TPMultiProducerCircularBufferAwaitTurn(buffer, reservedSpace);
+    TPCircularBufferProduce(&buffer->buffer, length);
+}
+
+bool TPMultiProducerCircularBufferProduceBytes(TPMultiProducerCircularBuffer *buffer, const void* src, int32_t len) {
+    void *ptr = TPMultiProducerCircularBufferReserve(buffer, len);
+    if ( !ptr ) return false;
+    memcpy(ptr, src, len);
+    TPMultiProducerCircularBufferCommit(buffer, ptr, len);
+    return true;
+}
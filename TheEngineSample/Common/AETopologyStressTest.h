@@ -0,0 +1,57 @@
+//
+//  AETopologyStressTest.h
+//  TheEngineSample
+//
+
+#import <Foundation/Foundation.h>
+#import "TheAmazingAudioEngine.h"
+
+/*!
+ * Topology stress test
+ *
+ *  Adds and removes channels at a steady rate while the audio controller renders, and counts
+ *  the glitches that result: render cycles that ran over budget, and xruns, as reported by
+ *  the audio controller's render load statistics. Runs in its own channel group, which it
+ *  removes when stopped.
+ *
+ *  Enable the audio controller's native group mixing to exercise lock-free topology updates.
+ */
+@interface AETopologyStressTest : NSObject
+
+/*!
+ * Initialise
+ *
+ * @param audioController The audio controller to add channels to
+ */
+- (id)initWithAudioController:(AEAudioController*)audioController;
+
+/*!
+ * Start adding and removing channels
+ */
+- (void)start;
+
+/*!
+ * Stop, and remove all the test's channels
+ */
+- (void)stop;
+
+/*!
+ * Channels added, and removed, per second
+ *
+ *  Default is 100.
+ */
+@property (nonatomic, assign) int changesPerSecond;
+
+/*!
+ * Block called once a second while running, on the main thread
+ */
+@property (nonatomic, copy) void (^progressBlock)(AETopologyStressTest *test);
+
+@property (nonatomic, readonly) BOOL running;
+@property (nonatomic, readonly) NSUInteger channelsAdded;       //!< Since start
+@property (nonatomic, readonly) NSUInteger channelsRemoved;     //!< Since start
+@property (nonatomic, readonly) NSUInteger overBudgetCycles;    //!< Render cycles that took longer than the buffer duration, since start
+@property (nonatomic, readonly) NSUInteger xruns;               //!< Discontinuities in the output, since start
+@property (nonatomic, readonly) NSUInteger glitches;            //!< Over-budget cycles plus xruns
+@property (nonatomic, readonly) double maximumLoad;             //!< Highest render load seen, as a fraction of the buffer duration
+@end
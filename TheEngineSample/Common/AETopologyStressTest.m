@@ -0,0 +1,135 @@
+//
+//  AETopologyStressTest.m
+//  TheEngineSample
+//
+
+#import "AETopologyStressTest.h"
+
+static const int kLiveChannels = 50;
+static const NSTimeInterval kReportInterval = 1.0;
+
+@interface AETopologyStressTest () {
+    AEChannelGroupRef _group;
+    int _ticks;
+}
+@property (nonatomic, weak) AEAudioController *audioController;
+@property (nonatomic, strong) NSMutableArray *channels;
+@property (nonatomic, weak) NSTimer *timer;
+@property (nonatomic, readwrite) BOOL running;
+@property (nonatomic, readwrite) NSUInteger channelsAdded;
+@property (nonatomic, readwrite) NSUInteger channelsRemoved;
+@property (nonatomic, readwrite) NSUInteger overBudgetCycles;
+@property (nonatomic, readwrite) NSUInteger xruns;
+@property (nonatomic, readwrite) double maximumLoad;
+@end
+
+@implementation AETopologyStressTest
+
+- (id)initWithAudioController:(AEAudioController*)audioController {
+    if ( !(self = [super init]) ) return nil;
+    self.audioController = audioController;
+    self.changesPerSecond = 100;
+    return self;
+}
+
+- (void)dealloc {
+    [self stop];
+}
+
+- (void)start {
+    if ( _running ) return;
+    
+    self.channels = [NSMutableArray array];
+    self.channelsAdded = self.channelsRemoved = self.overBudgetCycles = self.xruns = 0;
+    self.maximumLoad = 0.0;
+    _ticks = 0;
+    
+    _group = [_audioController createChannelGroup];
+    [_audioController setVolume:0.5 forChannelGroup:_group];
+    
+    // Fill up to the working set in one go, then change one channel at a time
+    NSMutableArray *initialChannels = [NSMutableArray array];
+    for ( int i=0; i<kLiveChannels; i++ ) {
+        [initialChannels addObject:[self createChannel]];
+    }
+    [_audioController addChannels:initialChannels toChannelGroup:_group];
+    [_channels addObjectsFromArray:initialChannels];
+    
+    // Discard the statistics gathered so far, so we only count what happens from here
+    [_audioController renderLoadStatistics];
+    
+    self.running = YES;
+    self.timer = [NSTimer scheduledTimerWithTimeInterval:1.0 / _changesPerSecond target:self selector:@selector(tick:) userInfo:nil repeats:YES];
+}
+
+- (void)stop {
+    if ( !_running ) return;
+    
+    [_timer invalidate];
+    [self collectStatistics];
+    
+    [_audioController removeChannels:_channels fromChannelGroup:_group];
+    [_audioController removeChannelGroup:_group];
+    _group = NULL;
+    self.channels = nil;
+    self.running = NO;
+    
+    NSLog(@"Topology stress test: %lu channels added and %lu removed, %lu glitches (%lu over-budget cycles, %lu xruns), maximum load %.0f%%",
+          (unsigned long)_channelsAdded, (unsigned long)_channelsRemoved, (unsigned long)self.glitches,
+          (unsigned long)_overBudgetCycles, (unsigned long)_xruns, _maximumLoad * 100.0);
+}
+
+- (NSUInteger)glitches {
+    return _overBudgetCycles + _xruns;
+}
+
+- (AEBlockChannel*)createChannel {
+    // A quiet tone, at a different pitch for each channel
+    __block float position = 0;
+    float rate = (220.0 + 20.0 * (_channelsAdded % 40)) / _audioController.audioDescription.mSampleRate;
+    AEBlockChannel *channel = [AEBlockChannel channelWithBlock:^(const AudioTimeStamp *time, UInt32 frames, AudioBufferList *audio) {
+        for ( int i=0; i<frames; i++ ) {
+            // Quick sin-esque oscillator
+            float x = position;
+            x *= x; x -= 1.0; x *= x;       // x now in the range 0...1
+            x -= 0.5;
+            position += rate;
+            if ( position > 1.0 ) position -= 2.0;
+            
+            ((float*)audio->mBuffers[0].mData)[i] = x;
+            ((float*)audio->mBuffers[1].mData)[i] = x;
+        }
+    }];
+    // Floating-point, so the engine's own mixer takes it without conversion
+    channel.audioDescription = AEAudioStreamBasicDescriptionNonInterleavedFloatStereo;
+    channel.volume = 1.0 / kLiveChannels;
+    _channelsAdded++;
+    return channel;
+}
+
+- (void)tick:(NSTimer*)timer {
+    // Add a new channel and remove the oldest, so both happen changesPerSecond times a second
+    AEBlockChannel *channel = [self createChannel];
+    [_audioController addChannels:@[channel] toChannelGroup:_group];
+    [_channels addObject:channel];
+    
+    id oldest = _channels[0];
+    [_audioController removeChannels:@[oldest] fromChannelGroup:_group];
+    [_channels removeObjectAtIndex:0];
+    _channelsRemoved++;
+    
+    if ( ++_ticks >= _changesPerSecond * kReportInterval ) {
+        _ticks = 0;
+        [self collectStatistics];
+        if ( _progressBlock ) _progressBlock(self);
+    }
+}
+
+- (void)collectStatistics {
+    AERenderLoadStatistics statistics = [_audioController renderLoadStatistics];
+    self.overBudgetCycles += statistics.overBudgetCount;
+    self.xruns += statistics.xrunCount;
+    self.maximumLoad = MAX(_maximumLoad, statistics.maximumLoad);
+}
+
+@end
@@ -14,6 +14,7 @@
 #import "AELimiterFilter.h"
 #import "AERecorder.h"
 #import "AEReverbFilter.h"
+#import "AETopologyStressTest.h"
 #import <QuartzCore/QuartzCore.h>
 
 static const int kInputChannelsChangedContext;
@@ -31,6 +32,7 @@ static const int kInputChannelsChangedContext;
 @property (nonatomic, strong) AELimiterFilter *limiter;
 @property (nonatomic, strong) AEExpanderFilter *expander;
 @property (nonatomic, strong) AEReverbFilter *reverb;
+@property (nonatomic, strong) AETopologyStressTest *stressTest;
 @property (nonatomic, strong) TPOscilloscopeLayer *outputOscilloscope;
 @property (nonatomic, strong) TPOscilloscopeLayer *inputOscilloscope;
 @property (nonatomic, strong) CALayer *inputLevelLayer;
@@ -83,6 +85,11 @@ static const int kInputChannelsChangedContext;
         
         [_audioController removeChannels:channelsToRemove];
         
+        if ( _stressTest ) {
+            [_stressTest stop];
+            self.stressTest = nil;
+        }
+        
         if ( _limiter ) {
             [_audioController removeFilter:_limiter];
             self.limiter = nil;
@@ -234,7 +241,7 @@ static const int kInputChannelsChangedContext;
 }
 
 -(NSInteger)numberOfSectionsInTableView:(UITableView *)tableView {
-    return 4;
+    return 5;
 }
 
 -(NSInteger)tableView:(UITableView *)tableView numberOfRowsInSection:(NSInteger)section {
@@ -251,6 +258,9 @@ static const int kInputChannelsChangedContext;
         case 3:
             return 4 + (_audioController.numberOfInputChannels > 1 ? 1 : 0);
             
+        case 4:
+            return 1;
+            
         default:
             return 0;
     }
@@ -454,6 +464,13 @@ static const int kInputChannelsChangedContext;
             }
             break;
         }
+        case 4: {
+            cell.accessoryView = [[UISwitch alloc] initWithFrame:CGRectZero];
+            cell.textLabel.text = [self stressTestDescription];
+            ((UISwitch*)cell.accessoryView).on = _stressTest.running;
+            [((UISwitch*)cell.accessoryView) addTarget:self action:@selector(stressTestSwitchChanged:) forControlEvents:UIControlEventValueChanged];
+            break;
+        }
             
     }
     
@@ -573,6 +590,27 @@ static const int kInputChannelsChangedContext;
     }
 }
 
+- (void)stressTestSwitchChanged:(UISwitch*)sender {
+    if ( sender.isOn ) {
+        self.stressTest = [[AETopologyStressTest alloc] initWithAudioController:_audioController];
+        __weak ViewController *weakSelf = self;
+        _stressTest.progressBlock = ^(AETopologyStressTest *test) {
+            NSIndexPath *indexPath = [NSIndexPath indexPathForRow:0 inSection:4];
+            [weakSelf.tableView cellForRowAtIndexPath:indexPath].textLabel.text = [weakSelf stressTestDescription];
+        };
+        [_stressTest start];
+    } else {
+        [_stressTest stop];
+    }
+    [self.tableView cellForRowAtIndexPath:[NSIndexPath indexPathForRow:0 inSection:4]].textLabel.text = [self stressTestDescription];
+}
+
+- (NSString*)stressTestDescription {
+    if ( !_stressTest ) return @"Topology Stress Test";
+    return [NSString stringWithFormat:@"Stress: %lu glitches, peak load %d%%",
+            (unsigned long)_stressTest.glitches, (int)round(_stressTest.maximumLoad * 100.0)];
+}
+
 - (void)measurementModeSwitchChanged:(UISwitch*)sender {
     _audioController.useMeasurementMode = sender.on;
 }